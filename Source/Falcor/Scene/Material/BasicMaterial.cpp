@@ -611,6 +611,39 @@ namespace Falcor
         return true;
     }
 
+    uint64_t BasicMaterial::computeHash() const
+    {
+        FNVHash64 hash;
+        insertBaseHash(hash);
+
+        // Hash the fields compared by operator==(). Zeros are normalized since -0 compares equal to +0.
+        auto insertFloat = [&hash](float value)
+        {
+            if (value == 0.f) value = 0.f;
+            hash.insert(&value, sizeof(value));
+        };
+
+#define hash_field(_a) insertFloat(float(mData._a))
+#define hash_vec_field(_a) for (int i = 0; i < mData._a.length(); i++) insertFloat(float(mData._a[i]))
+        hash.insert(&mData.flags, sizeof(mData.flags));
+        hash_field(displacementScale);
+        hash_field(displacementOffset);
+        hash_vec_field(baseColor);
+        hash_vec_field(specular);
+        hash_vec_field(emissive);
+        hash_field(emissiveFactor);
+        hash_field(diffuseTransmission);
+        hash_field(specularTransmission);
+        hash_vec_field(transmission);
+        hash_vec_field(volumeAbsorption);
+        hash_field(volumeAnisotropy);
+        hash_vec_field(volumeScattering);
+#undef hash_field
+#undef hash_vec_field
+
+        return hash.get();
+    }
+
     void BasicMaterial::updateAlphaMode()
     {
         if (!isAlphaSupported())
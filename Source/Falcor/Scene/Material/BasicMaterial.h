@@ -66,6 +66,11 @@ namespace Falcor
         */
         bool isEqual(const ref<Material>& pOther) const override;
 
+        /** Compute a hash of the material properties.
+            \return Hash of the material properties, identical for materials that compare equal.
+        */
+        uint64_t computeHash() const override;
+
         /** Set the alpha mode.
         */
         void setAlphaMode(AlphaMode alphaMode) override;
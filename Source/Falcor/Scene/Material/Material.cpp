@@ -328,6 +328,30 @@ namespace Falcor
         return true;
     }
 
+    uint64_t Material::computeHash() const
+    {
+        FNVHash64 hash;
+        insertBaseHash(hash);
+        return hash.get();
+    }
+
+    void Material::insertBaseHash(FNVHash64& hash) const
+    {
+        // This function hashes a subset of the data compared by isBaseEqual().
+        // The texture transform is left out, equal materials just need to end up with equal hashes.
+
+        hash.insert(&mHeader.packedData, sizeof(mHeader.packedData));
+
+        for (size_t i = 0; i < mTextureSlotInfo.size(); i++)
+        {
+            auto slot = (TextureSlot)i;
+            if (!hasTextureSlot(slot)) continue;
+            const Texture* pTexture = mTextureSlotData[i].pTexture.get();
+            hash.insert(&i, sizeof(i));
+            hash.insert(&pTexture, sizeof(pTexture));
+        }
+    }
+
     NormalMapType Material::detectNormalMapType(const ref<Texture>& pNormalMap)
     {
         NormalMapType type = NormalMapType::None;
@@ -38,6 +38,7 @@
 #include "Core/API/Texture.h"
 #include "Core/API/Sampler.h"
 #include "Utils/Image/TextureAnalyzer.h"
+#include "Utils/Math/FNVHash.h"
 #include "Utils/UI/Gui.h"
 #include "Scene/Transform.h"
 #include "MaterialTypeRegistry.h"
@@ -163,6 +164,13 @@ namespace Falcor
         */
         virtual bool isEqual(const ref<Material>& pOther) const = 0;
 
+        /** Compute a hash of the material properties.
+            Materials for which isEqual() returns true have the same hash, the name is not included.
+            Used by MaterialSystem::removeDuplicateMaterials() to only compare materials with equal hashes.
+            \return Hash of the material properties.
+        */
+        virtual uint64_t computeHash() const;
+
         /** Set the double-sided flag. This flag doesn't affect the cull state, just the shading.
         */
         virtual void setDoubleSided(bool doubleSided);
@@ -354,6 +362,7 @@ namespace Falcor
         void updateTextureHandle(MaterialSystem* pOwner, const TextureSlot slot, TextureHandle& handle);
         void updateDefaultTextureSamplerID(MaterialSystem* pOwner, const ref<Sampler>& pSampler);
         bool isBaseEqual(const Material& other) const;
+        void insertBaseHash(FNVHash64& hash) const;
 
         static NormalMapType detectNormalMapType(const ref<Texture>& pNormalMap);
 
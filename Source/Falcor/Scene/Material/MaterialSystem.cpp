@@ -32,6 +32,7 @@
 #include "Utils/StringUtils.h"
 #include "MaterialTypeRegistry.h"
 #include <numeric>
+#include <unordered_map>
 
 namespace Falcor
 {
@@ -336,20 +337,27 @@ namespace Falcor
         std::vector<ref<Material>> uniqueMaterials;
         idMap.resize(mMaterials.size());
 
+        // Bucket the unique materials by hash. Equal materials have equal hashes,
+        // so materials only need to be compared to the unique materials in their bucket.
+        std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+        buckets.reserve(mMaterials.size());
+
         // Find unique set of materials.
         for (MaterialID id{ 0 }; id.get() < mMaterials.size(); ++id)
         {
             const auto& pMaterial = mMaterials[id.get()];
-            auto it = std::find_if(uniqueMaterials.begin(), uniqueMaterials.end(), [&pMaterial](const auto& m) { return m->isEqual(pMaterial); });
-            if (it == uniqueMaterials.end())
+            auto& bucket = buckets[pMaterial->computeHash()];
+            auto it = std::find_if(bucket.begin(), bucket.end(), [&](uint32_t index) { return uniqueMaterials[index]->isEqual(pMaterial); });
+            if (it == bucket.end())
             {
                 idMap[id.get()] = MaterialID{ uniqueMaterials.size() };
+                bucket.push_back((uint32_t)uniqueMaterials.size());
                 uniqueMaterials.push_back(pMaterial);
             }
             else
             {
-                logInfo("Removing duplicate material '{}' (duplicate of '{}').", pMaterial->getName(), (*it)->getName());
-                idMap[id.get()] = MaterialID{ (size_t)std::distance(uniqueMaterials.begin(), it) };
+                logInfo("Removing duplicate material '{}' (duplicate of '{}').", pMaterial->getName(), uniqueMaterials[*it]->getName());
+                idMap[id.get()] = MaterialID{ *it };
             }
         }
 
@@ -31,10 +31,9 @@
 #include "Material/ClothMaterial.h"
 #include "Material/MaterialTextureLoader.h"
 #include "Utils/Logger.h"
+#include "Utils/TaskManager.h"
 
-#include <lz4_stream/lz4_stream.h>
-
-#include <fstream>
+#include <cstring>
 
 namespace Falcor
 {
@@ -43,37 +42,99 @@ namespace Falcor
         /** Specfies the current cache file version.
             This needs to be incremented every time the file format changes!
         */
-        const uint32_t kVersion = 25;
+        const uint32_t kVersion = 26;
 
         /** Scene cache directory (subdirectory in the application data directory).
         */
         const std::string kDirectory = "NVIDIA/Falcor/SceneCache";
 
-        const size_t kBlockSize = 1 * 1024 * 1024;
+        /** Sections of the cache file, see SceneCacheFile.
+            The compressed sections hold the serialized scene data, the raw sections the large vertex and index buffers.
+        */
+        enum class Section : uint32_t
+        {
+            Scene = 0,              ///< Everything but the geometry, compressed.
+            Meshes = 1,             ///< Mesh descriptions, instances and groups, compressed.
+            CachedMeshes = 2,       ///< Vertex animation caches of the meshes, compressed.
+            Curves = 3,             ///< Curve descriptions and animation caches, compressed.
+            CustomPrimitives = 4,   ///< Custom primitives, compressed.
+            MeshIndexData = 5,      ///< Raw.
+            MeshStaticData = 6,     ///< Raw.
+            MeshSkinningData = 7,   ///< Raw.
+            CurveIndexData = 8,     ///< Raw.
+            CurveStaticData = 9,    ///< Raw.
+        };
 
-        const char* kMagic = "FalcorS$";
-        struct Header
+        template<typename T>
+        void addRawSection(SceneCacheFile::Writer& file, Section section, const std::vector<T>& vec)
         {
-            uint8_t magic[8]{};
-            uint32_t version{};
+            static_assert(std::is_trivially_copyable<T>::value);
+            file.addRaw((uint32_t)section, vec.data(), vec.size() * sizeof(T));
+        }
 
-            bool isValid() const
+        /** Copy a raw section into a vector, the copy runs as a task.
+        */
+        template<typename T>
+        void readRawSection(const SceneCacheFile::Reader& file, Section section, std::vector<T>& vec, TaskManager& taskManager)
+        {
+            static_assert(std::is_trivially_copyable<T>::value);
+            const SceneCacheFile::Bytes bytes = file.getSection((uint32_t)section);
+            if (bytes.size % sizeof(T) != 0) FALCOR_THROW("Invalid size of scene cache section {}.", (uint32_t)section);
+            taskManager.addTask([&vec, bytes]()
             {
-                return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kVersion;
+                vec.resize(bytes.size / sizeof(T));
+                if (bytes.size > 0) std::memcpy(vec.data(), bytes.data, bytes.size);
+            });
+        }
+
+        /** Waits for the tasks of a task manager if the scope is left early, e.g. by an error in a corrupt cache file.
+            The running tasks reference the task manager and the data being read, they must not outlive them.
+        */
+        class TaskJoinGuard
+        {
+        public:
+            TaskJoinGuard(TaskManager& taskManager) : mTaskManager(taskManager) {}
+            TaskJoinGuard(const TaskJoinGuard&) = delete;
+            TaskJoinGuard& operator=(const TaskJoinGuard&) = delete;
+
+            ~TaskJoinGuard()
+            {
+                if (mFinished) return;
+                // Already unwinding, an error of a task is dropped in favor of the pending one.
+                try
+                {
+                    mTaskManager.finish(nullptr);
+                }
+                catch (...)
+                {
+                }
+            }
+
+            /** Wait for the tasks and rethrow an error of a task.
+            */
+            void finish()
+            {
+                mFinished = true;
+                mTaskManager.finish(nullptr);
             }
+
+        private:
+            TaskManager& mTaskManager;
+            bool mFinished = false;
         };
     }
 
-    /** Wrapper around std::ostream to ease serialization of basic types.
+    /** Serializes basic types into the bytes of a section.
     */
     class SceneCache::OutputStream
     {
     public:
-        OutputStream(std::ostream& stream) : mStream(stream) {}
+        OutputStream(std::vector<uint8_t>& data) : mData(data) {}
 
         void write(const void* data, size_t len)
         {
-            mStream.write(reinterpret_cast<const char*>(data), len);
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+            mData.insert(mData.end(), bytes, bytes + len);
         }
 
         template<typename T>
@@ -118,21 +179,25 @@ namespace Falcor
         }
 
     private:
-        std::ostream& mStream;
+        std::vector<uint8_t>& mData;
     };
 
-    /** Wrapper around std::istream to ease serialization of basic types.
+    /** Deserializes basic types from the bytes of a section.
     */
     class SceneCache::InputStream
     {
     public:
-        InputStream(std::istream& stream) : mStream(stream) {}
+        InputStream(SceneCacheFile::Bytes bytes) : mBytes(bytes) {}
 
         void read(void* data, size_t len)
         {
-            mStream.read(reinterpret_cast<char*>(data), len);
+            if (len > mBytes.size - mPosition) FALCOR_THROW("Unexpected end of scene cache section.");
+            std::memcpy(data, mBytes.data + mPosition, len);
+            mPosition += len;
         }
 
+        bool isEnd() const { return mPosition == mBytes.size; }
+
         template<typename T>
         void read(T& value)
         {
@@ -189,22 +254,15 @@ namespace Falcor
         }
 
     private:
-        std::istream& mStream;
+        SceneCacheFile::Bytes mBytes;
+        size_t mPosition = 0;
     };
 
     bool SceneCache::hasValidCache(const Key& key)
     {
         auto cachePath = getCachePath(key);
         if (!std::filesystem::exists(cachePath)) return false;
-
-        // Open file.
-        std::ifstream fs(cachePath.c_str(), std::ios_base::binary);
-        if (fs.bad()) return false;
-
-        // Verify header.
-        Header header;
-        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
-        return !fs.eof() && header.isValid();
+        return SceneCacheFile::hasValidHeader(cachePath, kVersion);
     }
 
     void SceneCache::writeCache(const Scene::SceneData& sceneData, const Key& key)
@@ -216,21 +274,10 @@ namespace Falcor
         // Create directories if not existing.
         std::filesystem::create_directories(cachePath.parent_path());
 
-        // Open file.
-        std::ofstream fs(cachePath.c_str(), std::ios_base::binary);
-        if (fs.bad()) FALCOR_THROW("Failed to create scene cache file '{}'.", cachePath);
-
-        // Write header (uncompressed).
-        Header header;
-        std::memcpy(header.magic, kMagic, sizeof(Header::magic));
-        header.version = kVersion;
-        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
-
-        // Write cache (compressed).
-        lz4_stream::basic_ostream<kBlockSize> zs(fs);
-        OutputStream stream(zs);
-        writeSceneData(stream, sceneData);
-        if (fs.bad()) FALCOR_THROW("Failed to write scene cache file to '{}'.", cachePath);
+        // Write the sections, they are compressed in parallel.
+        SceneCacheFile::Writer file;
+        writeSceneData(file, sceneData);
+        file.write(cachePath, kVersion);
     }
 
     Scene::SceneData SceneCache::readCache(ref<Device> pDevice, const Key& key)
@@ -239,21 +286,9 @@ namespace Falcor
 
         logInfo("Loading scene cache from '{}'.", cachePath);
 
-        // Open file.
-        std::ifstream fs(cachePath.c_str(), std::ios_base::binary);
-        if (fs.bad()) FALCOR_THROW("Failed to open scene cache file '{}'.", cachePath);
-
-        // Read header (uncompressed).
-        Header header;
-        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!header.isValid()) FALCOR_THROW("Invalid header in scene cache file '{}'.", cachePath);
-
-        // Read cache (compressed).
-        lz4_stream::basic_istream<kBlockSize, kBlockSize> zs(fs);
-        InputStream stream(zs);
-        auto sceneData = readSceneData(stream, pDevice);
-        if (fs.bad()) FALCOR_THROW("Failed to read scene cache file from '{}'.", cachePath);
-        return sceneData;
+        // Map the file, the sections are decompressed in parallel.
+        SceneCacheFile::Reader file(cachePath, kVersion);
+        return readSceneData(file, pDevice);
     }
 
     std::filesystem::path SceneCache::getCachePath(const Key& key)
@@ -263,8 +298,11 @@ namespace Falcor
 
     // SceneData
 
-    void SceneCache::writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData)
+    void SceneCache::writeSceneData(SceneCacheFile::Writer& file, const Scene::SceneData& sceneData)
     {
+        std::vector<uint8_t> sceneBytes;
+        OutputStream stream(sceneBytes);
+
         writeMarker(stream, "Path");
         stream.write(sceneData.path);
 
@@ -317,70 +355,96 @@ namespace Falcor
 
         writeMarker(stream, "Metadata");
         writeMetadata(stream, sceneData.metadata);
-
-        writeMarker(stream, "Meshes");
-        stream.write(sceneData.meshDesc);
-        stream.write(sceneData.meshNames);
-        stream.write(sceneData.meshBBs);
-        stream.write(sceneData.meshInstanceData);
-        stream.write((uint32_t)sceneData.meshIdToInstanceIds.size());
+        writeMarker(stream, "End");
+        file.addCompressed((uint32_t)Section::Scene, std::move(sceneBytes));
+
+        std::vector<uint8_t> meshBytes;
+        OutputStream meshStream(meshBytes);
+        writeMarker(meshStream, "Meshes");
+        meshStream.write(sceneData.meshDesc);
+        meshStream.write(sceneData.meshNames);
+        meshStream.write(sceneData.meshBBs);
+        meshStream.write(sceneData.meshInstanceData);
+        meshStream.write((uint32_t)sceneData.meshIdToInstanceIds.size());
         for (const auto& item : sceneData.meshIdToInstanceIds)
         {
-            stream.write(item);
+            meshStream.write(item);
         }
-        stream.write((uint32_t)sceneData.meshGroups.size());
+        meshStream.write((uint32_t)sceneData.meshGroups.size());
         for (const auto& group : sceneData.meshGroups)
         {
-            stream.write(group.meshList);
-            stream.write(group.isStatic);
-            stream.write(group.isDisplaced);
+            meshStream.write(group.meshList);
+            meshStream.write(group.isStatic);
+            meshStream.write(group.isDisplaced);
         }
-        stream.write((uint32_t)sceneData.cachedMeshes.size());
+        meshStream.write(sceneData.useCompressedHitInfo);
+        meshStream.write(sceneData.has16BitIndices);
+        meshStream.write(sceneData.has32BitIndices);
+        meshStream.write(sceneData.meshDrawCount);
+        file.addCompressed((uint32_t)Section::Meshes, std::move(meshBytes));
+
+        std::vector<uint8_t> cachedMeshBytes;
+        OutputStream cachedMeshStream(cachedMeshBytes);
+        writeMarker(cachedMeshStream, "CachedMeshes");
+        cachedMeshStream.write((uint32_t)sceneData.cachedMeshes.size());
         for (const auto& cachedMesh : sceneData.cachedMeshes)
         {
-            stream.write(cachedMesh.meshID);
-            stream.write(cachedMesh.timeSamples);
-            stream.write((uint32_t)cachedMesh.vertexData.size());
-            for (const auto& data : cachedMesh.vertexData) stream.write(data);
-        }
-        stream.write(sceneData.useCompressedHitInfo);
-        stream.write(sceneData.has16BitIndices);
-        stream.write(sceneData.has32BitIndices);
-        stream.write(sceneData.meshDrawCount);
-        stream.write(sceneData.meshIndexData);
-        stream.write(sceneData.meshStaticData);
-        stream.write(sceneData.meshSkinningData);
-
-        writeMarker(stream, "Curves");
-        stream.write(sceneData.curveDesc);
-        stream.write(sceneData.curveBBs);
-        stream.write(sceneData.curveInstanceData);
-        stream.write(sceneData.curveIndexData);
-        stream.write(sceneData.curveStaticData);
-
-        stream.write((uint32_t)sceneData.cachedCurves.size());
+            cachedMeshStream.write(cachedMesh.meshID);
+            cachedMeshStream.write(cachedMesh.timeSamples);
+            cachedMeshStream.write((uint32_t)cachedMesh.vertexData.size());
+            for (const auto& data : cachedMesh.vertexData) cachedMeshStream.write(data);
+        }
+        file.addCompressed((uint32_t)Section::CachedMeshes, std::move(cachedMeshBytes));
+
+        std::vector<uint8_t> curveBytes;
+        OutputStream curveStream(curveBytes);
+        writeMarker(curveStream, "Curves");
+        curveStream.write(sceneData.curveDesc);
+        curveStream.write(sceneData.curveBBs);
+        curveStream.write(sceneData.curveInstanceData);
+        curveStream.write((uint32_t)sceneData.cachedCurves.size());
         for (const auto& cachedCurve : sceneData.cachedCurves)
         {
-            stream.write(cachedCurve.tessellationMode);
-            stream.write(cachedCurve.geometryID);
-            stream.write(cachedCurve.timeSamples);
-            stream.write(cachedCurve.indexData);
-            stream.write((uint32_t)cachedCurve.vertexData.size());
-            for (const auto& data : cachedCurve.vertexData) stream.write(data);
+            curveStream.write(cachedCurve.tessellationMode);
+            curveStream.write(cachedCurve.geometryID);
+            curveStream.write(cachedCurve.timeSamples);
+            curveStream.write(cachedCurve.indexData);
+            curveStream.write((uint32_t)cachedCurve.vertexData.size());
+            for (const auto& data : cachedCurve.vertexData) curveStream.write(data);
         }
+        file.addCompressed((uint32_t)Section::Curves, std::move(curveBytes));
 
-        writeMarker(stream, "CustomPrimitives");
-        stream.write(sceneData.customPrimitiveDesc);
-        stream.write(sceneData.customPrimitiveAABBs);
+        std::vector<uint8_t> customPrimitiveBytes;
+        OutputStream customPrimitiveStream(customPrimitiveBytes);
+        writeMarker(customPrimitiveStream, "CustomPrimitives");
+        customPrimitiveStream.write(sceneData.customPrimitiveDesc);
+        customPrimitiveStream.write(sceneData.customPrimitiveAABBs);
+        file.addCompressed((uint32_t)Section::CustomPrimitives, std::move(customPrimitiveBytes));
 
-        writeMarker(stream, "End");
+        // The vertex and index data is stored uncompressed so that loading it is a copy from the mapped file.
+        addRawSection(file, Section::MeshIndexData, sceneData.meshIndexData);
+        addRawSection(file, Section::MeshStaticData, sceneData.meshStaticData);
+        addRawSection(file, Section::MeshSkinningData, sceneData.meshSkinningData);
+        addRawSection(file, Section::CurveIndexData, sceneData.curveIndexData);
+        addRawSection(file, Section::CurveStaticData, sceneData.curveStaticData);
     }
 
-    Scene::SceneData SceneCache::readSceneData(InputStream& stream, ref<Device> pDevice)
+    Scene::SceneData SceneCache::readSceneData(const SceneCacheFile::Reader& file, ref<Device> pDevice)
     {
         Scene::SceneData sceneData;
         sceneData.pMaterials = std::make_unique<MaterialSystem>(pDevice);
 
+        // Copy the vertex and index data from the mapped file while the rest of the scene is read.
+        TaskManager taskManager;
+        TaskJoinGuard taskJoinGuard(taskManager);
+        readRawSection(file, Section::MeshIndexData, sceneData.meshIndexData, taskManager);
+        readRawSection(file, Section::MeshStaticData, sceneData.meshStaticData, taskManager);
+        readRawSection(file, Section::MeshSkinningData, sceneData.meshSkinningData, taskManager);
+        readRawSection(file, Section::CurveIndexData, sceneData.curveIndexData, taskManager);
+        readRawSection(file, Section::CurveStaticData, sceneData.curveStaticData, taskManager);
+
+        InputStream stream(file.getSection((uint32_t)Section::Scene));
+
         readMarker(stream, "Path");
         stream.read(sceneData.path);
 
@@ -438,65 +502,70 @@ namespace Falcor
 
         readMarker(stream, "Metadata");
         sceneData.metadata = readMetadata(stream);
+        readMarker(stream, "End");
 
-        readMarker(stream, "Meshes");
-        stream.read(sceneData.meshDesc);
-        stream.read(sceneData.meshNames);
-        stream.read(sceneData.meshBBs);
-        stream.read(sceneData.meshInstanceData);
-        sceneData.meshIdToInstanceIds.resize(stream.read<uint32_t>());
+        InputStream meshStream(file.getSection((uint32_t)Section::Meshes));
+        readMarker(meshStream, "Meshes");
+        meshStream.read(sceneData.meshDesc);
+        meshStream.read(sceneData.meshNames);
+        meshStream.read(sceneData.meshBBs);
+        meshStream.read(sceneData.meshInstanceData);
+        sceneData.meshIdToInstanceIds.resize(meshStream.read<uint32_t>());
         for (auto& item : sceneData.meshIdToInstanceIds)
         {
-            stream.read(item);
+            meshStream.read(item);
         }
-        sceneData.meshGroups.resize(stream.read<uint32_t>());
+        sceneData.meshGroups.resize(meshStream.read<uint32_t>());
         for (auto& group : sceneData.meshGroups)
         {
-            stream.read(group.meshList);
-            stream.read(group.isStatic);
-            stream.read(group.isDisplaced);
+            meshStream.read(group.meshList);
+            meshStream.read(group.isStatic);
+            meshStream.read(group.isDisplaced);
         }
-        sceneData.cachedMeshes.resize(stream.read<uint32_t>());
+        meshStream.read(sceneData.useCompressedHitInfo);
+        meshStream.read(sceneData.has16BitIndices);
+        meshStream.read(sceneData.has32BitIndices);
+        meshStream.read(sceneData.meshDrawCount);
+
+        InputStream cachedMeshStream(file.getSection((uint32_t)Section::CachedMeshes));
+        readMarker(cachedMeshStream, "CachedMeshes");
+        sceneData.cachedMeshes.resize(cachedMeshStream.read<uint32_t>());
         for (auto& cachedMesh : sceneData.cachedMeshes)
         {
-            stream.read(cachedMesh.meshID);
-            stream.read(cachedMesh.timeSamples);
-            cachedMesh.vertexData.resize(stream.read<uint32_t>());
-            for (auto& data : cachedMesh.vertexData) stream.read(data);
-        }
-        stream.read(sceneData.useCompressedHitInfo);
-        stream.read(sceneData.has16BitIndices);
-        stream.read(sceneData.has32BitIndices);
-        stream.read(sceneData.meshDrawCount);
-        stream.read(sceneData.meshIndexData);
-        stream.read(sceneData.meshStaticData);
-        stream.read(sceneData.meshSkinningData);
-
-        readMarker(stream, "Curves");
-        stream.read(sceneData.curveDesc);
-        stream.read(sceneData.curveBBs);
-        stream.read(sceneData.curveInstanceData);
-        stream.read(sceneData.curveIndexData);
-        stream.read(sceneData.curveStaticData);
-
-        sceneData.cachedCurves.resize(stream.read<uint32_t>());
+            cachedMeshStream.read(cachedMesh.meshID);
+            cachedMeshStream.read(cachedMesh.timeSamples);
+            cachedMesh.vertexData.resize(cachedMeshStream.read<uint32_t>());
+            for (auto& data : cachedMesh.vertexData) cachedMeshStream.read(data);
+        }
+
+        InputStream curveStream(file.getSection((uint32_t)Section::Curves));
+        readMarker(curveStream, "Curves");
+        curveStream.read(sceneData.curveDesc);
+        curveStream.read(sceneData.curveBBs);
+        curveStream.read(sceneData.curveInstanceData);
+        sceneData.cachedCurves.resize(curveStream.read<uint32_t>());
         for (auto& cachedCurve : sceneData.cachedCurves)
         {
-            stream.read(cachedCurve.tessellationMode);
-            stream.read(cachedCurve.geometryID);
-            stream.read(cachedCurve.timeSamples);
-            stream.read(cachedCurve.indexData);
-            cachedCurve.vertexData.resize(stream.read<uint32_t>());
-            for (auto& data : cachedCurve.vertexData) stream.read(data);
+            curveStream.read(cachedCurve.tessellationMode);
+            curveStream.read(cachedCurve.geometryID);
+            curveStream.read(cachedCurve.timeSamples);
+            curveStream.read(cachedCurve.indexData);
+            cachedCurve.vertexData.resize(curveStream.read<uint32_t>());
+            for (auto& data : cachedCurve.vertexData) curveStream.read(data);
         }
 
-        readMarker(stream, "CustomPrimitives");
-        stream.read(sceneData.customPrimitiveDesc);
-        stream.read(sceneData.customPrimitiveAABBs);
+        InputStream customPrimitiveStream(file.getSection((uint32_t)Section::CustomPrimitives));
+        readMarker(customPrimitiveStream, "CustomPrimitives");
+        customPrimitiveStream.read(sceneData.customPrimitiveDesc);
+        customPrimitiveStream.read(sceneData.customPrimitiveAABBs);
 
-        readMarker(stream, "End");
+        for (const InputStream* pStream : {&stream, &meshStream, &cachedMeshStream, &curveStream, &customPrimitiveStream})
+        {
+            if (!pStream->isEnd()) FALCOR_THROW("Found unread data in scene cache section.");
+        }
 
         pMaterialTextureLoader.reset();
+        taskJoinGuard.finish();
 
         return sceneData;
     }
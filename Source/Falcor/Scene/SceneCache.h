@@ -36,6 +36,7 @@
 #include "Material/BasicMaterial.h"
 #include "Material/MaterialSystem.h"
 #include "Material/MaterialTextureLoader.h"
+#include "SceneCacheFile.h"
 
 #include "Core/Macros.h"
 #include "Core/API/fwd.h"
@@ -50,6 +51,8 @@ namespace Falcor
     /** Helper class for reading and writing scene cache files.
         The scene cache is used to heavily reduce load times of more complex assets.
         The cache stores a binary representation of `Scene::SceneData` which contains everything to re-create a `Scene`.
+        The file is split into sections (see SceneCacheFile), the vertex and index data is stored uncompressed and copied straight
+        from a memory mapping of the file while the compressed sections are decompressed in parallel.
     */
     class FALCOR_API SceneCache
     {
@@ -81,8 +84,8 @@ namespace Falcor
 
         static std::filesystem::path getCachePath(const Key& key);
 
-        static void writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData);
-        static Scene::SceneData readSceneData(InputStream& stream, ref<Device> pDevice);
+        static void writeSceneData(SceneCacheFile::Writer& file, const Scene::SceneData& sceneData);
+        static Scene::SceneData readSceneData(const SceneCacheFile::Reader& file, ref<Device> pDevice);
 
         static void writeMetadata(OutputStream& stream, const Scene::Metadata& metadata);
         static Scene::Metadata readMetadata(InputStream& stream);
@@ -0,0 +1,285 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "SceneCacheFile.h"
+#include "Core/Error.h"
+#include "Utils/TaskManager.h"
+#include "Utils/StringFormatters.h"
+
+#include <lz4frame.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace Falcor
+{
+namespace
+{
+const char kMagic[8] = {'F', 'a', 'l', 'c', 'o', 'r', 'S', '$'};
+
+struct Header
+{
+    uint8_t magic[8]{};
+    uint32_t version{};
+    uint32_t sectionCount{};
+
+    bool isValid(uint32_t expectedVersion) const
+    {
+        return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == expectedVersion;
+    }
+};
+
+static_assert(sizeof(Header) == 16);
+static_assert(sizeof(SceneCacheFile::SectionInfo) == 32);
+
+/// LZ4 does not decode a block to more than 255 times its size, larger decoded sizes of a section are corrupt.
+const uint64_t kMaxCompressionRatio = 255;
+
+uint64_t alignUp(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+std::vector<uint8_t> compressFrame(const std::vector<uint8_t>& data)
+{
+    LZ4F_preferences_t preferences{};
+    preferences.frameInfo.blockSizeID = LZ4F_max4MB;
+    preferences.frameInfo.contentSize = data.size();
+    std::vector<uint8_t> frame(LZ4F_compressFrameBound(data.size(), &preferences));
+    const size_t frameSize = LZ4F_compressFrame(frame.data(), frame.size(), data.data(), data.size(), &preferences);
+    if (LZ4F_isError(frameSize)) FALCOR_THROW("Failed to compress scene cache section: {}.", LZ4F_getErrorName(frameSize));
+    frame.resize(frameSize);
+    return frame;
+}
+
+uint64_t getFrameContentSize(const uint8_t* pFrame, size_t frameSize)
+{
+    LZ4F_dctx* pContext = nullptr;
+    const size_t result = LZ4F_createDecompressionContext(&pContext, LZ4F_VERSION);
+    if (LZ4F_isError(result)) FALCOR_THROW("Failed to create LZ4 decompression context: {}.", LZ4F_getErrorName(result));
+
+    LZ4F_frameInfo_t frameInfo{};
+    size_t srcSize = frameSize;
+    const size_t hint = LZ4F_getFrameInfo(pContext, &frameInfo, pFrame, &srcSize);
+    LZ4F_freeDecompressionContext(pContext);
+    if (LZ4F_isError(hint)) FALCOR_THROW("Invalid scene cache section: {}.", LZ4F_getErrorName(hint));
+    return frameInfo.contentSize;
+}
+
+void decompressFrame(const uint8_t* pFrame, size_t frameSize, uint8_t* pDst, size_t dstSize)
+{
+    LZ4F_dctx* pContext = nullptr;
+    const size_t result = LZ4F_createDecompressionContext(&pContext, LZ4F_VERSION);
+    if (LZ4F_isError(result)) FALCOR_THROW("Failed to create LZ4 decompression context: {}.", LZ4F_getErrorName(result));
+
+    size_t srcPos = 0;
+    size_t dstPos = 0;
+    size_t hint = 1;
+    while (hint != 0)
+    {
+        size_t srcLeft = frameSize - srcPos;
+        size_t dstLeft = dstSize - dstPos;
+        hint = LZ4F_decompress(pContext, pDst + dstPos, &dstLeft, pFrame + srcPos, &srcLeft, nullptr);
+        if (LZ4F_isError(hint))
+        {
+            LZ4F_freeDecompressionContext(pContext);
+            FALCOR_THROW("Failed to decompress scene cache section: {}.", LZ4F_getErrorName(hint));
+        }
+        srcPos += srcLeft;
+        dstPos += dstLeft;
+        // no progress means the frame is truncated or larger than its section
+        if (hint != 0 && srcLeft == 0 && dstLeft == 0) break;
+    }
+    LZ4F_freeDecompressionContext(pContext);
+    if (hint != 0 || dstPos != dstSize) FALCOR_THROW("Scene cache section is truncated.");
+}
+} // namespace
+
+bool SceneCacheFile::hasValidHeader(const std::filesystem::path& path, uint32_t version)
+{
+    std::ifstream fs(path, std::ios_base::binary);
+    if (!fs.good()) return false;
+    Header header;
+    fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return fs.good() && header.isValid(version);
+}
+
+void SceneCacheFile::Writer::addCompressed(uint32_t id, std::vector<uint8_t> data)
+{
+    Section section;
+    section.id = id;
+    section.encoding = Encoding::LZ4;
+    section.rawSize = data.size();
+    section.data = std::move(data);
+    mSections.push_back(std::move(section));
+}
+
+void SceneCacheFile::Writer::addRaw(uint32_t id, const void* data, size_t size)
+{
+    Section section;
+    section.id = id;
+    section.encoding = Encoding::Raw;
+    section.pRawData = reinterpret_cast<const uint8_t*>(data);
+    section.rawSize = size;
+    mSections.push_back(std::move(section));
+}
+
+void SceneCacheFile::Writer::write(const std::filesystem::path& path, uint32_t version) const
+{
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            if (mSections[i].id == mSections[j].id) FALCOR_THROW("Scene cache section {} is added twice.", mSections[i].id);
+        }
+    }
+
+    // Compress the sections in parallel.
+    std::vector<std::vector<uint8_t>> frames(mSections.size());
+    {
+        TaskManager taskManager;
+        for (size_t i = 0; i < mSections.size(); i++)
+        {
+            if (mSections[i].encoding == Encoding::LZ4) taskManager.addTask([&, i]() { frames[i] = compressFrame(mSections[i].data); });
+        }
+        taskManager.finish(nullptr);
+    }
+
+    // Lay out the sections behind the table, raw sections start on a page.
+    std::vector<SectionInfo> infos(mSections.size());
+    uint64_t offset = sizeof(Header) + sizeof(SectionInfo) * mSections.size();
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        const Section& section = mSections[i];
+        SectionInfo& info = infos[i];
+        info.id = section.id;
+        info.encoding = section.encoding;
+        info.rawSize = section.rawSize;
+        if (section.encoding == Encoding::Raw)
+        {
+            info.offset = alignUp(offset, kRawSectionAlignment);
+            info.size = section.rawSize;
+        }
+        else
+        {
+            info.offset = offset;
+            info.size = frames[i].size();
+        }
+        offset = info.offset + info.size;
+    }
+
+    std::ofstream fs(path, std::ios_base::binary);
+    if (!fs.good()) FALCOR_THROW("Failed to create scene cache file '{}'.", path);
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(Header::magic));
+    header.version = version;
+    header.sectionCount = uint32_t(mSections.size());
+    fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fs.write(reinterpret_cast<const char*>(infos.data()), sizeof(SectionInfo) * infos.size());
+
+    uint64_t position = sizeof(Header) + sizeof(SectionInfo) * infos.size();
+    const std::vector<char> padding(kRawSectionAlignment, 0);
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        fs.write(padding.data(), infos[i].offset - position);
+        const uint8_t* pData = mSections[i].encoding == Encoding::Raw ? mSections[i].pRawData : frames[i].data();
+        fs.write(reinterpret_cast<const char*>(pData), infos[i].size);
+        position = infos[i].offset + infos[i].size;
+    }
+    if (!fs.good()) FALCOR_THROW("Failed to write scene cache file '{}'.", path);
+}
+
+SceneCacheFile::Reader::Reader(const std::filesystem::path& path, uint32_t version) : mPath(path)
+{
+    if (!mFile.open(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan))
+        FALCOR_THROW("Failed to open scene cache file '{}'.", path);
+
+    const uint8_t* pFile = reinterpret_cast<const uint8_t*>(mFile.getData());
+    const uint64_t fileSize = mFile.getSize();
+    Header header;
+    if (fileSize < sizeof(Header)) FALCOR_THROW("Invalid header in scene cache file '{}'.", path);
+    std::memcpy(&header, pFile, sizeof(Header));
+    if (!header.isValid(version)) FALCOR_THROW("Invalid header in scene cache file '{}'.", path);
+
+    if (header.sectionCount > (fileSize - sizeof(Header)) / sizeof(SectionInfo))
+        FALCOR_THROW("Invalid section table in scene cache file '{}'.", path);
+    mInfos.resize(header.sectionCount);
+    std::memcpy(mInfos.data(), pFile + sizeof(Header), sizeof(SectionInfo) * mInfos.size());
+    for (const SectionInfo& info : mInfos)
+    {
+        const bool validEncoding = info.encoding == Encoding::Raw || info.encoding == Encoding::LZ4;
+        const bool inFile = info.offset <= fileSize && info.size <= fileSize - info.offset;
+        const bool validRaw = info.encoding != Encoding::Raw || (info.size == info.rawSize && info.offset % kRawSectionAlignment == 0);
+        if (!validEncoding || !inFile || !validRaw) FALCOR_THROW("Invalid section {} in scene cache file '{}'.", info.id, path);
+        // The decoded size is allocated up front, it has to match the frame and be reachable from the stored size.
+        if (info.encoding == Encoding::LZ4 &&
+            (info.rawSize > info.size * kMaxCompressionRatio || getFrameContentSize(pFile + info.offset, info.size) != info.rawSize))
+            FALCOR_THROW("Invalid section {} in scene cache file '{}'.", info.id, path);
+    }
+
+    // Decompress the sections in parallel, the raw sections are used from the mapping.
+    mDecoded.resize(mInfos.size());
+    TaskManager taskManager;
+    for (size_t i = 0; i < mInfos.size(); i++)
+    {
+        if (mInfos[i].encoding != Encoding::LZ4) continue;
+        taskManager.addTask(
+            [this, pFile, i]()
+            {
+                const SectionInfo& info = mInfos[i];
+                mDecoded[i].resize(info.rawSize);
+                decompressFrame(pFile + info.offset, info.size, mDecoded[i].data(), info.rawSize);
+            }
+        );
+    }
+    taskManager.finish(nullptr);
+}
+
+bool SceneCacheFile::Reader::hasSection(uint32_t id) const
+{
+    return findSection(id) < mInfos.size();
+}
+
+SceneCacheFile::Bytes SceneCacheFile::Reader::getSection(uint32_t id) const
+{
+    const size_t index = findSection(id);
+    if (index == mInfos.size()) FALCOR_THROW("Missing section {} in scene cache file '{}'.", id, mPath);
+    const SectionInfo& info = mInfos[index];
+    if (info.encoding == Encoding::Raw) return {reinterpret_cast<const uint8_t*>(mFile.getData()) + info.offset, info.size};
+    return {mDecoded[index].data(), mDecoded[index].size()};
+}
+
+size_t SceneCacheFile::Reader::findSection(uint32_t id) const
+{
+    for (size_t i = 0; i < mInfos.size(); i++)
+    {
+        if (mInfos[i].id == id) return i;
+    }
+    return mInfos.size();
+}
+} // namespace Falcor
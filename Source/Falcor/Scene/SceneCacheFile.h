@@ -0,0 +1,153 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Core/Platform/MemoryMappedFile.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Container file of the scene cache.
+ *
+ * The file holds an uncompressed header with magic and format version, a section table and the sections. Every section is
+ * either a single LZ4 frame that can be decompressed independently of the others, or stored uncompressed at a page aligned
+ * offset so that it can be used straight from a memory mapping of the file.
+ */
+class FALCOR_API SceneCacheFile
+{
+public:
+    enum class Encoding : uint32_t
+    {
+        Raw = 0, ///< Stored as is, page aligned.
+        LZ4 = 1, ///< A single LZ4 frame.
+    };
+
+    /// Alignment of the raw sections in the file.
+    static constexpr uint64_t kRawSectionAlignment = 4096;
+
+    /// Bytes of a section.
+    struct Bytes
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    /// Entry of the section table.
+    struct SectionInfo
+    {
+        uint32_t id = 0;
+        Encoding encoding = Encoding::Raw;
+        uint64_t offset = 0;  ///< Offset from the start of the file in bytes.
+        uint64_t size = 0;    ///< Stored size in bytes.
+        uint64_t rawSize = 0; ///< Decoded size in bytes.
+    };
+
+    /**
+     * Check the magic and format version of a file without reading the sections.
+     * @param[in] path File path.
+     * @param[in] version Expected format version.
+     * @return True if the file exists and has a valid header.
+     */
+    static bool hasValidHeader(const std::filesystem::path& path, uint32_t version);
+
+    /**
+     * Collects the sections of a file and writes them.
+     */
+    class FALCOR_API Writer
+    {
+    public:
+        /**
+         * Add a section that is compressed to its own LZ4 frame.
+         * @param[in] id Section ID, has to be unique in the file.
+         * @param[in] data Section data, taken over by the writer.
+         */
+        void addCompressed(uint32_t id, std::vector<uint8_t> data);
+
+        /**
+         * Add a section that is stored uncompressed. The data is not copied and has to stay alive until write() returns.
+         * @param[in] id Section ID, has to be unique in the file.
+         */
+        void addRaw(uint32_t id, const void* data, size_t size);
+
+        /**
+         * Compress the sections in parallel and write the file. Throws on failure.
+         * @param[in] path File path.
+         * @param[in] version Format version stored in the header.
+         */
+        void write(const std::filesystem::path& path, uint32_t version) const;
+
+    private:
+        struct Section
+        {
+            uint32_t id = 0;
+            Encoding encoding = Encoding::Raw;
+            std::vector<uint8_t> data;
+            const uint8_t* pRawData = nullptr;
+            size_t rawSize = 0;
+        };
+        std::vector<Section> mSections;
+    };
+
+    /**
+     * Maps a file and gives access to its sections.
+     */
+    class FALCOR_API Reader
+    {
+    public:
+        /**
+         * Map a file and decompress its compressed sections in parallel. Throws if the file can not be opened, the header does not
+         * match or a section is corrupt.
+         * @param[in] path File path.
+         * @param[in] version Expected format version.
+         */
+        Reader(const std::filesystem::path& path, uint32_t version);
+
+        bool hasSection(uint32_t id) const;
+
+        /**
+         * Get the decoded bytes of a section, raw sections point into the mapping of the file. The bytes are valid as long as the
+         * reader is alive. Throws if the section does not exist.
+         */
+        Bytes getSection(uint32_t id) const;
+
+        const std::vector<SectionInfo>& getSectionInfos() const { return mInfos; }
+
+    private:
+        size_t findSection(uint32_t id) const;
+
+        std::filesystem::path mPath;
+        MemoryMappedFile mFile;
+        std::vector<SectionInfo> mInfos;
+        std::vector<std::vector<uint8_t>> mDecoded;
+    };
+};
+} // namespace Falcor
@@ -48,6 +48,11 @@ namespace Falcor
         return ref<TriangleMesh>(new TriangleMesh(vertices, indices, frontFaceCW));
     }
 
+    ref<TriangleMesh> TriangleMesh::create(VertexList&& vertices, IndexList&& indices, bool frontFaceCW)
+    {
+        return ref<TriangleMesh>(new TriangleMesh(std::move(vertices), std::move(indices), frontFaceCW));
+    }
+
     ref<TriangleMesh> TriangleMesh::createDummy()
     {
         VertexList vertices = {{{0.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f}}};
@@ -322,6 +327,12 @@ namespace Falcor
         , mFrontFaceCW(frontFaceCW)
     {}
 
+    TriangleMesh::TriangleMesh(VertexList&& vertices, IndexList&& indices, bool frontFaceCW)
+        : mVertices(std::move(vertices))
+        , mIndices(std::move(indices))
+        , mFrontFaceCW(frontFaceCW)
+    {}
+
     FALCOR_SCRIPT_BINDING(TriangleMesh)
     {
         using namespace pybind11::literals;
@@ -78,6 +78,14 @@ namespace Falcor
         */
         static ref<TriangleMesh> create(const VertexList& vertices, const IndexList& indices, bool frontFaceCW = false);
 
+        /** Creates a triangle mesh, taking over the vertex and index lists.
+            \param[in] vertices Vertex list.
+            \param[in] indices Index list.
+            \param[in] frontFaceCW Triangle winding.
+            \return Returns the triangle mesh.
+        */
+        static ref<TriangleMesh> create(VertexList&& vertices, IndexList&& indices, bool frontFaceCW = false);
+
         /** Creates a dummy mesh (single degenerate triangle).
             \return Returns the triangle mesh.
         */
@@ -189,6 +197,7 @@ namespace Falcor
     private:
         TriangleMesh();
         TriangleMesh(const VertexList& vertices, const IndexList& indices, bool frontFaceCW);
+        TriangleMesh(VertexList&& vertices, IndexList&& indices, bool frontFaceCW);
 
         std::string mName;
         std::vector<Vertex> mVertices;
@@ -1,9 +1,12 @@
 #include "ComputePathTracer.h"
+#include "Host/RadianceHashCache.h"
 #include "Core/API/Formats.h"
 #include "RenderGraph/RenderPassHelpers.h"
 #include "RenderGraph/RenderPassStandardFlags.h"
 #include "imgui.h"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 
 namespace
@@ -12,8 +15,12 @@ const std::string kPTShaderFile("RenderPasses/ComputePathTracer/ComputePathTrace
 const std::string kPTTrainShaderFile("RenderPasses/ComputePathTracer/ComputePathTracerTrain.slang");
 const std::string kHCResolveShaderFile("RenderPasses/ComputePathTracer/RadianceHashCacheResolve.slang");
 const std::string kHCResetShaderFile("RenderPasses/ComputePathTracer/RadianceHashCacheReset.slang");
+const std::string kHCStatsShaderFile("RenderPasses/ComputePathTracer/RadianceHashCacheStats.slang");
 const std::string kGradientClearShaderFile("RenderPasses/ComputePathTracer/tinynn/GradientClear.slang");
 const std::string kGradientDescentShaderFile("RenderPasses/ComputePathTracer/tinynn/GradientDescentPrimal.slang");
+const std::string kFusedOptimizerShaderFile("RenderPasses/ComputePathTracer/tinynn/FusedOptimizer.slang");
+const std::string kNNTrainBatchShaderFile("RenderPasses/ComputePathTracer/NNTrainBatch.slang");
+const std::string kNNBatchInferenceShaderFile("RenderPasses/ComputePathTracer/NNBatchInference.slang");
 const std::string kNNResetShaderFile("RenderPasses/ComputePathTracer/tinynn/NNReset.slang");
 const std::string kIRDebugVisShaderFile("RenderPasses/ComputePathTracer/IRDebugVis.slang");
 
@@ -33,6 +40,11 @@ const ChannelList kOutputChannels = {kOutputColor, kIRDebugOutputColor};
 const std::string kLowerBounceCount = "lowerBounceCount";
 const std::string kUpperBounceCount = "upperBounceCount";
 const std::string kUseImportanceSampling = "useImportanceSampling";
+const std::string kWavefront = "wavefront";
+const std::string kLaneStats = "laneStats";
+const std::string kCacheStats = "cacheStats";
+// written by getProperties() with the cache stats enabled, ignored by setProperties()
+const std::string kCacheStatsValues = "cacheStatsValues";
 const std::string kUseNEE = "useNEE";
 const std::string kUseMIS = "useMIS";
 const std::string kMISUsePowerHeuristic = "MISUsePowerHeuristic";
@@ -43,13 +55,108 @@ const std::string kLightBVHOptions = "lightBVHOptions";
 const std::string kHCHashMapSizeExponent = "HCHashMapSizeExponent";
 const std::string kHCInjectRadianceSpread = "HCInjectRadianceSpread";
 const std::string kHCDebugColor = "HCDebugColor";
+const std::string kHCProbingScheme = "HCProbingScheme";
+const std::string kHCMaxAge = "HCMaxAge";
+const std::string kHCPackedVoxels = "HCPackedVoxels";
+const std::string kHCIncrementalResolve = "HCIncrementalResolve";
+const std::string kHCFitKeyLayout = "HCFitKeyLayout";
+const std::string kHCLevelTables = "HCLevelTables";
 const std::string kRRSurvivalProbOption = "RRSurvivalProbOption";
 const std::string kNNDebugOutput = "NNDebugOutput";
+const std::string kNNFusedOptimizer = "NNFusedOptimizer";
+const std::string kNNSparseFeatureGridUpdate = "NNSparseFeatureGridUpdate";
+const std::string kNNLazyFeatureGridAdam = "NNLazyFeatureGridAdam";
+const std::string kNNGradientPreReduction = "NNGradientPreReduction";
+const std::string kNNTrainingRecords = "NNTrainingRecords";
+const std::string kNNTrainingRecordsPerFrame = "NNTrainingRecordsPerFrame";
+const std::string kNNDeferredQueries = "NNDeferredQueries";
+const std::string kNNAdaptiveTraining = "NNAdaptiveTraining";
+const std::string kNNMLPCount = "NNMLPCount";
+const std::string kNNExpertRouting = "NNExpertRouting";
+
+// training passes per frame, each one followed by a descent
+const uint32_t kTrainingIterations = 4;
+// threads per group of the training passes
+const uint32_t kTrainingGroupSize = 128;
+// pixels per side of the tiles the training pass traces one path in, without training records
+const uint32_t kTrainingTileSize = 10;
+// changes that make the nn relearn parts of the scene, they restore the full training budget
+const Scene::UpdateFlags kTrainingBudgetResetFlags = Scene::UpdateFlags::GeometryMoved | Scene::UpdateFlags::CameraMoved |
+    Scene::UpdateFlags::CameraSwitched | Scene::UpdateFlags::LightsMoved | Scene::UpdateFlags::LightIntensityChanged |
+    Scene::UpdateFlags::SceneGraphChanged | Scene::UpdateFlags::MaterialsChanged | Scene::UpdateFlags::EnvMapChanged |
+    Scene::UpdateFlags::EmissiveMaterialsChanged;
+
+// records of a training iteration, rounded up to full groups
+uint32_t getTrainingBatchSize(uint32_t recordsPerFrame)
+{
+    return div_round_up(std::max(recordsPerFrame / kTrainingIterations, 1u), kTrainingGroupSize) * kTrainingGroupSize;
+}
+
+// tile size of the training pass with training records, chosen so that the paths produce about the records of a frame
+uint32_t getTrainingRecordTileSize(uint2 frameDim, uint32_t pathCount)
+{
+    const float pixelsPerPath = float(frameDim.x) * float(frameDim.y) / float(std::max(pathCount, 1u));
+    return std::clamp(uint32_t(std::ceil(std::sqrt(pixelsPerPath))), 1u, std::max(std::min(frameDim.x, frameDim.y), 1u));
+}
+
+Properties getCacheStatsProperties(const CacheStats& stats)
+{
+    Properties props;
+    props["capacity"] = stats.capacity;
+    props["occupiedSlots"] = stats.occupiedSlots;
+    props["loadFactor"] = stats.getLoadFactor();
+    props["failedInserts"] = stats.failedInserts;
+    props["averageProbeCount"] = stats.getAverageProbeCount();
+    props["maxProbeCount"] = stats.maxProbeCount;
+    props["featureGridParams"] = stats.featureGridParams;
+    props["featureGridGradients"] = stats.featureGridGradients;
+    props["gradientSparsity"] = stats.getGradientSparsity();
+    Properties levels;
+    for (size_t level = 0; level < stats.levelOccupiedSlots.size(); level++)
+    {
+        if (stats.levelOccupiedSlots[level] > 0) levels[std::to_string(level)] = stats.levelOccupiedSlots[level];
+    }
+    props["levelOccupiedSlots"] = levels;
+    return props;
+}
+
+const std::string kCacheSnapshotFrameCount = "FrameCount";
+const std::string kCacheSnapshotStepCount = "OptimizerStepCount";
+const std::string kCacheSnapshotDescentCount = "DescentCount";
 } // namespace
 
 extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registry)
 {
     registry.registerClass<RenderPass, ComputePathTracer>();
+    ScriptBindings::registerBinding(ComputePathTracer::registerBindings);
+}
+
+void ComputePathTracer::registerBindings(pybind11::module& m)
+{
+    pybind11::class_<ComputePathTracer, RenderPass, ref<ComputePathTracer>> pass(m, "ComputePathTracer");
+    pass.def("reset", &ComputePathTracer::reset);
+    pass.def("saveCaches", &ComputePathTracer::saveCaches, pybind11::arg("path"));
+    pass.def("loadCaches", &ComputePathTracer::loadCaches, pybind11::arg("path"));
+    pass.def("getLossHistory", &ComputePathTracer::getLossHistory);
+    pass.def(
+        "getTrainingBudget",
+        [](const ComputePathTracer& self)
+        {
+            const TrainingBudget::Budget budget = self.getTrainingBudget();
+            pybind11::dict d;
+            d["iterations"] = budget.iterations;
+            d["pathTileScale"] = budget.pathTileScale;
+            return d;
+        }
+    );
+    pass.def(
+        "getCacheStats",
+        [](const ComputePathTracer& self) -> pybind11::object
+        {
+            if (!self.getCacheStats()) return pybind11::none();
+            return getCacheStatsProperties(*self.getCacheStats()).toPython();
+        }
+    );
 }
 
 void ComputePathTracer::parseProperties(const Properties& props)
@@ -59,6 +166,10 @@ void ComputePathTracer::parseProperties(const Properties& props)
         if (key == kLowerBounceCount) mLowerBounceCount = value;
         else if (key == kUpperBounceCount) mUpperBounceCount = value;
         else if (key == kUseImportanceSampling) mUseImportanceSampling = value;
+        else if (key == kWavefront) mWavefront = value;
+        else if (key == kLaneStats) mLaneStats = value;
+        else if (key == kCacheStats) mCacheStatsEnabled = value;
+        else if (key == kCacheStatsValues) continue;
         else if (key == kUseNEE) mUseNEE = value;
         else if (key == kUseMIS) mUseMIS = value;
         else if (key == kMISUsePowerHeuristic) mMISUsePowerHeuristic = value;
@@ -71,8 +182,24 @@ void ComputePathTracer::parseProperties(const Properties& props)
         }
         else if (key == kHCInjectRadianceSpread) mHCParams.injectRadianceSpread = value;
         else if (key == kHCDebugColor) mHCParams.debugColor = value;
+        else if (key == kHCProbingScheme) mHCParams.probingScheme = value;
+        else if (key == kHCMaxAge) mHCParams.maxAge = value;
+        else if (key == kHCPackedVoxels) mHCParams.packedVoxels = value;
+        else if (key == kHCIncrementalResolve) mHCParams.incrementalResolve = value;
+        else if (key == kHCFitKeyLayout) mHCParams.fitKeyLayout = value;
+        else if (key == kHCLevelTables) mHCParams.levelTables = value;
         else if (key == kRRSurvivalProbOption) mRRParams.survivalProbOption = value;
         else if (key == kNNDebugOutput) mNNParams.debugOutput = value;
+        else if (key == kNNFusedOptimizer) mNNParams.fusedOptimizer = value;
+        else if (key == kNNSparseFeatureGridUpdate) mNNParams.sparseFeatureGridUpdate = value;
+        else if (key == kNNLazyFeatureGridAdam) mNNParams.lazyFeatureGridAdam = value;
+        else if (key == kNNGradientPreReduction) mNNParams.gradientPreReduction = value;
+        else if (key == kNNTrainingRecords) mNNParams.trainingRecords = value;
+        else if (key == kNNTrainingRecordsPerFrame) mNNParams.trainingRecordsPerFrame = value;
+        else if (key == kNNDeferredQueries) mNNParams.deferredQueries = value;
+        else if (key == kNNAdaptiveTraining) mNNParams.adaptiveTraining = value;
+        else if (key == kNNMLPCount) mNNParams.setMLPCount(int(value));
+        else if (key == kNNExpertRouting) mNNParams.expertRouting = value;
         else logWarning("Unknown property '{}' in ComputePathTracer properties.", key);
     }
 }
@@ -82,6 +209,9 @@ ComputePathTracer::ComputePathTracer(ref<Device> pDevice, const Properties& prop
     mpSampleGenerator = SampleGenerator::create(mpDevice, SAMPLE_GENERATOR_UNIFORM);
     mpPixelDebug = std::make_unique<PixelDebug>(mpDevice);
     mpPixelDebug->enable();
+    TrainingBudget::Desc budgetDesc;
+    budgetDesc.maxIterations = kTrainingIterations;
+    mTrainingBudget = TrainingBudget(budgetDesc);
     parseProperties(props);
 }
 
@@ -100,7 +230,21 @@ void ComputePathTracer::reset()
     mpEnvMapSampler = nullptr;
     mpSamplerBlock = nullptr;
     for (auto& b : mBuffers) b = nullptr;
+    mLaneStatCounts.clear();
+    mpLaneStatsReadbackBuffer = nullptr;
+    mLaneStatsFenceValues.fill(0);
+    mLaneStatsSlot = 0;
+    mpLossReadbackBuffer = nullptr;
+    mLossReadbackFenceValues.fill(0);
+    mLossReadbackSlot = 0;
+    mLossHistory.clear();
+    mTrainingBudget.reset();
+    mpCacheStatsReadbackBuffer = nullptr;
+    mCacheStatsFenceValues.fill(0);
+    mCacheStatsSlot = 0;
+    mCacheStats.reset();
     mFrameCount = 0;
+    mDescentCount = 0;
     for (auto& p : mPasses) p = nullptr;
 }
 
@@ -117,6 +261,10 @@ Properties ComputePathTracer::getProperties() const
     props[kLowerBounceCount] = mLowerBounceCount;
     props[kUpperBounceCount] = mUpperBounceCount;
     props[kUseImportanceSampling] = mUseImportanceSampling;
+    props[kWavefront] = mWavefront;
+    props[kLaneStats] = mLaneStats;
+    props[kCacheStats] = mCacheStatsEnabled;
+    if (mCacheStats) props[kCacheStatsValues] = getCacheStatsProperties(*mCacheStats);
     props[kUseNEE] = mUseNEE;
     props[kUseMIS] = mUseMIS;
     props[kMISUsePowerHeuristic] = mMISUsePowerHeuristic;
@@ -126,8 +274,24 @@ Properties ComputePathTracer::getProperties() const
     props[kHCHashMapSizeExponent] = mHCParams.hashMapSizeExp;
     props[kHCInjectRadianceSpread] = mHCParams.injectRadianceSpread;
     props[kHCDebugColor] = mHCParams.debugColor;
+    props[kHCProbingScheme] = mHCParams.probingScheme;
+    props[kHCMaxAge] = mHCParams.maxAge;
+    props[kHCPackedVoxels] = mHCParams.packedVoxels;
+    props[kHCIncrementalResolve] = mHCParams.incrementalResolve;
+    props[kHCFitKeyLayout] = mHCParams.fitKeyLayout;
+    props[kHCLevelTables] = mHCParams.levelTables;
     props[kRRSurvivalProbOption] = mRRParams.survivalProbOption;
     props[kNNDebugOutput] = mNNParams.debugOutput;
+    props[kNNFusedOptimizer] = mNNParams.fusedOptimizer;
+    props[kNNSparseFeatureGridUpdate] = mNNParams.sparseFeatureGridUpdate;
+    props[kNNLazyFeatureGridAdam] = mNNParams.lazyFeatureGridAdam;
+    props[kNNGradientPreReduction] = mNNParams.gradientPreReduction;
+    props[kNNTrainingRecords] = mNNParams.trainingRecords;
+    props[kNNTrainingRecordsPerFrame] = mNNParams.trainingRecordsPerFrame;
+    props[kNNDeferredQueries] = mNNParams.deferredQueries;
+    props[kNNAdaptiveTraining] = mNNParams.adaptiveTraining;
+    props[kNNMLPCount] = mNNParams.mlpCount;
+    props[kNNExpertRouting] = mNNParams.expertRouting;
     return props;
 }
 
@@ -166,6 +330,24 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
     defineList["HC_DEBUG_COLOR"] = mHCParams.debugColor ? "1" : "0";
     defineList["HC_DEBUG_LEVELS"] = mHCParams.debugLevels ? "1" : "0";
     defineList["HC_HASHMAP_SIZE"] = std::to_string(mHCParams.hashMapSize);
+    defineList["HC_PROBING_SCHEME"] = std::to_string(mHCParams.probingScheme);
+    defineList["HC_PACKED_VOXELS"] = mHCParams.packedVoxels ? "1" : "0";
+    defineList["HC_INCREMENTAL_RESOLVE"] = mHCParams.useIncrementalResolve() ? "1" : "0";
+    updateHCKeyLayout();
+    defineList["HC_POSITION_BIT_NUM"] = std::to_string(mHCKeyLayout.positionBitNum);
+    defineList["HC_DIRECTION_BIT_NUM"] = std::to_string(mHCKeyLayout.directionBitNum);
+    defineList["HC_LEVEL_BIT_NUM"] = std::to_string(mHCKeyLayout.levelBitNum);
+    defineList["HC_LEVEL_BIAS"] = std::to_string(mHCKeyLayout.levelBias);
+    // shortest round trip representation, the shader has to quantize exactly like the host mirror
+    defineList["HC_SCENE_SCALE"] = fmt::format("{}", mHCKeyLayout.sceneScale);
+    const float3 offset = mHCKeyLayout.positionOffset;
+    defineList["HC_POSITION_OFFSET"] = fmt::format("float3({}, {}, {})", offset.x, offset.y, offset.z);
+    defineList["HC_LEVEL_TABLE_COUNT"] = std::to_string(mHCLevelTables.getTableCount());
+    defineList["HC_LEVEL_TABLE_FIRST_LEVEL"] = std::to_string(mHCLevelTables.firstLevel);
+    const std::vector<uint32_t> levelTableOffsets = mHCLevelTables.offsets.empty() ? std::vector<uint32_t>{0, mHCParams.hashMapSize} : mHCLevelTables.offsets;
+    std::string levelTableOffsetList;
+    for (size_t i = 0; i < levelTableOffsets.size(); i++) levelTableOffsetList += (i > 0 ? ", " : "") + std::to_string(levelTableOffsets[i]);
+    defineList["HC_LEVEL_TABLE_OFFSETS"] = "{" + levelTableOffsetList + "}";
     defineList["USE_IMPORTANCE_SAMPLING"] = mUseImportanceSampling ? "1" : "0";
     defineList["USE_ANALYTIC_LIGHTS"] = mpScene->useAnalyticLights() ? "1" : "0";
     defineList["USE_EMISSIVE_LIGHTS"] = mpScene->useEmissiveLights() ? "1" : "0";
@@ -192,11 +374,28 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
     defineList["NN_LAYER_WIDTH"] = std::to_string(mNNParams.nnLayerWidth);
     defineList["MLP_COUNT"] = std::to_string(mNNParams.nnLayerCount.size());
     for (uint i = 0; i < mNNParams.nnLayerCount.size(); i++) defineList[std::string("NN_LAYER_COUNT") + std::to_string(i)] = std::to_string(mNNParams.nnLayerCount[i]);
+    defineList["NN_MAX_LAYER_COUNT"] = std::to_string(*std::max_element(mNNParams.nnLayerCount.begin(), mNNParams.nnLayerCount.end()));
+    const AABB& sceneBounds = mpScene->getSceneBounds();
+    const tinynn::ExpertRouter expertRouter = tinynn::ExpertRouter::create(
+        tinynn::ExpertRouting(mNNParams.expertRouting), mNNParams.nnLayerCount.size(), sceneBounds.minPoint, sceneBounds.maxPoint
+    );
+    defineList["NN_EXPERT_ROUTING"] = std::to_string(mNNParams.expertRouting);
+    defineList["NN_EXPERT_AXIS"] = std::to_string(expertRouter.axis);
+    // shortest round trip representation, the shader has to route exactly like the host mirror
+    defineList["NN_EXPERT_ORIGIN"] = fmt::format("{}", expertRouter.origin);
+    defineList["NN_EXPERT_SCALE"] = fmt::format("{}", expertRouter.scale);
     defineList["NN_TRAINING_BOUNCES"] = std::to_string(mNNParams.trainingBounces);
     defineList["FEATURE_HASH_GRID_SIZE"] = std::to_string(mNNParams.featureHashMapSize);
     defineList["FEATURE_HASH_GRID_PLACES_PER_ELEMENT"] = std::to_string(mNNParams.featureHashMapPlacesPerElement);
     defineList["FEATURE_HASH_ENC_SEPARATE_LEVEL_GRIDS"] = mNNParams.featureHashEncSeparateLevelGrids ? "1" : "0";
     defineList["FEATURE_HASH_GRID_PROBING_SIZE"] = std::to_string(mNNParams.featureHashMapProbingSize);
+    // debug outputs and the stats do not change the content of the caches, only the cache defines are part of the key
+    mCacheSnapshotKey = CacheSnapshot::computeKey(getSceneId(), CacheSnapshot::getKeyDefines(defineList));
+    defineList["CACHE_STATS"] = mCacheStatsEnabled ? "1" : "0";
+    defineList["CACHE_STATS_LEVEL_COUNT"] = std::to_string(CacheStats::kLevelCount);
+    std::string featureGridBeginList;
+    for (uint i = 0; i < mNNParams.nnLayerCount.size(); i++) featureGridBeginList += (i > 0 ? ", " : "") + std::to_string(mNNParams.getFeatureGridBegin(i));
+    defineList["NN_FEATURE_GRID_BEGINS"] = "{" + featureGridBeginList + "}";
 
     if (!mPasses[TRAIN_NN_FILL_CACHE_PASS] && (mHCParams.active || mNNParams.active))
     {
@@ -204,6 +403,9 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
         defineList["HC_QUERY"] = "0";
         defineList["NN_TRAIN"] = mNNParams.active ? "1" : "0";
         defineList["NN_QUERY"] = "0";
+        defineList["NN_GRADIENT_PRE_REDUCTION"] = mNNParams.gradientPreReduction ? "1" : "0";
+        defineList["NN_TRAINING_RECORDS"] = mNNParams.active && mNNParams.trainingRecords ? "1" : "0";
+        defineList["NN_TRAINING_RECORD_CAPACITY"] = std::to_string(mNNParams.trainingRecordsPerFrame);
         // use default rr for training
         defineList["RR_OPTION_BITS"] = "0";
         defineList["HC_INJECT_RADIANCE_SPREAD"] = "0";
@@ -213,6 +415,16 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
         desc.addTypeConformances(mpScene->getTypeConformances());
         mPasses[TRAIN_NN_FILL_CACHE_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
     }
+    if (!mPasses[NN_TRAIN_BATCH_PASS] && mNNParams.active && mNNParams.trainingRecords)
+    {
+        defineList["NN_TRAIN"] = "1";
+        defineList["NN_QUERY"] = "0";
+        defineList["NN_GRADIENT_PRE_REDUCTION"] = mNNParams.gradientPreReduction ? "1" : "0";
+        defineList["NN_TRAINING_RECORD_CAPACITY"] = std::to_string(mNNParams.trainingRecordsPerFrame);
+        ProgramDesc desc;
+        desc.addShaderLibrary(kNNTrainBatchShaderFile).csEntry("main");
+        mPasses[NN_TRAIN_BATCH_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
+    }
     if (!mPasses[PATH_TRACING_PASS])
     {
         defineList["HC_UPDATE"] = "0";
@@ -225,11 +437,41 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
         defineList["INJECT_RADIANCE_RR"] = mRRParams.injectRadiance ? "1" : "0";
         defineList["HC_INJECT_RADIANCE_SPREAD"] = mHCParams.injectRadianceSpread ? "1" : "0";
         defineList["NN_INJECT_RADIANCE_SPREAD"] = mNNParams.injectRadianceSpread ? "1" : "0";
+        defineList["PT_LANE_STATS"] = mLaneStats ? "1" : "0";
+        defineList["NN_DEFERRED_QUERIES"] = mNNParams.active && mNNParams.deferredQueries ? "1" : "0";
         ProgramDesc desc;
         desc.addShaderModules(mpScene->getShaderModules());
         desc.addShaderLibrary(kPTShaderFile).csEntry("main");
         desc.addTypeConformances(mpScene->getTypeConformances());
         mPasses[PATH_TRACING_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
+        if (mWavefront)
+        {
+            ProgramDesc generateDesc;
+            generateDesc.addShaderModules(mpScene->getShaderModules());
+            generateDesc.addShaderLibrary(kPTShaderFile).csEntry("generatePaths");
+            generateDesc.addTypeConformances(mpScene->getTypeConformances());
+            mPasses[PT_GENERATE_PATHS_PASS] = ComputePass::create(mpDevice, generateDesc, defineList, true);
+            ProgramDesc extendDesc;
+            extendDesc.addShaderModules(mpScene->getShaderModules());
+            extendDesc.addShaderLibrary(kPTShaderFile).csEntry("extendPaths");
+            extendDesc.addTypeConformances(mpScene->getTypeConformances());
+            mPasses[PT_EXTEND_PATHS_PASS] = ComputePass::create(mpDevice, extendDesc, defineList, true);
+        }
+    }
+    if (!mPasses[NN_BATCH_INFERENCE_PASS] && mNNParams.active && mNNParams.deferredQueries)
+    {
+        ProgramDesc inferDesc;
+        inferDesc.addShaderLibrary(kNNBatchInferenceShaderFile).csEntry("infer");
+        mPasses[NN_BATCH_INFERENCE_PASS] = ComputePass::create(mpDevice, inferDesc, defineList, true);
+        ProgramDesc resolveDesc;
+        resolveDesc.addShaderLibrary(kNNBatchInferenceShaderFile).csEntry("resolve");
+        mPasses[NN_QUERY_RESOLVE_PASS] = ComputePass::create(mpDevice, resolveDesc, defineList, true);
+        if (mNNParams.nnLayerCount.size() > 1)
+        {
+            ProgramDesc binDesc;
+            binDesc.addShaderLibrary(kNNBatchInferenceShaderFile).csEntry("bin");
+            mPasses[NN_QUERY_BIN_PASS] = ComputePass::create(mpDevice, binDesc, defineList, true);
+        }
     }
     if (!mPasses[HC_RESOLVE_PASS] && mHCParams.active)
     {
@@ -239,6 +481,14 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
         desc.addShaderLibrary(kHCResolveShaderFile).csEntry("hashCacheResolve");
         mPasses[HC_RESOLVE_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
     }
+    if (!mPasses[HC_EVICT_PASS] && mHCParams.active && mHCParams.useIncrementalResolve())
+    {
+        defineList["HC_UPDATE"] = "1";
+        defineList["HC_QUERY"] = "1";
+        ProgramDesc desc;
+        desc.addShaderLibrary(kHCResolveShaderFile).csEntry("hashCacheEvict");
+        mPasses[HC_EVICT_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
+    }
     if (!mPasses[HC_RESET_PASS] && mHCParams.active)
     {
         defineList["HC_UPDATE"] = "1";
@@ -247,6 +497,14 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
         desc.addShaderLibrary(kHCResetShaderFile).csEntry("main");
         mPasses[HC_RESET_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
     }
+    if (!mPasses[HC_STATS_PASS] && mHCParams.active && mCacheStatsEnabled)
+    {
+        defineList["HC_UPDATE"] = "1";
+        defineList["HC_QUERY"] = "1";
+        ProgramDesc desc;
+        desc.addShaderLibrary(kHCStatsShaderFile).csEntry("main");
+        mPasses[HC_STATS_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
+    }
     if (!mPasses[NN_GRADIENT_CLEAR_PASS] && mNNParams.active)
     {
         ProgramDesc desc;
@@ -260,6 +518,14 @@ void ComputePathTracer::createPasses(const RenderData& renderData)
         desc.addShaderLibrary(kGradientDescentShaderFile).csEntry("main");
         mPasses[NN_GRADIENT_DESCENT_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
     }
+    if (!mPasses[NN_FUSED_OPTIMIZER_PASS] && mNNParams.active)
+    {
+        defineList["NN_SPARSE_FEATURE_GRID_UPDATE"] = mNNParams.sparseFeatureGridUpdate ? "1" : "0";
+        defineList["NN_LAZY_FEATURE_GRID_ADAM"] = mNNParams.lazyFeatureGridAdam && mNNParams.optimizerParams.type == NNParams::ADAM ? "1" : "0";
+        ProgramDesc desc;
+        desc.addShaderLibrary(kFusedOptimizerShaderFile).csEntry("main");
+        mPasses[NN_FUSED_OPTIMIZER_PASS] = ComputePass::create(mpDevice, desc, defineList, true);
+    }
     if (!mPasses[NN_RESET_PASS] && mNNParams.active)
     {
         ProgramDesc desc;
@@ -295,9 +561,14 @@ void ComputePathTracer::setupData(RenderContext* pRenderContext)
     if (mHCParams.active)
     {
         if (!mBuffers[HC_HASH_GRID_ENTRIES_BUFFER]) mBuffers[HC_HASH_GRID_ENTRIES_BUFFER] = mpDevice->createStructuredBuffer(sizeof(uint64_t), mHCParams.hashMapSize);
-        // 128 bits per entry
-        if (!mBuffers[HC_VOXEL_DATA_BUFFER_0]) mBuffers[HC_VOXEL_DATA_BUFFER_0] = mpDevice->createBuffer(16 * mHCParams.hashMapSize);
-        if (!mBuffers[HC_VOXEL_DATA_BUFFER_1]) mBuffers[HC_VOXEL_DATA_BUFFER_1] = mpDevice->createBuffer(16 * mHCParams.hashMapSize);
+        if (!mBuffers[HC_HASH_GRID_META_BUFFER]) mBuffers[HC_HASH_GRID_META_BUFFER] = mpDevice->createBuffer(mHCParams.getMetaBufferSize());
+        if (!mBuffers[HC_HASH_GRID_STAMP_BUFFER]) mBuffers[HC_HASH_GRID_STAMP_BUFFER] = mpDevice->createBuffer(sizeof(uint32_t) * mHCParams.hashMapSize);
+        // indirect dispatch arguments and slot count followed by a slot index per entry
+        if (!mBuffers[HC_DIRTY_LIST_BUFFER] && mHCParams.useIncrementalResolve())
+            mBuffers[HC_DIRTY_LIST_BUFFER] = mpDevice->createBuffer(
+                sizeof(uint4) + sizeof(uint32_t) * mHCParams.hashMapSize, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::IndirectArg);
+        // a record per entry with the resolved estimate and the samples of the current frame, 16 bytes packed, 32 bytes as floats
+        if (!mBuffers[HC_VOXEL_DATA_BUFFER]) mBuffers[HC_VOXEL_DATA_BUFFER] = mpDevice->createBuffer((mHCParams.packedVoxels ? 16 : 32) * mHCParams.hashMapSize);
     }
     if (mNNParams.active)
     {
@@ -310,7 +581,43 @@ void ComputePathTracer::setupData(RenderContext* pRenderContext)
         mNNParams.gradientAuxElements = mNNParams.nnParamCount * 4;
         if (!mBuffers[NN_GRADIENT_AUX_BUFFER]) mBuffers[NN_GRADIENT_AUX_BUFFER] = mpDevice->createBuffer(mNNParams.gradientAuxElements * sizeof(float));
         if (mNNParams.featureHashMapProbingSize > 0 && !mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER]) mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER] = mpDevice->createStructuredBuffer(sizeof(uint64_t), mNNParams.featureHashMapSize / mNNParams.featureHashMapPlacesPerElement);
+        // position, direction, normal, target radiance and expert of a path vertex
+        if (mNNParams.trainingRecords && !mBuffers[NN_TRAINING_RECORD_BUFFER]) mBuffers[NN_TRAINING_RECORD_BUFFER] = mpDevice->createStructuredBuffer(4 * sizeof(float3) + sizeof(uint32_t), mNNParams.trainingRecordsPerFrame);
+        // record count of every expert
+        if (mNNParams.trainingRecords && !mBuffers[NN_TRAINING_RECORD_COUNTER_BUFFER]) mBuffers[NN_TRAINING_RECORD_COUNTER_BUFFER] = mpDevice->createBuffer(tinynn::kMaxExperts * sizeof(uint32_t));
+        // training loss sum and trained vertex count of a frame
+        if (!mBuffers[LOSS_SUM_BUFFER]) mBuffers[LOSS_SUM_BUFFER] = mpDevice->createBuffer(kLossSampleSize);
     }
+    // active and launched lanes of the primary hit and every bounce
+    if (mLaneStats && !mBuffers[PT_LANE_STATS_BUFFER]) mBuffers[PT_LANE_STATS_BUFFER] = mpDevice->createBuffer(sizeof(uint2) * (mUpperBounceCount + 1));
+    if (mCacheStatsEnabled && !mBuffers[CACHE_STATS_BUFFER]) mBuffers[CACHE_STATS_BUFFER] = mpDevice->createBuffer(kCacheStatsSize);
+}
+
+void ComputePathTracer::setupWavefrontData(uint2 frameDim)
+{
+    // the wavefront buffers hold a path per pixel and follow the frame size
+    const uint32_t pathCount = frameDim.x * frameDim.y;
+    if (mBuffers[PT_PATH_STATE_BUFFER] && mBuffers[PT_PATH_STATE_BUFFER]->getElementCount() == pathCount) return;
+    mBuffers[PT_PATH_STATE_BUFFER] = mpDevice->createStructuredBuffer(mPasses[PT_EXTEND_PATHS_PASS]->getRootVar()["gPathStateBuffer"], pathCount);
+    // indirect dispatch arguments and path count followed by a path index per pixel
+    for (uint32_t queue : {PT_PATH_QUEUE_BUFFER_0, PT_PATH_QUEUE_BUFFER_1})
+        mBuffers[queue] = mpDevice->createBuffer(sizeof(uint4) + sizeof(uint32_t) * pathCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::IndirectArg);
+}
+
+void ComputePathTracer::setupDeferredQueryData(uint2 frameDim)
+{
+    // a path records at most one query, the query and result buffers hold one per pixel and follow the frame size
+    const uint32_t queryCount = frameDim.x * frameDim.y;
+    if (mBuffers[NN_QUERY_BUFFER] && mBuffers[NN_QUERY_BUFFER]->getElementCount() == queryCount) return;
+    mBuffers[NN_QUERY_BUFFER] = mpDevice->createStructuredBuffer(mPasses[NN_BATCH_INFERENCE_PASS]->getRootVar()["gNNQueryBuffer"], queryCount);
+    mBuffers[NN_QUERY_RESULT_BUFFER] = mpDevice->createStructuredBuffer(sizeof(float3), queryCount);
+    // query index per slot of the expert bins, every bin is padded to a full group
+    if (mPasses[NN_QUERY_BIN_PASS])
+        mBuffers[NN_QUERY_ORDER_BUFFER] = mpDevice->createStructuredBuffer(sizeof(uint32_t), queryCount + tinynn::kMaxExperts * tinynn::kDeferredQueryGroupSize);
+    // indirect dispatch arguments of the bin, inference and resolve passes and query count, the inference arguments over the bins,
+    // the query count and the filled slots of every expert bin, see NNDeferredQuery.slang
+    if (!mBuffers[NN_QUERY_ARGS_BUFFER])
+        mBuffers[NN_QUERY_ARGS_BUFFER] = mpDevice->createBuffer(4 * sizeof(uint4), ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::IndirectArg);
 }
 
 void ComputePathTracer::setupBuffers()
@@ -321,6 +628,18 @@ void ComputePathTracer::setupBuffers()
     }
 }
 
+void ComputePathTracer::bindHCData(const ShaderVar& var)
+{
+    var["gHCHashGridEntriesBuffer"] = mBuffers[HC_HASH_GRID_ENTRIES_BUFFER];
+    var["gHCHashGridMetaBuffer"] = mBuffers[HC_HASH_GRID_META_BUFFER];
+    var["gHCHashGridStampBuffer"] = mBuffers[HC_HASH_GRID_STAMP_BUFFER];
+    if (mHCParams.useIncrementalResolve()) var["gHCDirtyListBuffer"] = mBuffers[HC_DIRTY_LIST_BUFFER];
+    var["HCHashGridCB"]["gHCFrameIndex"] = mFrameCount;
+    var["HCHashGridCB"]["gHCMaxAge"] = mHCParams.maxAge;
+    var["gHCVoxelDataBuffer"] = mBuffers[HC_VOXEL_DATA_BUFFER];
+    if (mBuffers[CACHE_STATS_BUFFER]) var["gCacheStatsBuffer"] = mBuffers[CACHE_STATS_BUFFER];
+}
+
 void ComputePathTracer::bindData(const RenderData& renderData, uint2 frameDim)
 {
     mCamPos = mpScene->getCamera()->getPosition();
@@ -331,46 +650,75 @@ void ComputePathTracer::bindData(const RenderData& renderData, uint2 frameDim)
         var["CB"]["gFrameCount"] = mFrameCount;
         var["CB"]["gCamPos"] = mCamPos;
         var["CB"]["gWeightsAddress"] = mBuffers[NN_PRIMAL_BUFFER]->getGpuAddress();
+        var["CB"]["gTrainTileSize"] = kTrainingTileSize;
         mpScene->bindShaderData(var["gScene"]);
         mpSampleGenerator->bindShaderData(var);
         if (mpEnvMapSampler) mpEnvMapSampler->bindShaderData(mpSamplerBlock->getRootVar()["envMapSampler"]);
         if (mpEmissiveSampler) mpEmissiveSampler->bindShaderData(mpSamplerBlock->getRootVar()["emissiveSampler"]);
         var["gSampler"] = mpSamplerBlock;
-        if (mHCParams.active)
-        {
-            var["gHCHashGridEntriesBuffer"] = mBuffers[HC_HASH_GRID_ENTRIES_BUFFER];
-            var["gHCVoxelDataBuffer"] = mFrameCount % 2 == 0 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-            var["gHCVoxelDataBufferPrev"] = mFrameCount % 2 == 1 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-        }
+        if (mHCParams.active) bindHCData(var);
         if (mNNParams.active)
         {
             var["PrimalBuffer"] = mBuffers[NN_PRIMAL_BUFFER];
             var["GradientBuffer"] = mBuffers[NN_GRADIENT_BUFFER];
             var["GradientCountBuffer"] = mBuffers[NN_GRADIENT_COUNT_BUFFER];
             if (mNNParams.featureHashMapProbingSize > 0 && mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER]) var["gFeatureHashGridEntriesBuffer"] = mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER];
+            if (!mPasses[NN_TRAIN_BATCH_PASS]) var["gLossSumBuffer"] = mBuffers[LOSS_SUM_BUFFER];
+        }
+        if (mPasses[NN_TRAIN_BATCH_PASS])
+        {
+            var["gNNTrainingRecordBuffer"] = mBuffers[NN_TRAINING_RECORD_BUFFER];
+            var["gNNTrainingRecordCounter"] = mBuffers[NN_TRAINING_RECORD_COUNTER_BUFFER];
         }
         var[kInputVBuffer.texname] = renderData.getTexture(kInputVBuffer.name);
         var[kInputViewDir.texname] = renderData.getTexture(kInputViewDir.name);
         mpPixelDebug->prepareProgram(mPasses[TRAIN_NN_FILL_CACHE_PASS]->getProgram(), var);
     }
+    if (mPasses[NN_TRAIN_BATCH_PASS])
+    {
+        auto var = mPasses[NN_TRAIN_BATCH_PASS]->getRootVar();
+        var["CB"]["gFrameCount"] = mFrameCount;
+        var["CB"]["gBatchSize"] = getTrainingBatchSize(mNNParams.trainingRecordsPerFrame);
+        var["CB"]["gWeightsAddress"] = mBuffers[NN_PRIMAL_BUFFER]->getGpuAddress();
+        mpSampleGenerator->bindShaderData(var);
+        var["PrimalBuffer"] = mBuffers[NN_PRIMAL_BUFFER];
+        var["GradientBuffer"] = mBuffers[NN_GRADIENT_BUFFER];
+        var["GradientCountBuffer"] = mBuffers[NN_GRADIENT_COUNT_BUFFER];
+        if (mNNParams.featureHashMapProbingSize > 0 && mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER]) var["gFeatureHashGridEntriesBuffer"] = mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER];
+        var["gNNTrainingRecordBuffer"] = mBuffers[NN_TRAINING_RECORD_BUFFER];
+        var["gNNTrainingRecordCounter"] = mBuffers[NN_TRAINING_RECORD_COUNTER_BUFFER];
+        var["gLossSumBuffer"] = mBuffers[LOSS_SUM_BUFFER];
+        mpPixelDebug->prepareProgram(mPasses[NN_TRAIN_BATCH_PASS]->getProgram(), var);
+    }
     if (mHCParams.active)
     {
         auto var = mPasses[HC_RESOLVE_PASS]->getRootVar();
-        var["gHCHashGridEntriesBuffer"] = mBuffers[HC_HASH_GRID_ENTRIES_BUFFER];
-        var["gHCVoxelDataBuffer"] = mFrameCount % 2 == 0 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-        var["gHCVoxelDataBufferPrev"] = mFrameCount % 2 == 1 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
+        bindHCData(var);
         mpPixelDebug->prepareProgram(mPasses[HC_RESOLVE_PASS]->getProgram(), var);
     }
+    if (mHCParams.active && mHCParams.useIncrementalResolve())
+    {
+        auto var = mPasses[HC_EVICT_PASS]->getRootVar();
+        bindHCData(var);
+        var["HCEvictCB"]["gHCEvictOffset"] = mHCParams.getEvictOffset(mFrameCount);
+        var["HCEvictCB"]["gHCEvictCount"] = mHCParams.getEvictCount();
+        mpPixelDebug->prepareProgram(mPasses[HC_EVICT_PASS]->getProgram(), var);
+    }
     if (mHCParams.active && mHCParams.reset)
     {
         auto var = mPasses[HC_RESET_PASS]->getRootVar();
-        var["gHCHashGridEntriesBuffer"] = mBuffers[HC_HASH_GRID_ENTRIES_BUFFER];
-        var["gHCVoxelDataBuffer"] = mBuffers[HC_VOXEL_DATA_BUFFER_0];
-        var["gHCVoxelDataBufferPrev"] = mBuffers[HC_VOXEL_DATA_BUFFER_1];
+        bindHCData(var);
         mpPixelDebug->prepareProgram(mPasses[HC_RESET_PASS]->getProgram(), var);
     }
+    if (mPasses[HC_STATS_PASS])
+    {
+        auto var = mPasses[HC_STATS_PASS]->getRootVar();
+        bindHCData(var);
+        mpPixelDebug->prepareProgram(mPasses[HC_STATS_PASS]->getProgram(), var);
+    }
+    auto bindPathTracerData = [&](ComputePass* pPass)
     {
-        auto var = mPasses[PATH_TRACING_PASS]->getRootVar();
+        auto var = pPass->getRootVar();
         var["CB"]["gFrameDim"] = frameDim;
         var["CB"]["gFrameCount"] = mFrameCount;
         var["CB"]["gCamPos"] = mCamPos;
@@ -383,12 +731,7 @@ void ComputePathTracer::bindData(const RenderData& renderData, uint2 frameDim)
         if (mpEnvMapSampler) mpEnvMapSampler->bindShaderData(mpSamplerBlock->getRootVar()["envMapSampler"]);
         if (mpEmissiveSampler) mpEmissiveSampler->bindShaderData(mpSamplerBlock->getRootVar()["emissiveSampler"]);
         var["gSampler"] = mpSamplerBlock;
-        if (mHCParams.active)
-        {
-            var["gHCHashGridEntriesBuffer"] = mBuffers[HC_HASH_GRID_ENTRIES_BUFFER];
-            var["gHCVoxelDataBuffer"] = mFrameCount % 2 == 0 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-            var["gHCVoxelDataBufferPrev"] = mFrameCount % 2 == 1 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-        }
+        if (mHCParams.active) bindHCData(var);
         if (mNNParams.active)
         {
 
@@ -399,7 +742,52 @@ void ComputePathTracer::bindData(const RenderData& renderData, uint2 frameDim)
         }
         for (auto channel : kInputChannels) var[channel.texname] = renderData.getTexture(channel.name);
         var[kOutputColor.texname] = renderData.getTexture(kOutputColor.name);
-        mpPixelDebug->prepareProgram(mPasses[PATH_TRACING_PASS]->getProgram(), var);
+        if (mBuffers[PT_LANE_STATS_BUFFER]) var["gLaneStatsBuffer"] = mBuffers[PT_LANE_STATS_BUFFER];
+        if (mPasses[NN_BATCH_INFERENCE_PASS])
+        {
+            var["gNNQueryBuffer"] = mBuffers[NN_QUERY_BUFFER];
+            var["gNNQueryArgs"] = mBuffers[NN_QUERY_ARGS_BUFFER];
+        }
+        mpPixelDebug->prepareProgram(pPass->getProgram(), var);
+    };
+    bindPathTracerData(mPasses[PATH_TRACING_PASS].get());
+    if (mPasses[PT_EXTEND_PATHS_PASS])
+    {
+        bindPathTracerData(mPasses[PT_GENERATE_PATHS_PASS].get());
+        bindPathTracerData(mPasses[PT_EXTEND_PATHS_PASS].get());
+        mPasses[PT_GENERATE_PATHS_PASS]->getRootVar()["gPathStateBuffer"] = mBuffers[PT_PATH_STATE_BUFFER];
+        mPasses[PT_EXTEND_PATHS_PASS]->getRootVar()["gPathStateBuffer"] = mBuffers[PT_PATH_STATE_BUFFER];
+    }
+    if (mPasses[NN_BATCH_INFERENCE_PASS])
+    {
+        auto var = mPasses[NN_BATCH_INFERENCE_PASS]->getRootVar();
+        var["CB"]["gWeightsAddress"] = mBuffers[NN_FILTERED_PRIMAL_BUFFER]->getGpuAddress();
+        var["PrimalBuffer"] = mBuffers[NN_FILTERED_PRIMAL_BUFFER];
+        var["GradientBuffer"] = mBuffers[NN_GRADIENT_BUFFER];
+        var["GradientCountBuffer"] = mBuffers[NN_GRADIENT_COUNT_BUFFER];
+        if (mNNParams.featureHashMapProbingSize > 0 && mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER]) var["gFeatureHashGridEntriesBuffer"] = mBuffers[FEATURE_HASH_GRID_ENTRIES_BUFFER];
+        var["gNNQueryBuffer"] = mBuffers[NN_QUERY_BUFFER];
+        var["gNNQueryArgs"] = mBuffers[NN_QUERY_ARGS_BUFFER];
+        var["gNNQueryResultBuffer"] = mBuffers[NN_QUERY_RESULT_BUFFER];
+        if (mPasses[NN_QUERY_BIN_PASS]) var["gNNQueryOrderBuffer"] = mBuffers[NN_QUERY_ORDER_BUFFER];
+        mpPixelDebug->prepareProgram(mPasses[NN_BATCH_INFERENCE_PASS]->getProgram(), var);
+    }
+    if (mPasses[NN_QUERY_BIN_PASS])
+    {
+        auto var = mPasses[NN_QUERY_BIN_PASS]->getRootVar();
+        var["gNNQueryBuffer"] = mBuffers[NN_QUERY_BUFFER];
+        var["gNNQueryArgs"] = mBuffers[NN_QUERY_ARGS_BUFFER];
+        var["gNNQueryOrderBuffer"] = mBuffers[NN_QUERY_ORDER_BUFFER];
+        mpPixelDebug->prepareProgram(mPasses[NN_QUERY_BIN_PASS]->getProgram(), var);
+    }
+    if (mPasses[NN_QUERY_RESOLVE_PASS])
+    {
+        auto var = mPasses[NN_QUERY_RESOLVE_PASS]->getRootVar();
+        var["gNNQueryBuffer"] = mBuffers[NN_QUERY_BUFFER];
+        var["gNNQueryArgs"] = mBuffers[NN_QUERY_ARGS_BUFFER];
+        var["gNNQueryResultBuffer"] = mBuffers[NN_QUERY_RESULT_BUFFER];
+        var[kOutputColor.texname] = renderData.getTexture(kOutputColor.name);
+        mpPixelDebug->prepareProgram(mPasses[NN_QUERY_RESOLVE_PASS]->getProgram(), var);
     }
     if (mNNParams.active)
     {
@@ -419,8 +807,23 @@ void ComputePathTracer::bindData(const RenderData& renderData, uint2 frameDim)
         var["GradientBuffer"] = mBuffers[NN_GRADIENT_BUFFER];
         var["GradientCountBuffer"] = mBuffers[NN_GRADIENT_COUNT_BUFFER];
         var["GradientAuxBuffer"] = mBuffers[NN_GRADIENT_AUX_BUFFER];
+        if (mBuffers[CACHE_STATS_BUFFER]) var["gCacheStatsBuffer"] = mBuffers[CACHE_STATS_BUFFER];
         mpPixelDebug->prepareProgram(mPasses[NN_GRADIENT_DESCENT_PASS]->getProgram(), var);
     }
+    if (mNNParams.active)
+    {
+        auto var = mPasses[NN_FUSED_OPTIMIZER_PASS]->getRootVar();
+        var["CB"]["t"] = mNNParams.optimizerParams.step_count;
+        var["CB"]["lr"] = mNNParams.optimizerParams.learn_r;
+        var["CB"]["filter_alpha"] = mNNParams.filterAlpha;
+        var["PrimalBuffer"] = mBuffers[NN_PRIMAL_BUFFER];
+        var["FilteredPrimalBuffer"] = mBuffers[NN_FILTERED_PRIMAL_BUFFER];
+        var["GradientBuffer"] = mBuffers[NN_GRADIENT_BUFFER];
+        var["GradientCountBuffer"] = mBuffers[NN_GRADIENT_COUNT_BUFFER];
+        var["GradientAuxBuffer"] = mBuffers[NN_GRADIENT_AUX_BUFFER];
+        if (mBuffers[CACHE_STATS_BUFFER]) var["gCacheStatsBuffer"] = mBuffers[CACHE_STATS_BUFFER];
+        mpPixelDebug->prepareProgram(mPasses[NN_FUSED_OPTIMIZER_PASS]->getProgram(), var);
+    }
     if (mNNParams.active && mNNParams.reset)
     {
         auto var = mPasses[NN_RESET_PASS]->getRootVar();
@@ -443,12 +846,7 @@ void ComputePathTracer::bindData(const RenderData& renderData, uint2 frameDim)
         var["CB"]["gAccumulate"] = mIRDebugPassParams.accumulate;
         uint64_t address = mBuffers[NN_FILTERED_PRIMAL_BUFFER]->getGpuAddress();
         var["CB"]["gWeightsAddress"] = address;
-        if (mHCParams.active)
-        {
-            var["gHCHashGridEntriesBuffer"] = mBuffers[HC_HASH_GRID_ENTRIES_BUFFER];
-            var["gHCVoxelDataBuffer"] = mFrameCount % 2 == 0 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-            var["gHCVoxelDataBufferPrev"] = mFrameCount % 2 == 1 ? mBuffers[HC_VOXEL_DATA_BUFFER_0] : mBuffers[HC_VOXEL_DATA_BUFFER_1];
-        }
+        if (mHCParams.active) bindHCData(var);
         if (mpEnvMapSampler) mpEnvMapSampler->bindShaderData(mpSamplerBlock->getRootVar()["envMapSampler"]);
         if (mpEmissiveSampler) mpEmissiveSampler->bindShaderData(mpSamplerBlock->getRootVar()["emissiveSampler"]);
         var["gSampler"] = mpSamplerBlock;
@@ -512,6 +910,9 @@ void ComputePathTracer::execute(RenderContext* pRenderContext, const RenderData&
         setupBuffers();
         mOptionsChanged = false;
     }
+    if (mPendingCacheSnapshot) applyCacheSnapshot();
+    if (mPasses[PT_EXTEND_PATHS_PASS]) setupWavefrontData(frameDim);
+    if (mPasses[NN_BATCH_INFERENCE_PASS]) setupDeferredQueryData(frameDim);
     bindData(renderData, frameDim);
 
     const uint2 targetDim = renderData.getDefaultTextureDims();
@@ -521,39 +922,263 @@ void ComputePathTracer::execute(RenderContext* pRenderContext, const RenderData&
         mHCParams.reset = false;
         mPasses[HC_RESET_PASS]->execute(pRenderContext, mHCParams.hashMapSize, 1);
     }
+    if (mNNParams.active) readLossSamples();
+    if (mBuffers[PT_LANE_STATS_BUFFER]) readLaneStats();
+    if (mBuffers[CACHE_STATS_BUFFER])
+    {
+        readCacheStats();
+        pRenderContext->clearUAV(mBuffers[CACHE_STATS_BUFFER]->getUAV().get(), uint4(0));
+    }
+    if (mNNParams.active && (mNNParams.reset || is_set(mpScene->getUpdates(), kTrainingBudgetResetFlags))) mTrainingBudget.reset();
     if (mNNParams.active && mNNParams.reset)
     {
         mNNParams.reset = false;
+        mNNParams.gradientsCleared = false;
         mPasses[NN_RESET_PASS]->execute(pRenderContext, std::max(mNNParams.gradientAuxElements, mNNParams.nnParamCount), 1);
     }
+    if (mHCParams.active && mHCParams.useIncrementalResolve())
+    {
+        // no groups, y and z dimension of the dispatch, no slots
+        const uint4 dirtyListHeader(0, 1, 1, 0);
+        pRenderContext->updateBuffer(mBuffers[HC_DIRTY_LIST_BUFFER].get(), &dirtyListHeader, 0, sizeof(dirtyListHeader));
+    }
     {
         FALCOR_PROFILE(pRenderContext, "ComputePathTracer::training");
-        for (uint32_t i = 0; i < 4; i++)
+        const TrainingBudget::Budget budget = getTrainingBudget();
+        if (mBuffers[LOSS_SUM_BUFFER]) pRenderContext->clearUAV(mBuffers[LOSS_SUM_BUFFER]->getUAV().get(), uint4(0));
+        if (mPasses[NN_TRAIN_BATCH_PASS])
         {
-            if (mNNParams.active) mPasses[NN_GRADIENT_CLEAR_PASS]->execute(pRenderContext, mNNParams.nnParamCount, 1);
-            if (mHCParams.active || mNNParams.active)
+            // trace the training paths of the frame at once, the training iterations draw their batches from the records
+            const std::array<uint32_t, tinynn::kMaxExperts> recordCounts = {};
+            pRenderContext->updateBuffer(mBuffers[NN_TRAINING_RECORD_COUNTER_BUFFER].get(), &recordCounts, 0, sizeof(recordCounts));
+            // a reduced budget traces fewer paths
+            const uint32_t pathCount =
+                mNNParams.trainingRecordsPerFrame / mNNParams.getTrainingRecordsPerPath() / (budget.pathTileScale * budget.pathTileScale);
+            const uint32_t tileSize = getTrainingRecordTileSize(frameDim, pathCount);
+            auto var = mPasses[TRAIN_NN_FILL_CACHE_PASS]->getRootVar();
+            var["CB"]["gTrainIteration"] = 0;
+            var["CB"]["gTrainTileSize"] = tileSize;
+            mPasses[TRAIN_NN_FILL_CACHE_PASS]->execute(pRenderContext, frameDim.x / tileSize, frameDim.y / tileSize);
+        }
+        for (uint32_t i = 0; i < budget.iterations; i++)
+        {
+            if (mNNParams.active && !mNNParams.gradientsCleared) mPasses[NN_GRADIENT_CLEAR_PASS]->execute(pRenderContext, mNNParams.nnParamCount, 1);
+            if (mPasses[NN_TRAIN_BATCH_PASS])
+            {
+                mPasses[NN_TRAIN_BATCH_PASS]->getRootVar()["CB"]["gTrainIteration"] = i;
+                mPasses[NN_TRAIN_BATCH_PASS]->execute(pRenderContext, 32, getTrainingBatchSize(mNNParams.trainingRecordsPerFrame) / 32);
+            }
+            else if (mHCParams.active || mNNParams.active)
             {
-                mPasses[TRAIN_NN_FILL_CACHE_PASS]->getRootVar()["CB"]["gTrainIteration"] = i;
-                mPasses[TRAIN_NN_FILL_CACHE_PASS]->execute(pRenderContext, frameDim.x / 10, frameDim.y / 10);
+                // a reduced budget spreads the training paths over larger tiles
+                const uint32_t tileSize = kTrainingTileSize * budget.pathTileScale;
+                auto var = mPasses[TRAIN_NN_FILL_CACHE_PASS]->getRootVar();
+                var["CB"]["gTrainIteration"] = i;
+                var["CB"]["gTrainTileSize"] = tileSize;
+                mPasses[TRAIN_NN_FILL_CACHE_PASS]->execute(pRenderContext, frameDim.x / tileSize, frameDim.y / tileSize);
             }
-            if (mNNParams.active && mNNParams.train) mPasses[NN_GRADIENT_DESCENT_PASS]->execute(pRenderContext, mNNParams.nnParamCount, 1);
+            const bool descent = mNNParams.active && mNNParams.train;
+            if (descent && mNNParams.fusedOptimizer)
+                mPasses[NN_FUSED_OPTIMIZER_PASS]->getRootVar()["CB"]["iteration"] = mDescentCount;
+            if (descent) mPasses[mNNParams.fusedOptimizer ? NN_FUSED_OPTIMIZER_PASS : NN_GRADIENT_DESCENT_PASS]->execute(pRenderContext, mNNParams.nnParamCount, 1);
+            if (descent) mDescentCount++;
+            mNNParams.gradientsCleared = descent && mNNParams.fusedOptimizer;
         }
-        if (mHCParams.active) mPasses[HC_RESOLVE_PASS]->execute(pRenderContext, mHCParams.hashMapSize, 1);
+        if (mHCParams.active && mHCParams.useIncrementalResolve())
+        {
+            // only the slots inserted by the training paths can hold new samples
+            mPasses[HC_RESOLVE_PASS]->executeIndirect(pRenderContext, mBuffers[HC_DIRTY_LIST_BUFFER].get());
+            if (mHCParams.maxAge > 0) mPasses[HC_EVICT_PASS]->execute(pRenderContext, mHCParams.getEvictCount(), 1);
+        }
+        else if (mHCParams.active) mPasses[HC_RESOLVE_PASS]->execute(pRenderContext, mHCParams.hashMapSize, 1);
+        if (mNNParams.active) copyLossSample(pRenderContext);
     }
     {
         FALCOR_PROFILE(pRenderContext, "ComputePathTracer::pt");
-        mPasses[PATH_TRACING_PASS]->execute(pRenderContext, frameDim.x, frameDim.y);
+        if (mBuffers[PT_LANE_STATS_BUFFER]) pRenderContext->clearUAV(mBuffers[PT_LANE_STATS_BUFFER]->getUAV().get(), uint4(0));
+        if (mPasses[NN_BATCH_INFERENCE_PASS])
+        {
+            // no groups, y and z dimension of the dispatch, no queries, the same for the inference over the bins, empty bins
+            const std::array<uint32_t, 16> queryArgs = {0, 1, 1, 0, 0, 1, 1, 0};
+            pRenderContext->updateBuffer(mBuffers[NN_QUERY_ARGS_BUFFER].get(), &queryArgs, 0, sizeof(queryArgs));
+        }
+        if (mPasses[PT_EXTEND_PATHS_PASS]) executeWavefront(pRenderContext, frameDim);
+        else mPasses[PATH_TRACING_PASS]->execute(pRenderContext, frameDim.x, frameDim.y);
+    }
+    if (mBuffers[PT_LANE_STATS_BUFFER]) copyLaneStats(pRenderContext);
+    if (mPasses[NN_BATCH_INFERENCE_PASS])
+    {
+        FALCOR_PROFILE(pRenderContext, "ComputePathTracer::nn_inference");
+        if (mPasses[NN_QUERY_BIN_PASS])
+        {
+            // the bin pass writes the dispatch arguments of the inference over the bins
+            mPasses[NN_QUERY_BIN_PASS]->executeIndirect(pRenderContext, mBuffers[NN_QUERY_ARGS_BUFFER].get());
+            mPasses[NN_BATCH_INFERENCE_PASS]->executeIndirect(pRenderContext, mBuffers[NN_QUERY_ARGS_BUFFER].get(), sizeof(uint4));
+        }
+        else mPasses[NN_BATCH_INFERENCE_PASS]->executeIndirect(pRenderContext, mBuffers[NN_QUERY_ARGS_BUFFER].get());
+        mPasses[NN_QUERY_RESOLVE_PASS]->executeIndirect(pRenderContext, mBuffers[NN_QUERY_ARGS_BUFFER].get());
     }
     if (mPasses[IR_DEBUG_PASS])
     {
         FALCOR_PROFILE(pRenderContext, "ComputePathTracer::ir_debug");
         mPasses[IR_DEBUG_PASS]->execute(pRenderContext, kIRDebugOutputDim.x, kIRDebugOutputDim.y);
     }
+    if (mBuffers[CACHE_STATS_BUFFER])
+    {
+        FALCOR_PROFILE(pRenderContext, "ComputePathTracer::cache_stats");
+        if (mPasses[HC_STATS_PASS]) mPasses[HC_STATS_PASS]->execute(pRenderContext, mHCParams.hashMapSize, 1);
+        copyCacheStats(pRenderContext);
+    }
     mpPixelDebug->endFrame(pRenderContext);
     mFrameCount++;
     mNNParams.optimizerParams.step_count++;
 }
 
+void ComputePathTracer::executeWavefront(RenderContext* pRenderContext, uint2 frameDim)
+{
+    // no groups, y and z dimension of the dispatch, no paths
+    const uint4 queueHeader(0, 1, 1, 0);
+    pRenderContext->updateBuffer(mBuffers[PT_PATH_QUEUE_BUFFER_0].get(), &queueHeader, 0, sizeof(queueHeader));
+    mPasses[PT_GENERATE_PATHS_PASS]->getRootVar()["gNextPathQueue"] = mBuffers[PT_PATH_QUEUE_BUFFER_0];
+    mPasses[PT_GENERATE_PATHS_PASS]->execute(pRenderContext, frameDim.x, frameDim.y);
+    // the queues swap every bounce, once all paths terminated the indirect dispatches launch no groups
+    for (uint32_t bounce = 1; bounce <= mUpperBounceCount; bounce++)
+    {
+        const ref<Buffer>& pQueue = mBuffers[bounce % 2 == 1 ? PT_PATH_QUEUE_BUFFER_0 : PT_PATH_QUEUE_BUFFER_1];
+        const ref<Buffer>& pNextQueue = mBuffers[bounce % 2 == 1 ? PT_PATH_QUEUE_BUFFER_1 : PT_PATH_QUEUE_BUFFER_0];
+        pRenderContext->updateBuffer(pNextQueue.get(), &queueHeader, 0, sizeof(queueHeader));
+        auto var = mPasses[PT_EXTEND_PATHS_PASS]->getRootVar();
+        var["CB"]["gBounce"] = bounce;
+        var["gPathQueue"] = pQueue;
+        var["gNextPathQueue"] = pNextQueue;
+        mPasses[PT_EXTEND_PATHS_PASS]->executeIndirect(pRenderContext, pQueue.get());
+    }
+}
+
+TrainingBudget::Budget ComputePathTracer::getTrainingBudget() const
+{
+    // hash cache only training keeps the full budget, the loss is measured on the nn
+    if (mNNParams.active && mNNParams.adaptiveTraining) return mTrainingBudget.getBudget();
+    return TrainingBudget::Budget{kTrainingIterations, 1};
+}
+
+void ComputePathTracer::readLossSamples()
+{
+    if (!mpLossReadbackBuffer) return;
+    const uint64_t completedValue = mpLossFence->getCurrentValue();
+    // oldest slot first, the slot to be written next holds the oldest copy
+    for (uint32_t i = 0; i < kLossReadbackSlots; i++)
+    {
+        const uint32_t slot = (mLossReadbackSlot + i) % kLossReadbackSlots;
+        const uint64_t fenceValue = mLossReadbackFenceValues[slot];
+        if (fenceValue == 0 || fenceValue > completedValue) continue;
+        const uint8_t* pData = reinterpret_cast<const uint8_t*>(mpLossReadbackBuffer->map()) + slot * kLossSampleSize;
+        float lossSum;
+        uint32_t lossCount;
+        std::memcpy(&lossSum, pData, sizeof(float));
+        std::memcpy(&lossCount, pData + sizeof(float), sizeof(uint32_t));
+        mpLossReadbackBuffer->unmap();
+        mLossReadbackFenceValues[slot] = 0;
+        if (lossCount == 0) continue;
+        const float loss = lossSum / float(lossCount);
+        mTrainingBudget.addLoss(loss);
+        mLossHistory.push_back(loss);
+        if (mLossHistory.size() > kLossHistorySize) mLossHistory.erase(mLossHistory.begin());
+    }
+}
+
+void ComputePathTracer::copyLossSample(RenderContext* pRenderContext)
+{
+    if (!mpLossReadbackBuffer)
+    {
+        mpLossReadbackBuffer = mpDevice->createBuffer(kLossReadbackSlots * kLossSampleSize, ResourceBindFlags::None, MemoryType::ReadBack);
+        mLossReadbackFenceValues.fill(0);
+        mLossReadbackSlot = 0;
+    }
+    if (!mpLossFence) mpLossFence = mpDevice->createFence();
+    // all slots in flight, the sample of this frame is dropped instead of stalling
+    if (mLossReadbackFenceValues[mLossReadbackSlot] != 0) return;
+    pRenderContext->copyBufferRegion(mpLossReadbackBuffer.get(), mLossReadbackSlot * kLossSampleSize, mBuffers[LOSS_SUM_BUFFER].get(), 0, kLossSampleSize);
+    pRenderContext->submit(false);
+    mLossReadbackFenceValues[mLossReadbackSlot] = pRenderContext->signal(mpLossFence.get());
+    mLossReadbackSlot = (mLossReadbackSlot + 1) % kLossReadbackSlots;
+}
+
+void ComputePathTracer::readCacheStats()
+{
+    if (!mpCacheStatsReadbackBuffer) return;
+    const uint64_t completedValue = mpCacheStatsFence->getCurrentValue();
+    // oldest slot first, so the newest completed frame is kept
+    for (uint32_t i = 0; i < kCacheStatsReadbackSlots; i++)
+    {
+        const uint32_t slot = (mCacheStatsSlot + i) % kCacheStatsReadbackSlots;
+        const uint64_t fenceValue = mCacheStatsFenceValues[slot];
+        if (fenceValue == 0 || fenceValue > completedValue) continue;
+        const uint8_t* pData = reinterpret_cast<const uint8_t*>(mpCacheStatsReadbackBuffer->map()) + slot * kCacheStatsSize;
+        std::array<uint32_t, CacheStats::kWordCount> words;
+        std::memcpy(words.data(), pData, kCacheStatsSize);
+        mpCacheStatsReadbackBuffer->unmap();
+        mCacheStatsFenceValues[slot] = 0;
+        mCacheStats = CacheStats::decode(words.data(), mCacheStatsCapacities[slot]);
+    }
+}
+
+void ComputePathTracer::copyCacheStats(RenderContext* pRenderContext)
+{
+    if (!mpCacheStatsReadbackBuffer)
+    {
+        mpCacheStatsReadbackBuffer = mpDevice->createBuffer(kCacheStatsReadbackSlots * kCacheStatsSize, ResourceBindFlags::None, MemoryType::ReadBack);
+        mCacheStatsFenceValues.fill(0);
+        mCacheStatsSlot = 0;
+    }
+    if (!mpCacheStatsFence) mpCacheStatsFence = mpDevice->createFence();
+    // all slots in flight, the stats of this frame are dropped instead of stalling
+    if (mCacheStatsFenceValues[mCacheStatsSlot] != 0) return;
+    pRenderContext->copyBufferRegion(mpCacheStatsReadbackBuffer.get(), mCacheStatsSlot * kCacheStatsSize, mBuffers[CACHE_STATS_BUFFER].get(), 0, kCacheStatsSize);
+    pRenderContext->submit(false);
+    mCacheStatsFenceValues[mCacheStatsSlot] = pRenderContext->signal(mpCacheStatsFence.get());
+    mCacheStatsCapacities[mCacheStatsSlot] = mHCParams.active ? mHCParams.hashMapSize : 0;
+    mCacheStatsSlot = (mCacheStatsSlot + 1) % kCacheStatsReadbackSlots;
+}
+
+void ComputePathTracer::readLaneStats()
+{
+    if (!mpLaneStatsReadbackBuffer) return;
+    const uint64_t completedValue = mpLaneStatsFence->getCurrentValue();
+    const size_t slotSize = mpLaneStatsReadbackBuffer->getSize() / kLaneStatsReadbackSlots;
+    // oldest slot first, so the newest completed frame is kept
+    for (uint32_t i = 0; i < kLaneStatsReadbackSlots; i++)
+    {
+        const uint32_t slot = (mLaneStatsSlot + i) % kLaneStatsReadbackSlots;
+        const uint64_t fenceValue = mLaneStatsFenceValues[slot];
+        if (fenceValue == 0 || fenceValue > completedValue) continue;
+        const uint8_t* pData = reinterpret_cast<const uint8_t*>(mpLaneStatsReadbackBuffer->map()) + slot * slotSize;
+        mLaneStatCounts.resize(slotSize / sizeof(uint2));
+        std::memcpy(mLaneStatCounts.data(), pData, slotSize);
+        mpLaneStatsReadbackBuffer->unmap();
+        mLaneStatsFenceValues[slot] = 0;
+    }
+}
+
+void ComputePathTracer::copyLaneStats(RenderContext* pRenderContext)
+{
+    const size_t slotSize = mBuffers[PT_LANE_STATS_BUFFER]->getSize();
+    // the bounce count sizes the stats buffer, a new size drops the copies in flight
+    if (!mpLaneStatsReadbackBuffer || mpLaneStatsReadbackBuffer->getSize() != kLaneStatsReadbackSlots * slotSize)
+    {
+        mpLaneStatsReadbackBuffer = mpDevice->createBuffer(kLaneStatsReadbackSlots * slotSize, ResourceBindFlags::None, MemoryType::ReadBack);
+        mLaneStatsFenceValues.fill(0);
+        mLaneStatsSlot = 0;
+    }
+    if (!mpLaneStatsFence) mpLaneStatsFence = mpDevice->createFence();
+    // all slots in flight, the stats of this frame are dropped instead of stalling
+    if (mLaneStatsFenceValues[mLaneStatsSlot] != 0) return;
+    pRenderContext->copyBufferRegion(mpLaneStatsReadbackBuffer.get(), mLaneStatsSlot * slotSize, mBuffers[PT_LANE_STATS_BUFFER].get(), 0, slotSize);
+    pRenderContext->submit(false);
+    mLaneStatsFenceValues[mLaneStatsSlot] = pRenderContext->signal(mpLaneStatsFence.get());
+    mLaneStatsSlot = (mLaneStatsSlot + 1) % kLaneStatsReadbackSlots;
+}
+
 void ComputePathTracer::renderUI(Gui::Widgets& widget)
 {
     ImGui::PushItemWidth(40);
@@ -572,6 +1197,8 @@ void ComputePathTracer::renderUI(Gui::Widgets& widget)
     widget.checkbox("MIS", mUseMIS);
     widget.checkbox("power heuristic", mMISUsePowerHeuristic, true);
     widget.tooltip("Active: power heuristic; Inactive: balance heuristic", true);
+    widget.checkbox("wavefront", mWavefront);
+    widget.tooltip("Trace one bounce per dispatch over a compacted queue of the active paths, the nn queries run on full waves. Requires a shader reload.", true);
     if (Gui::Group rr_group = widget.group("RR"))
     {
         rr_group.checkbox("enable", mRRParams.active);
@@ -616,10 +1243,34 @@ void ComputePathTracer::renderUI(Gui::Widgets& widget)
     {
         hc_group.text(std::string("active: ") + (mHCParams.active ? "true" : "false"));
         hc_group.dropdown("HC method", mHCParams.hcMethodList, mHCParams.hcMethod);
+        hc_group.dropdown("probing", mHCParams.probingSchemeList, mHCParams.probingScheme);
+        hc_group.tooltip("How the hash map resolves collisions.\nlinear: scan the whole bucket\nbounded displacement: only test the slots occupied by keys with the same home slot\nbucketized: fingerprint filtered groups of 8 keys, misses stop at the first group with a free slot", true);
         ImGui::PushItemWidth(40);
         ImGui::InputScalar("hashMapSizeExponent", ImGuiDataType_U32, &mHCParams.hashMapSizeExp);
         ImGui::PopItemWidth();
         hc_group.tooltip("Use the radiance estimate from the hc instead of the rr weights.", true);
+        ImGui::PushItemWidth(40);
+        ImGui::InputScalar("max age", ImGuiDataType_U32, &mHCParams.maxAge);
+        ImGui::PopItemWidth();
+        hc_group.tooltip("Entries that were not updated for more than this many frames are evicted during resolve, 0 disables eviction", true);
+        hc_group.checkbox("packed voxels", mHCParams.packedVoxels);
+        hc_group.tooltip("Store the estimate as RGB9E5 next to a 64 bit accumulator of the current frame, half of the voxel memory. Requires a shader reload.", true);
+        hc_group.checkbox("incremental resolve", mHCParams.incrementalResolve);
+        hc_group.tooltip("Only resolve the entries inserted this frame and test a window of the table for eviction. Requires a shader reload.", true);
+        hc_group.checkbox("fit key layout", mHCParams.fitKeyLayout);
+        hc_group.tooltip("Fit the position and level bits of the hash keys to the scene bounds and the distance range of the camera. Requires a shader reload.", true);
+        hc_group.text(fmt::format("key bits: position 3x{}, level {}, direction 2x{}", mHCKeyLayout.positionBitNum, mHCKeyLayout.levelBitNum, mHCKeyLayout.directionBitNum));
+        hc_group.text(fmt::format("expected key collisions: {:.2f}%", 100.f * mHCKeyCollisionRate));
+        hc_group.tooltip("Share of the voxels of the scene bounds whose key aliases another voxel.", true);
+        hc_group.checkbox("per level tables", mHCParams.levelTables);
+        hc_group.tooltip("Split the hash map into one table per grid level sized by the expected occupancy of the level, so the few coarse keys do not compete with the fine ones for slots. Requires a shader reload.", true);
+        if (mHCLevelTables.getTableCount() > 1)
+        {
+            std::string tableSizes;
+            for (uint32_t i = 0; i < mHCLevelTables.getTableCount(); i++)
+                tableSizes += fmt::format("\n  level {}: {}", mHCLevelTables.firstLevel + i, mHCLevelTables.offsets[i + 1] - mHCLevelTables.offsets[i]);
+            hc_group.text("table slots:" + tableSizes);
+        }
         hc_group.checkbox("inject radiance to spread", mHCParams.injectRadianceSpread);
         hc_group.tooltip("Terminate the path as soon as the accumulated roughness blurred the inaccuracies of the hc away. Then, query the hc for a radiance estimate.", true);
         hc_group.checkbox("debug voxels", mHCParams.debugVoxels);
@@ -647,22 +1298,60 @@ void ComputePathTracer::renderUI(Gui::Widgets& widget)
                 ImGui::InputFloat("beta_2", &mNNParams.optimizerParams.param_1, 0.0f, 0.0f, "%.8f");
             }
             ImGui::PopItemWidth();
+            nn_optimizer_group.checkbox("fused", mNNParams.fusedOptimizer);
+            nn_optimizer_group.tooltip("Clear the gradients, run the descent and filter the weights in a single pass.", true);
+            if (mNNParams.fusedOptimizer)
+            {
+                nn_optimizer_group.checkbox("sparse feature grid update", mNNParams.sparseFeatureGridUpdate);
+                nn_optimizer_group.tooltip("Skip feature hash grid entries without gradient, their optimizer state is kept. Requires a shader reload.", true);
+                if (mNNParams.optimizerParams.type == mNNParams.ADAM)
+                {
+                    nn_optimizer_group.checkbox("lazy feature grid adam", mNNParams.lazyFeatureGridAdam);
+                    nn_optimizer_group.tooltip("Skip feature hash grid entries without gradient and apply the missed steps with their next gradient. Requires a shader reload.", true);
+                }
+            }
         }
         ImGui::PushItemWidth(120);
         nn_group.dropdown("NN layer width", mNNParams.nnLayerWidthList, mNNParams.nnLayerWidth);
         nn_group.dropdown("NN method", mNNParams.nnMethodList, mNNParams.nnMethod);
-        if (mNNParams.nnMethod == NNParams::USE_NIRC) mNNParams.mlpCount = 1;
-        else if (mNNParams.nnMethod == NNParams::USE_NRC) mNNParams.mlpCount = 1;
-        if (mNNParams.nnLayerCount.size() != mNNParams.mlpCount) mNNParams.nnLayerCount.resize(mNNParams.mlpCount, 1);
+        if (ImGui::InputInt("MLP count", &mNNParams.mlpCount)) mNNParams.setMLPCount(mNNParams.mlpCount);
+        nn_group.tooltip("Experts of the nn, every one is an mlp with its own feature hash grid that evaluates and trains the queries routed to it. Requires a shader reload.", true);
+        if (mNNParams.mlpCount > 1)
+        {
+            nn_group.dropdown("expert routing", mNNParams.expertRoutingList, mNNParams.expertRouting);
+            nn_group.tooltip("Route the queries to the experts by slabs along the longest axis of the scene or by their material. Requires a shader reload.", true);
+        }
         for (uint i = 0; i < mNNParams.nnLayerCount.size(); i++) ImGui::InputInt(std::string(std::string("MLP ") + std::to_string(i) + std::string(" layer count")).c_str(), &mNNParams.nnLayerCount[i]);
         nn_group.dropdown("enc method", mNNParams.encMethodList, mNNParams.encMethod);
         ImGui::InputFloat("Filter alpha", &mNNParams.filterAlpha, 0.0f, 0.0f, "%.4f");
         nn_group.checkbox("inject radiance to spread", mNNParams.injectRadianceSpread);
         nn_group.checkbox("debug NN output", mNNParams.debugOutput);
+        nn_group.checkbox("deferred queries", mNNParams.deferredQueries);
+        nn_group.tooltip("Record the queries for the radiance injection and the debug output and evaluate them in a batch after the path tracer. Requires a shader reload.", true);
+        nn_group.checkbox("gradient pre-reduction", mNNParams.gradientPreReduction);
+        nn_group.tooltip("Sum the weight gradients of a thread group and the hash grid gradients of a wave before the atomics. Requires a shader reload.", true);
         ImGui::Text("Weight init bounds");
         ImGui::InputFloat("min", &mNNParams.weightInitBound.x, 0.0f, 0.0f, "%.6f");
         ImGui::InputFloat("max", &mNNParams.weightInitBound.y, 0.0f, 0.0f, "%.6f");
         ImGui::InputInt("training bounces", &mNNParams.trainingBounces);
+        nn_group.checkbox("training records", mNNParams.trainingRecords);
+        nn_group.tooltip("Store the vertices of the training paths in a buffer and train on fixed size batches drawn from it, the training cost no longer depends on the resolution. Requires a shader reload.", true);
+        if (mNNParams.trainingRecords)
+        {
+            ImGui::InputScalar("training records per frame", ImGuiDataType_U32, &mNNParams.trainingRecordsPerFrame);
+            nn_group.tooltip("Records the training iterations of a frame train on. The training paths are spread over the frame so that they produce about as many records. Requires a shader reload.", true);
+        }
+        nn_group.checkbox("adaptive training", mNNParams.adaptiveTraining);
+        nn_group.tooltip("Measure the training loss and reduce the training iterations, then the training paths, while the loss plateaus. Camera or scene changes restore the full budget.", true);
+        if (mNNParams.adaptiveTraining)
+        {
+            const TrainingBudget::Budget budget = getTrainingBudget();
+            nn_group.text(fmt::format("training iterations: {}, path tile scale: {}", budget.iterations, budget.pathTileScale));
+        }
+        if (!mLossHistory.empty())
+        {
+            ImGui::PlotLines("training loss", mLossHistory.data(), int(mLossHistory.size()), 0, fmt::format("{:.5f}", mLossHistory.back()).c_str(), 0.f, FLT_MAX, ImVec2(0, 60));
+        }
         ImGui::Separator();
         ImGui::Text("input encoding");
         nn_group.checkbox("hash enc separate level grids", mNNParams.featureHashEncSeparateLevelGrids);
@@ -687,6 +1376,33 @@ void ComputePathTracer::renderUI(Gui::Widgets& widget)
         debug_group.checkbox("accumulate", mIRDebugPassParams.accumulate);
         ImGui::Separator();
         debug_group.checkbox("path length", mDebugPathLength);
+        debug_group.checkbox("lane stats", mLaneStats);
+        debug_group.tooltip("Count the active and launched lanes of every bounce. They are read back a few frames late without stalling. Requires a shader reload.", true);
+        for (size_t i = 0; i < mLaneStatCounts.size(); i++)
+        {
+            const uint2 lanes = mLaneStatCounts[i];
+            if (lanes.y == 0) continue;
+            debug_group.text(fmt::format("bounce {}: {} / {} lanes active ({:.1f}%)", i, lanes.x, lanes.y, 100.f * lanes.x / lanes.y));
+        }
+        debug_group.checkbox("cache stats", mCacheStatsEnabled);
+        debug_group.tooltip("Count the occupancy, failed inserts and probe lengths of the hc and the feature grid parameters with a gradient. They are read back a few frames late without stalling. Requires a shader reload.", true);
+        if (mCacheStats)
+        {
+            const CacheStats& stats = *mCacheStats;
+            if (stats.capacity > 0)
+            {
+                debug_group.text(fmt::format("hc slots: {} / {} ({:.1f}%), failed inserts: {}", stats.occupiedSlots, stats.capacity, 100.f * stats.getLoadFactor(), stats.failedInserts));
+                debug_group.text(fmt::format("hc probes: {:.2f} average, {} max", stats.getAverageProbeCount(), stats.maxProbeCount));
+                std::string levelSlots;
+                for (size_t level = 0; level < stats.levelOccupiedSlots.size(); level++)
+                {
+                    if (stats.levelOccupiedSlots[level] > 0) levelSlots += fmt::format("\n  level {}: {}", level, stats.levelOccupiedSlots[level]);
+                }
+                debug_group.text("hc slots per level:" + levelSlots);
+            }
+            if (stats.featureGridParams > 0)
+                debug_group.text(fmt::format("feature grid params without gradient: {:.1f}%", 100.f * stats.getGradientSparsity()));
+        }
         mpPixelDebug->renderUI(debug_group);
     }
 
@@ -708,3 +1424,88 @@ void ComputePathTracer::setScene(RenderContext* pRenderContext, const ref<Scene>
     reset();
 }
 
+std::string ComputePathTracer::getSceneId() const
+{
+    // the bounds catch edits to a scene file that keep its path
+    const AABB& bounds = mpScene->getSceneBounds();
+    return fmt::format("{} {} {}", mpScene->getPath(), bounds.minPoint, bounds.maxPoint);
+}
+
+void ComputePathTracer::updateHCKeyLayout()
+{
+    const RadianceHashGrid::Layout base = mHCParams.hcMethod == HCParams::USE_IRHC ? RadianceHashGrid::Layout::irhc() : RadianceHashGrid::Layout::rhc();
+    const AABB& bounds = mpScene->getSceneBounds();
+    // hit distances range from the near plane to the scene diagonal, independent of the camera position so the layout stays
+    // valid while the camera moves; longer distances end up on the highest level
+    const float minDistance = std::max(mpScene->getCamera()->getNearPlane(), 1e-4f);
+    const float maxDistance = std::max(length(bounds.extent()), minDistance);
+    const uint32_t levelSpread = RadianceHashCache::kLevelTrainingSpread / 2;
+    mHCKeyLayout = mHCParams.fitKeyLayout && bounds.valid()
+        ? RadianceHashGrid::Layout::fitScene(base, bounds.minPoint, bounds.maxPoint, minDistance, maxDistance, levelSpread)
+        : base;
+    mHCKeyCollisionRate = bounds.valid() ? mHCKeyLayout.estimateCollisionRate(bounds.minPoint, bounds.maxPoint, minDistance, maxDistance, levelSpread) : 0.f;
+    mHCLevelTables = mHCParams.levelTables && bounds.valid()
+        ? RadianceHashGrid::LevelTables::fitScene(mHCKeyLayout, mHCParams.hashMapSize, bounds.minPoint, bounds.maxPoint, minDistance, maxDistance, levelSpread)
+        : RadianceHashGrid::LevelTables();
+}
+
+void ComputePathTracer::saveCaches(const std::filesystem::path& path) const
+{
+    if (!mBuffers[HC_HASH_GRID_ENTRIES_BUFFER] && !mBuffers[NN_PRIMAL_BUFFER]) FALCOR_THROW("ComputePathTracer has no caches to save, execute it first.");
+    CacheSnapshot snapshot;
+    snapshot.setKey(mCacheSnapshotKey);
+    for (const auto& [buffer, name] : kCacheSnapshotBuffers)
+    {
+        if (!mBuffers[buffer]) continue;
+        std::vector<uint8_t> data(mBuffers[buffer]->getSize());
+        mBuffers[buffer]->getBlob(data.data(), 0, data.size());
+        snapshot.setSection(name, std::move(data));
+    }
+    // stamps depend on the frame count, the adam bias correction on the step count
+    snapshot.setValue(kCacheSnapshotFrameCount, mFrameCount);
+    snapshot.setValue(kCacheSnapshotStepCount, mNNParams.optimizerParams.step_count);
+    snapshot.setValue(kCacheSnapshotDescentCount, mDescentCount);
+    snapshot.write(path);
+    logInfo("Saved ComputePathTracer caches to '{}'.", path);
+}
+
+void ComputePathTracer::loadCaches(const std::filesystem::path& path)
+{
+    mPendingCacheSnapshot = CacheSnapshot::read(path);
+    logInfo("Loaded ComputePathTracer caches from '{}', they are applied in the next frame.", path);
+}
+
+void ComputePathTracer::applyCacheSnapshot()
+{
+    const CacheSnapshot snapshot = std::move(*mPendingCacheSnapshot);
+    mPendingCacheSnapshot.reset();
+    if (snapshot.getKey() != mCacheSnapshotKey)
+    {
+        logWarning("Cache snapshot was written for a different scene or configuration, it is ignored.");
+        return;
+    }
+    // the snapshot replaces the reset passes, so every buffer in use has to be restored
+    for (const auto& [buffer, name] : kCacheSnapshotBuffers)
+    {
+        if (!mBuffers[buffer]) continue;
+        if (!snapshot.hasSection(name) || snapshot.getSection(name).size() != mBuffers[buffer]->getSize())
+        {
+            logWarning("Cache snapshot has no matching '{}' buffer, it is ignored.", name);
+            return;
+        }
+    }
+    for (const auto& [buffer, name] : kCacheSnapshotBuffers)
+    {
+        if (!mBuffers[buffer]) continue;
+        const auto& data = snapshot.getSection(name);
+        mBuffers[buffer]->setBlob(data.data(), 0, data.size());
+    }
+    mFrameCount = snapshot.getValue<uint>(kCacheSnapshotFrameCount);
+    mNNParams.optimizerParams.step_count = snapshot.getValue<int>(kCacheSnapshotStepCount);
+    // snapshots of the fixed budget ran the full iterations every frame
+    mDescentCount = snapshot.hasSection(kCacheSnapshotDescentCount) ? snapshot.getValue<uint>(kCacheSnapshotDescentCount)
+                                                                     : mNNParams.optimizerParams.step_count * kTrainingIterations;
+    mHCParams.reset = false;
+    mNNParams.reset = false;
+    mNNParams.gradientsCleared = false;
+}
@@ -31,6 +31,14 @@
 #include "Utils/Debug/PixelDebug.h"
 #include "Rendering/Lights/LightBVHSampler.h"
 #include "Rendering/Lights/EnvMapSampler.h"
+#include "Host/CacheSnapshot.h"
+#include "Host/CacheStats.h"
+#include "Host/RadianceHashGrid.h"
+#include "Host/TinynnExperts.h"
+#include "Host/TrainingBudget.h"
+
+#include <array>
+#include <optional>
 
 using namespace Falcor;
 
@@ -60,28 +68,83 @@ public:
     virtual bool onKeyEvent(const KeyboardEvent& keyEvent) override { return false; }
     virtual void setScene(RenderContext* pRenderContext, const ref<Scene>& pScene) override;
 
+    /// Write the hash cache and network buffers to a snapshot file. The pass must have been executed before.
+    void saveCaches(const std::filesystem::path& path) const;
+    /**
+     * Load a snapshot written by saveCaches(). It is applied in place of the reset passes at the start of the next frame, if the
+     * scene and the shader defines match the ones it was written with.
+     */
+    void loadCaches(const std::filesystem::path& path);
+
+    /// Mean training loss of the last frames that were read back, oldest first.
+    const std::vector<float>& getLossHistory() const { return mLossHistory; }
+    /// Training budget of the next frame, the full budget unless the adaptive training is enabled.
+    TrainingBudget::Budget getTrainingBudget() const;
+    /// Cache stats of the last frame that was read back, empty unless the cache stats are enabled.
+    const std::optional<CacheStats>& getCacheStats() const { return mCacheStats; }
+
+    static void registerBindings(pybind11::module& m);
+
 private:
     void parseProperties(const Properties& props);
     void createPasses(const RenderData& renderData);
     void setupData(RenderContext* pRenderContext);
     void setupBuffers();
     void bindData(const RenderData& renderData, uint2 frameDim);
+    void bindHCData(const ShaderVar& var);
+    void setupWavefrontData(uint2 frameDim);
+    void executeWavefront(RenderContext* pRenderContext, uint2 frameDim);
+    void setupDeferredQueryData(uint2 frameDim);
+    void readLossSamples();
+    void copyLossSample(RenderContext* pRenderContext);
+    void readCacheStats();
+    void copyCacheStats(RenderContext* pRenderContext);
+    void readLaneStats();
+    void copyLaneStats(RenderContext* pRenderContext);
+    std::string getSceneId() const;
+    void updateHCKeyLayout();
+    void applyCacheSnapshot();
 
     enum // Buffer
     {
         HC_HASH_GRID_ENTRIES_BUFFER = 0,
-        HC_VOXEL_DATA_BUFFER_0 = 1,
-        HC_VOXEL_DATA_BUFFER_1 = 2,
-        NN_PRIMAL_BUFFER = 3,
-        NN_FILTERED_PRIMAL_BUFFER = 4,
-        NN_GRADIENT_BUFFER = 5,
-        NN_GRADIENT_COUNT_BUFFER = 6,
-        NN_GRADIENT_AUX_BUFFER = 7,
-        LOSS_SUM_BUFFER = 8,
-        FEATURE_HASH_GRID_ENTRIES_BUFFER = 9,
+        HC_VOXEL_DATA_BUFFER = 1,
+        NN_PRIMAL_BUFFER = 2,
+        NN_FILTERED_PRIMAL_BUFFER = 3,
+        NN_GRADIENT_BUFFER = 4,
+        NN_GRADIENT_COUNT_BUFFER = 5,
+        NN_GRADIENT_AUX_BUFFER = 6,
+        LOSS_SUM_BUFFER = 7,
+        FEATURE_HASH_GRID_ENTRIES_BUFFER = 8,
+        HC_HASH_GRID_META_BUFFER = 9,
+        HC_HASH_GRID_STAMP_BUFFER = 10,
+        HC_DIRTY_LIST_BUFFER = 11,
+        NN_TRAINING_RECORD_BUFFER = 12,
+        NN_TRAINING_RECORD_COUNTER_BUFFER = 13,
+        PT_PATH_STATE_BUFFER = 14,
+        PT_PATH_QUEUE_BUFFER_0 = 15,
+        PT_PATH_QUEUE_BUFFER_1 = 16,
+        PT_LANE_STATS_BUFFER = 17,
+        NN_QUERY_BUFFER = 18,
+        NN_QUERY_ARGS_BUFFER = 19,
+        NN_QUERY_RESULT_BUFFER = 20,
+        CACHE_STATS_BUFFER = 21,
+        NN_QUERY_ORDER_BUFFER = 22,
         BUFFER_COUNT
     };
 
+    // buffers stored in a cache snapshot, gradients, loss, dirty list, training records and queries are recomputed every frame
+    static constexpr std::pair<uint32_t, const char*> kCacheSnapshotBuffers[] = {
+        {HC_HASH_GRID_ENTRIES_BUFFER, "HCHashGridEntries"},
+        {HC_HASH_GRID_META_BUFFER, "HCHashGridMeta"},
+        {HC_HASH_GRID_STAMP_BUFFER, "HCHashGridStamps"},
+        {HC_VOXEL_DATA_BUFFER, "HCVoxelData"},
+        {NN_PRIMAL_BUFFER, "NNPrimal"},
+        {NN_FILTERED_PRIMAL_BUFFER, "NNFilteredPrimal"},
+        {NN_GRADIENT_AUX_BUFFER, "NNGradientAux"},
+        {FEATURE_HASH_GRID_ENTRIES_BUFFER, "FeatureHashGridEntries"},
+    };
+
     enum // Passes
     {
         TRAIN_NN_FILL_CACHE_PASS = 0,
@@ -92,6 +155,15 @@ private:
         NN_GRADIENT_DESCENT_PASS = 5,
         NN_RESET_PASS = 6,
         IR_DEBUG_PASS = 7,
+        HC_EVICT_PASS = 8,
+        NN_FUSED_OPTIMIZER_PASS = 9,
+        NN_TRAIN_BATCH_PASS = 10,
+        PT_GENERATE_PATHS_PASS = 11,
+        PT_EXTEND_PATHS_PASS = 12,
+        NN_BATCH_INFERENCE_PASS = 13,
+        NN_QUERY_RESOLVE_PASS = 14,
+        HC_STATS_PASS = 15,
+        NN_QUERY_BIN_PASS = 16,
         PASS_COUNT
     };
 
@@ -158,6 +230,14 @@ private:
     // Use importance sampling for materials.
     bool mUseImportanceSampling = true;
     bool mDebugPathLength = false;
+    // trace one bounce per dispatch over a compacted queue of the active paths instead of the whole path in one kernel
+    bool mWavefront = false;
+    // count the active and launched lanes of every bounce of the path tracer
+    bool mLaneStats = false;
+    // active and launched lanes per bounce of the newest frame that was read back
+    std::vector<uint2> mLaneStatCounts;
+    // count the occupancy, failed inserts and probe lengths of the hash cache and the feature grid gradients, see CacheStats
+    bool mCacheStatsEnabled = false;
     mutable LightBVHSampler::Options mLightBVHOptions;
 
     std::unique_ptr<EnvMapSampler> mpEnvMapSampler;
@@ -185,12 +265,47 @@ private:
         Gui::DropdownList hcMethodList{Gui::DropdownValue{USE_RHC, "rhc"}, Gui::DropdownValue{USE_IRHC, "irhc"}};
         uint hcMethod = USE_RHC;
 
+        enum ProbingSchemes {
+            PROBING_LINEAR = 0,
+            PROBING_BOUNDED_DISPLACEMENT = 1,
+            PROBING_BUCKETIZED = 2
+        };
+        Gui::DropdownList probingSchemeList{Gui::DropdownValue{PROBING_LINEAR, "linear"}, Gui::DropdownValue{PROBING_BOUNDED_DISPLACEMENT, "bounded displacement"}, Gui::DropdownValue{PROBING_BUCKETIZED, "bucketized"}};
+        uint probingScheme = PROBING_LINEAR;
+        // evict entries that were not updated for more than this many frames, 0 keeps entries until the next reset
+        uint maxAge = 0;
+        // 16 bytes per voxel with an RGB9E5 estimate and a shared exponent accumulator instead of 32 bytes of float estimate and delta
+        bool packedVoxels = false;
+        // resolve only the entries inserted this frame, the entries without new samples keep their estimate
+        bool incrementalResolve = true;
+        // fit the bit widths, level bias and offset of the hash keys to the scene bounds instead of the fixed layout of the method
+        bool fitKeyLayout = true;
+        // one sub-table per grid level sized by its expected occupancy instead of a table shared by all levels
+        bool levelTables = false;
+
+        bool useIncrementalResolve() const { return incrementalResolve; }
+        // the eviction window covers the whole table every maxAge frames
+        uint getEvictCount() const { return maxAge > 0 ? (hashMapSize + maxAge - 1) / maxAge : 0; }
+        uint getEvictOffset(uint frameIndex) const { return maxAge > 0 ? (frameIndex % maxAge) * getEvictCount() : 0; }
+
+        // bytes of probing metadata, a uint offset mask per slot for bounded displacement and a fingerprint byte per slot for bucketized
+        uint getMetaBufferSize() const
+        {
+            if (probingScheme == PROBING_BOUNDED_DISPLACEMENT) return hashMapSize * sizeof(uint32_t);
+            if (probingScheme == PROBING_BUCKETIZED) return hashMapSize;
+            return sizeof(uint32_t);
+        }
+
         void update()
         {
             reset = true;
             hashMapSize = std::pow(2u, hashMapSizeExp);
         }
     } mHCParams;
+    // key layout the shaders are compiled with and its expected share of voxels with a shared key
+    RadianceHashGrid::Layout mHCKeyLayout;
+    float mHCKeyCollisionRate = 0.f;
+    RadianceHashGrid::LevelTables mHCLevelTables;
 
 // NN
     struct NNParams
@@ -209,8 +324,11 @@ private:
             float param_0 = 0.9;
             float param_1 = 0.99;
         } optimizerParams;
+        // layer count of every mlp, each mlp with its feature hash grid is an expert of the nn
         std::vector<int> nnLayerCount = {2};
         int mlpCount = nnLayerCount.size();
+        Gui::DropdownList expertRoutingList{Gui::DropdownValue{uint(tinynn::ExpertRouting::Spatial), "spatial"}, Gui::DropdownValue{uint(tinynn::ExpertRouting::Material), "material"}};
+        uint expertRouting = uint(tinynn::ExpertRouting::Spatial);
         Gui::DropdownList nnLayerWidthList{Gui::DropdownValue{16, "16"}, Gui::DropdownValue{32, "32"}};
         uint nnLayerWidth = 32;
 
@@ -243,6 +361,43 @@ private:
         // how many numbers one element in the hash map contains (how many feature values for each level)
         uint featureHashMapPlacesPerElement = 1;
         int featureHashMapProbingSize = 0;
+        // clear the gradients, run the descent and filter the primal in one dispatch instead of a clear and a descent pass
+        bool fusedOptimizer = true;
+        // fused optimizer only, feature hash grid slots without a gradient keep their optimizer state (sparse adam)
+        bool sparseFeatureGridUpdate = false;
+        // fused adam only, feature hash grid slots without a gradient are skipped and catch up on the missed steps with their next gradient
+        bool lazyFeatureGridAdam = false;
+        // sum the weight gradients of the warps of a group and the hash grid gradients of a wave before the atomics
+        bool gradientPreReduction = true;
+        // the training pass only appends the vertices of its paths to a record buffer and the batch training pass trains on a fixed
+        // number of records drawn from it, instead of training on the paths of the training pass directly
+        bool trainingRecords = false;
+        // records consumed by the training iterations of a frame, also the capacity of the record buffer
+        uint trainingRecordsPerFrame = 1u << 16;
+        // the path tracer records the nn queries that terminate a path (radiance injection and debug output) and a batch inference
+        // pass evaluates them on full waves after the path tracer, instead of every query paying for a whole wave inline
+        bool deferredQueries = false;
+        // reduce the training iterations and paths while the training loss plateaus
+        bool adaptiveTraining = false;
+        // the fused optimizer consumed the gradients of the last training iteration, so the next one does not need a clear pass
+        bool gradientsCleared = false;
+
+        // new mlps get the layer count of the first one
+        void setMLPCount(int count)
+        {
+            mlpCount = std::clamp(count, 1, int(tinynn::kMaxExperts));
+            nnLayerCount.resize(mlpCount, nnLayerCount[0]);
+        }
+        // the experts follow each other in the parameters, every feature hash grid directly follows the weights of its mlp
+        uint getExpertParamBegin(uint expert) const
+        {
+            uint begin = 0;
+            for (uint e = 0; e < expert; e++) begin += nnLayerWidth * nnLayerWidth * nnLayerCount[e] + featureHashMapSize;
+            return begin;
+        }
+        uint getFeatureGridBegin(uint expert) const { return getExpertParamBegin(expert) + nnLayerWidth * nnLayerWidth * nnLayerCount[expert]; }
+        // every vertex of a training path but the last two yields a record
+        uint getTrainingRecordsPerPath() const { return std::max(trainingBounces - 2, 1); }
 
         void update()
         {
@@ -251,6 +406,8 @@ private:
             nnParamCount = ((nnLayerWidth * nnLayerWidth /*weights*/ + nnLayerWidth /*biases*/) * std::reduce(nnLayerCount.begin(), nnLayerCount.end()) + featureHashMapSize /*feature hash grid storage*/ * nnLayerCount.size() /*one feature hashmap per nn*/);
             featureHashMapPlacesPerElement = featureHashEncUseMultiLevelDir ? 1 : 2;
             featureHashEncUseMultiLevelDir &= (nnMethod == USE_NIRC);
+            // at least a full group of the batch training pass
+            trainingRecordsPerFrame = std::max(trainingRecordsPerFrame, 128u);
         }
     } mNNParams;
 
@@ -270,8 +427,46 @@ private:
     } mIRDebugPassParams;
 
     uint mFrameCount = 0;
+    // gradient descent steps since the reset, the lazy adam of the fused optimizer counts skipped steps with it
+    uint mDescentCount = 0;
     bool mOptionsChanged = true;
 
+    // the loss sum of a frame is copied to a slot of a staging buffer and read once its fence signaled, so the readback never
+    // stalls, frames whose slot is still in flight are dropped
+    static constexpr uint32_t kLossReadbackSlots = 4;
+    // float sum and uint count of the losses of a frame
+    static constexpr uint32_t kLossSampleSize = sizeof(float) + sizeof(uint32_t);
+    static constexpr size_t kLossHistorySize = 256;
+    ref<Buffer> mpLossReadbackBuffer;
+    ref<Fence> mpLossFence;
+    // fence value of the copy in a slot, 0 for a free slot
+    std::array<uint64_t, kLossReadbackSlots> mLossReadbackFenceValues{};
+    uint32_t mLossReadbackSlot = 0;
+    std::vector<float> mLossHistory;
+    TrainingBudget mTrainingBudget{TrainingBudget::Desc{}};
+
+    // the cache stats are read back through a ring of staging slots like the loss
+    static constexpr uint32_t kCacheStatsReadbackSlots = 4;
+    static constexpr uint32_t kCacheStatsSize = CacheStats::kWordCount * sizeof(uint32_t);
+    ref<Buffer> mpCacheStatsReadbackBuffer;
+    ref<Fence> mpCacheStatsFence;
+    std::array<uint64_t, kCacheStatsReadbackSlots> mCacheStatsFenceValues{};
+    // hash cache capacity of the frame in a slot, 0 if the hash cache was inactive
+    std::array<uint32_t, kCacheStatsReadbackSlots> mCacheStatsCapacities{};
+    uint32_t mCacheStatsSlot = 0;
+    std::optional<CacheStats> mCacheStats;
+
+    // the lane stats are read back through a ring of staging slots like the loss, a slot holds the counts of every bounce
+    static constexpr uint32_t kLaneStatsReadbackSlots = 4;
+    ref<Buffer> mpLaneStatsReadbackBuffer;
+    ref<Fence> mpLaneStatsFence;
+    std::array<uint64_t, kLaneStatsReadbackSlots> mLaneStatsFenceValues{};
+    uint32_t mLaneStatsSlot = 0;
+
+    // key of the current scene and defines, compared against loaded snapshots
+    CacheSnapshot::Key mCacheSnapshotKey{};
+    std::optional<CacheSnapshot> mPendingCacheSnapshot;
+
     std::array<ref<Buffer>, BUFFER_COUNT> mBuffers;
     std::array<ref<ComputePass>, PASS_COUNT> mPasses;
 };
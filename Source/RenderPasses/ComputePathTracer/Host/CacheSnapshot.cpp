@@ -0,0 +1,170 @@
+#include "CacheSnapshot.h"
+#include "Core/Error.h"
+#include "Utils/StringFormatters.h"
+
+#include <lz4_stream/lz4_stream.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace Falcor
+{
+namespace
+{
+const size_t kBlockSize = 1 * 1024 * 1024;
+const uint64_t kMaxNameSize = 256;
+// sections are read in chunks, a corrupt size then fails on the stream instead of allocating it up front
+const size_t kReadChunkSize = 64 * 1024 * 1024;
+
+const char* kMagic = "FalcorHC";
+struct Header
+{
+    uint8_t magic[8]{};
+    uint32_t version{};
+    CacheSnapshot::Key key{};
+
+    bool isValid() const { return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == CacheSnapshot::kVersion; }
+};
+
+void writeString(std::ostream& stream, const std::string& value)
+{
+    const uint64_t len = value.size();
+    stream.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    stream.write(value.data(), len);
+}
+
+uint64_t readSize(std::istream& stream)
+{
+    uint64_t value = 0;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+void readData(std::istream& stream, uint64_t size, std::vector<uint8_t>& data)
+{
+    while (stream && data.size() < size)
+    {
+        const size_t offset = data.size();
+        const size_t chunkSize = size_t(std::min<uint64_t>(size - offset, kReadChunkSize));
+        data.resize(offset + chunkSize);
+        stream.read(reinterpret_cast<char*>(data.data() + offset), chunkSize);
+    }
+}
+} // namespace
+
+CacheSnapshot::Key CacheSnapshot::computeKey(const std::string& sceneId, const std::map<std::string, std::string>& defines)
+{
+    SHA1 sha1;
+    sha1.update(kVersion);
+    sha1.update(sceneId);
+    // separators keep ("AB", "C") and ("A", "BC") apart
+    sha1.update(uint8_t(0));
+    for (const auto& [name, value] : defines)
+    {
+        sha1.update(name);
+        sha1.update(uint8_t(0));
+        sha1.update(value);
+        sha1.update(uint8_t(0));
+    }
+    return sha1.finalize();
+}
+
+std::map<std::string, std::string> CacheSnapshot::getKeyDefines(const std::map<std::string, std::string>& defines)
+{
+    static const std::string kPrefixes[] = {"HC_", "NN_", "FEATURE_", "MLP_"};
+    static const std::string kDebugPrefixes[] = {"HC_DEBUG_", "NN_DEBUG"};
+    static const std::string kNames[] = {"USE_RHC", "USE_IRHC", "USE_NRC", "USE_NIRC", "USE_MULTI_LEVEL_DIR"};
+    auto hasPrefix = [](const std::string& name, const std::string& prefix) { return name.compare(0, prefix.size(), prefix) == 0; };
+
+    std::map<std::string, std::string> keyDefines;
+    for (const auto& [name, value] : defines)
+    {
+        bool selected = std::find(std::begin(kNames), std::end(kNames), name) != std::end(kNames);
+        for (const auto& prefix : kPrefixes)
+            selected |= hasPrefix(name, prefix);
+        for (const auto& prefix : kDebugPrefixes)
+            selected &= !hasPrefix(name, prefix);
+        if (selected) keyDefines.emplace(name, value);
+    }
+    return keyDefines;
+}
+
+const std::vector<uint8_t>& CacheSnapshot::getSection(const std::string& name) const
+{
+    auto it = mSections.find(name);
+    if (it == mSections.end()) FALCOR_THROW("Cache snapshot has no section '{}'.", name);
+    return it->second;
+}
+
+void CacheSnapshot::checkSize(const std::string& name, size_t size, size_t expectedSize)
+{
+    if (size != expectedSize) FALCOR_THROW("Cache snapshot section '{}' has {} bytes, expected {}.", name, size, expectedSize);
+}
+
+void CacheSnapshot::write(const std::filesystem::path& path) const
+{
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+    std::ofstream fs(path, std::ios_base::binary);
+    if (!fs) FALCOR_THROW("Failed to create cache snapshot file '{}'.", path);
+
+    // Write header (uncompressed).
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(Header::magic));
+    header.version = kVersion;
+    header.key = mKey;
+    fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Write sections (compressed).
+    {
+        lz4_stream::basic_ostream<kBlockSize> zs(fs);
+        const uint64_t sectionCount = mSections.size();
+        zs.write(reinterpret_cast<const char*>(&sectionCount), sizeof(sectionCount));
+        for (const auto& [name, data] : mSections)
+        {
+            if (name.size() > kMaxNameSize) FALCOR_THROW("Cache snapshot section name '{}' is too long.", name);
+            writeString(zs, name);
+            const uint64_t size = data.size();
+            zs.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            zs.write(reinterpret_cast<const char*>(data.data()), size);
+        }
+        // the lz4 frame is finished when the stream is destroyed
+    }
+    if (!fs) FALCOR_THROW("Failed to write cache snapshot file '{}'.", path);
+}
+
+CacheSnapshot CacheSnapshot::read(const std::filesystem::path& path)
+{
+    std::ifstream fs(path, std::ios_base::binary);
+    if (!fs) FALCOR_THROW("Failed to open cache snapshot file '{}'.", path);
+
+    // Read header (uncompressed).
+    Header header;
+    fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fs || !header.isValid()) FALCOR_THROW("Invalid header in cache snapshot file '{}'.", path);
+
+    CacheSnapshot snapshot;
+    snapshot.mKey = header.key;
+
+    // Read sections (compressed).
+    lz4_stream::basic_istream<kBlockSize, kBlockSize> zs(fs);
+    const uint64_t sectionCount = readSize(zs);
+    for (uint64_t i = 0; i < sectionCount; i++)
+    {
+        // the sizes come from the file, names are bounded and data only grows as far as the stream delivers it
+        const uint64_t nameSize = readSize(zs);
+        if (!zs) break;
+        if (nameSize > kMaxNameSize) FALCOR_THROW("Invalid section name size {} in cache snapshot file '{}'.", nameSize, path);
+        std::string name(nameSize, '\0');
+        zs.read(name.data(), name.size());
+        const uint64_t size = readSize(zs);
+        if (!zs) break;
+        std::vector<uint8_t> data;
+        readData(zs, size, data);
+        if (!zs) break;
+        snapshot.mSections[name] = std::move(data);
+    }
+    if (!zs || snapshot.mSections.size() != sectionCount) FALCOR_THROW("Truncated cache snapshot file '{}'.", path);
+    return snapshot;
+}
+} // namespace Falcor
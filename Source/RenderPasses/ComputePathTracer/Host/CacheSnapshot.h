@@ -0,0 +1,82 @@
+#pragma once
+#include "Utils/CryptoUtils.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * On-disk snapshot of the hash cache and network buffers of the ComputePathTracer.
+ * The file holds an uncompressed header with magic, format version and key, followed by an lz4 stream of named sections like the
+ * SceneCache. The key covers the scene and the shader defines, a snapshot only matches a pass that would produce bit-compatible
+ * buffers.
+ */
+class CacheSnapshot
+{
+public:
+    using Key = SHA1::MD;
+
+    /// Incremented every time the file format or the layout of a stored buffer changes.
+    static constexpr uint32_t kVersion = 3;
+
+    /**
+     * Compute the key of a snapshot.
+     * @param[in] sceneId Identifies the scene, e.g. its path and bounds.
+     * @param[in] defines Shader defines of the pass, the order of the map makes the key independent of insertion order.
+     */
+    static Key computeKey(const std::string& sceneId, const std::map<std::string, std::string>& defines);
+
+    /**
+     * Select the defines that change the layout or the content of the cached buffers: the hash cache, network and feature grid
+     * defines and the cache methods. Debug, output and light sampling defines are left out, toggling them keeps a snapshot valid.
+     */
+    static std::map<std::string, std::string> getKeyDefines(const std::map<std::string, std::string>& defines);
+
+    void setKey(const Key& key) { mKey = key; }
+    const Key& getKey() const { return mKey; }
+
+    void setSection(const std::string& name, std::vector<uint8_t> data) { mSections[name] = std::move(data); }
+    bool hasSection(const std::string& name) const { return mSections.count(name) > 0; }
+    /// Data of a section, throws if it does not exist.
+    const std::vector<uint8_t>& getSection(const std::string& name) const;
+    const std::map<std::string, std::vector<uint8_t>>& getSections() const { return mSections; }
+
+    template<typename T>
+    void setValue(const std::string& name, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::vector<uint8_t> data(sizeof(T));
+        std::memcpy(data.data(), &value, sizeof(T));
+        setSection(name, std::move(data));
+    }
+
+    /// Value stored with setValue(), throws if the section does not exist or has a different size.
+    template<typename T>
+    T getValue(const std::string& name) const
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto& data = getSection(name);
+        checkSize(name, data.size(), sizeof(T));
+        T value;
+        std::memcpy(&value, data.data(), sizeof(T));
+        return value;
+    }
+
+    /// Write the snapshot, creates missing directories. Throws on I/O errors.
+    void write(const std::filesystem::path& path) const;
+
+    /// Read a snapshot, throws if the file cannot be read or has a different format version.
+    static CacheSnapshot read(const std::filesystem::path& path);
+
+private:
+    static void checkSize(const std::string& name, size_t size, size_t expectedSize);
+
+    Key mKey{};
+    std::map<std::string, std::vector<uint8_t>> mSections;
+};
+} // namespace Falcor
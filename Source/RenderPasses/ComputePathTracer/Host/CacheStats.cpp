@@ -0,0 +1,42 @@
+#include "CacheStats.h"
+
+#include <algorithm>
+
+namespace Falcor
+{
+float CacheStats::getGradientSparsity() const
+{
+    return featureGridParams > 0 ? 1.f - float(featureGridGradients) / float(featureGridParams) : 0.f;
+}
+
+CacheStats CacheStats::decode(const uint32_t* pWords, uint32_t capacity)
+{
+    CacheStats stats;
+    stats.capacity = capacity;
+    stats.occupiedSlots = pWords[kOccupiedSlotsWord];
+    stats.failedInserts = pWords[kFailedInsertsWord];
+    stats.probeSum = pWords[kProbeSumWord];
+    stats.maxProbeCount = pWords[kMaxProbeCountWord];
+    stats.featureGridParams = pWords[kFeatureGridParamsWord];
+    stats.featureGridGradients = pWords[kFeatureGridGradientsWord];
+    uint32_t levelCount = kLevelCount;
+    while (levelCount > 0 && pWords[kLevelWord + levelCount - 1] == 0) levelCount--;
+    stats.levelOccupiedSlots.assign(pWords + kLevelWord, pWords + kLevelWord + levelCount);
+    return stats;
+}
+
+void CacheStats::accumulate(const RadianceHashGrid& grid, uint32_t* pWords)
+{
+    for (uint32_t idx = 0; idx < grid.getCapacity(); idx++)
+    {
+        const RadianceHashGrid::HashKey hashKey = grid.getEntry(idx);
+        if (hashKey == RadianceHashGrid::kInvalidHashKey) continue;
+        uint32_t probeCount = 0;
+        grid.findEntry(hashKey, &probeCount);
+        pWords[kOccupiedSlotsWord]++;
+        pWords[kProbeSumWord] += probeCount;
+        pWords[kMaxProbeCountWord] = std::max(pWords[kMaxProbeCountWord], probeCount);
+        pWords[kLevelWord + std::min(grid.getKeyLevel(hashKey), kLevelCount - 1)]++;
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,63 @@
+#pragma once
+#include "RadianceHashGrid.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Health counters of the hash cache and the nn feature grid of a frame. The GPU accumulates them in a small buffer of uints, see
+ * CacheStats.slang: the hash cache inserts count their failures, the optimizer passes count the feature grid parameters with a
+ * gradient and the stats pass adds the occupancy and the probe lengths of the table at the end of the frame. The host decodes a copy
+ * of the buffer that was read back a few frames later.
+ *
+ * | occupied slots | failed inserts | probe sum | max probes | grid params | grid params with gradient | occupied slots per level |
+ */
+struct CacheStats
+{
+    static constexpr uint32_t kOccupiedSlotsWord = 0;
+    static constexpr uint32_t kFailedInsertsWord = 1;
+    static constexpr uint32_t kProbeSumWord = 2;
+    static constexpr uint32_t kMaxProbeCountWord = 3;
+    static constexpr uint32_t kFeatureGridParamsWord = 4;
+    static constexpr uint32_t kFeatureGridGradientsWord = 5;
+    static constexpr uint32_t kLevelWord = 6;
+    /// Levels with a counter, the keys of higher levels are counted in the last one. Matches CACHE_STATS_LEVEL_COUNT.
+    static constexpr uint32_t kLevelCount = 64;
+    static constexpr uint32_t kWordCount = kLevelWord + kLevelCount;
+
+    /// Hash cache slots, 0 if the hash cache was inactive.
+    uint32_t capacity = 0;
+    uint32_t occupiedSlots = 0;
+    /// Inserts of the frame that found no free slot within their bucket.
+    uint32_t failedInserts = 0;
+    /// Sum and maximum of the loads a lookup of every stored key takes, counted like RadianceHashGrid::findEntry().
+    uint64_t probeSum = 0;
+    uint32_t maxProbeCount = 0;
+    /// Feature grid parameters visited by the optimizer passes of the frame, once per training iteration.
+    uint32_t featureGridParams = 0;
+    /// Visited feature grid parameters with a gradient count above zero.
+    uint32_t featureGridGradients = 0;
+    /// Occupied slots per grid level, up to the highest level with keys.
+    std::vector<uint32_t> levelOccupiedSlots;
+
+    float getLoadFactor() const { return capacity > 0 ? float(occupiedSlots) / float(capacity) : 0.f; }
+    float getAverageProbeCount() const { return occupiedSlots > 0 ? float(double(probeSum) / double(occupiedSlots)) : 0.f; }
+    /// Share of the visited feature grid parameters without a gradient.
+    float getGradientSparsity() const;
+
+    /**
+     * Decode a stats buffer.
+     * @param[in] pWords kWordCount words as written by the shaders.
+     * @param[in] capacity Hash cache slots, 0 if the hash cache was inactive.
+     */
+    static CacheStats decode(const uint32_t* pWords, uint32_t capacity);
+
+    /**
+     * Add the occupancy and probe lengths of a grid to a stats buffer like the stats pass does. Failed inserts and the feature grid
+     * counters are not touched, the shaders count them while the frame runs.
+     */
+    static void accumulate(const RadianceHashGrid& grid, uint32_t* pWords);
+};
+} // namespace Falcor
@@ -0,0 +1,323 @@
+#include "RadianceHashCache.h"
+#include "VoxelPacking.h"
+#include "Core/Error.h"
+
+#include <algorithm>
+
+namespace Falcor
+{
+namespace
+{
+void atomicAddF32(std::atomic<uint32_t>& word, float value)
+{
+    uint32_t prev = word.load(std::memory_order_relaxed);
+    while (!word.compare_exchange_weak(prev, math::asuint(math::asfloat(prev) + value), std::memory_order_relaxed))
+        ;
+}
+
+uint32_t getHashMapSize(uint32_t hashMapSizeExp)
+{
+    FALCOR_CHECK(hashMapSizeExp < 32, "Hash map size exponent must be smaller than 32, got {}.", hashMapSizeExp);
+    return 1u << hashMapSizeExp;
+}
+} // namespace
+
+RadianceHashCache::RadianceHashCache(
+    Method method,
+    uint32_t hashMapSizeExp,
+    RadianceHashGrid::ProbingScheme probingScheme,
+    VoxelLayout voxelLayout
+)
+    : mMethod(method)
+    , mVoxelLayout(voxelLayout)
+    , mHashGrid(
+          method == Method::IRHC ? RadianceHashGrid::Layout::irhc() : RadianceHashGrid::Layout::rhc(),
+          getHashMapSize(hashMapSizeExp),
+          probingScheme
+      )
+{
+    if (mVoxelLayout == VoxelLayout::Packed)
+    {
+        mPackedVoxelData = std::make_unique<std::atomic<uint64_t>[]>(size_t(getCapacity()) * kPackedVoxelWordCount);
+    }
+    else
+    {
+        mVoxelData = std::make_unique<std::atomic<uint32_t>[]>(size_t(getCapacity()) * kVoxelWordCount);
+    }
+    reset();
+}
+
+RadianceHashCache::VoxelData RadianceHashCache::getVoxelData(bool usePrev, uint32_t idx) const
+{
+    VoxelData voxelData;
+    // invalid and out of range indices read as zero like with robust buffer access on the GPU
+    if (idx >= getCapacity()) return voxelData;
+    if (mVoxelLayout == VoxelLayout::Packed)
+    {
+        const uint64_t payload = mPackedVoxelData[size_t(idx) * kPackedVoxelWordCount].load(std::memory_order_relaxed);
+        voxelData.radiance = hc::decodeRGB9E5(uint32_t(payload));
+        voxelData.sampleNum = uint32_t(payload >> 32) & 0xffff;
+        if (!usePrev) voxelData.sampleNum += uint32_t(payload >> 48);
+        return voxelData;
+    }
+    const std::atomic<uint32_t>* pWords = getVoxelWords(idx);
+    voxelData.radiance.x = math::asfloat(pWords[0].load(std::memory_order_relaxed));
+    voxelData.radiance.y = math::asfloat(pWords[1].load(std::memory_order_relaxed));
+    voxelData.radiance.z = math::asfloat(pWords[2].load(std::memory_order_relaxed));
+    voxelData.sampleNum = pWords[3].load(std::memory_order_relaxed);
+    if (!usePrev) voxelData.sampleNum += getDeltaWords(idx)[3].load(std::memory_order_relaxed);
+    return voxelData;
+}
+
+float3 RadianceHashCache::getVoxelRadianceSum(uint32_t idx) const
+{
+    if (idx >= getCapacity() || mVoxelLayout == VoxelLayout::Packed) return float3(0.f);
+    const std::atomic<uint32_t>* pDelta = getDeltaWords(idx);
+    return float3(
+        math::asfloat(pDelta[0].load(std::memory_order_relaxed)),
+        math::asfloat(pDelta[1].load(std::memory_order_relaxed)),
+        math::asfloat(pDelta[2].load(std::memory_order_relaxed))
+    );
+}
+
+void RadianceHashCache::setVoxelData(uint32_t idx, const VoxelData& data)
+{
+    if (idx >= getCapacity()) return;
+    if (mVoxelLayout == VoxelLayout::Packed)
+    {
+        std::atomic<uint64_t>* pWords = &mPackedVoxelData[size_t(idx) * kPackedVoxelWordCount];
+        pWords[0].store(uint64_t(hc::encodeRGB9E5(data.radiance)) | (uint64_t(std::min(data.sampleNum, 0xffffu)) << 32), std::memory_order_relaxed);
+        pWords[1].store(0, std::memory_order_relaxed);
+        return;
+    }
+    std::atomic<uint32_t>* pWords = getVoxelWords(idx);
+    pWords[0].store(math::asuint(data.radiance.x), std::memory_order_relaxed);
+    pWords[1].store(math::asuint(data.radiance.y), std::memory_order_relaxed);
+    pWords[2].store(math::asuint(data.radiance.z), std::memory_order_relaxed);
+    pWords[3].store(data.sampleNum, std::memory_order_relaxed);
+    std::atomic<uint32_t>* pDelta = getDeltaWords(idx);
+    for (uint32_t i = 0; i < kDeltaWordCount; i++)
+        pDelta[i].store(0, std::memory_order_relaxed);
+}
+
+void RadianceHashCache::addVoxelData(const VoxelIndices& idx, float3 value, bool newSample)
+{
+    for (uint32_t i = 0; i < kLevelTrainingSpread; i++)
+    {
+        // writes past the end of the table are dropped on the GPU
+        if (idx[i] >= getCapacity()) continue;
+        if (mVoxelLayout == VoxelLayout::Packed)
+        {
+            std::atomic<uint64_t>* pWords = &mPackedVoxelData[size_t(idx[i]) * kPackedVoxelWordCount];
+            if (value.x > 0.f || value.y > 0.f || value.z > 0.f)
+            {
+                uint64_t prev = pWords[1].load(std::memory_order_relaxed);
+                while (!pWords[1].compare_exchange_weak(prev, hc::accumulate(prev, value), std::memory_order_relaxed))
+                    ;
+            }
+            // the count of the current frame lives in the upper 16 bits and saturates like on the GPU
+            if (newSample)
+            {
+                uint64_t prevPayload = pWords[0].load(std::memory_order_relaxed);
+                while ((prevPayload >> 48) != 0xffff &&
+                       !pWords[0].compare_exchange_weak(prevPayload, prevPayload + (1ull << 48), std::memory_order_relaxed))
+                    ;
+            }
+            continue;
+        }
+        std::atomic<uint32_t>* pWords = getDeltaWords(idx[i]);
+        if (value.x > 0.f) atomicAddF32(pWords[0], value.x);
+        if (value.y > 0.f) atomicAddF32(pWords[1], value.y);
+        if (value.z > 0.f) atomicAddF32(pWords[2], value.z);
+        if (newSample) pWords[3].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+RadianceHashCache::VoxelIndices RadianceHashCache::insertEntries(const HitData& hitData)
+{
+    VoxelIndices idx;
+    for (uint32_t i = 0; i < kLevelTrainingSpread; i++)
+    {
+        const int levelOffset = int(i) - int(kLevelTrainingSpread / 2);
+        const auto hashKey =
+            mHashGrid.computeSpatialHash(hitData.distance, hitData.positionWorld, hitData.direction, hitData.normalWorld, levelOffset);
+        idx[i] = mHashGrid.insertEntry(hashKey);
+    }
+    return idx;
+}
+
+void RadianceHashCache::updateMiss(PathState& state, float3 radiance)
+{
+    for (uint32_t i = 0; i < state.pathLength; ++i)
+    {
+        if (mMethod == Method::RHC)
+        {
+            radiance *= state.sampleWeights[i];
+            addVoxelData(state.voxelIndices[i], radiance, false);
+        }
+        else
+        {
+            addVoxelData(state.voxelIndices[i], radiance, false);
+            radiance *= state.sampleWeights[i];
+        }
+    }
+}
+
+void RadianceHashCache::updateHit(PathState& state, const HitData& hitData, float3 radiance)
+{
+    updateMiss(state, radiance);
+    for (uint32_t i = state.pathLength; i > 0; --i)
+    {
+        state.voxelIndices[i] = state.voxelIndices[i - 1];
+        state.sampleWeights[i] = state.sampleWeights[i - 1];
+    }
+    state.voxelIndices[0] = insertEntries(hitData);
+    state.pathLength = std::min(state.pathLength + 1, kPropagationDepth - 1);
+    if (mMethod == Method::IRHC) radiance = float3(0.f);
+    addVoxelData(state.voxelIndices[0], radiance, true);
+}
+
+bool RadianceHashCache::getCachedRadiance(const HitData& hitData, float3& radiance) const
+{
+    radiance = float3(0.f);
+    const auto hashKey = mHashGrid.computeSpatialHash(hitData.distance, hitData.positionWorld, hitData.direction, hitData.normalWorld);
+    const uint32_t idx = mHashGrid.findEntry(hashKey);
+    if (idx == RadianceHashGrid::kInvalidIdx) return false;
+    // only the resolved samples contribute to the estimate
+    const VoxelData voxelData = getVoxelData(true, idx);
+    if (voxelData.sampleNum > 0)
+    {
+        radiance = voxelData.radiance;
+        return true;
+    }
+    return false;
+}
+
+float3 RadianceHashCache::combineRadiance(float3 prevRadiance, uint32_t prevSampleNum, float3 radianceSum, uint32_t sampleNum) const
+{
+    const uint32_t newSampleNum = sampleNum - prevSampleNum;
+    if (newSampleNum == 0) return prevRadiance;
+    if (mMethod == Method::IRHC && sampleNum < 32)
+    {
+        radianceSum += prevRadiance * float(prevSampleNum);
+        return radianceSum / float(sampleNum);
+    }
+    float3 radiance = radianceSum / float(newSampleNum);
+    if (prevSampleNum > 0)
+    {
+        const float weight = float(newSampleNum) * (mMethod == Method::RHC ? 0.001f : 0.0015f);
+        radiance = (1 - weight) * prevRadiance + weight * radiance;
+    }
+    return radiance;
+}
+
+void RadianceHashCache::combinePacked(uint32_t idx)
+{
+    std::atomic<uint64_t>* pWords = &mPackedVoxelData[size_t(idx) * kPackedVoxelWordCount];
+    const uint64_t payload = pWords[0].load(std::memory_order_relaxed);
+    const uint32_t prevSampleNum = uint32_t(payload >> 32) & 0xffff;
+    const uint32_t sampleNum = prevSampleNum + uint32_t(payload >> 48);
+    if (sampleNum == 0)
+    {
+        // radiance spread to a voxel without samples is dropped, like in the float layout
+        pWords[1].store(0, std::memory_order_relaxed);
+        return;
+    }
+    const float3 radiance =
+        combineRadiance(hc::decodeRGB9E5(uint32_t(payload)), prevSampleNum, hc::decodeAccumulator(pWords[1].load(std::memory_order_relaxed)), sampleNum);
+    pWords[0].store(uint64_t(hc::encodeRGB9E5(radiance)) | (uint64_t(std::min(sampleNum, 0xffffu)) << 32), std::memory_order_relaxed);
+    pWords[1].store(0, std::memory_order_relaxed);
+}
+
+void RadianceHashCache::combine(uint32_t idx)
+{
+    if (mVoxelLayout == VoxelLayout::Packed)
+    {
+        combinePacked(idx);
+        return;
+    }
+    // voxels without samples in this frame only read their delta
+    const float3 radianceSum = getVoxelRadianceSum(idx);
+    const uint32_t newSampleNum = getDeltaWords(idx)[3].load(std::memory_order_relaxed);
+    if (newSampleNum == 0 && radianceSum.x == 0.f && radianceSum.y == 0.f && radianceSum.z == 0.f) return;
+    VoxelData voxelData = getVoxelData(true, idx);
+    const uint32_t sampleNum = voxelData.sampleNum + newSampleNum;
+    voxelData.radiance = combineRadiance(voxelData.radiance, voxelData.sampleNum, radianceSum, sampleNum);
+    voxelData.sampleNum = std::min(kMaxSampleCount, sampleNum);
+    setVoxelData(idx, voxelData);
+}
+
+void RadianceHashCache::resolve(uint32_t begin, uint32_t end)
+{
+    FALCOR_CHECK(begin <= end && end <= getCapacity(), "Resolve range [{}, {}) is out of bounds.", begin, end);
+    for (uint32_t i = begin; i < end; i++)
+    {
+        if (mHashGrid.isStale(i))
+        {
+            evictSlot(i);
+            continue;
+        }
+        combine(i);
+    }
+}
+
+void RadianceHashCache::evictSlot(uint32_t idx)
+{
+    mHashGrid.evictEntry(idx);
+    if (mVoxelLayout == VoxelLayout::Packed)
+    {
+        setVoxelData(idx, VoxelData());
+        return;
+    }
+    // both deltas, like hashCacheResetVoxelData()
+    std::atomic<uint32_t>* pWords = getVoxelWords(idx);
+    for (uint32_t i = 0; i < kVoxelWordCount; i++)
+        pWords[i].store(0, std::memory_order_relaxed);
+}
+
+void RadianceHashCache::setIncrementalResolve(bool enabled)
+{
+    mHashGrid.setTrackDirtySlots(enabled);
+}
+
+void RadianceHashCache::resolveDirty(uint32_t begin, uint32_t end)
+{
+    FALCOR_CHECK(getIncrementalResolve(), "Incremental resolve is not enabled.");
+    FALCOR_CHECK(begin <= end && end <= mHashGrid.getDirtySlotCount(), "Dirty list range [{}, {}) is out of bounds.", begin, end);
+    for (uint32_t i = begin; i < end; i++)
+        combine(mHashGrid.getDirtySlot(i));
+}
+
+void RadianceHashCache::evict(uint32_t begin, uint32_t end)
+{
+    FALCOR_CHECK(begin <= end && end <= getCapacity(), "Evict range [{}, {}) is out of bounds.", begin, end);
+    for (uint32_t i = begin; i < end; i++)
+    {
+        if (mHashGrid.isStale(i)) evictSlot(i);
+    }
+}
+
+void RadianceHashCache::endFrame()
+{
+    mFrameCount++;
+    mHashGrid.setFrameIndex(mFrameCount);
+    mHashGrid.clearDirtySlots();
+}
+
+void RadianceHashCache::reset()
+{
+    mHashGrid.reset();
+    if (mVoxelLayout == VoxelLayout::Packed)
+    {
+        for (size_t i = 0; i < size_t(getCapacity()) * kPackedVoxelWordCount; i++)
+            mPackedVoxelData[i].store(0, std::memory_order_relaxed);
+    }
+    else
+    {
+        for (size_t i = 0; i < size_t(getCapacity()) * kVoxelWordCount; i++)
+            mVoxelData[i].store(0, std::memory_order_relaxed);
+    }
+    mFrameCount = 0;
+    mHashGrid.setFrameIndex(mFrameCount);
+}
+} // namespace Falcor
@@ -0,0 +1,157 @@
+#pragma once
+#include "RadianceHashGrid.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace Falcor
+{
+/**
+ * Host-side mirror of the radiance hash cache in RadianceHashCacheCommon.slang.
+ * Holds the hash grid and a voxel record per slot with the resolved estimate and the samples of the current frame. Accumulation uses
+ * CAS-based atomics so that training samples can be splatted from many threads like in the training pass. combine() and resolve()
+ * reproduce the shader math.
+ */
+class RadianceHashCache
+{
+public:
+    // matches ComputePathTracer::HCParams::HCMethods
+    enum class Method
+    {
+        RHC = 0,
+        IRHC = 1,
+    };
+
+    // matches ComputePathTracer::HCParams::packedVoxels
+    enum class VoxelLayout
+    {
+        // float3 estimate and uint sample count followed by a float3 radiance sum and uint sample count delta, 32 bytes per voxel.
+        // The parity of the frame count selects the delta of the current frame.
+        Float = 0,
+        // RGB9E5 estimate, 16-bit sample counts and a shared exponent accumulator in a single buffer, 16 bytes per voxel
+        Packed = 1,
+    };
+
+    static constexpr uint32_t kLevelTrainingSpread = 3;
+    static constexpr uint32_t kPropagationDepth = 8;
+    // prevent overflow by only counting samples to this limit
+    static constexpr uint32_t kMaxSampleCount = 65536;
+
+    using VoxelIndices = std::array<uint32_t, kLevelTrainingSpread>;
+
+    struct VoxelData
+    {
+        float3 radiance = float3(0.f);
+        uint32_t sampleNum = 0;
+    };
+
+    struct HitData
+    {
+        float distance = 0.f;
+        float3 positionWorld = float3(0.f);
+        float3 normalWorld = float3(0.f);
+        float3 direction = float3(0.f);
+    };
+
+    /// Per-path training state, mirrors hc::HashCacheState with HC_UPDATE.
+    struct PathState
+    {
+        VoxelIndices voxelIndices[kPropagationDepth];
+        float3 sampleWeights[kPropagationDepth];
+        uint32_t pathLength = 0;
+    };
+
+    /**
+     * Create an empty cache.
+     * @param[in] method Cache variant, selects key layout and combine weights.
+     * @param[in] hashMapSizeExp Log2 of the number of slots, corresponds to the HCHashMapSizeExponent property.
+     * @param[in] probingScheme Collision resolution of the hash grid, corresponds to the HCProbingScheme property.
+     * @param[in] voxelLayout Voxel storage, corresponds to the HCPackedVoxels property.
+     */
+    RadianceHashCache(
+        Method method,
+        uint32_t hashMapSizeExp,
+        RadianceHashGrid::ProbingScheme probingScheme = RadianceHashGrid::ProbingScheme::Linear,
+        VoxelLayout voxelLayout = VoxelLayout::Float
+    );
+
+    Method getMethod() const { return mMethod; }
+    VoxelLayout getVoxelLayout() const { return mVoxelLayout; }
+    uint32_t getCapacity() const { return mHashGrid.getCapacity(); }
+    RadianceHashGrid& getHashGrid() { return mHashGrid; }
+    const RadianceHashGrid& getHashGrid() const { return mHashGrid; }
+
+    /**
+     * Read a voxel. The radiance is the resolved estimate, the sample count includes the samples of the current frame unless usePrev
+     * is set.
+     */
+    VoxelData getVoxelData(bool usePrev, uint32_t idx) const;
+    /// Set the resolved estimate of a voxel and clear the samples of the current frame.
+    void setVoxelData(uint32_t idx, const VoxelData& data);
+    /// Radiance sum of the samples of the current frame, only the float layout keeps it, the packed layout reads 0.
+    float3 getVoxelRadianceSum(uint32_t idx) const;
+    /// Thread-safe accumulation into the samples of the current frame, only positive components are added.
+    void addVoxelData(const VoxelIndices& idx, float3 value, bool newSample);
+
+    /// Insert the voxels on the training spread levels around a hit.
+    VoxelIndices insertEntries(const HitData& hitData);
+
+    void updateHit(PathState& state, const HitData& hitData, float3 radiance);
+    void updateMiss(PathState& state, float3 radiance);
+    void setThroughput(PathState& state, float3 throughput) const { state.sampleWeights[0] = throughput; }
+
+    bool getCachedRadiance(const HitData& hitData, float3& radiance) const;
+
+    /// Merge the samples of the current frame into the running estimate of one slot, mirrors hashCacheCombine().
+    void combine(uint32_t idx);
+    /**
+     * Combine the slots in [begin, end) and evict stale entries like hashCacheResolve(). Slots can be resolved in parallel from
+     * different threads.
+     */
+    void resolve(uint32_t begin, uint32_t end);
+    void resolve() { resolve(0, getCapacity()); }
+
+    /// Only resolve the slots inserted in the current frame, mirrors HC_INCREMENTAL_RESOLVE.
+    void setIncrementalResolve(bool enabled);
+    bool getIncrementalResolve() const { return mHashGrid.getTrackDirtySlots(); }
+    /// Combine the entries [begin, end) of the dirty list like the incremental hashCacheResolve(), thread-safe for disjoint ranges.
+    void resolveDirty(uint32_t begin, uint32_t end);
+    void resolveDirty() { resolveDirty(0, mHashGrid.getDirtySlotCount()); }
+    /// Evict stale entries in the slots [begin, end) like hashCacheEvict(), thread-safe for disjoint ranges.
+    void evict(uint32_t begin, uint32_t end);
+
+    /**
+     * Advance the frame count like the render pass does between frames, advance the hash grid frame index and start a new dirty
+     * list.
+     */
+    void endFrame();
+    uint32_t getFrameCount() const { return mFrameCount; }
+
+    /// Clear keys and voxel data, mirrors the HC reset pass.
+    void reset();
+
+private:
+    // estimate and delta, same layout as the 32 byte shader record
+    static constexpr uint32_t kVoxelWordCount = 8;
+    static constexpr uint32_t kDeltaWordOffset = 4;
+    static constexpr uint32_t kDeltaWordCount = 4;
+    // packed voxel: RGB9E5 estimate | sample count << 32 | new sample count << 48, then the accumulator
+    static constexpr uint32_t kPackedVoxelWordCount = 2;
+
+    float3 combineRadiance(float3 prevRadiance, uint32_t prevSampleNum, float3 radianceSum, uint32_t sampleNum) const;
+    void combinePacked(uint32_t idx);
+    void evictSlot(uint32_t idx);
+
+    std::atomic<uint32_t>* getVoxelWords(uint32_t idx) const { return &mVoxelData[size_t(idx) * kVoxelWordCount]; }
+    std::atomic<uint32_t>* getDeltaWords(uint32_t idx) const { return getVoxelWords(idx) + kDeltaWordOffset; }
+
+    Method mMethod;
+    VoxelLayout mVoxelLayout;
+    RadianceHashGrid mHashGrid;
+    std::unique_ptr<std::atomic<uint32_t>[]> mVoxelData;
+    std::unique_ptr<std::atomic<uint64_t>[]> mPackedVoxelData;
+    uint32_t mFrameCount = 0;
+};
+} // namespace Falcor
@@ -0,0 +1,666 @@
+#include "RadianceHashGrid.h"
+#include "Core/Error.h"
+#include "Core/Platform/OS.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Falcor
+{
+namespace
+{
+const float kPi = 3.14159265358979323846f;
+
+// float to integer conversions follow the D3D rules the shaders rely on: NaN maps to 0 and out of range values saturate
+uint32_t toUint(float v)
+{
+    if (!(v > 0.f)) return 0;
+    if (v >= 4294967296.f) return std::numeric_limits<uint32_t>::max();
+    return uint32_t(v);
+}
+
+int32_t toInt(float v)
+{
+    if (std::isnan(v)) return 0;
+    if (v >= 2147483648.f) return std::numeric_limits<int32_t>::max();
+    if (v <= -2147483648.f) return std::numeric_limits<int32_t>::min();
+    return int32_t(v);
+}
+
+float logOfBase(float x, float base)
+{
+    return std::log(x) / std::log(base);
+}
+
+float2 convertDirToPolar(float3 input)
+{
+    return float2(std::atan(input.y / input.x), std::acos(input.z));
+}
+
+uint2 quantizePolarToBitRange(float2 input, uint32_t newMax)
+{
+    const float range = float(newMax + 1) - 0.001f;
+    uint2 result;
+    result.x = toUint(((input.x + kPi) / (kPi + kPi)) * range);
+    result.y = toUint((input.y / kPi) * range);
+    return result;
+}
+
+// bits needed to store the values [0, count)
+uint32_t getBitNum(double count)
+{
+    uint32_t bitNum = 1;
+    while (bitNum < 63 && double(uint64_t(1) << bitNum) < count) bitNum++;
+    return bitNum;
+}
+
+// levels with their own failed insert counter, the higher levels of layouts with many level bits share the last one
+uint32_t getStatsLevelCount(const RadianceHashGrid::Layout& layout)
+{
+    return uint32_t(std::min<uint64_t>(layout.getLevelBitMask(), 1023) + 1);
+}
+
+// fraction of the voxels of a level whose key is shared with another voxel of the AABB
+double getLevelCollisionRate(const RadianceHashGrid::Layout& layout, int32_t gridLevel, float3 sceneMin, float3 sceneMax)
+{
+    // the level wraps around the level bits and aliases another level
+    if (gridLevel < 0 || uint64_t(gridLevel) > layout.getLevelBitMask()) return 1.0;
+    const double voxelSize = layout.getVoxelSize(uint32_t(gridLevel));
+    const double slotCount = double(uint64_t(1) << layout.positionBitNum);
+    // a key is unique iff the grid position is unique modulo the position bits on every axis
+    double uniqueFraction = 1.0;
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        const double lo = std::floor((sceneMin[axis] + layout.positionOffset[axis]) / voxelSize);
+        const double hi = std::floor((sceneMax[axis] + layout.positionOffset[axis]) / voxelSize);
+        const double cellCount = hi - lo + 1.0;
+        const double wraps = std::floor(cellCount / slotCount);
+        if (wraps >= 2.0) return 1.0;
+        // after a single wrap the positions of the first cellCount - slotCount slots are taken twice
+        if (wraps == 1.0) uniqueFraction *= (2.0 * slotCount - cellCount) / cellCount;
+    }
+    return 1.0 - uniqueFraction;
+}
+} // namespace
+
+RadianceHashGrid::Layout RadianceHashGrid::Layout::rhc()
+{
+    Layout layout;
+    layout.positionBitNum = 17;
+    layout.directionBitNum = 0;
+    layout.levelBitNum = 10;
+    layout.normalBitNum = 3;
+    layout.sceneScale = 60.f;
+    return layout;
+}
+
+RadianceHashGrid::Layout RadianceHashGrid::Layout::irhc()
+{
+    Layout layout;
+    layout.positionBitNum = 15;
+    layout.directionBitNum = 3;
+    layout.levelBitNum = 7;
+    layout.normalBitNum = 3;
+    layout.sceneScale = 45.f;
+    return layout;
+}
+
+RadianceHashGrid::Layout RadianceHashGrid::Layout::fitScene(
+    const Layout& base,
+    float3 sceneMin,
+    float3 sceneMax,
+    float minDistance,
+    float maxDistance,
+    uint32_t levelSpread
+)
+{
+    FALCOR_CHECK(minDistance > 0.f && maxDistance >= minDistance, "Invalid hit distance range [{}, {}].", minDistance, maxDistance);
+    FALCOR_CHECK(all(sceneMax >= sceneMin), "Invalid scene bounds.");
+
+    Layout layout = base;
+    const int32_t spread = int32_t(levelSpread);
+    const float3 extent = sceneMax - sceneMin;
+    const float maxExtent = std::max({extent.x, extent.y, extent.z});
+    // the level bits depend on the distance range and the position bits on the level bits, a few rounds settle both
+    float fitMinDistance = minDistance;
+    for (uint32_t round = 0; round < 4; round++)
+    {
+        // the closest hits land on level 1, the lowest level GetGridLevel() returns, the spread below reaches level 1 - spread
+        layout.levelBias = 1 - int32_t(std::floor(logOfBase(fitMinDistance, layout.logBase)));
+        const int32_t maxLevel = int32_t(std::floor(logOfBase(std::max(maxDistance, fitMinDistance), layout.logBase))) + layout.levelBias + spread;
+        layout.levelBitNum = getBitNum(double(maxLevel) + 1.0);
+        const uint32_t freeBitNum = 64 - layout.normalBitNum - layout.levelBitNum - 2 * layout.directionBitNum;
+        FALCOR_CHECK(freeBitNum >= 3, "The key has no bits left for the position.");
+        // the position is converted to int, so 31 bits are the limit
+        layout.positionBitNum = std::min(freeBitNum / 3, 31u);
+
+        // closest distance whose finest spread level still covers the scene without wrapping around the position bits, closer
+        // hits are clamped to level 1 and get coarser voxels instead of sharing them with the other side of the scene
+        const double cellCount = double((uint64_t(1) << layout.positionBitNum) - 1);
+        const float wrapFreeDistance = std::pow(
+            layout.logBase, std::ceil(logOfBase(float(layout.sceneScale * maxExtent / cellCount), layout.logBase)) + float(spread)
+        );
+        if (!(wrapFreeDistance > fitMinDistance)) break;
+        fitMinDistance = wrapFreeDistance;
+    }
+    layout.positionOffset = -sceneMin;
+    return layout;
+}
+
+uint32_t RadianceHashGrid::Layout::getGridLevel(float distance) const
+{
+    const float level = std::floor(logOfBase(distance, logBase) + float(levelBias));
+    // fmax/fmin instead of std::clamp to get the GPU behavior for NaN
+    return toUint(std::fmin(std::fmax(level, 1.f), float(getLevelBitMask())));
+}
+
+float RadianceHashGrid::Layout::getVoxelSize(uint32_t gridLevel) const
+{
+    return std::pow(logBase, float(gridLevel)) / (sceneScale * std::pow(logBase, float(levelBias)));
+}
+
+float RadianceHashGrid::Layout::estimateCollisionRate(
+    float3 sceneMin,
+    float3 sceneMax,
+    float minDistance,
+    float maxDistance,
+    uint32_t levelSpread
+) const
+{
+    FALCOR_CHECK(minDistance > 0.f && maxDistance >= minDistance, "Invalid hit distance range [{}, {}].", minDistance, maxDistance);
+    // midpoint rule over the log distance, fine enough to weight every level by its share of the range
+    const uint32_t sampleCount = 256;
+    const float logMin = std::log(minDistance);
+    const float logMax = std::log(maxDistance);
+    const int32_t spread = int32_t(levelSpread);
+    double rate = 0.0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        const float distance = std::exp(logMin + (float(i) + 0.5f) / float(sampleCount) * (logMax - logMin));
+        const int32_t gridLevel = int32_t(getGridLevel(distance));
+        for (int32_t offset = -spread; offset <= spread; offset++)
+            rate += getLevelCollisionRate(*this, gridLevel + offset, sceneMin, sceneMax);
+    }
+    return float(rate / double(sampleCount * (2 * levelSpread + 1)));
+}
+
+RadianceHashGrid::LevelTables RadianceHashGrid::LevelTables::fitScene(
+    const Layout& layout,
+    uint32_t capacity,
+    float3 sceneMin,
+    float3 sceneMax,
+    float minDistance,
+    float maxDistance,
+    uint32_t levelSpread
+)
+{
+    FALCOR_CHECK(minDistance > 0.f && maxDistance >= minDistance, "Invalid hit distance range [{}, {}].", minDistance, maxDistance);
+    // sub-tables are multiples of the bucket size, so buckets, groups and displacement masks never span two sub-tables
+    const uint32_t blockSize = std::max(layout.bucketSize, kGroupSize);
+    FALCOR_CHECK(capacity % blockSize == 0, "Capacity {} is not a multiple of the bucket size {}.", capacity, blockSize);
+
+    LevelTables levelTables;
+    // hits closer than the first level are clamped to level 1 and spread down from there
+    levelTables.firstLevel = levelSpread >= 1 ? 0 : 1;
+    const uint32_t lastLevel =
+        uint32_t(std::min<uint64_t>(uint64_t(layout.getGridLevel(maxDistance)) + levelSpread, layout.getLevelBitMask()));
+    const uint32_t tableCount = lastLevel - levelTables.firstLevel + 1;
+    const uint32_t blockCount = capacity / blockSize;
+    FALCOR_CHECK(blockCount >= tableCount, "Capacity {} is too small for {} level tables.", capacity, tableCount);
+    auto getTableIndex = [&](int32_t level) { return uint32_t(std::clamp(level - int32_t(levelTables.firstLevel), 0, int32_t(tableCount) - 1)); };
+
+    // every hit inserts one key per spread level, with log-uniform hit distances a table gets keys in proportion to the share
+    // of the distance range that reaches its level
+    const uint32_t sampleCount = 256;
+    const float logMin = std::log(minDistance);
+    const float logMax = std::log(maxDistance);
+    std::vector<double> weights(tableCount, 0.0);
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        const float distance = std::exp(logMin + (float(i) + 0.5f) / float(sampleCount) * (logMax - logMin));
+        const int32_t gridLevel = int32_t(layout.getGridLevel(distance));
+        for (int32_t offset = -int32_t(levelSpread); offset <= int32_t(levelSpread); offset++)
+            weights[getTableIndex(gridLevel + offset)] += 1.0;
+    }
+
+    // a level holds at most as many keys as its voxels cover the surface of the AABB, every direction bin is a key of its own;
+    // the tables get twice that for half load
+    const float3 extent = sceneMax - sceneMin;
+    const double area = 2.0 * (double(extent.x) * extent.y + double(extent.y) * extent.z + double(extent.z) * extent.x);
+    const double keysPerVoxel = double(uint64_t(1) << (2 * layout.directionBitNum));
+    std::vector<uint32_t> blocks(tableCount, 0);
+    std::vector<bool> capped(tableCount, false);
+    uint32_t remainingBlocks = blockCount;
+    // water filling: the tables whose proportional share exceeds their demand get the demand, the others split what is left
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        double weightSum = 0.0;
+        for (uint32_t i = 0; i < tableCount; i++)
+            if (!capped[i]) weightSum += weights[i];
+        const uint32_t available = remainingBlocks;
+        for (uint32_t i = 0; i < tableCount; i++)
+        {
+            if (capped[i] || weightSum == 0.0) continue;
+            const double voxelSize = layout.getVoxelSize(levelTables.firstLevel + i);
+            const double demandBlocks = std::ceil(2.0 * keysPerVoxel * std::max(area / (voxelSize * voxelSize), 6.0) / blockSize);
+            if (demandBlocks <= double(available) * weights[i] / weightSum)
+            {
+                blocks[i] = uint32_t(demandBlocks);
+                remainingBlocks -= blocks[i];
+                capped[i] = true;
+                changed = true;
+            }
+        }
+    }
+    double weightSum = 0.0;
+    for (uint32_t i = 0; i < tableCount; i++)
+        if (!capped[i]) weightSum += weights[i];
+    for (uint32_t i = 0; i < tableCount; i++)
+        if (!capped[i] && weightSum > 0.0) blocks[i] = uint32_t(double(remainingBlocks) * weights[i] / weightSum);
+
+    // every table needs a block, the rounding remainder goes to the largest one
+    for (uint32_t& b : blocks) b = std::max(b, 1u);
+    const uint32_t largest = uint32_t(std::max_element(blocks.begin(), blocks.end()) - blocks.begin());
+    uint32_t blockSum = 0;
+    for (uint32_t b : blocks) blockSum += b;
+    blocks[largest] += blockCount - blockSum;
+
+    levelTables.offsets.resize(tableCount + 1);
+    levelTables.offsets[0] = 0;
+    for (uint32_t i = 0; i < tableCount; i++)
+        levelTables.offsets[i + 1] = levelTables.offsets[i] + blocks[i] * blockSize;
+    return levelTables;
+}
+
+float RadianceHashGrid::Stats::getAverageProbeCount() const
+{
+    uint64_t keyCount = 0;
+    uint64_t probeSum = 0;
+    for (size_t i = 0; i < probeHistogram.size(); i++)
+    {
+        keyCount += probeHistogram[i];
+        probeSum += probeHistogram[i] * i;
+    }
+    return keyCount > 0 ? float(double(probeSum) / double(keyCount)) : 0.f;
+}
+
+uint32_t RadianceHashGrid::Stats::getMaxProbeCount() const
+{
+    for (size_t i = probeHistogram.size(); i > 0; i--)
+    {
+        if (probeHistogram[i - 1] > 0) return uint32_t(i - 1);
+    }
+    return 0;
+}
+
+RadianceHashGrid::RadianceHashGrid(const Layout& layout, uint32_t capacity, ProbingScheme probingScheme)
+    : mLayout(layout), mCapacity(capacity), mProbingScheme(probingScheme)
+{
+    FALCOR_CHECK(capacity > 0, "Hash grid capacity must be larger than 0.");
+    FALCOR_CHECK(
+        mLayout.normalBitNum + mLayout.levelBitNum + 3 * mLayout.positionBitNum + 2 * mLayout.directionBitNum <= 64,
+        "Hash grid key layout does not fit into 64 bits."
+    );
+    FALCOR_CHECK(
+        mProbingScheme != ProbingScheme::BoundedDisplacement || mLayout.bucketSize <= 32,
+        "Bounded displacement probing needs a bucket size of at most 32, got {}.",
+        mLayout.bucketSize
+    );
+    FALCOR_CHECK(
+        mProbingScheme != ProbingScheme::Bucketized || (mCapacity % kGroupSize == 0 && mLayout.bucketSize % kGroupSize == 0),
+        "Bucketized probing needs capacity and bucket size to be multiples of {}.",
+        kGroupSize
+    );
+    mEntries = std::make_unique<std::atomic<HashKey>[]>(mCapacity);
+    mMeta = std::make_unique<std::atomic<uint32_t>[]>(getMetaWordCount());
+    mStamps = std::make_unique<std::atomic<uint32_t>[]>(mCapacity);
+    mLevelFailedInserts = std::make_unique<std::atomic<uint64_t>[]>(getStatsLevelCount(mLayout));
+    reset();
+}
+
+uint32_t RadianceHashGrid::hashJenkins32(uint32_t a)
+{
+    a = (a + 0x7ed55d16) + (a << 12);
+    a = (a ^ 0xc761c23c) ^ (a >> 19);
+    a = (a + 0x165667b1) + (a << 5);
+    a = (a + 0xd3a2646c) ^ (a << 9);
+    a = (a + 0xfd7046c5) + (a << 3);
+    a = (a ^ 0xb55a4f09) ^ (a >> 16);
+    return a;
+}
+
+uint32_t RadianceHashGrid::hash32(HashKey hashKey)
+{
+    return hashJenkins32(uint32_t((hashKey >> 0) & 0xffffffff)) ^ hashJenkins32(uint32_t((hashKey >> 32) & 0xffffffff));
+}
+
+int4 RadianceHashGrid::calculateGridPositionLog(float distance, float3 samplePosition, int levelOffset) const
+{
+    // unsigned wrap-around for negative offsets is intended, the shader computes the level in uint as well
+    const uint32_t gridLevel = getGridLevel(distance) + uint32_t(levelOffset);
+    const float voxelSize = getVoxelSize(gridLevel);
+    samplePosition += mLayout.positionOffset;
+    return int4(
+        toInt(std::floor(samplePosition.x / voxelSize)),
+        toInt(std::floor(samplePosition.y / voxelSize)),
+        toInt(std::floor(samplePosition.z / voxelSize)),
+        int32_t(gridLevel)
+    );
+}
+
+RadianceHashGrid::HashKey RadianceHashGrid::computeSpatialHash(
+    float distance,
+    float3 samplePosition,
+    float3 sampleDirection,
+    float3 sampleNormal,
+    int levelOffset
+) const
+{
+    const int4 gridPosition = calculateGridPositionLog(distance, samplePosition, levelOffset);
+    const uint2 quantizedDir = quantizePolarToBitRange(convertDirToPolar(sampleDirection), uint32_t(mLayout.getDirectionBitMask()));
+    const HashKey positionMask = mLayout.getPositionBitMask();
+    HashKey hashKey = (sampleNormal.x >= 0 ? 1 : 0) + (sampleNormal.y >= 0 ? 2 : 0) + (sampleNormal.z >= 0 ? 4 : 0);
+    hashKey <<= mLayout.levelBitNum;
+    hashKey |= (HashKey(uint32_t(gridPosition.w)) & mLayout.getLevelBitMask());
+    hashKey <<= mLayout.positionBitNum;
+    hashKey |= (HashKey(uint32_t(gridPosition.z)) & positionMask);
+    hashKey <<= mLayout.positionBitNum;
+    hashKey |= (HashKey(uint32_t(gridPosition.y)) & positionMask);
+    hashKey <<= mLayout.positionBitNum;
+    hashKey |= (HashKey(uint32_t(gridPosition.x)) & positionMask);
+    hashKey <<= mLayout.directionBitNum;
+    hashKey |= HashKey(quantizedDir.y);
+    hashKey <<= mLayout.directionBitNum;
+    hashKey |= HashKey(quantizedDir.x);
+    return hashKey;
+}
+
+void RadianceHashGrid::setLevelTables(const LevelTables& levelTables)
+{
+    if (!levelTables.offsets.empty())
+    {
+        const uint32_t blockSize = std::max(mLayout.bucketSize, kGroupSize);
+        FALCOR_CHECK(levelTables.offsets.size() >= 2, "Level tables need at least one sub-table.");
+        FALCOR_CHECK(levelTables.offsets.front() == 0 && levelTables.offsets.back() == mCapacity, "Level tables have to cover the capacity.");
+        for (size_t i = 0; i + 1 < levelTables.offsets.size(); i++)
+        {
+            const uint32_t size = levelTables.offsets[i + 1] - levelTables.offsets[i];
+            FALCOR_CHECK(
+                levelTables.offsets[i + 1] > levelTables.offsets[i] && size % blockSize == 0,
+                "Level table {} has to be a non-empty multiple of {} slots.",
+                i,
+                blockSize
+            );
+        }
+    }
+    mLevelTables = levelTables;
+}
+
+uint32_t RadianceHashGrid::getKeyLevel(HashKey hashKey) const
+{
+    return uint32_t((hashKey >> (2 * mLayout.directionBitNum + 3 * mLayout.positionBitNum)) & mLayout.getLevelBitMask());
+}
+
+RadianceHashGrid::Table RadianceHashGrid::getTable(HashKey hashKey) const
+{
+    if (mLevelTables.offsets.empty()) return {0, mCapacity};
+    const uint32_t level = getKeyLevel(hashKey);
+    const uint32_t i = std::min(level - std::min(level, mLevelTables.firstLevel), mLevelTables.getTableCount() - 1);
+    return {mLevelTables.offsets[i], mLevelTables.offsets[i + 1] - mLevelTables.offsets[i]};
+}
+
+uint32_t RadianceHashGrid::getSlot(HashKey hashKey) const
+{
+    const uint32_t hash = hash32(hashKey);
+    const Table table = getTable(hashKey);
+    if (mProbingScheme == ProbingScheme::Bucketized) return table.offset + (hash % (table.size / kGroupSize)) * kGroupSize;
+    return table.offset + hash % table.size;
+}
+
+uint32_t RadianceHashGrid::getMetaWordCount() const
+{
+    switch (mProbingScheme)
+    {
+    case ProbingScheme::BoundedDisplacement:
+        return mCapacity;
+    case ProbingScheme::Bucketized:
+        return mCapacity / 4;
+    default:
+        return 1;
+    }
+}
+
+uint32_t RadianceHashGrid::getFingerprint(uint32_t hash)
+{
+    // 0 marks a free slot and kTombstone an evicted one
+    return std::clamp(hash >> 24, 1u, kTombstone - 1);
+}
+
+uint32_t RadianceHashGrid::matchFingerprint(uint32_t word, uint32_t fingerprint)
+{
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+        mask |= (((word >> (i * 8)) & 0xff) == fingerprint ? 1u : 0u) << i;
+    return mask;
+}
+
+void RadianceHashGrid::touchSlot(uint32_t idx)
+{
+    if (!mDirtySlots)
+    {
+        mStamps[idx].store(mFrameIndex, std::memory_order_relaxed);
+        return;
+    }
+    if (mStamps[idx].exchange(mFrameIndex, std::memory_order_relaxed) == mFrameIndex) return;
+    mDirtySlots[mDirtySlotCount.fetch_add(1, std::memory_order_relaxed)].store(idx, std::memory_order_relaxed);
+}
+
+uint32_t RadianceHashGrid::insertEntry(HashKey hashKey, uint32_t* pProbeCount)
+{
+    const uint32_t hash = hash32(hashKey);
+    uint32_t probeCount = 0;
+    // most inserts hit existing keys, with metadata a lookup is cheaper than running the atomics over the bucket
+    // with eviction free slots may precede the key, so the lookup is needed to not store the key twice
+    if (mProbingScheme != ProbingScheme::Linear || mMaxAge > 0)
+    {
+        const uint32_t idx = findEntry(hashKey, &probeCount);
+        if (idx != kInvalidIdx)
+        {
+            touchSlot(idx);
+            if (pProbeCount) *pProbeCount = probeCount;
+            return idx;
+        }
+    }
+    const Table table = getTable(hashKey);
+    const uint32_t slot = getSlot(hashKey);
+    for (uint32_t bucketOffset = 0; bucketOffset < mLayout.bucketSize; ++bucketOffset)
+    {
+        const uint32_t idx = table.offset + (slot - table.offset + bucketOffset) % table.size;
+        probeCount++;
+        // voxel data is only ever accessed through its own atomics, so the key does not need to order other memory operations
+        HashKey prevHashKey = kInvalidHashKey;
+        mEntries[idx].compare_exchange_strong(prevHashKey, hashKey, std::memory_order_relaxed);
+        if (prevHashKey == kInvalidHashKey)
+        {
+            if (mProbingScheme == ProbingScheme::BoundedDisplacement)
+                mMeta[slot].fetch_or(1u << bucketOffset, std::memory_order_relaxed);
+            else if (mProbingScheme == ProbingScheme::Bucketized)
+            {
+                // the CAS winner owns the byte, which is 0 or a tombstone. Replace it with a single atomic so that
+                // concurrent lookups never see a transient free slot
+                const uint32_t shift = (idx % 4) * 8;
+                const uint32_t prevByte = (mMeta[idx / 4].load(std::memory_order_relaxed) >> shift) & 0xff;
+                mMeta[idx / 4].fetch_xor((prevByte ^ getFingerprint(hash)) << shift, std::memory_order_relaxed);
+            }
+        }
+        if (prevHashKey == kInvalidHashKey || prevHashKey == hashKey)
+        {
+            touchSlot(idx);
+            if (pProbeCount) *pProbeCount = probeCount;
+            return idx;
+        }
+    }
+    if (pProbeCount) *pProbeCount = probeCount;
+    mFailedInserts.fetch_add(1, std::memory_order_relaxed);
+    mLevelFailedInserts[std::min(getKeyLevel(hashKey), getStatsLevelCount(mLayout) - 1)].fetch_add(1, std::memory_order_relaxed);
+    return kInvalidIdx;
+}
+
+uint32_t RadianceHashGrid::findEntry(HashKey hashKey, uint32_t* pProbeCount) const
+{
+    const uint32_t hash = hash32(hashKey);
+    const Table table = getTable(hashKey);
+    uint32_t probeCount = 0;
+    uint32_t result = kInvalidIdx;
+    if (mProbingScheme == ProbingScheme::BoundedDisplacement)
+    {
+        const uint32_t home = hash % table.size;
+        probeCount++;
+        uint32_t offsetMask = mMeta[table.offset + home].load(std::memory_order_relaxed);
+        while (offsetMask != 0 && result == kInvalidIdx)
+        {
+            const uint32_t idx = table.offset + (home + bitScanForward(offsetMask)) % table.size;
+            offsetMask &= offsetMask - 1;
+            probeCount++;
+            if (getEntry(idx) == hashKey) result = idx;
+        }
+    }
+    else if (mProbingScheme == ProbingScheme::Bucketized)
+    {
+        const uint32_t groupCount = table.size / kGroupSize;
+        const uint32_t group = hash % groupCount;
+        const uint32_t fingerprint = getFingerprint(hash);
+        for (uint32_t groupOffset = 0; groupOffset < mLayout.bucketSize / kGroupSize && result == kInvalidIdx; ++groupOffset)
+        {
+            const uint32_t groupIdx = table.offset / kGroupSize + (group + groupOffset) % groupCount;
+            // the shader fetches both words with a single Load2
+            probeCount++;
+            const uint32_t word0 = mMeta[groupIdx * 2].load(std::memory_order_relaxed);
+            const uint32_t word1 = mMeta[groupIdx * 2 + 1].load(std::memory_order_relaxed);
+            uint32_t matchMask = matchFingerprint(word0, fingerprint) | (matchFingerprint(word1, fingerprint) << 4);
+            while (matchMask != 0 && result == kInvalidIdx)
+            {
+                const uint32_t idx = groupIdx * kGroupSize + bitScanForward(matchMask);
+                matchMask &= matchMask - 1;
+                probeCount++;
+                if (getEntry(idx) == hashKey) result = idx;
+            }
+            // keys are placed in the first free slot, so the key cannot be in a later group
+            if ((matchFingerprint(word0, 0) | matchFingerprint(word1, 0)) != 0) break;
+        }
+    }
+    else
+    {
+        const uint32_t home = hash % table.size;
+        for (uint32_t bucketOffset = 0; bucketOffset < mLayout.bucketSize && result == kInvalidIdx; ++bucketOffset)
+        {
+            const uint32_t idx = table.offset + (home + bucketOffset) % table.size;
+            probeCount++;
+            if (getEntry(idx) == hashKey) result = idx;
+        }
+    }
+    if (pProbeCount) *pProbeCount = probeCount;
+    return result;
+}
+
+RadianceHashGrid::HashKey RadianceHashGrid::getEntry(uint32_t idx) const
+{
+    return idx < mCapacity ? mEntries[idx].load(std::memory_order_relaxed) : kInvalidHashKey;
+}
+
+uint32_t RadianceHashGrid::getStamp(uint32_t idx) const
+{
+    return idx < mCapacity ? mStamps[idx].load(std::memory_order_relaxed) : 0;
+}
+
+void RadianceHashGrid::setTrackDirtySlots(bool enabled)
+{
+    mDirtySlots = enabled ? std::make_unique<std::atomic<uint32_t>[]>(mCapacity) : nullptr;
+    mDirtySlotCount = 0;
+}
+
+uint32_t RadianceHashGrid::getDirtySlot(uint32_t dirtyIdx) const
+{
+    FALCOR_CHECK(dirtyIdx < getDirtySlotCount(), "Dirty slot {} is out of range.", dirtyIdx);
+    return mDirtySlots[dirtyIdx].load(std::memory_order_relaxed);
+}
+
+bool RadianceHashGrid::isStale(uint32_t idx) const
+{
+    if (mMaxAge == 0) return false;
+    if (getEntry(idx) == kInvalidHashKey) return false;
+    // unsigned difference keeps working when the frame index wraps around
+    return mFrameIndex - getStamp(idx) > mMaxAge;
+}
+
+void RadianceHashGrid::evictEntry(uint32_t idx)
+{
+    FALCOR_CHECK(idx < mCapacity, "Slot {} is out of range.", idx);
+    const HashKey hashKey = mEntries[idx].exchange(kInvalidHashKey, std::memory_order_relaxed);
+    if (hashKey == kInvalidHashKey) return;
+    if (mProbingScheme == ProbingScheme::BoundedDisplacement)
+    {
+        const Table table = getTable(hashKey);
+        const uint32_t home = hash32(hashKey) % table.size;
+        mMeta[table.offset + home].fetch_and(~(1u << ((idx - table.offset + table.size - home) % table.size)), std::memory_order_relaxed);
+    }
+    else if (mProbingScheme == ProbingScheme::Bucketized)
+    {
+        mMeta[idx / 4].fetch_or(kTombstone << ((idx % 4) * 8), std::memory_order_relaxed);
+    }
+    mEvictedEntries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RadianceHashGrid::reset()
+{
+    for (uint32_t i = 0; i < mCapacity; i++)
+    {
+        mEntries[i].store(kInvalidHashKey, std::memory_order_relaxed);
+        mStamps[i].store(kInvalidStamp, std::memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < getMetaWordCount(); i++)
+        mMeta[i].store(0, std::memory_order_relaxed);
+    mFailedInserts = 0;
+    for (uint32_t i = 0; i < getStatsLevelCount(mLayout); i++)
+        mLevelFailedInserts[i].store(0, std::memory_order_relaxed);
+    mEvictedEntries = 0;
+    mDirtySlotCount = 0;
+}
+
+RadianceHashGrid::Stats RadianceHashGrid::computeStats() const
+{
+    Stats stats;
+    stats.capacity = mCapacity;
+    for (uint32_t i = 0; i < mCapacity; i++)
+    {
+        const HashKey hashKey = getEntry(i);
+        if (hashKey == kInvalidHashKey) continue;
+        stats.occupiedSlots++;
+        const uint32_t level = getKeyLevel(hashKey);
+        if (level >= stats.levels.size()) stats.levels.resize(level + 1);
+        stats.levels[level].occupiedSlots++;
+        uint32_t probeCount = 0;
+        findEntry(hashKey, &probeCount);
+        if (probeCount >= stats.probeHistogram.size()) stats.probeHistogram.resize(probeCount + 1, 0);
+        stats.probeHistogram[probeCount]++;
+    }
+    stats.failedInserts = mFailedInserts.load();
+    stats.evictedEntries = mEvictedEntries.load();
+    for (uint32_t level = 0; level < getStatsLevelCount(mLayout); level++)
+    {
+        const uint64_t failedInserts = mLevelFailedInserts[level].load(std::memory_order_relaxed);
+        if (failedInserts == 0) continue;
+        if (level >= stats.levels.size()) stats.levels.resize(level + 1);
+        stats.levels[level].failedInserts = failedInserts;
+    }
+    for (uint32_t level = 0; level < stats.levels.size(); level++)
+    {
+        // a key of the level is enough to find its sub-table
+        const HashKey levelKey = HashKey(level) << (2 * mLayout.directionBitNum + 3 * mLayout.positionBitNum);
+        stats.levels[level].capacity = getTable(levelKey).size;
+    }
+    return stats;
+}
+} // namespace Falcor
@@ -0,0 +1,270 @@
+#pragma once
+#include "Utils/Math/Vector.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Host-side mirror of the spatial hash grid in RadianceHashCacheHashGridCommon.slang.
+ * Keys, hashes, slot indices and probing metadata are bit-identical to the shader, so occupancy and probe lengths measured on the
+ * CPU carry over to the GPU. Inserts are lock-free (CAS on the 64-bit key) and may be issued from any number of threads.
+ */
+class RadianceHashGrid
+{
+public:
+    using HashKey = uint64_t;
+
+    static constexpr HashKey kInvalidHashKey = 0;
+    static constexpr uint32_t kInvalidIdx = 0xffffffff;
+    static constexpr uint32_t kGroupSize = 8;
+    // fingerprint byte of an evicted slot with the bucketized scheme
+    static constexpr uint32_t kTombstone = 0xff;
+    // stamp of a slot that was never inserted
+    static constexpr uint32_t kInvalidStamp = 0xffffffff;
+
+    /// Collision resolution, matches HC_PROBING_SCHEME.
+    enum class ProbingScheme
+    {
+        // scan over the whole bucket
+        Linear = 0,
+        // a per home slot bitmask of occupied bucket offsets limits the slots a lookup has to test
+        BoundedDisplacement = 1,
+        // groups of kGroupSize keys with one fingerprint byte per key, lookups stop at the first group with a free slot
+        Bucketized = 2,
+    };
+
+    /**
+     * Bit layout of the spatial hash key.
+     * | normal bits | level | pos.z | pos.y | pos.x | dir.y | dir.x |
+     */
+    struct Layout
+    {
+        uint32_t positionBitNum = 17;
+        uint32_t directionBitNum = 0;
+        uint32_t levelBitNum = 10;
+        uint32_t normalBitNum = 3;
+        float sceneScale = 60.f;
+        // positive bias adds extra levels with content magnification
+        int32_t levelBias = 2;
+        float logBase = 2.f;
+        uint32_t bucketSize = 32;
+        // added to the sample position before it is quantized, moves the scene to the positive octant
+        float3 positionOffset = float3(0.f);
+
+        /// Layout used by the shaders with USE_RHC.
+        static Layout rhc();
+        /// Layout used by the shaders with USE_IRHC.
+        static Layout irhc();
+
+        /**
+         * Fit a layout to a scene. The voxel size at a distance is kept, the level bias is chosen so that the closest hits land
+         * on level 1, and the level bits cover the level of the farthest hits and the training spread above it. The remaining key bits go to the position, the offset moves the scene AABB to the origin. If the finest level
+         * would wrap around the position bits, the range starts at the closest distance that does not, so the voxels of closer
+         * hits are coarser instead of aliased.
+         * @param[in] base Layout the angular resolution (scene scale), direction and normal bits are taken from.
+         * @param[in] sceneMin Minimum of the scene AABB.
+         * @param[in] sceneMax Maximum of the scene AABB.
+         * @param[in] minDistance Smallest hit distance, e.g. the camera near plane.
+         * @param[in] maxDistance Largest hit distance, e.g. the scene diagonal.
+         * @param[in] levelSpread Levels below and above the level of a hit that are inserted as well.
+         */
+        static Layout fitScene(const Layout& base, float3 sceneMin, float3 sceneMax, float minDistance, float maxDistance, uint32_t levelSpread);
+
+        HashKey getPositionBitMask() const { return (HashKey(1) << positionBitNum) - 1; }
+        HashKey getDirectionBitMask() const { return (HashKey(1) << directionBitNum) - 1; }
+        HashKey getLevelBitMask() const { return (HashKey(1) << levelBitNum) - 1; }
+        /// Bits of the key that are used, at most 64.
+        uint32_t getKeyBitNum() const { return normalBitNum + levelBitNum + 3 * positionBitNum + 2 * directionBitNum; }
+
+        uint32_t getGridLevel(float distance) const;
+        float getVoxelSize(uint32_t gridLevel) const;
+
+        /**
+         * Expected fraction of the voxels whose key is shared with another voxel of the scene because the grid position wraps
+         * around the position bits or the level does not fit the level bits. Assumes that the surfaces fill the scene AABB and that
+         * the hit distances are log-uniform in [minDistance, maxDistance], every hit touches the levelSpread levels around its level.
+         * Key collisions come on top of the slot collisions of the hash map, the voxels involved share their radiance estimate.
+         */
+        float estimateCollisionRate(float3 sceneMin, float3 sceneMax, float minDistance, float maxDistance, uint32_t levelSpread) const;
+    };
+
+    /**
+     * Split of the slots into one sub-table per grid level, mirrors HC_LEVEL_TABLE_COUNT and HC_LEVEL_TABLE_OFFSETS. The keys of
+     * level firstLevel + i are probed within [offsets[i], offsets[i + 1]), the levels outside of the range use the closest
+     * sub-table. Without sub-tables all levels share the whole table.
+     */
+    struct LevelTables
+    {
+        uint32_t firstLevel = 0;
+        // sub-table count + 1 slot offsets, the last one is the capacity
+        std::vector<uint32_t> offsets;
+
+        uint32_t getTableCount() const { return offsets.empty() ? 1 : uint32_t(offsets.size() - 1); }
+
+        /**
+         * Size the sub-tables by their expected occupancy. Every hit inserts a key on each of its spread levels, so with log-uniform
+         * hit distances a level gets keys in proportion to the share of the distance range that reaches it. A coarse level holds
+         * at most as many keys as its voxels cover the surface of the scene AABB, its table is capped at twice that.
+         * @param[in] layout Key layout, see Layout::fitScene().
+         * @param[in] capacity Number of slots, a multiple of the bucket size.
+         * @param[in] sceneMin Minimum of the scene AABB.
+         * @param[in] sceneMax Maximum of the scene AABB.
+         * @param[in] minDistance Smallest hit distance, e.g. the camera near plane.
+         * @param[in] maxDistance Largest hit distance, the levels above its level and the spread use the last sub-table.
+         * @param[in] levelSpread Levels below and above the level of a hit that are inserted as well.
+         */
+        static LevelTables fitScene(
+            const Layout& layout,
+            uint32_t capacity,
+            float3 sceneMin,
+            float3 sceneMax,
+            float minDistance,
+            float maxDistance,
+            uint32_t levelSpread
+        );
+    };
+
+    struct LevelStats
+    {
+        // slots of the sub-table of the level, the whole capacity if the levels share the table
+        uint32_t capacity = 0;
+        uint32_t occupiedSlots = 0;
+        uint64_t failedInserts = 0;
+
+        float getLoadFactor() const { return capacity > 0 ? float(occupiedSlots) / float(capacity) : 0.f; }
+    };
+
+    struct Stats
+    {
+        uint32_t capacity = 0;
+        uint32_t occupiedSlots = 0;
+        // entry i holds the number of stored keys that are found with i probes
+        std::vector<uint64_t> probeHistogram;
+        // inserts that found no free slot within the bucket and returned kInvalidIdx
+        uint64_t failedInserts = 0;
+        // keys removed by evictEntry() since the last reset
+        uint64_t evictedEntries = 0;
+        // entry i holds the keys of grid level i, up to the highest level with keys or failed inserts
+        std::vector<LevelStats> levels;
+
+        float getLoadFactor() const { return capacity > 0 ? float(occupiedSlots) / float(capacity) : 0.f; }
+        float getAverageProbeCount() const;
+        uint32_t getMaxProbeCount() const;
+    };
+
+    /**
+     * Create an empty hash grid.
+     * @param[in] layout Key layout, usually Layout::rhc() or Layout::irhc().
+     * @param[in] capacity Number of slots, corresponds to HC_HASHMAP_SIZE.
+     * @param[in] probingScheme Collision resolution, corresponds to HC_PROBING_SCHEME.
+     */
+    RadianceHashGrid(const Layout& layout, uint32_t capacity, ProbingScheme probingScheme = ProbingScheme::Linear);
+
+    const Layout& getLayout() const { return mLayout; }
+    uint32_t getCapacity() const { return mCapacity; }
+    ProbingScheme getProbingScheme() const { return mProbingScheme; }
+
+    // http://burtleburtle.net/bob/hash/integer.html
+    static uint32_t hashJenkins32(uint32_t a);
+    static uint32_t hash32(HashKey hashKey);
+
+    uint32_t getGridLevel(float distance) const { return mLayout.getGridLevel(distance); }
+    float getVoxelSize(uint32_t gridLevel) const { return mLayout.getVoxelSize(gridLevel); }
+    int4 calculateGridPositionLog(float distance, float3 samplePosition, int levelOffset) const;
+    HashKey computeSpatialHash(float distance, float3 samplePosition, float3 sampleDirection, float3 sampleNormal, int levelOffset = 0) const;
+
+    /// Split the slots into per level sub-tables, must be called while the grid is empty.
+    void setLevelTables(const LevelTables& levelTables);
+    const LevelTables& getLevelTables() const { return mLevelTables; }
+    /// Grid level stored in a key.
+    uint32_t getKeyLevel(HashKey hashKey) const;
+
+    /// Home slot of a key, the first slot probed by insertEntry(). For the bucketized scheme this is the first slot of the home group.
+    uint32_t getSlot(HashKey hashKey) const;
+
+    /**
+     * Insert a key, thread-safe.
+     * @param[in] hashKey Key to insert.
+     * @param[out] pProbeCount Optional, receives the number of memory loads (keys and metadata words).
+     * @return Slot index of the key, kInvalidIdx if the bucket is full.
+     */
+    uint32_t insertEntry(HashKey hashKey, uint32_t* pProbeCount = nullptr);
+
+    /**
+     * Look up a key, thread-safe with respect to concurrent inserts.
+     * @param[in] hashKey Key to find.
+     * @param[out] pProbeCount Optional, receives the number of memory loads (keys and metadata words).
+     * @return Slot index of the key or kInvalidIdx if it is not stored.
+     */
+    uint32_t findEntry(HashKey hashKey, uint32_t* pProbeCount = nullptr) const;
+
+    /// Key stored in a slot, out of range slots read as empty.
+    HashKey getEntry(uint32_t idx) const;
+
+    /// Frame index written by inserts, mirrors gHCFrameIndex.
+    void setFrameIndex(uint32_t frameIndex) { mFrameIndex = frameIndex; }
+    uint32_t getFrameIndex() const { return mFrameIndex; }
+    /// Entries not inserted for more than maxAge frames are stale, 0 disables eviction. Mirrors gHCMaxAge.
+    void setMaxAge(uint32_t maxAge) { mMaxAge = maxAge; }
+    uint32_t getMaxAge() const { return mMaxAge; }
+    /// Frame index of the last insert of the key in a slot.
+    uint32_t getStamp(uint32_t idx) const;
+
+    /**
+     * Record the slots inserted in the current frame, mirrors HC_INCREMENTAL_RESOLVE. The stamp deduplicates the list, so every slot
+     * is appended once per frame index. The list holds up to getCapacity() slots.
+     */
+    void setTrackDirtySlots(bool enabled);
+    bool getTrackDirtySlots() const { return mDirtySlots != nullptr; }
+    uint32_t getDirtySlotCount() const { return mDirtySlotCount.load(std::memory_order_relaxed); }
+    uint32_t getDirtySlot(uint32_t dirtyIdx) const;
+    /// Start a new list, must not run concurrently with inserts.
+    void clearDirtySlots() { mDirtySlotCount = 0; }
+
+    /// True if the slot holds a key that was not inserted within the last getMaxAge() frames, mirrors IsStale().
+    bool isStale(uint32_t idx) const;
+    /// Free a slot, mirrors EvictEntry(). Must not run concurrently with inserts, but different slots can be evicted in parallel.
+    void evictEntry(uint32_t idx);
+
+    /// Clear all keys, stamps and counters, mirrors HashMapReset().
+    void reset();
+
+    Stats computeStats() const;
+
+private:
+    struct Table
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // sub-table the key is probed in
+    Table getTable(HashKey hashKey) const;
+    uint32_t getMetaWordCount() const;
+    void touchSlot(uint32_t idx);
+    static uint32_t getFingerprint(uint32_t hash);
+    static uint32_t matchFingerprint(uint32_t word, uint32_t fingerprint);
+
+    Layout mLayout;
+    uint32_t mCapacity;
+    ProbingScheme mProbingScheme;
+    std::unique_ptr<std::atomic<HashKey>[]> mEntries;
+    // same layout as gHCHashGridMetaBuffer
+    std::unique_ptr<std::atomic<uint32_t>[]> mMeta;
+    std::unique_ptr<std::atomic<uint32_t>[]> mStamps;
+    // slots inserted since the last clearDirtySlots(), null if not tracked
+    std::unique_ptr<std::atomic<uint32_t>[]> mDirtySlots;
+    std::atomic<uint32_t> mDirtySlotCount{0};
+    uint32_t mFrameIndex = 0;
+    uint32_t mMaxAge = 0;
+    LevelTables mLevelTables;
+    std::atomic<uint64_t> mFailedInserts{0};
+    // failed inserts per grid level
+    std::unique_ptr<std::atomic<uint64_t>[]> mLevelFailedInserts;
+    std::atomic<uint64_t> mEvictedEntries{0};
+};
+} // namespace Falcor
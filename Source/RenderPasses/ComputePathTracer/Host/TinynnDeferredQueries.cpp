@@ -0,0 +1,82 @@
+#include "TinynnDeferredQueries.h"
+#include "Core/Error.h"
+#include "Utils/Math/Common.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+// queries encoded and evaluated at once, bounds the size of the feature vectors
+const uint32_t kInferenceChunkSize = 32 * kDeferredQueryGroupSize;
+} // namespace
+
+uint32_t appendDeferredQueries(uint4& header, uint32_t waveQueryCount)
+{
+    const uint32_t offset = header.w;
+    header.w += waveQueryCount;
+    // groups needed for the new queries
+    header.x += div_round_up(offset + waveQueryCount, kDeferredQueryGroupSize) - div_round_up(offset, kDeferredQueryGroupSize);
+    return offset;
+}
+
+void inferDeferredQueries(
+    Encoding encoding,
+    FeatureHashGrid* grid,
+    const float16_t* primal,
+    const HalfMLP& mlp,
+    const DeferredQuery* queries,
+    uint32_t count,
+    float3* results
+)
+{
+    FALCOR_CHECK(mlp.getWidth() == kFeatureWidth, "Deferred queries need a network of width {}.", kFeatureWidth);
+    const uint32_t chunkSize = std::min(count, kInferenceChunkSize);
+    std::vector<float> components(9 * size_t(chunkSize));
+    std::vector<float16_t> features(size_t(chunkSize) * kFeatureWidth);
+    for (uint32_t begin = 0; begin < count; begin += chunkSize)
+    {
+        QueryBatch batch;
+        batch.count = std::min(chunkSize, count - begin);
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            batch.position[c] = components.data() + c * chunkSize;
+            batch.direction[c] = components.data() + (3 + c) * chunkSize;
+            batch.normal[c] = components.data() + (6 + c) * chunkSize;
+        }
+        for (uint32_t q = 0; q < batch.count; q++)
+        {
+            const DeferredQuery& query = queries[begin + q];
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                components[c * chunkSize + q] = query.pos[c];
+                components[(3 + c) * chunkSize + q] = query.dir[c];
+                components[(6 + c) * chunkSize + q] = query.normal[c];
+            }
+        }
+        computeFeatures(encoding, grid, primal, batch, false, features.data());
+        mlp.forward(features.data(), features.data(), batch.count);
+        for (uint32_t q = 0; q < batch.count; q++)
+        {
+            const float16_t* output = features.data() + size_t(q) * kFeatureWidth;
+            results[begin + q] = float3(float(output[0]), float(output[1]), float(output[2]));
+        }
+    }
+}
+
+void resolveDeferredQueries(const DeferredQuery* queries, const float3* results, uint32_t count, uint2 frameDim, float4* image)
+{
+    for (uint32_t q = 0; q < count; q++)
+    {
+        const uint2 pixel = queries[q].pixel;
+        FALCOR_CHECK(pixel.x < frameDim.x && pixel.y < frameDim.y, "Query {} lies outside of the frame.", q);
+        float4& color = image[size_t(pixel.y) * frameDim.x + pixel.x];
+        color = float4(color.xyz() + queries[q].weight * results[q], color.w);
+    }
+}
+} // namespace tinynn
+} // namespace Falcor
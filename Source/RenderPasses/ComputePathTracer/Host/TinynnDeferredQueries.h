@@ -0,0 +1,65 @@
+#pragma once
+#include "TinynnFeatureEncodings.h"
+#include "TinynnMLP.h"
+#include "Utils/Math/Vector.h"
+
+#include <cstdint>
+
+namespace Falcor
+{
+namespace tinynn
+{
+// CPU version of the deferred nn queries of NNDeferredQuery.slang and the batch inference pass in NNBatchInference.slang.
+
+/// Queries per group of the batch inference and resolve passes.
+constexpr uint32_t kDeferredQueryGroupSize = 128;
+
+/**
+ * Radiance query a path recorded instead of evaluating the network inline, same layout as NNDeferredQuery. The resolve adds
+ * weight * network output to the pixel.
+ */
+struct DeferredQuery
+{
+    float3 pos;
+    float3 dir;
+    float3 normal;
+    float3 weight;
+    uint2 pixel;
+    /// Expert the query was routed to, see TinynnExperts.h.
+    uint32_t expert;
+};
+static_assert(sizeof(DeferredQuery) == 60, "DeferredQuery has to match the layout of NNDeferredQuery.");
+
+/**
+ * Header of the query buffer after a wave appended its queries, mirrors deferNNQuery().
+ * @param[in,out] header Indirect dispatch arguments of the inference pass in xyz and the query count in w.
+ * @param[in] waveQueryCount Queries appended by the wave.
+ * @return Index of the first query of the wave.
+ */
+uint32_t appendDeferredQueries(uint4& header, uint32_t waveQueryCount);
+
+/**
+ * Evaluate the network for a batch of queries, mirrors NNBatchInference::infer().
+ * @param[in] encoding Input encoding of the network.
+ * @param[in] grid Feature hash grid, only used by the hash encodings.
+ * @param[in] primal Whole primal buffer the weights of the network were loaded from.
+ * @param[in] mlp Network with loaded weights, its width has to be kFeatureWidth.
+ * @param[out] results First three outputs of the network per query.
+ */
+void inferDeferredQueries(
+    Encoding encoding,
+    FeatureHashGrid* grid,
+    const float16_t* primal,
+    const HalfMLP& mlp,
+    const DeferredQuery* queries,
+    uint32_t count,
+    float3* results
+);
+
+/**
+ * Add the weighted results to the pixels of their queries, mirrors NNBatchInference::resolve().
+ * @param[in,out] image Row-major image of frameDim.x * frameDim.y pixels.
+ */
+void resolveDeferredQueries(const DeferredQuery* queries, const float3* results, uint32_t count, uint2 frameDim, float4* image);
+} // namespace tinynn
+} // namespace Falcor
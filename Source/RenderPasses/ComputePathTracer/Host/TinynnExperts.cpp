@@ -0,0 +1,98 @@
+#include "TinynnExperts.h"
+#include "Core/Error.h"
+#include "Utils/Math/Common.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Falcor
+{
+namespace tinynn
+{
+ExpertRouter ExpertRouter::create(ExpertRouting routing, uint32_t expertCount, float3 sceneMin, float3 sceneMax)
+{
+    FALCOR_CHECK(expertCount >= 1 && expertCount <= kMaxExperts, "Expert count {} is outside of [1, {}].", expertCount, kMaxExperts);
+    ExpertRouter router;
+    router.routing = routing;
+    router.expertCount = expertCount;
+    const float3 extent = sceneMax - sceneMin;
+    for (uint32_t c = 1; c < 3; c++)
+    {
+        if (extent[c] > extent[router.axis]) router.axis = c;
+    }
+    router.origin = sceneMin[router.axis];
+    router.scale = extent[router.axis] > 0.f ? float(expertCount) / extent[router.axis] : 0.f;
+    return router;
+}
+
+uint32_t ExpertRouter::route(float3 pos, uint32_t materialID) const
+{
+    if (expertCount == 1) return 0;
+    if (routing == ExpertRouting::Material) return materialID % expertCount;
+    const float slab = std::floor((pos[axis] - origin) * scale);
+    // written so that nan lands in the first slab like the shader min and max
+    return uint32_t(std::min(std::max(0.f, slab), float(expertCount - 1)));
+}
+
+uint32_t ExpertBins::getGroupExpert(uint32_t group) const
+{
+    const uint32_t slot = group * kDeferredQueryGroupSize;
+    uint32_t expert = 0;
+    while (expert + 1 < offsets.size() && slot >= offsets[expert + 1]) expert++;
+    return expert;
+}
+
+uint32_t getExpertBinOffset(const uint32_t* counts, uint32_t expert)
+{
+    uint32_t offset = 0;
+    for (uint32_t e = 0; e < expert; e++) offset += div_round_up(counts[e], kDeferredQueryGroupSize) * kDeferredQueryGroupSize;
+    return offset;
+}
+
+ExpertBins binDeferredQueries(const DeferredQuery* queries, uint32_t count, uint32_t expertCount)
+{
+    FALCOR_CHECK(expertCount >= 1 && expertCount <= kMaxExperts, "Expert count {} is outside of [1, {}].", expertCount, kMaxExperts);
+    ExpertBins bins;
+    bins.counts.assign(expertCount, 0);
+    for (uint32_t q = 0; q < count; q++)
+    {
+        FALCOR_CHECK(queries[q].expert < expertCount, "Query {} has the expert {} of {}.", q, queries[q].expert, expertCount);
+        bins.counts[queries[q].expert]++;
+    }
+    bins.offsets.resize(expertCount);
+    for (uint32_t e = 0; e < expertCount; e++) bins.offsets[e] = getExpertBinOffset(bins.counts.data(), e);
+    bins.order.assign(getExpertBinOffset(bins.counts.data(), expertCount), ExpertBins::kInvalidQuery);
+    std::vector<uint32_t> fill(expertCount, 0);
+    for (uint32_t q = 0; q < count; q++)
+    {
+        const uint32_t expert = queries[q].expert;
+        bins.order[bins.offsets[expert] + fill[expert]++] = q;
+    }
+    return bins;
+}
+
+void inferExpertQueries(
+    Encoding encoding,
+    FeatureHashGrid* const* grids,
+    const float16_t* primal,
+    const HalfMLP* const* mlps,
+    const ExpertBins& bins,
+    const DeferredQuery* queries,
+    float3* results
+)
+{
+    std::vector<DeferredQuery> batch;
+    std::vector<float3> batchResults;
+    for (uint32_t e = 0; e < bins.counts.size(); e++)
+    {
+        const uint32_t count = bins.counts[e];
+        if (count == 0) continue;
+        batch.resize(count);
+        batchResults.resize(count);
+        for (uint32_t i = 0; i < count; i++) batch[i] = queries[bins.order[bins.offsets[e] + i]];
+        inferDeferredQueries(encoding, grids[e], primal, *mlps[e], batch.data(), count, batchResults.data());
+        for (uint32_t i = 0; i < count; i++) results[bins.order[bins.offsets[e] + i]] = batchResults[i];
+    }
+}
+} // namespace tinynn
+} // namespace Falcor
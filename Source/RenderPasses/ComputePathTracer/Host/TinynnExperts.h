@@ -0,0 +1,102 @@
+#pragma once
+#include "TinynnDeferredQueries.h"
+#include "TinynnFeatureEncodings.h"
+#include "TinynnMLP.h"
+#include "Utils/Math/Vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+namespace tinynn
+{
+// CPU version of the nn experts of NNExperts.slang and the binning of the deferred queries in NNBatchInference.slang.
+
+/// Most experts the shaders instantiate an mlp for, MLP_COUNT.
+constexpr uint32_t kMaxExperts = 4;
+
+/// How queries are assigned to the experts, matches NN_EXPERT_ROUTING.
+enum class ExpertRouting : uint32_t
+{
+    Spatial = 0,  ///< Slabs of equal width along the longest axis of the scene bounds.
+    Material = 1, ///< Material ID modulo the expert count.
+};
+
+/**
+ * Assigns every query to one of the experts. Every expert is an mlp followed by its own feature hash grid in the parameter buffer,
+ * all queries of a region or a material are evaluated and trained by the same expert.
+ */
+struct ExpertRouter
+{
+    ExpertRouting routing = ExpertRouting::Spatial;
+    uint32_t expertCount = 1;
+    /// Slab axis of the spatial routing, NN_EXPERT_AXIS.
+    uint32_t axis = 0;
+    /// Start of the first slab on the axis, NN_EXPERT_ORIGIN.
+    float origin = 0.f;
+    /// Slabs per world unit, NN_EXPERT_SCALE.
+    float scale = 0.f;
+
+    /**
+     * Router for a scene, the slabs of the spatial routing split the longest axis of the bounds evenly.
+     * @param[in] expertCount Number of experts, 1 to kMaxExperts.
+     */
+    static ExpertRouter create(ExpertRouting routing, uint32_t expertCount, float3 sceneMin, float3 sceneMax);
+
+    /// Expert of a query, mirrors getNNExpert(). Positions outside of the bounds use the closest slab.
+    uint32_t route(float3 pos, uint32_t materialID) const;
+};
+
+/**
+ * Deferred queries binned by their expert. Every bin starts at a full group of the inference pass, so every group evaluates a
+ * single expert and can preload its weights.
+ */
+struct ExpertBins
+{
+    /// Slot of the padding at the end of a bin.
+    static constexpr uint32_t kInvalidQuery = ~0u;
+
+    /// Queries per expert.
+    std::vector<uint32_t> counts;
+    /// First slot of the bin of every expert.
+    std::vector<uint32_t> offsets;
+    /// Query index per slot, kInvalidQuery for the padding.
+    std::vector<uint32_t> order;
+
+    /// Groups of the inference pass.
+    uint32_t getGroupCount() const { return uint32_t(order.size()) / kDeferredQueryGroupSize; }
+    /// Expert evaluated by a group, mirrors findNNExpertBin().
+    uint32_t getGroupExpert(uint32_t group) const;
+};
+
+/**
+ * First slot of the bin of an expert, mirrors getNNExpertBinOffset().
+ * @param[in] counts Queries per expert.
+ */
+uint32_t getExpertBinOffset(const uint32_t* counts, uint32_t expert);
+
+/**
+ * Bin the queries by the expert they were recorded with, mirrors the bin pass. The GPU appends to the bins in an arbitrary order,
+ * here the queries of a bin keep their order.
+ */
+ExpertBins binDeferredQueries(const DeferredQuery* queries, uint32_t count, uint32_t expertCount);
+
+/**
+ * Evaluate the binned queries with their experts, mirrors NNBatchInference::infer() with several experts. Every bin is evaluated
+ * as one batch by its expert.
+ * @param[in] grids Feature hash grid per expert, only used by the hash encodings.
+ * @param[in] mlps Network per expert with loaded weights, their width has to be kFeatureWidth.
+ * @param[out] results First three outputs of the expert of every query, indexed like the queries.
+ */
+void inferExpertQueries(
+    Encoding encoding,
+    FeatureHashGrid* const* grids,
+    const float16_t* primal,
+    const HalfMLP* const* mlps,
+    const ExpertBins& bins,
+    const DeferredQuery* queries,
+    float3* results
+);
+} // namespace tinynn
+} // namespace Falcor
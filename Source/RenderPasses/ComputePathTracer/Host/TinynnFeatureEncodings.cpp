@@ -0,0 +1,609 @@
+#include "TinynnFeatureEncodings.h"
+#include "TinynnKernels.h"
+#include "RadianceHashGrid.h"
+#include "Core/Error.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+const float kPi = 3.14159265358979323846f;
+const float kSceneScale = 60.f;
+const float kLogBase = 2.f;
+// NIRC looks up the multi level direction values at a fixed position level
+const uint32_t kMultiLevelDirPositionLevel = 5;
+const uint16_t kHalfOne = 0x3c00;
+// keys between the prefetch of a home slot and its lookup
+const uint32_t kPrefetchDistance = 16;
+
+// float to integer conversions follow the D3D rules the shaders rely on: NaN maps to 0 and out of range values saturate
+uint32_t toUint(float v)
+{
+    if (!(v > 0.f)) return 0;
+    if (v >= 4294967296.f) return std::numeric_limits<uint32_t>::max();
+    return uint32_t(v);
+}
+
+int32_t toInt(float v)
+{
+    if (std::isnan(v)) return 0;
+    if (v >= 2147483648.f) return std::numeric_limits<int32_t>::max();
+    if (v <= -2147483648.f) return std::numeric_limits<int32_t>::min();
+    return int32_t(v);
+}
+
+int3 floorToInt(float3 v)
+{
+    return int3(toInt(std::floor(v.x)), toInt(std::floor(v.y)), toInt(std::floor(v.z)));
+}
+
+uint3 asUint(int3 v)
+{
+    return uint3(uint32_t(v.x), uint32_t(v.y), uint32_t(v.z));
+}
+
+float roundToHalf(float x)
+{
+    return math::float16ToFloat32(floatToHalfBits(x));
+}
+
+uint2 quantizePolarToBitRange(float2 input, uint32_t newMax)
+{
+    const float range = float(newMax + 1) - 0.001f;
+    uint2 result;
+    result.x = toUint(((input.x + kPi) / (kPi + kPi)) * range);
+    result.y = toUint((input.y / kPi) * range);
+    return result;
+}
+
+/// Key bit counts of a level.
+struct KeyLayout
+{
+    uint32_t positionBitNum;
+    uint32_t directionBitNum;
+    uint32_t levelBitNum;
+    // level stored in the key and used for the grid position
+    uint32_t positionLevel;
+};
+
+KeyLayout getKeyLayout(FeatureHashGrid::Method method, uint32_t level, bool multiLevelDir)
+{
+    if (method == FeatureHashGrid::Method::NRC) return {17, 0, 10, level};
+    // range of used bits for directional encoding: [1, 8]
+    const uint32_t directionBitNum = multiLevelDir ? level + 1 : 4;
+    return {18 - directionBitNum, directionBitNum, 7, multiLevelDir ? kMultiLevelDirPositionLevel : level};
+}
+
+// corner offsets in the order of HashEncInterpolate.slang
+const int3 kCornerOffsets[FeatureHashGrid::kCornerCount] = {
+    int3(0, 0, 0),
+    int3(1, 1, 1),
+    int3(1, 0, 0),
+    int3(0, 1, 0),
+    int3(0, 0, 1),
+    int3(1, 1, 0),
+    int3(1, 0, 1),
+    int3(0, 1, 1),
+};
+
+void computeCornerWeights(float3 w, float weights[FeatureHashGrid::kCornerCount])
+{
+    weights[0] = (1.f - w.x) * (1.f - w.y) * (1.f - w.z);
+    weights[1] = w.x * w.y * w.z;
+    weights[2] = w.x * (1.f - w.y) * (1.f - w.z);
+    weights[3] = (1.f - w.x) * w.y * (1.f - w.z);
+    weights[4] = (1.f - w.x) * (1.f - w.y) * w.z;
+    weights[5] = w.x * w.y * (1.f - w.z);
+    weights[6] = w.x * (1.f - w.y) * w.z;
+    weights[7] = (1.f - w.x) * w.y * w.z;
+}
+
+float3 loadQuery(const float* const components[3], uint32_t q)
+{
+    return float3(components[0][q], components[1][q], components[2][q]);
+}
+
+// https://github.com/nvlabs/tiny-cuda-nn
+// SH polynomials generated using scripts/gen_sh.py based on the recurrence relations in appendix A1 of
+// https://www.ppsloan.org/publications/StupidSH36.pdf
+template<uint32_t Degree>
+void evalSH(float x, float y, float z, float* v, uint32_t stride)
+{
+    [[maybe_unused]] const float xy = x * y, xz = x * z, yz = y * z, x2 = x * x, y2 = y * y, z2 = z * z;
+    [[maybe_unused]] const float x4 = x2 * x2, y4 = y2 * y2, z4 = z2 * z2;
+    [[maybe_unused]] const float x6 = x4 * x2, y6 = y4 * y2, z6 = z4 * z2;
+
+    v[0 * stride] = roundToHalf(0.28209479177387814f); // 1/(2*sqrt(pi))
+    if constexpr (Degree <= 1) return;
+    v[1 * stride] = roundToHalf(-0.48860251190291987f*y); // -sqrt(3)*y/(2*sqrt(pi))
+    v[2 * stride] = roundToHalf(0.48860251190291987f*z); // sqrt(3)*z/(2*sqrt(pi))
+    v[3 * stride] = roundToHalf(-0.48860251190291987f*x); // -sqrt(3)*x/(2*sqrt(pi))
+    if constexpr (Degree <= 2) return;
+    v[4 * stride] = roundToHalf(1.0925484305920792f*xy); // sqrt(15)*xy/(2*sqrt(pi))
+    v[5 * stride] = roundToHalf(-1.0925484305920792f*yz); // -sqrt(15)*yz/(2*sqrt(pi))
+    v[6 * stride] = roundToHalf(0.94617469575755997f*z2 - 0.31539156525251999f); // sqrt(5)*(3*z2 - 1)/(4*sqrt(pi))
+    v[7 * stride] = roundToHalf(-1.0925484305920792f*xz); // -sqrt(15)*xz/(2*sqrt(pi))
+    v[8 * stride] = roundToHalf(0.54627421529603959f*x2 - 0.54627421529603959f*y2); // sqrt(15)*(x2 - y2)/(4*sqrt(pi))
+    if constexpr (Degree <= 3) return;
+    v[9 * stride] = roundToHalf(0.59004358992664352f*y*(-3.0f*x2 + y2)); // sqrt(70)*y*(-3*x2 + y2)/(8*sqrt(pi))
+    v[10 * stride] = roundToHalf(2.8906114426405538f*xy*z); // sqrt(105)*xy*z/(2*sqrt(pi))
+    v[11 * stride] = roundToHalf(0.45704579946446572f*y*(1.0f - 5.0f*z2)); // sqrt(42)*y*(1 - 5*z2)/(8*sqrt(pi))
+    v[12 * stride] = roundToHalf(0.3731763325901154f*z*(5.0f*z2 - 3.0f)); // sqrt(7)*z*(5*z2 - 3)/(4*sqrt(pi))
+    v[13 * stride] = roundToHalf(0.45704579946446572f*x*(1.0f - 5.0f*z2)); // sqrt(42)*x*(1 - 5*z2)/(8*sqrt(pi))
+    v[14 * stride] = roundToHalf(1.4453057213202769f*z*(x2 - y2)); // sqrt(105)*z*(x2 - y2)/(4*sqrt(pi))
+    v[15 * stride] = roundToHalf(0.59004358992664352f*x*(-x2 + 3.0f*y2)); // sqrt(70)*x*(-x2 + 3*y2)/(8*sqrt(pi))
+    if constexpr (Degree <= 4) return;
+    v[16 * stride] = roundToHalf(2.5033429417967046f*xy*(x2 - y2)); // 3*sqrt(35)*xy*(x2 - y2)/(4*sqrt(pi))
+    v[17 * stride] = roundToHalf(1.7701307697799304f*yz*(-3.0f*x2 + y2)); // 3*sqrt(70)*yz*(-3*x2 + y2)/(8*sqrt(pi))
+    v[18 * stride] = roundToHalf(0.94617469575756008f*xy*(7.0f*z2 - 1.0f)); // 3*sqrt(5)*xy*(7*z2 - 1)/(4*sqrt(pi))
+    v[19 * stride] = roundToHalf(0.66904654355728921f*yz*(3.0f - 7.0f*z2)); // 3*sqrt(10)*yz*(3 - 7*z2)/(8*sqrt(pi))
+    // 3*(-30*z2 + 35*z4 + 3)/(16*sqrt(pi))
+    v[20 * stride] = roundToHalf(-3.1735664074561294f*z2 + 3.7024941420321507f*z4 + 0.31735664074561293f);
+    v[21 * stride] = roundToHalf(0.66904654355728921f*xz*(3.0f - 7.0f*z2)); // 3*sqrt(10)*xz*(3 - 7*z2)/(8*sqrt(pi))
+    v[22 * stride] = roundToHalf(0.47308734787878004f*(x2 - y2)*(7.0f*z2 - 1.0f)); // 3*sqrt(5)*(x2 - y2)*(7*z2 - 1)/(8*sqrt(pi))
+    v[23 * stride] = roundToHalf(1.7701307697799304f*xz*(-x2 + 3.0f*y2)); // 3*sqrt(70)*xz*(-x2 + 3*y2)/(8*sqrt(pi))
+    // 3*sqrt(35)*(-6*x2*y2 + x4 + y4)/(16*sqrt(pi))
+    v[24 * stride] = roundToHalf(-3.7550144126950569f*x2*y2 + 0.62583573544917614f*x4 + 0.62583573544917614f*y4);
+    if constexpr (Degree <= 5) return;
+    v[25 * stride] = roundToHalf(0.65638205684017015f*y*(10.0f*x2*y2 - 5.0f*x4 - y4)); // 3*sqrt(154)*y*(10*x2*y2 - 5*x4 - y4)/(32*sqrt(pi))
+    v[26 * stride] = roundToHalf(8.3026492595241645f*xy*z*(x2 - y2)); // 3*sqrt(385)*xy*z*(x2 - y2)/(4*sqrt(pi))
+    // -sqrt(770)*y*(3*x2 - y2)*(9*z2 - 1)/(32*sqrt(pi))
+    v[27 * stride] = roundToHalf(-0.48923829943525038f*y*(3.0f*x2 - y2)*(9.0f*z2 - 1.0f));
+    v[28 * stride] = roundToHalf(4.7935367849733241f*xy*z*(3.0f*z2 - 1.0f)); // sqrt(1155)*xy*z*(3*z2 - 1)/(4*sqrt(pi))
+    v[29 * stride] = roundToHalf(0.45294665119569694f*y*(14.0f*z2 - 21.0f*z4 - 1.0f)); // sqrt(165)*y*(14*z2 - 21*z4 - 1)/(16*sqrt(pi))
+    v[30 * stride] = roundToHalf(0.1169503224534236f*z*(-70.0f*z2 + 63.0f*z4 + 15.0f)); // sqrt(11)*z*(-70*z2 + 63*z4 + 15)/(16*sqrt(pi))
+    v[31 * stride] = roundToHalf(0.45294665119569694f*x*(14.0f*z2 - 21.0f*z4 - 1.0f)); // sqrt(165)*x*(14*z2 - 21*z4 - 1)/(16*sqrt(pi))
+    v[32 * stride] = roundToHalf(2.3967683924866621f*z*(x2 - y2)*(3.0f*z2 - 1.0f)); // sqrt(1155)*z*(x2 - y2)*(3*z2 - 1)/(8*sqrt(pi))
+    // -sqrt(770)*x*(x2 - 3*y2)*(9*z2 - 1)/(32*sqrt(pi))
+    v[33 * stride] = roundToHalf(-0.48923829943525038f*x*(x2 - 3.0f*y2)*(9.0f*z2 - 1.0f));
+    v[34 * stride] = roundToHalf(2.0756623148810411f*z*(-6.0f*x2*y2 + x4 + y4)); // 3*sqrt(385)*z*(-6*x2*y2 + x4 + y4)/(16*sqrt(pi))
+    v[35 * stride] = roundToHalf(0.65638205684017015f*x*(10.0f*x2*y2 - x4 - 5.0f*y4)); // 3*sqrt(154)*x*(10*x2*y2 - x4 - 5*y4)/(32*sqrt(pi))
+    if constexpr (Degree <= 6) return;
+    // sqrt(6006)*xy*(-10*x2*y2 + 3*x4 + 3*y4)/(32*sqrt(pi))
+    v[36 * stride] = roundToHalf(1.3663682103838286f*xy*(-10.0f*x2*y2 + 3.0f*x4 + 3.0f*y4));
+    // 3*sqrt(2002)*yz*(10*x2*y2 - 5*x4 - y4)/(32*sqrt(pi))
+    v[37 * stride] = roundToHalf(2.3666191622317521f*yz*(10.0f*x2*y2 - 5.0f*x4 - y4));
+    v[38 * stride] = roundToHalf(2.0182596029148963f*xy*(x2 - y2)*(11.0f*z2 - 1.0f)); // 3*sqrt(91)*xy*(x2 - y2)*(11*z2 - 1)/(8*sqrt(pi))
+    // -sqrt(2730)*yz*(3*x2 - y2)*(11*z2 - 3)/(32*sqrt(pi))
+    v[39 * stride] = roundToHalf(-0.92120525951492349f*yz*(3.0f*x2 - y2)*(11.0f*z2 - 3.0f));
+    v[40 * stride] = roundToHalf(0.92120525951492349f*xy*(-18.0f*z2 + 33.0f*z4 + 1.0f)); // sqrt(2730)*xy*(-18*z2 + 33*z4 + 1)/(32*sqrt(pi))
+    v[41 * stride] = roundToHalf(0.58262136251873131f*yz*(30.0f*z2 - 33.0f*z4 - 5.0f)); // sqrt(273)*yz*(30*z2 - 33*z4 - 5)/(16*sqrt(pi))
+    // sqrt(13)*(105*z2 - 315*z4 + 231*z6 - 5)/(32*sqrt(pi))
+    v[42 * stride] = roundToHalf(6.6747662381009842f*z2 - 20.024298714302954f*z4 + 14.684485723822165f*z6 - 0.31784601133814211f);
+    v[43 * stride] = roundToHalf(0.58262136251873131f*xz*(30.0f*z2 - 33.0f*z4 - 5.0f)); // sqrt(273)*xz*(30*z2 - 33*z4 - 5)/(16*sqrt(pi))
+    // sqrt(2730)*(x2 - y2)*(11*z2*(3*z2 - 1) - 7*z2 + 1)/(64*sqrt(pi))
+    v[44 * stride] = roundToHalf(0.46060262975746175f*(x2 - y2)*(11.0f*z2*(3.0f*z2 - 1.0f) - 7.0f*z2 + 1.0f));
+    // -sqrt(2730)*xz*(x2 - 3*y2)*(11*z2 - 3)/(32*sqrt(pi))
+    v[45 * stride] = roundToHalf(-0.92120525951492349f*xz*(x2 - 3.0f*y2)*(11.0f*z2 - 3.0f));
+    // 3*sqrt(91)*(11*z2 - 1)*(-6*x2*y2 + x4 + y4)/(32*sqrt(pi))
+    v[46 * stride] = roundToHalf(0.50456490072872406f*(11.0f*z2 - 1.0f)*(-6.0f*x2*y2 + x4 + y4));
+    // 3*sqrt(2002)*xz*(10*x2*y2 - x4 - 5*y4)/(32*sqrt(pi))
+    v[47 * stride] = roundToHalf(2.3666191622317521f*xz*(10.0f*x2*y2 - x4 - 5.0f*y4));
+    // sqrt(6006)*(15*x2*y4 - 15*x4*y2 + x6 - y6)/(64*sqrt(pi))
+    v[48 * stride] = roundToHalf(10.247761577878714f*x2*y4 - 10.247761577878714f*x4*y2 + 0.6831841051919143f*x6 - 0.6831841051919143f*y6);
+    if constexpr (Degree <= 7) return;
+    // 3*sqrt(715)*y*(-21*x2*y4 + 35*x4*y2 - 7*x6 + y6)/(64*sqrt(pi))
+    v[49 * stride] = roundToHalf(0.70716273252459627f*y*(-21.0f*x2*y4 + 35.0f*x4*y2 - 7.0f*x6 + y6));
+    // 3*sqrt(10010)*xy*z*(-10*x2*y2 + 3*x4 + 3*y4)/(32*sqrt(pi))
+    v[50 * stride] = roundToHalf(5.2919213236038001f*xy*z*(-10.0f*x2*y2 + 3.0f*x4 + 3.0f*y4));
+    // -3*sqrt(385)*y*(13*z2 - 1)*(-10*x2*y2 + 5*x4 + y4)/(64*sqrt(pi))
+    v[51 * stride] = roundToHalf(-0.51891557872026028f*y*(13.0f*z2 - 1.0f)*(-10.0f*x2*y2 + 5.0f*x4 + y4));
+    // 3*sqrt(385)*xy*z*(x2 - y2)*(13*z2 - 3)/(8*sqrt(pi))
+    v[52 * stride] = roundToHalf(4.1513246297620823f*xy*z*(x2 - y2)*(13.0f*z2 - 3.0f));
+    // -3*sqrt(35)*y*(3*x2 - y2)*(13*z2*(11*z2 - 3) - 27*z2 + 3)/(64*sqrt(pi))
+    v[53 * stride] = roundToHalf(-0.15645893386229404f*y*(3.0f*x2 - y2)*(13.0f*z2*(11.0f*z2 - 3.0f) - 27.0f*z2 + 3.0f));
+    // 3*sqrt(70)*xy*z*(-110*z2 + 143*z4 + 15)/(32*sqrt(pi))
+    v[54 * stride] = roundToHalf(0.44253269244498261f*xy*z*(-110.0f*z2 + 143.0f*z4 + 15.0f));
+    // sqrt(105)*y*(-135*z2 + 495*z4 - 429*z6 + 5)/(64*sqrt(pi))
+    v[55 * stride] = roundToHalf(0.090331607582517306f*y*(-135.0f*z2 + 495.0f*z4 - 429.0f*z6 + 5.0f));
+    // sqrt(15)*z*(315*z2 - 693*z4 + 429*z6 - 35)/(32*sqrt(pi))
+    v[56 * stride] = roundToHalf(0.068284276912004949f*z*(315.0f*z2 - 693.0f*z4 + 429.0f*z6 - 35.0f));
+    // sqrt(105)*x*(-135*z2 + 495*z4 - 429*z6 + 5)/(64*sqrt(pi))
+    v[57 * stride] = roundToHalf(0.090331607582517306f*x*(-135.0f*z2 + 495.0f*z4 - 429.0f*z6 + 5.0f));
+    // sqrt(70)*z*(x2 - y2)*(143*z2*(3*z2 - 1) - 187*z2 + 45)/(64*sqrt(pi))
+    v[58 * stride] = roundToHalf(0.07375544874083044f*z*(x2 - y2)*(143.0f*z2*(3.0f*z2 - 1.0f) - 187.0f*z2 + 45.0f));
+    // -3*sqrt(35)*x*(x2 - 3*y2)*(13*z2*(11*z2 - 3) - 27*z2 + 3)/(64*sqrt(pi))
+    v[59 * stride] = roundToHalf(-0.15645893386229404f*x*(x2 - 3.0f*y2)*(13.0f*z2*(11.0f*z2 - 3.0f) - 27.0f*z2 + 3.0f));
+    // 3*sqrt(385)*z*(13*z2 - 3)*(-6*x2*y2 + x4 + y4)/(32*sqrt(pi))
+    v[60 * stride] = roundToHalf(1.0378311574405206f*z*(13.0f*z2 - 3.0f)*(-6.0f*x2*y2 + x4 + y4));
+    // -3*sqrt(385)*x*(13*z2 - 1)*(-10*x2*y2 + x4 + 5*y4)/(64*sqrt(pi))
+    v[61 * stride] = roundToHalf(-0.51891557872026028f*x*(13.0f*z2 - 1.0f)*(-10.0f*x2*y2 + x4 + 5.0f*y4));
+    // 3*sqrt(10010)*z*(15*x2*y4 - 15*x4*y2 + x6 - y6)/(64*sqrt(pi))
+    v[62 * stride] = roundToHalf(2.6459606618019f*z*(15.0f*x2*y4 - 15.0f*x4*y2 + x6 - y6));
+    // 3*sqrt(715)*x*(-35*x2*y4 + 21*x4*y2 - x6 + 7*y6)/(64*sqrt(pi))
+    v[63 * stride] = roundToHalf(0.70716273252459627f*x*(-35.0f*x2*y4 + 21.0f*x4*y2 - x6 + 7.0f*y6));
+}
+
+template<uint32_t Degree>
+void evalSHBatch(const QueryBatch& batch, float* values)
+{
+    for (uint32_t q = 0; q < batch.count; q++)
+        evalSH<Degree>(batch.direction[0][q], batch.direction[1][q], batch.direction[2][q], values + q, batch.count);
+}
+
+/// Convert one SoA array to a feature column.
+void storeColumn(const float* values, uint32_t count, uint32_t column, float16_t* features)
+{
+    for (uint32_t q = 0; q < count; q++)
+        features[q * kFeatureWidth + column] = float16_t::fromBits(floatToHalfBits(values[q]));
+}
+} // namespace
+
+FeatureHashGrid::FeatureHashGrid(const Desc& desc, uint32_t& offsetPrim, uint32_t& offsetGrad)
+    : mDesc(desc), mOffsetPrim(offsetPrim), mOffsetGrad(offsetGrad)
+{
+    const uint32_t slotCount = mDesc.size / getPlacesPerElement();
+    mCapacity = mDesc.separateLevelGrids ? slotCount / kLevelCount : slotCount;
+    FALCOR_CHECK(mCapacity > 0, "Feature hash grid of size {} has no slots.", mDesc.size);
+    mEntries = std::make_unique<std::atomic<HashKey>[]>(slotCount);
+    reset();
+    offsetPrim += mDesc.size;
+    offsetGrad += mDesc.size;
+}
+
+uint32_t FeatureHashGrid::hash32(HashKey hashKey)
+{
+    return RadianceHashGrid::hash32(hashKey);
+}
+
+float FeatureHashGrid::getVoxelSize(uint32_t level)
+{
+    return std::pow(kLogBase, float(level)) / kSceneScale;
+}
+
+FeatureHashGrid::QueryInfo FeatureHashGrid::getQueryInfo(float3 direction, float3 normal) const
+{
+    QueryInfo info;
+    info.polar = float2(std::atan(direction.y / direction.x), std::acos(direction.z));
+    info.normalBits = (normal.x >= 0 ? 1 : 0) + (normal.y >= 0 ? 2 : 0) + (normal.z >= 0 ? 4 : 0);
+    return info;
+}
+
+FeatureHashGrid::HashKey FeatureHashGrid::packKey(const QueryInfo& info, uint3 gridPosition, uint32_t level, bool multiLevelDir) const
+{
+    const KeyLayout layout = getKeyLayout(mDesc.method, level, multiLevelDir);
+    const HashKey positionBitMask = (HashKey(1) << layout.positionBitNum) - 1;
+    const HashKey directionBitMask = (HashKey(1) << layout.directionBitNum) - 1;
+    const HashKey levelBitMask = (HashKey(1) << layout.levelBitNum) - 1;
+    const uint2 quantizedDir = quantizePolarToBitRange(info.polar, uint32_t(directionBitMask));
+
+    HashKey hashKey = info.normalBits;
+    hashKey <<= layout.levelBitNum;
+    if (!mDesc.separateLevelGrids) hashKey |= HashKey(layout.positionLevel) & levelBitMask;
+    hashKey <<= layout.positionBitNum;
+    hashKey |= HashKey(gridPosition.z) & positionBitMask;
+    hashKey <<= layout.positionBitNum;
+    hashKey |= HashKey(gridPosition.y) & positionBitMask;
+    hashKey <<= layout.positionBitNum;
+    hashKey |= HashKey(gridPosition.x) & positionBitMask;
+    hashKey <<= layout.directionBitNum;
+    hashKey |= HashKey(quantizedDir.y) & directionBitMask;
+    hashKey <<= layout.directionBitNum;
+    hashKey |= HashKey(quantizedDir.x) & directionBitMask;
+    return hashKey;
+}
+
+FeatureHashGrid::HashKey FeatureHashGrid::computeSpatialHash(
+    float3 position,
+    float3 direction,
+    float3 normal,
+    uint32_t level,
+    bool multiLevelDir
+) const
+{
+    const float voxelSize = getVoxelSize(getKeyLayout(mDesc.method, level, multiLevelDir).positionLevel);
+    const float3 scaled = position / voxelSize;
+    return packKey(getQueryInfo(direction, normal), asUint(floorToInt(scaled)), level, multiLevelDir);
+}
+
+void FeatureHashGrid::computeCornerHashes(
+    float3 position,
+    float3 direction,
+    float3 normal,
+    uint32_t level,
+    bool multiLevelDir,
+    HashKey keys[kCornerCount],
+    float weights[kCornerCount]
+) const
+{
+    const float voxelSize = getVoxelSize(getKeyLayout(mDesc.method, level, multiLevelDir).positionLevel);
+    const float3 scaled = position / voxelSize;
+    const int3 gridPosition = floorToInt(scaled);
+    computeCornerWeights(scaled - float3(gridPosition), weights);
+    const QueryInfo info = getQueryInfo(direction, normal);
+    for (uint32_t i = 0; i < kCornerCount; i++)
+    {
+        keys[i] = packKey(info, asUint(gridPosition + kCornerOffsets[i]), level, multiLevelDir);
+    }
+}
+
+void FeatureHashGrid::countLookup(uint32_t level, uint32_t probes, bool miss) const
+{
+    Counters& counters = mCounters[level];
+    counters.lookups.fetch_add(1, std::memory_order_relaxed);
+    counters.probes.fetch_add(probes, std::memory_order_relaxed);
+    if (miss) counters.misses.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t FeatureHashGrid::insertEntry(HashKey hashKey, uint32_t level)
+{
+    uint32_t slot = hash32(hashKey) % mCapacity;
+    const uint32_t levelOffset = getLevelOffset() * level;
+    uint32_t probes = 0;
+    bool found = false;
+    // search for slot that is empty or occupied with the same hash
+    // if no such slot is found, produce collision on the first slot
+    for (uint32_t bucketOffset = 0; bucketOffset <= mDesc.probingSize && slot + bucketOffset < mCapacity; ++bucketOffset)
+    {
+        probes++;
+        HashKey prevHashKey = kInvalidHashKey;
+        mEntries[slot + bucketOffset + levelOffset].compare_exchange_strong(prevHashKey, hashKey, std::memory_order_relaxed);
+        if (prevHashKey == kInvalidHashKey || prevHashKey == hashKey)
+        {
+            slot += bucketOffset;
+            found = true;
+            break;
+        }
+    }
+    countLookup(level, probes, !found);
+    return (slot + levelOffset) * getPlacesPerElement();
+}
+
+uint32_t FeatureHashGrid::findEntry(HashKey hashKey, uint32_t level) const
+{
+    uint32_t slot = hash32(hashKey) % mCapacity;
+    const uint32_t levelOffset = getLevelOffset() * level;
+    uint32_t probes = 0;
+    bool found = false;
+    for (uint32_t bucketOffset = 0; bucketOffset <= mDesc.probingSize && slot + bucketOffset < mCapacity; ++bucketOffset)
+    {
+        probes++;
+        if (mEntries[slot + bucketOffset + levelOffset].load(std::memory_order_relaxed) == hashKey)
+        {
+            slot += bucketOffset;
+            found = true;
+            break;
+        }
+    }
+    countLookup(level, probes, !found);
+    return (slot + levelOffset) * getPlacesPerElement();
+}
+
+void FeatureHashGrid::resolveKeys(const HashKey* keys, uint32_t count, uint32_t level, bool insert, uint32_t* indices)
+{
+    // the grid is much larger than the caches, prefetching the home slots of the next keys overlaps the misses
+    const uint32_t levelOffset = getLevelOffset() * level;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i + kPrefetchDistance < count)
+        {
+            const uint32_t slot = hash32(keys[i + kPrefetchDistance]) % mCapacity + levelOffset;
+            _mm_prefetch(reinterpret_cast<const char*>(&mEntries[slot]), _MM_HINT_T0);
+        }
+        indices[i] = insert ? insertEntry(keys[i], level) : findEntry(keys[i], level);
+    }
+}
+
+void FeatureHashGrid::computeIndices(const QueryBatch& batch, bool multiLevelDir, bool insert, uint32_t* indices)
+{
+    // the direction and normal bits are shared by all levels, only the grid position changes
+    std::vector<QueryInfo> infos(batch.count);
+    for (uint32_t q = 0; q < batch.count; q++)
+        infos[q] = getQueryInfo(loadQuery(batch.direction, q), loadQuery(batch.normal, q));
+
+    std::vector<HashKey> keys(batch.count);
+    for (uint32_t level = 0; level < kLevelCount; level++)
+    {
+        const float voxelSize = getVoxelSize(getKeyLayout(mDesc.method, level, multiLevelDir).positionLevel);
+        for (uint32_t q = 0; q < batch.count; q++)
+        {
+            const float3 scaled = loadQuery(batch.position, q) / voxelSize;
+            keys[q] = packKey(infos[q], asUint(floorToInt(scaled)), level, multiLevelDir);
+        }
+        resolveKeys(keys.data(), batch.count, level, insert, indices + level * batch.count);
+    }
+}
+
+void FeatureHashGrid::computeCornerIndices(const QueryBatch& batch, bool multiLevelDir, bool insert, uint32_t* indices, float* weights)
+{
+    std::vector<QueryInfo> infos(batch.count);
+    for (uint32_t q = 0; q < batch.count; q++)
+        infos[q] = getQueryInfo(loadQuery(batch.direction, q), loadQuery(batch.normal, q));
+
+    std::vector<HashKey> keys(kCornerCount * batch.count);
+    for (uint32_t level = 0; level < kLevelCount; level++)
+    {
+        const float voxelSize = getVoxelSize(getKeyLayout(mDesc.method, level, multiLevelDir).positionLevel);
+        float* levelWeights = weights + level * kCornerCount * batch.count;
+        for (uint32_t q = 0; q < batch.count; q++)
+        {
+            const float3 scaled = loadQuery(batch.position, q) / voxelSize;
+            const int3 gridPosition = floorToInt(scaled);
+            float cornerWeights[kCornerCount];
+            computeCornerWeights(scaled - float3(gridPosition), cornerWeights);
+            for (uint32_t i = 0; i < kCornerCount; i++)
+            {
+                keys[i * batch.count + q] = packKey(infos[q], asUint(gridPosition + kCornerOffsets[i]), level, multiLevelDir);
+                levelWeights[i * batch.count + q] = cornerWeights[i];
+            }
+        }
+        resolveKeys(keys.data(), kCornerCount * batch.count, level, insert, indices + level * kCornerCount * batch.count);
+    }
+}
+
+void FeatureHashGrid::reset()
+{
+    const uint32_t slotCount = mDesc.size / getPlacesPerElement();
+    for (uint32_t i = 0; i < slotCount; i++)
+        mEntries[i].store(kInvalidHashKey, std::memory_order_relaxed);
+    resetStats();
+}
+
+void FeatureHashGrid::resetStats()
+{
+    for (Counters& counters : mCounters)
+    {
+        counters.lookups = 0;
+        counters.misses = 0;
+        counters.probes = 0;
+    }
+}
+
+FeatureHashGrid::LevelStats FeatureHashGrid::getLevelStats(uint32_t level) const
+{
+    FALCOR_CHECK(level < kLevelCount, "Feature hash grid has no level {}.", level);
+    const Counters& counters = mCounters[level];
+    LevelStats stats;
+    stats.lookups = counters.lookups.load(std::memory_order_relaxed);
+    stats.misses = counters.misses.load(std::memory_order_relaxed);
+    stats.probes = counters.probes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void encodeSH(uint32_t degree, const QueryBatch& batch, float* values)
+{
+    switch (degree)
+    {
+    case 1:
+        return evalSHBatch<1>(batch, values);
+    case 2:
+        return evalSHBatch<2>(batch, values);
+    case 3:
+        return evalSHBatch<3>(batch, values);
+    case 4:
+        return evalSHBatch<4>(batch, values);
+    case 5:
+        return evalSHBatch<5>(batch, values);
+    case 6:
+        return evalSHBatch<6>(batch, values);
+    case 7:
+        return evalSHBatch<7>(batch, values);
+    case 8:
+        return evalSHBatch<8>(batch, values);
+    default:
+        FALCOR_THROW("Unsupported spherical harmonics degree {}, shEnc() supports 1 to 8.", degree);
+    }
+}
+
+void encodeFrequency(uint32_t octaveCount, uint32_t octaveStep, const QueryBatch& batch, float* values)
+{
+    for (uint32_t i = 0; i < octaveCount; i++)
+    {
+        const float frequency = roundToHalf(3.1415926f * std::exp2(float(i * octaveStep)));
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            float* dst = values + (3 * i + c) * batch.count;
+            for (uint32_t q = 0; q < batch.count; q++)
+                dst[q] = roundToHalf(std::sin(roundToHalf(roundToHalf(batch.position[c][q]) * frequency)));
+        }
+    }
+}
+
+void computeFeatures(
+    Encoding encoding,
+    FeatureHashGrid* grid,
+    const float16_t* primal,
+    const QueryBatch& batch,
+    bool train,
+    float16_t* features
+)
+{
+    const uint32_t count = batch.count;
+    std::fill(features, features + size_t(count) * kFeatureWidth, float16_t::fromBits(kHalfOne));
+    uint32_t column = 0;
+    for (uint32_t c = 0; c < 3; c++)
+        storeColumn(batch.position[c], count, column++, features);
+
+    // octaves and SH degree of the analytic encodings
+    const bool useHashGrid = encoding == Encoding::Hash || encoding == Encoding::HashInterpolation;
+    const uint32_t octaveCount = useHashGrid ? 1 : 4;
+    const uint32_t octaveStep = useHashGrid ? 1 : 2;
+    const uint32_t shDegree = useHashGrid ? 3 : 4;
+    std::vector<float> values(size_t(std::max(3 * octaveCount, shDegree * shDegree)) * count);
+    encodeFrequency(octaveCount, octaveStep, batch, values.data());
+    for (uint32_t i = 0; i < 3 * octaveCount; i++)
+        storeColumn(values.data() + i * count, count, column++, features);
+    encodeSH(shDegree, batch, values.data());
+    for (uint32_t i = 0; i < shDegree * shDegree; i++)
+        storeColumn(values.data() + i * count, count, column++, features);
+    if (!useHashGrid) return;
+
+    FALCOR_CHECK(grid != nullptr && primal != nullptr, "Hash encodings need a feature hash grid and its primal buffer.");
+    const float16_t* data = primal + grid->getOffsetPrim();
+    const bool multiLevelDir = grid->useMultiLevelDir();
+    const uint32_t levelCount = FeatureHashGrid::kLevelCount;
+    // the first index array holds the multi level direction values, the second the fixed direction or the second half of the slot
+    const bool interpolate = encoding == Encoding::HashInterpolation;
+    const uint32_t cornerCount = interpolate ? FeatureHashGrid::kCornerCount : 1;
+    const uint32_t lookupCount = multiLevelDir ? 2 : 1;
+    // lookup 0 reads the multi level direction values or both halfs of the slot, lookup 1 the fixed direction values
+    const size_t indexCount = size_t(levelCount) * cornerCount * count;
+    std::vector<uint32_t> indices(lookupCount * indexCount);
+    std::vector<float> weights(interpolate ? lookupCount * indexCount : 0);
+    for (uint32_t k = 0; k < lookupCount; k++)
+    {
+        // computeFeature() passes multiLevelDir = true for the first value of a level with USE_MULTI_LEVEL_DIR
+        const bool levelDir = multiLevelDir && k == 0;
+        if (interpolate)
+            grid->computeCornerIndices(batch, levelDir, train, indices.data() + k * indexCount, weights.data() + k * indexCount);
+        else
+            grid->computeIndices(batch, levelDir, train, indices.data() + k * indexCount);
+    }
+
+    // gather level by level, the indices of a level and corner are contiguous
+    std::vector<float> value0(count), value1(count);
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const size_t levelOffset = size_t(level) * cornerCount * count;
+        const uint32_t* idx0 = indices.data() + levelOffset;
+        const uint32_t* idx1 = multiLevelDir ? idx0 + indexCount : nullptr;
+        if (!interpolate)
+        {
+            for (uint32_t q = 0; q < count; q++)
+            {
+                value0[q] = float(data[idx0[q]]);
+                value1[q] = float(data[multiLevelDir ? idx1[q] : idx0[q] + 1]);
+            }
+        }
+        else
+        {
+            std::fill(value0.begin(), value0.end(), 0.f);
+            std::fill(value1.begin(), value1.end(), 0.f);
+            const float* w0 = weights.data() + levelOffset;
+            const float* w1 = multiLevelDir ? w0 + indexCount : nullptr;
+            for (uint32_t i = 0; i < cornerCount; i++)
+            {
+                const size_t offset = size_t(i) * count;
+                if (multiLevelDir)
+                {
+                    for (uint32_t q = 0; q < count; q++)
+                    {
+                        value0[q] += float(data[idx0[offset + q]]) * w0[offset + q];
+                        value1[q] += float(data[idx1[offset + q]]) * w1[offset + q];
+                    }
+                }
+                else
+                {
+                    // every weighted value is rounded to half before it is accumulated
+                    for (uint32_t q = 0; q < count; q++)
+                    {
+                        value0[q] += roundToHalf(float(data[idx0[offset + q]]) * w0[offset + q]);
+                        value1[q] += roundToHalf(float(data[idx0[offset + q] + 1]) * w0[offset + q]);
+                    }
+                }
+            }
+        }
+        storeColumn(value0.data(), count, column++, features);
+        storeColumn(value1.data(), count, column++, features);
+    }
+}
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,225 @@
+#pragma once
+#include "Utils/Math/ScalarTypes.h"
+#include "Utils/Math/Vector.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+namespace tinynn
+{
+/// Values per feature vector, the input width of the MLPs.
+constexpr uint32_t kFeatureWidth = 32;
+
+/// Input encodings of tinynn/TinynnFeatureEncodings.slang, matches NNParams::encMethod.
+enum class Encoding : uint32_t
+{
+    Hash = 0,              ///< NN_USE_HASH_ENC
+    HashInterpolation = 1, ///< NN_USE_HASH_ENC_INTERPOLATION
+    Frequency = 2,         ///< NN_USE_FREQ_ENC
+};
+
+/**
+ * Structure-of-arrays batch of encoder inputs, component c of query q is position[c][q]. The normals are only used by the hash
+ * encodings.
+ */
+struct QueryBatch
+{
+    uint32_t count = 0;
+    const float* position[3] = {};
+    const float* direction[3] = {};
+    const float* normal[3] = {};
+};
+
+/**
+ * CPU version of the multiresolution feature hash grid in tinynn/HashEnc.slang and tinynn/HashEncInterpolate.slang.
+ *
+ * Keys, slots and probing are the same as in the shader, so collision rates measured on the CPU carry over to the GPU. The grid
+ * always keeps the keys of its slots to count collisions, without probing every key simply uses its home slot like the shader.
+ * Inserts are lock-free and may be issued from any number of threads.
+ */
+class FeatureHashGrid
+{
+public:
+    using HashKey = uint64_t;
+
+    static constexpr HashKey kInvalidHashKey = 0;
+    /// Levels of the encoding, computeFeature() reads two values per level.
+    static constexpr uint32_t kLevelCount = 8;
+    /// Corners of the voxel blended by the interpolated encoding.
+    static constexpr uint32_t kCornerCount = 8;
+
+    /// Network the grid belongs to, matches NNParams::nnMethod.
+    enum class Method : uint32_t
+    {
+        NIRC = 0, ///< USE_NIRC
+        NRC = 1,  ///< USE_NRC
+    };
+
+    /// Configuration, corresponds to the FEATURE_HASH_* defines.
+    struct Desc
+    {
+        Method method = Method::NIRC;
+        /// Halfs of storage in the primal buffer, FEATURE_HASH_GRID_SIZE.
+        uint32_t size = 1u << 22;
+        /// USE_MULTI_LEVEL_DIR, only used with NIRC.
+        bool multiLevelDir = true;
+        /// FEATURE_HASH_ENC_SEPARATE_LEVEL_GRIDS, every level gets its own part of the grid.
+        bool separateLevelGrids = true;
+        /// FEATURE_HASH_GRID_PROBING_SIZE
+        uint32_t probingSize = 0;
+    };
+
+    /// Counters of one level since the last reset.
+    struct LevelStats
+    {
+        uint64_t lookups = 0;
+        /// Inserts that found no slot for their key or lookups that did not find their key, both use the home slot.
+        uint64_t misses = 0;
+        /// Slots tested by all lookups.
+        uint64_t probes = 0;
+
+        float getMissRate() const { return lookups > 0 ? float(misses) / float(lookups) : 0.f; }
+        float getAverageProbeCount() const { return lookups > 0 ? float(probes) / float(lookups) : 0.f; }
+    };
+
+    /**
+     * Same as the shader constructor, the grid storage starts at offsetPrim and offsetGrad which are advanced past it.
+     */
+    FeatureHashGrid(const Desc& desc, uint32_t& offsetPrim, uint32_t& offsetGrad);
+
+    const Desc& getDesc() const { return mDesc; }
+    uint32_t getOffsetPrim() const { return mOffsetPrim; }
+    uint32_t getOffsetGrad() const { return mOffsetGrad; }
+    /// True if every level reads one multi level and one fixed direction value, USE_MULTI_LEVEL_DIR && USE_NIRC.
+    bool useMultiLevelDir() const { return mDesc.multiLevelDir && mDesc.method == Method::NIRC; }
+    /// Halfs per slot, FEATURE_HASH_GRID_PLACES_PER_ELEMENT.
+    uint32_t getPlacesPerElement() const { return useMultiLevelDir() ? 1 : 2; }
+    /// Slots available to one level.
+    uint32_t getCapacity() const { return mCapacity; }
+    /// Distance between the slots of two consecutive levels, 0 if all levels share the grid.
+    uint32_t getLevelOffset() const { return mDesc.separateLevelGrids ? mCapacity : 0; }
+
+    // http://burtleburtle.net/bob/hash/integer.html
+    static uint32_t hash32(HashKey hashKey);
+    static float getVoxelSize(uint32_t level);
+
+    /**
+     * Key of a query at a level, mirrors ComputeSpatialHash().
+     * | normal bits | level | pos.z | pos.y | pos.x | dir.y | dir.x |
+     */
+    HashKey computeSpatialHash(float3 position, float3 direction, float3 normal, uint32_t level, bool multiLevelDir) const;
+
+    /**
+     * Keys and trilinear weights of the voxel corners around a query, mirrors ComputeSpatialHash() of HashEncInterpolate.slang.
+     */
+    void computeCornerHashes(
+        float3 position,
+        float3 direction,
+        float3 normal,
+        uint32_t level,
+        bool multiLevelDir,
+        HashKey keys[kCornerCount],
+        float weights[kCornerCount]
+    ) const;
+
+    /**
+     * Insert a key, mirrors FeatureHashGrid::InsertEntry().
+     * @return Index of the first half of the slot relative to the grid storage.
+     */
+    uint32_t insertEntry(HashKey hashKey, uint32_t level);
+
+    /**
+     * Look up a key, mirrors FeatureHashGrid::FindEntry(). Keys that are not stored use their home slot.
+     * @return Index of the first half of the slot relative to the grid storage.
+     */
+    uint32_t findEntry(HashKey hashKey, uint32_t level) const;
+
+    /**
+     * Slots of a batch of queries at all levels. The direction and normal part of the keys is computed once per query and the
+     * indices of a level are written to a contiguous array, so the feature values can be gathered level by level.
+     * @param[in] insert Insert the keys like the training pass instead of looking them up.
+     * @param[out] indices kLevelCount arrays of one index per query, the index of query q at level l is indices[l * count + q].
+     */
+    void computeIndices(const QueryBatch& batch, bool multiLevelDir, bool insert, uint32_t* indices);
+
+    /**
+     * Slots and weights of the voxel corners of a batch of queries at all levels.
+     * @param[out] indices Index of corner i of query q at level l is indices[(l * kCornerCount + i) * count + q].
+     * @param[out] weights Trilinear weights, same layout as the indices.
+     */
+    void computeCornerIndices(const QueryBatch& batch, bool multiLevelDir, bool insert, uint32_t* indices, float* weights);
+
+    /// Key stored in a slot.
+    HashKey getEntry(uint32_t slot) const { return mEntries[slot].load(std::memory_order_relaxed); }
+
+    /// Clear all keys and counters, mirrors the entries part of NNReset.slang.
+    void reset();
+    void resetStats();
+    LevelStats getLevelStats(uint32_t level) const;
+
+private:
+    struct Counters
+    {
+        std::atomic<uint64_t> lookups{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> probes{0};
+    };
+
+    /// Per query values that do not depend on the level.
+    struct QueryInfo
+    {
+        float2 polar;
+        HashKey normalBits;
+    };
+
+    QueryInfo getQueryInfo(float3 direction, float3 normal) const;
+    HashKey packKey(const QueryInfo& info, uint3 gridPosition, uint32_t level, bool multiLevelDir) const;
+    void countLookup(uint32_t level, uint32_t probes, bool miss) const;
+    /// Insert or look up the keys of one level.
+    void resolveKeys(const HashKey* keys, uint32_t count, uint32_t level, bool insert, uint32_t* indices);
+
+    Desc mDesc;
+    uint32_t mOffsetPrim;
+    uint32_t mOffsetGrad;
+    uint32_t mCapacity;
+    std::unique_ptr<std::atomic<HashKey>[]> mEntries;
+    mutable std::array<Counters, kLevelCount> mCounters;
+};
+
+/**
+ * Spherical harmonics encoding of shEnc(), degree * degree values up to degree 8. Like the shader the values are rounded to half.
+ * @param[out] values Value i of query q is written to values[i * count + q].
+ */
+void encodeSH(uint32_t degree, const QueryBatch& batch, float* values);
+
+/**
+ * Frequency encoding of computeFeature(), sin(pi * 2^(octaveStep * i) * p) for every octave i and position component, evaluated in
+ * half precision like the shader.
+ * @param[out] values Value 3 * i + c of query q is written to values[(3 * i + c) * count + q].
+ */
+void encodeFrequency(uint32_t octaveCount, uint32_t octaveStep, const QueryBatch& batch, float* values);
+
+/**
+ * Features of a batch of queries, mirrors computeFeature().
+ * @param[in] encoding Encoding to evaluate.
+ * @param[in] grid Feature hash grid, only used by the hash encodings.
+ * @param[in] primal Whole primal buffer, the grid values are read at the grid offset.
+ * @param[in] batch Queries.
+ * @param[in] train Insert the keys into the grid like the training pass instead of looking them up.
+ * @param[out] features kFeatureWidth values per query, ready for HalfMLP::forward().
+ */
+void computeFeatures(
+    Encoding encoding,
+    FeatureHashGrid* grid,
+    const float16_t* primal,
+    const QueryBatch& batch,
+    bool train,
+    float16_t* features
+);
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,101 @@
+#include "TinynnGradientReduction.h"
+#include "Core/Error.h"
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+uint32_t getGradientIndex(const WarpGradients& warps, uint32_t element)
+{
+    return (element % warps.width) * warps.width + element / warps.width;
+}
+
+void checkWarpGradients(const WarpGradients& warps)
+{
+    FALCOR_CHECK(warps.width > 0 && warps.warpCount > 0, "Warp gradients are empty.");
+    FALCOR_CHECK(warps.warpStride >= warps.width * warps.width, "Warp gradients of width {} overlap.", warps.width);
+}
+} // namespace
+
+uint32_t accumulateWarpGradients(const WarpGradients& warps, float* gradient, float* gradientCount)
+{
+    checkWarpGradients(warps);
+    const uint32_t elementCount = warps.width * warps.width;
+    for (uint32_t w = 0; w < warps.warpCount; w++)
+    {
+        for (uint32_t e = 0; e < elementCount; e++)
+        {
+            const uint32_t index = getGradientIndex(warps, e);
+            gradient[index] += float(warps.data[w * warps.warpStride + e]);
+            gradientCount[index] += 1.f;
+        }
+    }
+    return 2 * warps.warpCount * elementCount;
+}
+
+uint32_t reduceGroupGradients(const WarpGradients& warps, float* gradient, float* gradientCount)
+{
+    checkWarpGradients(warps);
+    const uint32_t elementCount = warps.width * warps.width;
+    for (uint32_t e = 0; e < elementCount; e++)
+    {
+        float sum = 0.f;
+        for (uint32_t w = 0; w < warps.warpCount; w++)
+            sum += float(warps.data[w * warps.warpStride + e]);
+        const uint32_t index = getGradientIndex(warps, e);
+        gradient[index] += sum;
+        gradientCount[index] += float(warps.warpCount);
+    }
+    return 2 * elementCount;
+}
+
+uint32_t accumulateLaneGradients(const uint32_t* indices, const float* values, uint32_t laneCount, float* gradient, float* gradientCount)
+{
+    for (uint32_t lane = 0; lane < laneCount; lane++)
+    {
+        gradient[indices[lane]] += values[lane];
+        gradientCount[indices[lane]] += 1.f;
+    }
+    return 2 * laneCount;
+}
+
+uint32_t coalesceLaneGradients(
+    const uint32_t* indices,
+    const float* values,
+    uint32_t laneCount,
+    uint32_t active,
+    float* gradient,
+    float* gradientCount
+)
+{
+    FALCOR_CHECK(laneCount <= kLaneCount, "A wave has at most {} lanes.", kLaneCount);
+    uint32_t atomicCount = 0;
+    for (uint32_t lane = 0; lane < laneCount; lane++)
+    {
+        if (!(active & (1u << lane))) continue;
+        // WaveMatch(), WaveMultiPrefixSum() and WaveMultiPrefixCountBits()
+        float prefix = 0.f;
+        uint32_t rank = 0;
+        uint32_t peerCount = 0;
+        for (uint32_t other = 0; other < laneCount; other++)
+        {
+            if (!(active & (1u << other)) || indices[other] != indices[lane]) continue;
+            if (other < lane)
+            {
+                prefix += values[other];
+                rank++;
+            }
+            peerCount++;
+        }
+        // only the last peer adds the sum
+        if (rank + 1 != peerCount) continue;
+        gradient[indices[lane]] += prefix + values[lane];
+        gradientCount[indices[lane]] += float(peerCount);
+        atomicCount += 2;
+    }
+    return atomicCount;
+}
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,51 @@
+#pragma once
+#include "Utils/Math/ScalarTypes.h"
+
+#include <cstdint>
+
+namespace Falcor
+{
+namespace tinynn
+{
+// CPU simulation of how the training pass adds gradients to the GradientBuffer and GradientCountBuffer, with per thread atomics
+// and with the pre-reduction of NN_GRADIENT_PRE_REDUCTION. All functions return the number of atomics they issued.
+
+/// Threads per warp and wave.
+constexpr uint32_t kLaneCount = 32;
+
+/**
+ * Per warp weight gradients of a width x width linear layer as the weight gradient matmul leaves them in shared memory. Warp w
+ * holds width * width halfs at data + w * warpStride, element e is the gradient of weight (e % width) * width + e / width.
+ */
+struct WarpGradients
+{
+    const float16_t* data = nullptr;
+    uint32_t width = 0;
+    uint32_t warpCount = 0;
+    uint32_t warpStride = 0;
+};
+
+/// Every thread adds its elements with one atomic each and a count of one per warp, mirrors the per warp loops of _eval_bwd().
+uint32_t accumulateWarpGradients(const WarpGradients& warps, float* gradient, float* gradientCount);
+
+/// The group sums the elements of all warps and adds them with one atomic per weight, mirrors LinearHalf::reduceWeightGradients().
+uint32_t reduceGroupGradients(const WarpGradients& warps, float* gradient, float* gradientCount);
+
+/// Every lane adds its value to its element with one atomic, mirrors TensorView::interlocked_add_grad().
+uint32_t accumulateLaneGradients(const uint32_t* indices, const float* values, uint32_t laneCount, float* gradient, float* gradientCount);
+
+/**
+ * Lanes of a wave with the same element sum their values with a prefix sum over their peers and the last of them adds the sum,
+ * mirrors TensorView::wave_coalesced_add_grad().
+ * @param[in] active Active lanes, lanes outside the mask do not take part.
+ */
+uint32_t coalesceLaneGradients(
+    const uint32_t* indices,
+    const float* values,
+    uint32_t laneCount,
+    uint32_t active,
+    float* gradient,
+    float* gradientCount
+);
+} // namespace tinynn
+} // namespace Falcor
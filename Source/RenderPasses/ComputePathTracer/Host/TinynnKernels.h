@@ -0,0 +1,380 @@
+#pragma once
+#include "TinynnMLP.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Falcor
+{
+namespace tinynn
+{
+/// Network data the kernels work on.
+struct KernelParams
+{
+    uint32_t width;
+    uint32_t layerCount;
+    Activation activation;
+    const float* weights;
+    const float* weightsT;
+};
+
+/// Independent accumulators the kernels aim for, 8 vector FMAs in flight cover the latency on current CPUs.
+constexpr uint32_t kAccumulatorCount = 8;
+/// Largest number of queries the kernels evaluate together.
+constexpr uint32_t kMaxBlockSize = 8;
+
+// Kernels of one instruction set, each set lives in its own translation unit compiled with the matching target flags.
+// backward() needs scratch space for (2 * layerCount + 1) * width * kMaxBlockSize floats and gets the gradient buffer already
+// offset.
+#define TINYNN_DECLARE_KERNELS(isa)                                                                                                 \
+    void forward##isa(const KernelParams& params, const uint16_t* input, uint16_t* output, uint32_t count);                       \
+    void backward##isa(                                                                                                            \
+        const KernelParams& params,                                                                                                \
+        const uint16_t* input,                                                                                                     \
+        const uint16_t* dOutput,                                                                                                   \
+        uint16_t* dInput,                                                                                                          \
+        float* gradient,                                                                                                           \
+        float* scratch,                                                                                                            \
+        uint32_t count                                                                                                             \
+    );
+
+TINYNN_DECLARE_KERNELS(Scalar)
+TINYNN_DECLARE_KERNELS(AVX2)
+TINYNN_DECLARE_KERNELS(AVX512)
+
+#undef TINYNN_DECLARE_KERNELS
+
+// Everything below is compiled into every kernel translation unit. Internal linkage keeps the linker from picking a copy that was
+// compiled for a wider instruction set than the caller's.
+namespace
+{
+/// Float to half bits with round to nearest even like F16C, math::float32ToFloat16() rounds ties away from zero.
+inline uint16_t floatToHalfBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t absBits = bits & 0x7fffffff;
+    // inf and NaN, NaNs are quieted
+    if (absBits >= 0x7f800000) return uint16_t(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 | ((absBits >> 13) & 0x3ff) : 0));
+    // values from 65520 on round to inf
+    if (absBits >= 0x477ff000) return uint16_t(sign | 0x7c00);
+    // values below 2^-25 round to 0
+    if (absBits < 0x33000000) return uint16_t(sign);
+    uint32_t shift = 13;
+    uint32_t mantissa = absBits - 0x38000000;
+    if (absBits < 0x38800000)
+    {
+        // denormal half, the implicit one becomes explicit
+        shift = 126 - (absBits >> 23);
+        mantissa = (absBits & 0x7fffff) | 0x800000;
+    }
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t tie = 1u << (shift - 1);
+    // a carry into the exponent is the correctly rounded result
+    if (remainder > tie || (remainder == tie && (half & 1))) half++;
+    return uint16_t(sign | half);
+}
+
+inline float evalActivation(Activation activation, float x)
+{
+    switch (activation)
+    {
+    case Activation::ReLU:
+        return x > 0.f ? x : 0.f;
+    case Activation::LeakyReLU:
+        return (x > 0.f ? x : 0.f) + 0.01f * (x < 0.f ? x : 0.f);
+    case Activation::Exponential:
+        return std::exp(x);
+    case Activation::Sigmoid:
+        return 1.f / (1.f + std::exp(-x));
+    case Activation::Sine:
+        return std::sin(x);
+    case Activation::Tanh:
+        return std::tanh(x);
+    default:
+        return x;
+    }
+}
+
+/// Derivative of the activation with respect to the pre-activation x.
+inline float evalActivationDerivative(Activation activation, float x)
+{
+    switch (activation)
+    {
+    case Activation::ReLU:
+        return x > 0.f ? 1.f : 0.f;
+    case Activation::LeakyReLU:
+        return x > 0.f ? 1.f : (x < 0.f ? 0.01f : 0.f);
+    case Activation::Exponential:
+        return std::exp(x);
+    case Activation::Sigmoid:
+    {
+        const float s = 1.f / (1.f + std::exp(-x));
+        return s * (1.f - s);
+    }
+    case Activation::Sine:
+        return std::cos(x);
+    case Activation::Tanh:
+    {
+        const float t = std::tanh(x);
+        return 1.f - t * t;
+    }
+    default:
+        return 1.f;
+    }
+}
+
+/**
+ * Kernels for one layer width, V wraps the vector instructions of one instruction set.
+ * Every instruction set runs the same operations in the same order, products are accumulated with fused multiply-add, so all of
+ * them produce bitwise identical results.
+ */
+template<typename V, uint32_t Width>
+struct Kernels
+{
+    using T = typename V::Type;
+    static constexpr uint32_t kLanes = V::kLanes;
+    static constexpr uint32_t kVecs = Width / kLanes;
+    static_assert(Width % kLanes == 0);
+    /// Queries evaluated together, they share the weight loads and give enough independent accumulators to hide the FMA latency.
+    static constexpr uint32_t kBlockSize = kVecs >= kAccumulatorCount ? 1 : kAccumulatorCount / kVecs;
+    static_assert(kBlockSize <= kMaxBlockSize);
+
+    static T activate(Activation activation, T x)
+    {
+        switch (activation)
+        {
+        case Activation::None:
+            return x;
+        case Activation::ReLU:
+            return V::max(x, V::zero());
+        case Activation::LeakyReLU:
+            return V::fmadd(V::broadcast(0.01f), V::min(x, V::zero()), V::max(x, V::zero()));
+        default:
+            return applyScalar(x, [activation](float v) { return evalActivation(activation, v); });
+        }
+    }
+
+    static T activateDerivative(Activation activation, T x)
+    {
+        switch (activation)
+        {
+        case Activation::None:
+            return V::broadcast(1.f);
+        case Activation::ReLU:
+            return V::stepPositive(x);
+        case Activation::LeakyReLU:
+            return V::fmadd(V::broadcast(0.01f), V::stepNegative(x), V::stepPositive(x));
+        default:
+            return applyScalar(x, [activation](float v) { return evalActivationDerivative(activation, v); });
+        }
+    }
+
+    template<typename Func>
+    static T applyScalar(T x, Func func)
+    {
+        float values[kLanes];
+        V::store(values, x);
+        for (uint32_t i = 0; i < kLanes; i++)
+            values[i] = func(values[i]);
+        return V::load(values);
+    }
+
+    /// results[b][n] = round(sum_k matrix[k][n] * vectors[b][k]) for B vectors, matrix is row-major. results may alias vectors.
+    template<uint32_t B>
+    static void multiply(const float* matrix, const float* vectors, float* results)
+    {
+        T acc[B][kVecs];
+        for (uint32_t b = 0; b < B; b++)
+            for (uint32_t j = 0; j < kVecs; j++)
+                acc[b][j] = V::zero();
+        for (uint32_t k = 0; k < Width; k++)
+        {
+            T x[B];
+            for (uint32_t b = 0; b < B; b++)
+                x[b] = V::broadcast(vectors[b * Width + k]);
+            for (uint32_t j = 0; j < kVecs; j++)
+            {
+                const T w = V::load(matrix + k * Width + j * kLanes);
+                for (uint32_t b = 0; b < B; b++)
+                    acc[b][j] = V::fmadd(x[b], w, acc[b][j]);
+            }
+        }
+        for (uint32_t b = 0; b < B; b++)
+            for (uint32_t j = 0; j < kVecs; j++)
+                V::store(results + b * Width + j * kLanes, V::roundToHalf(acc[b][j]));
+    }
+
+    /// Evaluate a layer for B queries, stores the pre-activations if preActivations is not nullptr. outputs may alias inputs.
+    template<uint32_t B>
+    static void evalLayer(const float* weightsT, Activation activation, const float* inputs, float* preActivations, float* outputs)
+    {
+        alignas(64) float z[B * Width];
+        multiply<B>(weightsT, inputs, z);
+        for (uint32_t i = 0; i < B * Width; i += kLanes)
+        {
+            const T x = V::load(z + i);
+            if (preActivations) V::store(preActivations + i, x);
+            V::store(outputs + i, V::roundToHalf(activate(activation, x)));
+        }
+    }
+
+    static void loadHalf(const uint16_t* src, float* dst, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i += kLanes)
+            V::store(dst + i, V::loadHalf(src + i));
+    }
+
+    static void storeHalf(const float* src, uint16_t* dst, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i += kLanes)
+            V::storeHalf(dst + i, V::load(src + i));
+    }
+
+    template<uint32_t B>
+    static void forwardBlock(const KernelParams& params, const uint16_t* input, uint16_t* output)
+    {
+        alignas(64) float values[B * Width];
+        loadHalf(input, values, B * Width);
+        for (uint32_t l = 0; l < params.layerCount; l++)
+            evalLayer<B>(params.weightsT + l * Width * Width, params.activation, values, nullptr, values);
+        storeHalf(values, output, B * Width);
+    }
+
+    template<uint32_t B>
+    static void backwardBlock(
+        const KernelParams& params,
+        const uint16_t* input,
+        const uint16_t* dOutput,
+        uint16_t* dInput,
+        float* gradient,
+        float* scratch
+    )
+    {
+        const uint32_t layerCount = params.layerCount;
+        const uint32_t blockWidth = B * Width;
+        // inputs of all layers followed by the network output, then the pre-activations of all layers
+        float* activations = scratch;
+        float* preActivations = scratch + (layerCount + 1) * blockWidth;
+        loadHalf(input, activations, blockWidth);
+        for (uint32_t l = 0; l < layerCount; l++)
+        {
+            const float* weightsT = params.weightsT + l * Width * Width;
+            float* layerOutputs = activations + (l + 1) * blockWidth;
+            evalLayer<B>(weightsT, params.activation, activations + l * blockWidth, preActivations + l * blockWidth, layerOutputs);
+        }
+
+        alignas(64) float dValues[B * Width];
+        alignas(64) float dPreActivations[B * Width];
+        loadHalf(dOutput, dValues, blockWidth);
+        for (uint32_t l = layerCount; l-- > 0;)
+        {
+            const float* layerInputs = activations + l * blockWidth;
+            const float* z = preActivations + l * blockWidth;
+            for (uint32_t i = 0; i < blockWidth; i += kLanes)
+            {
+                const T d = V::mul(V::load(dValues + i), activateDerivative(params.activation, V::load(z + i)));
+                V::store(dPreActivations + i, V::roundToHalf(d));
+            }
+
+            // dW[n][k] += dz[n] * in[k], the queries of the block are added in order
+            float* layerGradient = gradient + l * Width * Width;
+            for (uint32_t n = 0; n < Width; n++)
+            {
+                float* row = layerGradient + n * Width;
+                T acc[kVecs];
+                for (uint32_t j = 0; j < kVecs; j++)
+                    acc[j] = V::load(row + j * kLanes);
+                for (uint32_t b = 0; b < B; b++)
+                {
+                    const T d = V::broadcast(dPreActivations[b * Width + n]);
+                    for (uint32_t j = 0; j < kVecs; j++)
+                        acc[j] = V::fmadd(d, V::load(layerInputs + b * Width + j * kLanes), acc[j]);
+                }
+                for (uint32_t j = 0; j < kVecs; j++)
+                    V::store(row + j * kLanes, acc[j]);
+            }
+
+            // din[k] = sum_n W[n][k] * dz[n]
+            multiply<B>(params.weights + l * Width * Width, dPreActivations, dValues);
+        }
+        if (dInput) storeHalf(dValues, dInput, blockWidth);
+    }
+
+    static void forward(const KernelParams& params, const uint16_t* input, uint16_t* output, uint32_t count)
+    {
+        uint32_t q = 0;
+        for (; q + kBlockSize <= count; q += kBlockSize)
+            forwardBlock<kBlockSize>(params, input + size_t(q) * Width, output + size_t(q) * Width);
+        for (; q < count; q++)
+            forwardBlock<1>(params, input + size_t(q) * Width, output + size_t(q) * Width);
+    }
+
+    static void backward(
+        const KernelParams& params,
+        const uint16_t* input,
+        const uint16_t* dOutput,
+        uint16_t* dInput,
+        float* gradient,
+        float* scratch,
+        uint32_t count
+    )
+    {
+        auto offset = [](auto* ptr, uint32_t q) { return ptr ? ptr + size_t(q) * Width : nullptr; };
+        uint32_t q = 0;
+        for (; q + kBlockSize <= count; q += kBlockSize)
+            backwardBlock<kBlockSize>(params, input + size_t(q) * Width, dOutput + size_t(q) * Width, offset(dInput, q), gradient, scratch);
+        for (; q < count; q++)
+            backwardBlock<1>(params, input + size_t(q) * Width, dOutput + size_t(q) * Width, offset(dInput, q), gradient, scratch);
+    }
+};
+
+template<typename V>
+void dispatchForward(const KernelParams& params, const uint16_t* input, uint16_t* output, uint32_t count)
+{
+    if (params.width == 16)
+        Kernels<V, 16>::forward(params, input, output, count);
+    else
+        Kernels<V, 32>::forward(params, input, output, count);
+}
+
+template<typename V>
+void dispatchBackward(
+    const KernelParams& params,
+    const uint16_t* input,
+    const uint16_t* dOutput,
+    uint16_t* dInput,
+    float* gradient,
+    float* scratch,
+    uint32_t count
+)
+{
+    if (params.width == 16)
+        Kernels<V, 16>::backward(params, input, dOutput, dInput, gradient, scratch, count);
+    else
+        Kernels<V, 32>::backward(params, input, dOutput, dInput, gradient, scratch, count);
+}
+} // namespace
+
+#define TINYNN_DEFINE_KERNELS(isa, V)                                                                                               \
+    void forward##isa(const KernelParams& params, const uint16_t* input, uint16_t* output, uint32_t count)                        \
+    {                                                                                                                              \
+        dispatchForward<V>(params, input, output, count);                                                                          \
+    }                                                                                                                              \
+    void backward##isa(                                                                                                            \
+        const KernelParams& params,                                                                                                \
+        const uint16_t* input,                                                                                                     \
+        const uint16_t* dOutput,                                                                                                   \
+        uint16_t* dInput,                                                                                                          \
+        float* gradient,                                                                                                           \
+        float* scratch,                                                                                                            \
+        uint32_t count                                                                                                             \
+    )                                                                                                                              \
+    {                                                                                                                              \
+        dispatchBackward<V>(params, input, dOutput, dInput, gradient, scratch, count);                                             \
+    }
+} // namespace tinynn
+} // namespace Falcor
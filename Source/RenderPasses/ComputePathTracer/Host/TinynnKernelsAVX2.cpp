@@ -0,0 +1,38 @@
+// Compiled with AVX2, FMA and F16C enabled, only called after checking the CPU supports them.
+#include "TinynnKernels.h"
+
+#include <immintrin.h>
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+struct VecAVX2
+{
+    using Type = __m256;
+    static constexpr uint32_t kLanes = 8;
+
+    static Type zero() { return _mm256_setzero_ps(); }
+    static Type broadcast(float value) { return _mm256_set1_ps(value); }
+    static Type load(const float* src) { return _mm256_loadu_ps(src); }
+    static void store(float* dst, Type value) { _mm256_storeu_ps(dst, value); }
+    static Type fmadd(Type a, Type b, Type c) { return _mm256_fmadd_ps(a, b, c); }
+    static Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+    static Type max(Type a, Type b) { return _mm256_max_ps(a, b); }
+    static Type min(Type a, Type b) { return _mm256_min_ps(a, b); }
+    static Type stepPositive(Type x) { return _mm256_and_ps(_mm256_cmp_ps(x, zero(), _CMP_GT_OQ), broadcast(1.f)); }
+    static Type stepNegative(Type x) { return _mm256_and_ps(_mm256_cmp_ps(x, zero(), _CMP_LT_OQ), broadcast(1.f)); }
+    static Type roundToHalf(Type x) { return _mm256_cvtph_ps(_mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+    static Type loadHalf(const uint16_t* src) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))); }
+    static void storeHalf(uint16_t* dst, Type value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+};
+} // namespace
+
+TINYNN_DEFINE_KERNELS(AVX2, VecAVX2)
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,38 @@
+// Compiled with AVX-512F enabled, only called after checking the CPU supports it.
+#include "TinynnKernels.h"
+
+#include <immintrin.h>
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+struct VecAVX512
+{
+    using Type = __m512;
+    static constexpr uint32_t kLanes = 16;
+
+    static Type zero() { return _mm512_setzero_ps(); }
+    static Type broadcast(float value) { return _mm512_set1_ps(value); }
+    static Type load(const float* src) { return _mm512_loadu_ps(src); }
+    static void store(float* dst, Type value) { _mm512_storeu_ps(dst, value); }
+    static Type fmadd(Type a, Type b, Type c) { return _mm512_fmadd_ps(a, b, c); }
+    static Type mul(Type a, Type b) { return _mm512_mul_ps(a, b); }
+    static Type max(Type a, Type b) { return _mm512_max_ps(a, b); }
+    static Type min(Type a, Type b) { return _mm512_min_ps(a, b); }
+    static Type stepPositive(Type x) { return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, zero(), _CMP_GT_OQ), broadcast(1.f)); }
+    static Type stepNegative(Type x) { return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, zero(), _CMP_LT_OQ), broadcast(1.f)); }
+    static Type roundToHalf(Type x) { return _mm512_cvtph_ps(_mm512_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+    static Type loadHalf(const uint16_t* src) { return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src))); }
+    static void storeHalf(uint16_t* dst, Type value)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm512_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+};
+} // namespace
+
+TINYNN_DEFINE_KERNELS(AVX512, VecAVX512)
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,208 @@
+#include "TinynnMLP.h"
+#include "TinynnKernels.h"
+#include "Core/Error.h"
+
+#include <algorithm>
+
+#if FALCOR_MSVC
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+struct VecScalar
+{
+    using Type = float;
+    static constexpr uint32_t kLanes = 1;
+
+    static Type zero() { return 0.f; }
+    static Type broadcast(float value) { return value; }
+    static Type load(const float* src) { return *src; }
+    static void store(float* dst, Type value) { *dst = value; }
+    static Type fmadd(Type a, Type b, Type c) { return std::fma(a, b, c); }
+    static Type mul(Type a, Type b) { return a * b; }
+    // same operand order as maxps/minps, which return the second operand for NaNs
+    static Type max(Type a, Type b) { return a > b ? a : b; }
+    static Type min(Type a, Type b) { return a < b ? a : b; }
+    static Type stepPositive(Type x) { return x > 0.f ? 1.f : 0.f; }
+    static Type stepNegative(Type x) { return x < 0.f ? 1.f : 0.f; }
+    static Type roundToHalf(Type x) { return math::float16ToFloat32(floatToHalfBits(x)); }
+    static Type loadHalf(const uint16_t* src) { return math::float16ToFloat32(*src); }
+    static void storeHalf(uint16_t* dst, Type value) { *dst = floatToHalfBits(value); }
+};
+
+void cpuid(uint32_t leaf, uint32_t regs[4])
+{
+#if FALCOR_MSVC
+    int values[4];
+    __cpuidex(values, int(leaf), 0);
+    std::copy(values, values + 4, regs);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/// Register states the OS saves on context switches (XCR0).
+uint64_t getEnabledXStates()
+{
+#if FALCOR_MSVC
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t(hi) << 32) | lo;
+#endif
+}
+
+struct CpuFeatures
+{
+    bool avx2 = false;
+    bool avx512 = false;
+
+    CpuFeatures()
+    {
+        uint32_t regs[4];
+        cpuid(0, regs);
+        const uint32_t maxLeaf = regs[0];
+        if (maxLeaf < 7) return;
+        cpuid(1, regs);
+        const bool fma = regs[2] & (1u << 12);
+        const bool osxsave = regs[2] & (1u << 27);
+        const bool f16c = regs[2] & (1u << 29);
+        if (!osxsave) return;
+        cpuid(7, regs);
+        const uint64_t xstates = getEnabledXStates();
+        // SSE and AVX state, AVX-512 additionally needs the opmask and upper ZMM states
+        const bool avxState = (xstates & 0x6) == 0x6;
+        const bool avx512State = (xstates & 0xe6) == 0xe6;
+        avx2 = avxState && fma && f16c && (regs[1] & (1u << 5));
+        avx512 = avx512State && (regs[1] & (1u << 16));
+    }
+};
+} // namespace
+
+TINYNN_DEFINE_KERNELS(Scalar, VecScalar)
+
+bool isIsaSupported(Isa isa)
+{
+    static const CpuFeatures features;
+    switch (isa)
+    {
+    case Isa::Scalar:
+        return true;
+    case Isa::AVX2:
+        return features.avx2;
+    case Isa::AVX512:
+        return features.avx512;
+    default:
+        return false;
+    }
+}
+
+Isa getBestIsa()
+{
+    if (isIsaSupported(Isa::AVX512)) return Isa::AVX512;
+    if (isIsaSupported(Isa::AVX2)) return Isa::AVX2;
+    return Isa::Scalar;
+}
+
+HalfMLP::HalfMLP(uint32_t width, uint32_t layerCount, Activation activation, uint32_t& offsetPrim, uint32_t& offsetGrad)
+    : mWidth(width), mLayerCount(layerCount), mActivation(activation), mOffsetPrim(offsetPrim), mOffsetGrad(offsetGrad), mIsa(getBestIsa())
+{
+    FALCOR_CHECK(width == 16 || width == 32, "Unsupported MLP width {}, the shader has 16 and 32 wide layers.", width);
+    FALCOR_CHECK(layerCount > 0, "MLP needs at least one layer.");
+    offsetPrim += getParamCount();
+    offsetGrad += getParamCount();
+}
+
+void HalfMLP::setIsa(Isa isa)
+{
+    FALCOR_CHECK(isIsaSupported(isa), "Instruction set {} is not supported by this CPU.", uint32_t(isa));
+    mIsa = isa;
+}
+
+void HalfMLP::loadWeights(const float16_t* primal)
+{
+    const uint32_t matrixSize = mWidth * mWidth;
+    mWeights.resize(getParamCount());
+    mWeightsT.resize(getParamCount());
+    for (uint32_t l = 0; l < mLayerCount; l++)
+    {
+        const float16_t* src = primal + mOffsetPrim + l * matrixSize;
+        float* weights = mWeights.data() + l * matrixSize;
+        float* weightsT = mWeightsT.data() + l * matrixSize;
+        for (uint32_t n = 0; n < mWidth; n++)
+        {
+            for (uint32_t k = 0; k < mWidth; k++)
+            {
+                const float w = float(src[n * mWidth + k]);
+                weights[n * mWidth + k] = w;
+                weightsT[k * mWidth + n] = w;
+            }
+        }
+    }
+}
+
+void HalfMLP::forward(const float16_t* input, float16_t* output, uint32_t count) const
+{
+    FALCOR_CHECK(!mWeights.empty(), "MLP weights were not loaded.");
+    const KernelParams params{mWidth, mLayerCount, mActivation, mWeights.data(), mWeightsT.data()};
+    const uint16_t* src = reinterpret_cast<const uint16_t*>(input);
+    uint16_t* dst = reinterpret_cast<uint16_t*>(output);
+    switch (mIsa)
+    {
+    case Isa::AVX512:
+        forwardAVX512(params, src, dst, count);
+        break;
+    case Isa::AVX2:
+        forwardAVX2(params, src, dst, count);
+        break;
+    default:
+        forwardScalar(params, src, dst, count);
+        break;
+    }
+}
+
+void HalfMLP::backward(
+    const float16_t* input,
+    const float16_t* dOutput,
+    float16_t* dInput,
+    float* gradient,
+    float* gradientCount,
+    uint32_t count
+) const
+{
+    FALCOR_CHECK(!mWeights.empty(), "MLP weights were not loaded.");
+    const KernelParams params{mWidth, mLayerCount, mActivation, mWeights.data(), mWeightsT.data()};
+    std::vector<float> scratch((2 * mLayerCount + 1) * mWidth * kMaxBlockSize);
+    const uint16_t* src = reinterpret_cast<const uint16_t*>(input);
+    const uint16_t* dSrc = reinterpret_cast<const uint16_t*>(dOutput);
+    uint16_t* dDst = reinterpret_cast<uint16_t*>(dInput);
+    float* layerGradient = gradient + mOffsetGrad;
+    switch (mIsa)
+    {
+    case Isa::AVX512:
+        backwardAVX512(params, src, dSrc, dDst, layerGradient, scratch.data(), count);
+        break;
+    case Isa::AVX2:
+        backwardAVX2(params, src, dSrc, dDst, layerGradient, scratch.data(), count);
+        break;
+    default:
+        backwardScalar(params, src, dSrc, dDst, layerGradient, scratch.data(), count);
+        break;
+    }
+
+    if (gradientCount)
+    {
+        const float warpCount = float((count + kWarpSize - 1) / kWarpSize);
+        std::for_each(gradientCount + mOffsetGrad, gradientCount + mOffsetGrad + getParamCount(), [&](float& c) { c += warpCount; });
+    }
+}
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,111 @@
+#pragma once
+#include "Utils/Math/ScalarTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * CPU reference of the tinynn half precision MLPs (tinynn/TinynnHalfMLP.slang), used to test and benchmark the network outside of
+ * the GPU passes.
+ */
+namespace tinynn
+{
+/// Activation functions of tinynn/TinynnActivations.slang.
+enum class Activation : uint32_t
+{
+    None,
+    ReLU,
+    LeakyReLU,
+    Exponential,
+    Sigmoid,
+    Sine,
+    Tanh,
+};
+
+/// Instruction sets of the kernels, all of them produce bitwise identical results.
+enum class Isa : uint32_t
+{
+    Scalar,
+    AVX2,   ///< AVX2, FMA and F16C.
+    AVX512, ///< AVX-512F.
+};
+
+bool isIsaSupported(Isa isa);
+/// Fastest instruction set supported by the CPU.
+Isa getBestIsa();
+
+/**
+ * CPU version of MLPHalf16X16 and MLPHalf32X32. The layers read their weights from the same PrimalBuffer layout as the shader,
+ * layer i uses the width x width row-major matrix at offsetPrim + i * width * width and computes out[n] = sum_k W[n][k] * in[k]
+ * followed by the activation, there are no biases.
+ *
+ * Like the HalfFeature passed between the shader layers every layer output is rounded to half. The products are accumulated in
+ * float, the tensor cores accumulate in half, so GPU results only match up to rounding.
+ */
+class HalfMLP
+{
+public:
+    /// Queries that share one gradient count, the shader adds one count per warp.
+    static constexpr uint32_t kWarpSize = 32;
+
+    /**
+     * Same as the shader constructor, the layers start at offsetPrim and offsetGrad which are advanced past them.
+     * @param[in] width Width of the layers, either 16 or 32.
+     */
+    HalfMLP(uint32_t width, uint32_t layerCount, Activation activation, uint32_t& offsetPrim, uint32_t& offsetGrad);
+
+    uint32_t getWidth() const { return mWidth; }
+    uint32_t getLayerCount() const { return mLayerCount; }
+    Activation getActivation() const { return mActivation; }
+    uint32_t getParamCount() const { return mLayerCount * mWidth * mWidth; }
+    uint32_t getOffsetPrim() const { return mOffsetPrim; }
+    uint32_t getOffsetGrad() const { return mOffsetGrad; }
+
+    /// Select the kernels, throws if the CPU does not support the instruction set. Defaults to getBestIsa().
+    void setIsa(Isa isa);
+    Isa getIsa() const { return mIsa; }
+
+    /// Convert the weights of the network from the whole primal buffer, has to be called again whenever the buffer changed.
+    void loadWeights(const float16_t* primal);
+
+    /**
+     * Evaluate the network.
+     * @param[in] input Width values per query.
+     * @param[out] output Width values per query, may alias input.
+     * @param[in] count Number of queries.
+     */
+    void forward(const float16_t* input, float16_t* output, uint32_t count) const;
+
+    /**
+     * Backpropagate the loss gradient of the outputs like the backward derivative of forward() in the training pass.
+     * @param[in] input Width values per query, the inputs forward() was evaluated with.
+     * @param[in] dOutput Width loss gradients per query.
+     * @param[out] dInput Width loss gradients per query or nullptr, may alias dOutput.
+     * @param[in,out] gradient Whole gradient buffer, the weight gradients are added at offsetGrad.
+     * @param[in,out] gradientCount Whole gradient count buffer or nullptr, one count per started group of kWarpSize queries is added.
+     * @param[in] count Number of queries.
+     */
+    void backward(
+        const float16_t* input,
+        const float16_t* dOutput,
+        float16_t* dInput,
+        float* gradient,
+        float* gradientCount,
+        uint32_t count
+    ) const;
+
+private:
+    uint32_t mWidth;
+    uint32_t mLayerCount;
+    Activation mActivation;
+    uint32_t mOffsetPrim;
+    uint32_t mOffsetGrad;
+    Isa mIsa;
+    // row-major weights of all layers and their transposes, converted to float
+    std::vector<float> mWeights;
+    std::vector<float> mWeightsT;
+};
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,157 @@
+#include "TinynnOptimizer.h"
+#include "TinynnKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+namespace tinynn
+{
+namespace
+{
+const float kThetaBound = 65000.f;
+
+float sgdOptimizer(float theta, float dfDTheta, float& b, int step, float lr, float momentum, float dampening)
+{
+    float g = dfDTheta;
+    b = (momentum != 0.f && step > 1) ? momentum * b + (1.f - dampening) * g : g;
+    g = b;
+    if (std::isnan(g) || std::isinf(g))
+    {
+        g = 0.f;
+        b = 0.f;
+    }
+    return theta - lr * g;
+}
+
+float adamOptimizer(float theta, float dfDTheta, float& m, float& v, int step, float lr, float beta1, float beta2)
+{
+    const int t = step + 1;
+    const float epsilon = 1e-15f;
+
+    // lerp(m, g, 1 - beta_1)
+    m = m + (1.f - beta1) * (dfDTheta - m);
+    v *= beta2;
+    v += (1.f - beta2) * dfDTheta * dfDTheta;
+
+    const float biasCorrection1 = 1.f - std::pow(beta1, float(t));
+    const float biasCorrection2 = 1.f - std::pow(beta2, float(t));
+
+    const float stepSize = (lr / biasCorrection1) * -1.f;
+    float denom = std::sqrt(v) / std::sqrt(biasCorrection2);
+    denom = denom + epsilon;
+    return theta + (m / denom) * stepSize;
+}
+
+float16_t toHalf(float value)
+{
+    return float16_t::fromBits(floatToHalfBits(value));
+}
+
+/// One thread of the descent pass, lazy updates of a feature grid parameter catch up on the steps since its last update.
+void updateParam(const OptimizerDesc& desc, int step, const OptimizerBuffers& buffers, uint32_t i, const SparseUpdate* lazy = nullptr)
+{
+    float theta = float(buffers.primal[i]);
+    float filtered = float(buffers.filteredPrimal[i]);
+    const float count = buffers.gradientCount[i];
+    float dfDTheta = count > 0.01f ? buffers.gradient[i] / count : 0.f;
+    if (std::isnan(dfDTheta) || std::isinf(dfDTheta)) dfDTheta = 0.f;
+    float thetaNew = theta;
+
+    if (desc.type == OptimizerType::SGD)
+    {
+        float b = step == 0 ? 0.f : buffers.aux[i];
+        thetaNew = sgdOptimizer(theta, dfDTheta, b, step, desc.learningRate, desc.param0, desc.param1);
+        buffers.aux[i] = b;
+    }
+    else if (desc.type == OptimizerType::Adam)
+    {
+        float m = step == 0 ? 0.f : buffers.aux[2 * i + 0];
+        float v = step == 0 ? 0.f : buffers.aux[2 * i + 1];
+        if (lazy)
+        {
+            float& lastIterationBits = buffers.aux[2 * buffers.paramCount + i];
+            uint32_t lastIteration;
+            std::memcpy(&lastIteration, &lastIterationBits, sizeof(lastIteration));
+            const uint32_t skippedSteps = lazy->iteration > lastIteration ? lazy->iteration - lastIteration - 1 : 0;
+            theta =
+                adamLazyCatchUp(theta, filtered, m, v, skippedSteps, step, desc.learningRate, desc.param0, desc.param1, desc.filterAlpha);
+            std::memcpy(&lastIterationBits, &lazy->iteration, sizeof(lastIterationBits));
+        }
+        thetaNew = adamOptimizer(theta, dfDTheta, m, v, step, desc.learningRate, desc.param0, desc.param1);
+        buffers.aux[2 * i + 0] = m;
+        buffers.aux[2 * i + 1] = v;
+    }
+    thetaNew = std::clamp(thetaNew, -kThetaBound, kThetaBound);
+    buffers.primal[i] = toHalf(thetaNew);
+    buffers.filteredPrimal[i] = toHalf((1.f - desc.filterAlpha) * thetaNew + desc.filterAlpha * filtered);
+}
+} // namespace
+
+float adamLazyCatchUp(
+    float theta,
+    float& filtered,
+    float& m,
+    float& v,
+    uint32_t skippedSteps,
+    int step,
+    float lr,
+    float beta1,
+    float beta2,
+    float filterAlpha
+)
+{
+    if (skippedSteps == 0) return theta;
+    const int t = step + 1;
+    const float k = float(skippedSteps);
+
+    const float biasCorrection1 = 1.f - std::pow(beta1, float(t));
+    const float biasCorrection2 = 1.f - std::pow(beta2, float(t));
+    const float ratio = beta1 / std::sqrt(beta2);
+    const float ratioK = std::pow(ratio, k);
+    const float alphaK = std::pow(filterAlpha, k);
+
+    // movement of the first skipped step, step j moves by drift * ratio^(j - 1)
+    const float stepSize = (lr / biasCorrection1) * -1.f;
+    const bool decaying = v > 0.f && ratio < 1.f && std::abs(filterAlpha - ratio) > 1e-6f;
+    const float drift = decaying ? (m / std::sqrt(v)) * std::sqrt(biasCorrection2) * stepSize * ratio : 0.f;
+    // sum of ratio^(j - 1) for j = 1..k
+    const float series = decaying ? (1.f - ratioK) / (1.f - ratio) : 0.f;
+    // sum of (1 - filterAlpha) * filterAlpha^(k - j) * (1 - ratio^j) / (1 - ratio) for j = 1..k
+    const float filterSeries =
+        decaying ? ((1.f - alphaK) - (1.f - filterAlpha) * ratio * (alphaK - ratioK) / (filterAlpha - ratio)) / (1.f - ratio) : 0.f;
+
+    filtered = alphaK * filtered + (1.f - alphaK) * theta + drift * filterSeries;
+    m *= std::pow(beta1, k);
+    v *= std::pow(beta2, k);
+    return theta + drift * series;
+}
+
+void clearGradients(const OptimizerBuffers& buffers)
+{
+    std::fill(buffers.gradient, buffers.gradient + buffers.paramCount, 0.f);
+    std::fill(buffers.gradientCount, buffers.gradientCount + buffers.paramCount, 0.f);
+}
+
+void gradientDescent(const OptimizerDesc& desc, int step, const OptimizerBuffers& buffers)
+{
+    for (uint32_t i = 0; i < buffers.paramCount; i++) updateParam(desc, step, buffers, i);
+}
+
+void fusedOptimizerStep(const OptimizerDesc& desc, int step, const OptimizerBuffers& buffers, const SparseUpdate& sparse)
+{
+    const bool lazyAdam = sparse.lazyAdam && desc.type == OptimizerType::Adam;
+    for (uint32_t i = 0; i < buffers.paramCount; i++)
+    {
+        const bool featureGridParam = i >= sparse.begin && i < sparse.end;
+        // the count and gradient are accumulated together, so the gradient of a skipped parameter is already zero
+        if (buffers.gradientCount[i] == 0.f && featureGridParam) continue;
+        updateParam(desc, step, buffers, i, lazyAdam && featureGridParam ? &sparse : nullptr);
+        buffers.gradient[i] = 0.f;
+        buffers.gradientCount[i] = 0.f;
+    }
+}
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,101 @@
+#pragma once
+#include "Utils/Math/ScalarTypes.h"
+
+#include <cstdint>
+
+namespace Falcor
+{
+namespace tinynn
+{
+/// Optimizers of tinynn/Optimizer.slang, matches NNParams::OptimizerType.
+enum class OptimizerType : uint32_t
+{
+    SGD = 0,
+    Adam = 1,
+};
+
+/// Settings of the descent passes, corresponds to the NN_OPTIMIZER_TYPE and NN_PARAM_* defines and the constant buffer.
+struct OptimizerDesc
+{
+    OptimizerType type = OptimizerType::Adam;
+    float learningRate = 0.01f;
+    /// Momentum for SGD, beta_1 for Adam.
+    float param0 = 0.9f;
+    /// Dampening for SGD, beta_2 for Adam.
+    float param1 = 0.99f;
+    /// Weight of the previous filtered primal in the exponential moving average.
+    float filterAlpha = 0.99f;
+};
+
+/**
+ * The buffers the optimizer passes work on. All of them hold paramCount values except the aux buffer which holds one value per
+ * parameter for SGD, two for Adam and three for lazy Adam.
+ */
+struct OptimizerBuffers
+{
+    uint32_t paramCount = 0;
+    float16_t* primal = nullptr;
+    float16_t* filteredPrimal = nullptr;
+    float* gradient = nullptr;
+    float* gradientCount = nullptr;
+    float* aux = nullptr;
+};
+
+/// Clear the gradients and counts, mirrors tinynn/GradientClear.slang.
+void clearGradients(const OptimizerBuffers& buffers);
+
+/**
+ * Update every parameter from its averaged gradient and filter the primal, mirrors tinynn/GradientDescentPrimal.slang.
+ * @param[in] step Optimizer step of the frame, the moments are reset at step 0.
+ */
+void gradientDescent(const OptimizerDesc& desc, int step, const OptimizerBuffers& buffers);
+
+/// Sparse update of the feature hash grid parameters in fusedOptimizerStep(), covers the grid of a single expert.
+struct SparseUpdate
+{
+    /// First parameter of the feature hash grid, an entry of NN_FEATURE_GRID_BEGINS.
+    uint32_t begin = 0;
+    /**
+     * End of the feature hash grid, begin + FEATURE_HASH_GRID_SIZE. Parameters in [begin, end) with a zero gradient count are skipped and keep
+     * their optimizer state like with NN_SPARSE_FEATURE_GRID_UPDATE.
+     */
+    uint32_t end = 0;
+    /**
+     * NN_LAZY_FEATURE_GRID_ADAM, Adam only. The grid parameters remember the iteration of their last update at aux[2 * paramCount + i]
+     * and catch up on the skipped steps with their next gradient. The moments decay exactly, the parameter and its filter follow
+     * the geometric series of the skipped steps using the bias corrections of the current step, so the catch up matches dense Adam
+     * once the bias corrections converged.
+     */
+    bool lazyAdam = false;
+    /// Training iteration, counts every descent. Only used by lazy Adam.
+    uint32_t iteration = 0;
+};
+
+/**
+ * gradientDescent() followed by clearGradients() in a single pass over the buffers, mirrors tinynn/FusedOptimizer.slang. Without
+ * a sparse range the results are bitwise identical to the unfused passes.
+ */
+void fusedOptimizerStep(const OptimizerDesc& desc, int step, const OptimizerBuffers& buffers, const SparseUpdate& sparse = {});
+
+/**
+ * Applies skippedSteps Adam steps with a zero gradient, each followed by the filter of the primal, at once. Mirrors
+ * adam_lazy_catch_up() of tinynn/Optimizer.slang.
+ * @param[in,out] filtered Filtered primal.
+ * @param[in,out] m First moment.
+ * @param[in,out] v Second moment.
+ * @return The parameter after the skipped steps.
+ */
+float adamLazyCatchUp(
+    float theta,
+    float& filtered,
+    float& m,
+    float& v,
+    uint32_t skippedSteps,
+    int step,
+    float lr,
+    float beta1,
+    float beta2,
+    float filterAlpha
+);
+} // namespace tinynn
+} // namespace Falcor
@@ -0,0 +1,65 @@
+#include "TrainingBudget.h"
+#include "Core/Error.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Falcor
+{
+TrainingBudget::TrainingBudget(const Desc& desc) : mDesc(desc)
+{
+    FALCOR_CHECK(mDesc.maxIterations > 0, "The full budget needs at least one training iteration.");
+    FALCOR_CHECK(mDesc.smoothing > 0.f && mDesc.smoothing <= 1.f, "Loss smoothing {} has to be in (0, 1].", mDesc.smoothing);
+    FALCOR_CHECK(mDesc.window > 0, "The plateau window needs at least one sample.");
+}
+
+void TrainingBudget::addLoss(float loss)
+{
+    if (!std::isfinite(loss) || loss < 0.f) return;
+    mSmoothedLoss = mSampleCount == 0 ? loss : mSmoothedLoss + mDesc.smoothing * (loss - mSmoothedLoss);
+    mSampleCount++;
+    if (mWindowSamples == 0)
+    {
+        mWindowLoss = mSmoothedLoss;
+        if (mMinLoss == 0.f) mMinLoss = mSmoothedLoss;
+    }
+    mMinLoss = std::min(mMinLoss, mSmoothedLoss);
+    if (mLevel > 0 && mSmoothedLoss > mMinLoss * (1.f + mDesc.riseThreshold))
+    {
+        // the reduced budget cannot keep up anymore
+        setLevel(0);
+        return;
+    }
+    if (++mWindowSamples < mDesc.window) return;
+    const bool plateau = mSmoothedLoss > mWindowLoss * (1.f - mDesc.plateauThreshold);
+    if (plateau && mLevel < mDesc.maxLevel) setLevel(mLevel + 1);
+    mWindowSamples = 0;
+}
+
+void TrainingBudget::reset()
+{
+    setLevel(0);
+    mSampleCount = 0;
+    mSmoothedLoss = 0.f;
+    mMinLoss = 0.f;
+}
+
+TrainingBudget::Budget TrainingBudget::getBudget() const
+{
+    Budget budget{mDesc.maxIterations, 1};
+    for (uint32_t level = 0; level < mLevel; level++)
+    {
+        if (budget.iterations > 1) budget.iterations /= 2;
+        else budget.pathTileScale *= 2;
+    }
+    return budget;
+}
+
+void TrainingBudget::setLevel(uint32_t level)
+{
+    mLevel = level;
+    // the loss of the new level is measured from scratch
+    mWindowSamples = 0;
+    mMinLoss = mSmoothedLoss;
+}
+} // namespace Falcor
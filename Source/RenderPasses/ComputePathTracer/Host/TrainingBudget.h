@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+namespace Falcor
+{
+/**
+ * Controller of the nn training work per frame. It is fed the mean training loss of the frames and steps the budget down one
+ * level whenever the smoothed loss stopped improving for a while. A change of the camera or the scene, or a loss that rises well
+ * above the plateau, restores the full budget.
+ *
+ * The first levels halve the training iterations down to one, every further level doubles the side of the tiles the training
+ * paths are spread over, so a quarter of the paths is traced.
+ */
+class TrainingBudget
+{
+public:
+    struct Desc
+    {
+        /// Training iterations of the full budget.
+        uint32_t maxIterations = 4;
+        /// Lowest level of the budget.
+        uint32_t maxLevel = 4;
+        /// Weight of a new loss in the exponential moving average.
+        float smoothing = 0.1f;
+        /// Loss samples per plateau test.
+        uint32_t window = 30;
+        /// The loss plateaus if the smoothed loss improved by less than this fraction over a window.
+        float plateauThreshold = 0.02f;
+        /// The full budget is restored if the smoothed loss rises by more than this fraction above its minimum at the level.
+        float riseThreshold = 0.25f;
+    };
+
+    struct Budget
+    {
+        uint32_t iterations;
+        /// Factor of the side of the tiles with a training path.
+        uint32_t pathTileScale;
+    };
+
+    explicit TrainingBudget(const Desc& desc);
+
+    const Desc& getDesc() const { return mDesc; }
+
+    /// Add the mean loss of a frame. Non-finite and negative samples are ignored.
+    void addLoss(float loss);
+    /// Restore the full budget and forget the loss, e.g. after the camera moved or the nn was reset.
+    void reset();
+
+    uint32_t getLevel() const { return mLevel; }
+    Budget getBudget() const;
+    /// Smoothed loss, 0 before the first sample.
+    float getSmoothedLoss() const { return mSmoothedLoss; }
+
+private:
+    void setLevel(uint32_t level);
+
+    Desc mDesc;
+    uint32_t mLevel = 0;
+    uint32_t mSampleCount = 0;
+    float mSmoothedLoss = 0.f;
+    // smoothed loss at the start of the current window and lowest smoothed loss at the current level
+    float mWindowLoss = 0.f;
+    float mMinLoss = 0.f;
+    uint32_t mWindowSamples = 0;
+};
+} // namespace Falcor
@@ -0,0 +1,112 @@
+#include "VoxelPacking.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Falcor
+{
+namespace hc
+{
+namespace
+{
+constexpr int kRGB9E5MantissaBits = 9;
+constexpr int kRGB9E5ExponentBias = 15;
+constexpr uint64_t kAccumulatorMantissaMask = (1ull << kAccumulatorMantissaBits) - 1;
+constexpr int kAccumulatorMaxExponent = 127;
+
+float sanitize(float value, float maxValue)
+{
+    // fmax/fmin drop NaN like the shader max/min
+    return std::fmin(std::fmax(value, 0.f), maxValue);
+}
+
+uint64_t roundShift(uint64_t mantissa, int shift)
+{
+    if (shift == 0) return mantissa;
+    if (shift > int(kAccumulatorMantissaBits)) return 0;
+    return (mantissa + (1ull << (shift - 1))) >> shift;
+}
+
+uint64_t quantize(float value, int exponent)
+{
+    return uint64_t(std::floor(value * exp2i(kAccumulatorExponentBias - exponent) + 0.5f));
+}
+
+// smallest exponent that keeps the value below 2^19 after quantization
+int getAccumulatorExponent(float value)
+{
+    return std::clamp(floorLog2(value) + kAccumulatorExponentBias - int(kAccumulatorMantissaBits) + 1, 0, kAccumulatorMaxExponent);
+}
+} // namespace
+
+float exp2i(int exponent)
+{
+    return math::asfloat(uint32_t(exponent + 127) << 23);
+}
+
+int floorLog2(float value)
+{
+    return int((math::asuint(value) >> 23) & 0xff) - 127;
+}
+
+uint32_t encodeRGB9E5(float3 value)
+{
+    const float3 c(sanitize(value.x, kRGB9E5Max), sanitize(value.y, kRGB9E5Max), sanitize(value.z, kRGB9E5Max));
+    const float maxC = std::max(c.x, std::max(c.y, c.z));
+    int exponent = std::max(-kRGB9E5ExponentBias - 1, floorLog2(maxC)) + 1 + kRGB9E5ExponentBias;
+    float scale = exp2i(kRGB9E5MantissaBits + kRGB9E5ExponentBias - exponent);
+    // rounding can carry into the next exponent
+    if (uint32_t(std::floor(maxC * scale + 0.5f)) == (1u << kRGB9E5MantissaBits))
+    {
+        exponent++;
+        scale *= 0.5f;
+    }
+    const uint32_t r = uint32_t(std::floor(c.x * scale + 0.5f));
+    const uint32_t g = uint32_t(std::floor(c.y * scale + 0.5f));
+    const uint32_t b = uint32_t(std::floor(c.z * scale + 0.5f));
+    return (uint32_t(exponent) << 27) | (b << 18) | (g << 9) | r;
+}
+
+float3 decodeRGB9E5(uint32_t packed)
+{
+    const float scale = exp2i(int(packed >> 27) - kRGB9E5ExponentBias - kRGB9E5MantissaBits);
+    return float3(float(packed & 0x1ff), float((packed >> 9) & 0x1ff), float((packed >> 18) & 0x1ff)) * scale;
+}
+
+uint64_t accumulate(uint64_t accumulator, float3 value)
+{
+    const float3 v(sanitize(value.x, kAccumulatorMaxValue), sanitize(value.y, kAccumulatorMaxValue), sanitize(value.z, kAccumulatorMaxValue));
+    const int exponent = int(accumulator >> kAccumulatorExponentShift);
+    const uint64_t m[3] = {
+        accumulator & kAccumulatorMantissaMask,
+        (accumulator >> kAccumulatorMantissaBits) & kAccumulatorMantissaMask,
+        (accumulator >> (2 * kAccumulatorMantissaBits)) & kAccumulatorMantissaMask,
+    };
+    const float3 sum = decodeAccumulator(accumulator) + v;
+    int newExponent = std::max(exponent, getAccumulatorExponent(std::max(sum.x, std::max(sum.y, sum.z))));
+    while (true)
+    {
+        const uint64_t r = roundShift(m[0], newExponent - exponent) + quantize(v.x, newExponent);
+        const uint64_t g = roundShift(m[1], newExponent - exponent) + quantize(v.y, newExponent);
+        const uint64_t b = roundShift(m[2], newExponent - exponent) + quantize(v.z, newExponent);
+        if (std::max(r, std::max(g, b)) <= kAccumulatorMantissaMask || newExponent == kAccumulatorMaxExponent)
+        {
+            return (uint64_t(newExponent) << kAccumulatorExponentShift) | (std::min(b, kAccumulatorMantissaMask) << (2 * kAccumulatorMantissaBits)) |
+                   (std::min(g, kAccumulatorMantissaMask) << kAccumulatorMantissaBits) | std::min(r, kAccumulatorMantissaMask);
+        }
+        newExponent++;
+    }
+}
+
+float3 decodeAccumulator(uint64_t accumulator)
+{
+    const float scale = exp2i(int(accumulator >> kAccumulatorExponentShift) - kAccumulatorExponentBias);
+    return float3(
+               float(accumulator & kAccumulatorMantissaMask),
+               float((accumulator >> kAccumulatorMantissaBits) & kAccumulatorMantissaMask),
+               float((accumulator >> (2 * kAccumulatorMantissaBits)) & kAccumulatorMantissaMask)
+           ) *
+           scale;
+}
+} // namespace hc
+} // namespace Falcor
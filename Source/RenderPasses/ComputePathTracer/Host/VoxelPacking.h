@@ -0,0 +1,43 @@
+#pragma once
+#include "Utils/Math/Vector.h"
+
+#include <cstdint>
+
+namespace Falcor
+{
+/**
+ * Encodings of the packed hash cache voxel layout (HC_PACKED_VOXELS), mirroring the functions in RadianceHashCacheCommon.slang.
+ * A packed voxel holds the resolved estimate as RGB9E5, a 16-bit saturating sample count, a 16-bit count of the samples of the
+ * current frame and a 64-bit accumulator for the radiance of the current frame.
+ */
+namespace hc
+{
+// largest value representable in RGB9E5, (2^9 - 1) / 2^9 * 2^16
+constexpr float kRGB9E5Max = 65408.f;
+// 19 bit mantissa per channel and a 7 bit exponent shared by all three channels
+constexpr uint32_t kAccumulatorMantissaBits = 19;
+constexpr uint32_t kAccumulatorExponentShift = 3 * kAccumulatorMantissaBits;
+constexpr int kAccumulatorExponentBias = 83;
+// largest sample value the accumulator takes, larger values are clamped
+constexpr float kAccumulatorMaxValue = 1.8446744e19f;
+
+/// 2^exponent for exponent in [-126, 127], built from the float bits to be exact on all platforms.
+float exp2i(int exponent);
+/// floor(log2(value)) for normal positive floats, -127 for 0 and denormals.
+int floorLog2(float value);
+
+/// Encode non-negative radiance, negative and NaN components become 0 and large values are clamped to kRGB9E5Max.
+uint32_t encodeRGB9E5(float3 value);
+float3 decodeRGB9E5(uint32_t packed);
+
+/**
+ * Add a sample to a shared exponent fixed-point accumulator. The exponent only grows, when a sum does not fit anymore all
+ * mantissas are shifted down, so the accumulator never overflows and keeps 18 to 19 significant bits of the largest channel.
+ * @param[in] accumulator Current value, 0 is an empty accumulator.
+ * @param[in] value Sample to add, negative and NaN components are ignored like with hashCacheAddVoxelData().
+ * @return Accumulator holding the sum.
+ */
+uint64_t accumulate(uint64_t accumulator, float3 value);
+float3 decodeAccumulator(uint64_t accumulator);
+} // namespace hc
+} // namespace Falcor
@@ -0,0 +1,294 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "Core/Error.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <regex>
+
+namespace Falcor
+{
+namespace bench
+{
+namespace
+{
+std::vector<std::unique_ptr<Benchmark>>& getRegistry()
+{
+    static std::vector<std::unique_ptr<Benchmark>> sBenchmarks;
+    return sBenchmarks;
+}
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations = 0;
+    double seconds = 0.0;
+    uint64_t itemsProcessed = 0;
+    std::map<std::string, double> counters;
+    std::map<std::string, std::vector<uint64_t>> histograms;
+    std::string label;
+};
+
+std::string formatRate(double rate)
+{
+    const char* kUnits[] = {"", "k", "M", "G", "T"};
+    size_t unit = 0;
+    while (rate >= 1000.0 && unit + 1 < std::size(kUnits))
+    {
+        rate /= 1000.0;
+        unit++;
+    }
+    return fmt::format("{:.3g}{}", rate, kUnits[unit]);
+}
+
+std::string formatHistogram(const std::vector<uint64_t>& histogram)
+{
+    const uint64_t total = std::accumulate(histogram.begin(), histogram.end(), uint64_t(0));
+    if (total == 0) return "empty";
+    double mean = 0.0;
+    size_t p50 = 0, p99 = 0, max = 0;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        if (histogram[i] == 0) continue;
+        mean += double(i) * double(histogram[i]);
+        if (sum < (total + 1) / 2 && sum + histogram[i] >= (total + 1) / 2) p50 = i;
+        if (sum < total - total / 100 && sum + histogram[i] >= total - total / 100) p99 = i;
+        sum += histogram[i];
+        max = i;
+    }
+    std::string str = fmt::format("n={} mean={:.3f} p50={} p99={} max={} |", total, mean / double(total), p50, p99, max);
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        if (histogram[i] > 0) str += fmt::format(" {}:{}", i, histogram[i]);
+    }
+    return str;
+}
+
+Result runInstance(const Benchmark& benchmark, const std::vector<int64_t>& args, double minTime)
+{
+    Result result;
+    result.name = benchmark.getInstanceName(args);
+
+    // grow the iteration count until the measured time is long enough, like google benchmark does
+    uint64_t iterations = benchmark.getFixedIterations() > 0 ? benchmark.getFixedIterations() : 1;
+    const double targetTime = benchmark.getMinTime() > 0.0 ? benchmark.getMinTime() : minTime;
+    while (true)
+    {
+        State state(args, iterations);
+        benchmark.getFunction()(state);
+        const double seconds = state.getElapsedSeconds();
+        const bool done = benchmark.getFixedIterations() > 0 || seconds >= targetTime || iterations >= (uint64_t(1) << 30);
+        if (done)
+        {
+            result.iterations = state.getIterations();
+            result.seconds = seconds;
+            result.itemsProcessed = state.getItemsProcessed();
+            result.counters = state.getCounters();
+            result.histograms = state.getHistograms();
+            result.label = state.getLabel();
+            return result;
+        }
+        const double scale = seconds > 0.0 ? std::min(10.0, 1.4 * targetTime / seconds) : 10.0;
+        iterations = std::max(iterations + 1, uint64_t(double(iterations) * scale));
+    }
+}
+
+void printResult(const Result& result)
+{
+    const double timePerIteration = result.iterations > 0 ? result.seconds / double(result.iterations) : 0.0;
+    std::string line = fmt::format("{:<64} {:>14.3f} ms {:>10}", result.name, timePerIteration * 1e3, result.iterations);
+    if (result.itemsProcessed > 0 && result.seconds > 0.0)
+        line += fmt::format(" {:>10} items/s", formatRate(double(result.itemsProcessed) / result.seconds));
+    for (const auto& [name, value] : result.counters)
+        line += fmt::format(" {}={:.4g}", name, value);
+    if (!result.label.empty()) line += " " + result.label;
+    fmt::print("{}\n", line);
+    for (const auto& [name, histogram] : result.histograms)
+        fmt::print("    {}: {}\n", name, formatHistogram(histogram));
+}
+
+void writeCsv(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream stream(path);
+    FALCOR_CHECK(stream.good(), "Failed to open '{}' for writing.", path);
+    stream << "name,iterations,seconds,items_per_second,counters\n";
+    for (const auto& result : results)
+    {
+        const double rate = result.seconds > 0.0 ? double(result.itemsProcessed) / result.seconds : 0.0;
+        std::string counters;
+        for (const auto& [name, value] : result.counters)
+            counters += fmt::format("{}{}={}", counters.empty() ? "" : ";", name, value);
+        stream << fmt::format("{},{},{},{},{}\n", result.name, result.iterations, result.seconds, rate, counters);
+    }
+}
+} // namespace
+
+int64_t State::range(size_t index) const
+{
+    FALCOR_CHECK(index < mArgs.size(), "Benchmark argument {} requested, but only {} arguments are set.", index, mArgs.size());
+    return mArgs[index];
+}
+
+bool State::keepRunning()
+{
+    if (!mStarted)
+    {
+        mStarted = true;
+        resumeTiming();
+    }
+    if (mIterations < mMaxIterations)
+    {
+        mIterations++;
+        return true;
+    }
+    pauseTiming();
+    return false;
+}
+
+void State::pauseTiming()
+{
+    if (!mRunning) return;
+    mElapsed += Clock::now() - mStart;
+    mRunning = false;
+}
+
+void State::resumeTiming()
+{
+    if (mRunning) return;
+    mStart = Clock::now();
+    mRunning = true;
+}
+
+Benchmark* Benchmark::arg(int64_t value)
+{
+    mArgs.push_back({value});
+    return this;
+}
+
+Benchmark* Benchmark::args(std::vector<int64_t> values)
+{
+    mArgs.push_back(std::move(values));
+    return this;
+}
+
+Benchmark* Benchmark::denseRange(int64_t start, int64_t limit, int64_t step)
+{
+    FALCOR_CHECK(step > 0, "Benchmark range step must be positive.");
+    for (int64_t value = start; value <= limit; value += step)
+        arg(value);
+    return this;
+}
+
+Benchmark* Benchmark::argsProduct(const std::vector<std::vector<int64_t>>& values)
+{
+    std::vector<std::vector<int64_t>> product = {{}};
+    for (const auto& list : values)
+    {
+        std::vector<std::vector<int64_t>> next;
+        for (const auto& prefix : product)
+        {
+            for (int64_t value : list)
+            {
+                next.push_back(prefix);
+                next.back().push_back(value);
+            }
+        }
+        product = std::move(next);
+    }
+    for (auto& args : product)
+        mArgs.push_back(std::move(args));
+    return this;
+}
+
+Benchmark* Benchmark::argNames(std::vector<std::string> names)
+{
+    mArgNames = std::move(names);
+    return this;
+}
+
+Benchmark* Benchmark::minTime(double seconds)
+{
+    mMinTime = seconds;
+    return this;
+}
+
+Benchmark* Benchmark::iterations(uint64_t count)
+{
+    mIterations = count;
+    return this;
+}
+
+std::string Benchmark::getInstanceName(const std::vector<int64_t>& args) const
+{
+    std::string name = mName;
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        if (i < mArgNames.size() && !mArgNames[i].empty()) name += fmt::format("/{}:{}", mArgNames[i], args[i]);
+        else name += fmt::format("/{}", args[i]);
+    }
+    return name;
+}
+
+Benchmark* registerBenchmark(std::string name, Benchmark::Function func)
+{
+    getRegistry().push_back(std::make_unique<Benchmark>(std::move(name), std::move(func)));
+    return getRegistry().back().get();
+}
+
+const std::vector<std::unique_ptr<Benchmark>>& getBenchmarks()
+{
+    return getRegistry();
+}
+
+int runBenchmarks(const RunOptions& options)
+{
+    const std::regex filter(options.filter.empty() ? ".*" : options.filter);
+    std::vector<Result> results;
+    fmt::print("{:<64} {:>17} {:>10}\n", "Benchmark", "Time/iteration", "Iterations");
+    fmt::print("{}\n", std::string(96, '-'));
+    for (const auto& benchmark : getBenchmarks())
+    {
+        std::vector<std::vector<int64_t>> argSets = benchmark->getArgs();
+        if (argSets.empty()) argSets.push_back({});
+        for (const auto& args : argSets)
+        {
+            if (!std::regex_search(benchmark->getInstanceName(args), filter)) continue;
+            results.push_back(runInstance(*benchmark, args, options.minTime));
+            printResult(results.back());
+        }
+    }
+    if (!options.csvPath.empty()) writeCsv(options.csvPath, results);
+    return 0;
+}
+} // namespace bench
+} // namespace Falcor
@@ -0,0 +1,177 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+namespace bench
+{
+/**
+ * State passed to a benchmark function.
+ * The function does its setup, runs the measured loop with keepRunning() and reports what it processed. Work that should not
+ * be measured can be excluded with pauseTiming() / resumeTiming().
+ *
+ * void bmFoo(bench::State& state)
+ * {
+ *     std::vector<int> data(state.range(0));
+ *     while (state.keepRunning())
+ *         doFoo(data);
+ *     state.setItemsProcessed(state.getIterations() * data.size());
+ * }
+ * FALCOR_BENCHMARK(bmFoo)->denseRange(10, 20, 2);
+ */
+class State
+{
+public:
+    State(std::vector<int64_t> args, uint64_t maxIterations) : mArgs(std::move(args)), mMaxIterations(maxIterations) {}
+
+    /// Get a benchmark argument.
+    int64_t range(size_t index = 0) const;
+
+    /// Returns true as long as the measured loop should continue. The timer starts with the first call.
+    bool keepRunning();
+
+    void pauseTiming();
+    void resumeTiming();
+
+    uint64_t getIterations() const { return mIterations; }
+    double getElapsedSeconds() const { return mElapsed.count(); }
+
+    /// Set the number of processed items, reported as items per second.
+    void setItemsProcessed(uint64_t items) { mItemsProcessed = items; }
+    /// Set a free-form counter printed next to the timings.
+    void setCounter(const std::string& name, double value) { mCounters[name] = value; }
+    /// Set a histogram, bin i counts occurrences of value i. Printed as summary statistics plus the non-empty bins.
+    void setHistogram(const std::string& name, std::vector<uint64_t> histogram) { mHistograms[name] = std::move(histogram); }
+    /// Set a label printed at the end of the result line.
+    void setLabel(const std::string& label) { mLabel = label; }
+
+    uint64_t getItemsProcessed() const { return mItemsProcessed; }
+    const std::map<std::string, double>& getCounters() const { return mCounters; }
+    const std::map<std::string, std::vector<uint64_t>>& getHistograms() const { return mHistograms; }
+    const std::string& getLabel() const { return mLabel; }
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::vector<int64_t> mArgs;
+    uint64_t mMaxIterations;
+    uint64_t mIterations = 0;
+    bool mStarted = false;
+    bool mRunning = false;
+    Clock::time_point mStart;
+    std::chrono::duration<double> mElapsed{0};
+
+    uint64_t mItemsProcessed = 0;
+    std::map<std::string, double> mCounters;
+    std::map<std::string, std::vector<uint64_t>> mHistograms;
+    std::string mLabel;
+};
+
+/**
+ * A registered benchmark with its argument sets. Each argument set is run as a separate benchmark instance.
+ */
+class Benchmark
+{
+public:
+    using Function = std::function<void(State&)>;
+
+    Benchmark(std::string name, Function func) : mName(std::move(name)), mFunc(std::move(func)) {}
+
+    /// Add an instance with a single argument.
+    Benchmark* arg(int64_t value);
+    /// Add an instance with multiple arguments.
+    Benchmark* args(std::vector<int64_t> values);
+    /// Add single argument instances for start, start + step, ... up to and including limit.
+    Benchmark* denseRange(int64_t start, int64_t limit, int64_t step = 1);
+    /// Add instances for the cartesian product of the given argument lists.
+    Benchmark* argsProduct(const std::vector<std::vector<int64_t>>& values);
+    /// Name the arguments, used in the instance names (e.g. "bmFoo/size:16").
+    Benchmark* argNames(std::vector<std::string> names);
+    /// Override the minimum measuring time of this benchmark.
+    Benchmark* minTime(double seconds);
+    /// Run exactly the given number of iterations instead of measuring for a minimum time.
+    Benchmark* iterations(uint64_t count);
+
+    const std::string& getName() const { return mName; }
+    const Function& getFunction() const { return mFunc; }
+    const std::vector<std::vector<int64_t>>& getArgs() const { return mArgs; }
+    double getMinTime() const { return mMinTime; }
+    uint64_t getFixedIterations() const { return mIterations; }
+
+    /// Name of the instance with the given argument set.
+    std::string getInstanceName(const std::vector<int64_t>& args) const;
+
+private:
+    std::string mName;
+    Function mFunc;
+    std::vector<std::vector<int64_t>> mArgs;
+    std::vector<std::string> mArgNames;
+    double mMinTime = 0.0;
+    uint64_t mIterations = 0;
+};
+
+Benchmark* registerBenchmark(std::string name, Benchmark::Function func);
+
+const std::vector<std::unique_ptr<Benchmark>>& getBenchmarks();
+
+struct RunOptions
+{
+    std::string filter;
+    double minTime = 0.5;
+    std::string csvPath;
+};
+
+/// Run all benchmark instances whose name matches the filter regex, returns the process exit code.
+int runBenchmarks(const RunOptions& options);
+
+/// Prevent the compiler from optimizing away a computed value.
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+#if FALCOR_MSVC
+    static const void* volatile sSink;
+    sSink = &value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+} // namespace bench
+} // namespace Falcor
+
+#define FALCOR_BENCHMARK(func) \
+    static ::Falcor::bench::Benchmark* FALCOR_CONCAT_STRINGS(sBenchmark, func) = ::Falcor::bench::registerBenchmark(#func, func)
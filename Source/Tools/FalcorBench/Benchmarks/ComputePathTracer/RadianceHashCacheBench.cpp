@@ -0,0 +1,554 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "Host/RadianceHashCache.h"
+
+#include <BS_thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using HashKey = RadianceHashGrid::HashKey;
+
+// hashMapSizeExp range worth considering for HC_HASHMAP_SIZE
+const std::vector<int64_t> kHashMapSizeExps = {16, 18, 20, 22, 24, 26};
+
+RadianceHashGrid::Layout getLayout(int64_t method)
+{
+    return method == int64_t(RadianceHashCache::Method::IRHC) ? RadianceHashGrid::Layout::irhc() : RadianceHashGrid::Layout::rhc();
+}
+
+float3 sampleDirection(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    while (true)
+    {
+        const float3 d(dist(rng), dist(rng), dist(rng));
+        const float len2 = dot(d, d);
+        if (len2 > 1e-4f && len2 <= 1.f) return d / std::sqrt(len2);
+    }
+}
+
+/**
+ * Keys of random training hits inserted on all spread levels, the same access pattern as the training pass.
+ * Hits are spread over a 100^3 scene with hit distances up to 30 units. Generating them is slow for the large tables, so
+ * they are cached between benchmark runs.
+ */
+const std::vector<HashKey>& getSampleKeys(int64_t method, uint32_t hitCount, uint32_t seed)
+{
+    static std::map<std::tuple<int64_t, uint32_t, uint32_t>, std::vector<HashKey>> sCache;
+    static std::mutex sMutex;
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto& keys = sCache[{method, hitCount, seed}];
+    if (!keys.empty()) return keys;
+
+    const RadianceHashGrid grid(getLayout(method), 1);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> positionDist(-50.f, 50.f);
+    std::uniform_real_distribution<float> distanceDist(0.5f, 30.f);
+    keys.reserve(size_t(hitCount) * RadianceHashCache::kLevelTrainingSpread);
+    for (uint32_t i = 0; i < hitCount; i++)
+    {
+        const float distance = distanceDist(rng);
+        const float3 position(positionDist(rng), positionDist(rng), positionDist(rng));
+        const float3 direction = sampleDirection(rng);
+        const float3 normal = sampleDirection(rng);
+        for (uint32_t l = 0; l < RadianceHashCache::kLevelTrainingSpread; l++)
+        {
+            const int levelOffset = int(l) - int(RadianceHashCache::kLevelTrainingSpread / 2);
+            keys.push_back(grid.computeSpatialHash(distance, position, direction, normal, levelOffset));
+        }
+    }
+    return keys;
+}
+
+template<typename Func>
+void forEachKey(BS::thread_pool* pPool, size_t count, Func func)
+{
+    if (!pPool)
+    {
+        func(size_t(0), count);
+        return;
+    }
+    pPool->parallelize_loop(size_t(0), count, func).wait();
+}
+
+void fillGrid(RadianceHashGrid& grid, BS::thread_pool* pPool, const std::vector<HashKey>& keys)
+{
+    forEachKey(
+        pPool,
+        keys.size(),
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+                grid.insertEntry(keys[i]);
+        }
+    );
+}
+
+void reportGridStats(bench::State& state, const RadianceHashGrid& grid)
+{
+    RadianceHashGrid::Stats stats = grid.computeStats();
+    state.setCounter("load", stats.getLoadFactor());
+    state.setCounter("failed", double(stats.failedInserts));
+    state.setHistogram("storedKeyProbes", std::move(stats.probeHistogram));
+}
+
+void addProbeCount(std::vector<uint64_t>& histogram, uint32_t probeCount)
+{
+    if (probeCount >= histogram.size()) histogram.resize(probeCount + 1, 0);
+    histogram[probeCount]++;
+}
+
+/**
+ * Insert throughput into an empty table. The table receives capacity / 4 training hits, i.e. up to 3/4 of its capacity in keys,
+ * arguments: hashMapSizeExp, method (0 = rhc, 1 = irhc), thread count.
+ */
+void bmRadianceHashGridInsert(bench::State& state)
+{
+    const uint32_t capacity = 1u << state.range(0);
+    const uint32_t threadCount = uint32_t(state.range(2));
+    const std::vector<HashKey>& keys = getSampleKeys(state.range(1), capacity / 4, 1);
+    RadianceHashGrid grid(getLayout(state.range(1)), capacity);
+    std::unique_ptr<BS::thread_pool> pPool = threadCount > 1 ? std::make_unique<BS::thread_pool>(threadCount) : nullptr;
+
+    while (state.keepRunning())
+    {
+        state.pauseTiming();
+        grid.reset();
+        state.resumeTiming();
+        fillGrid(grid, pPool.get(), keys);
+    }
+
+    state.setItemsProcessed(state.getIterations() * keys.size());
+    reportGridStats(state, grid);
+}
+
+/**
+ * Lookup throughput in a table filled like in bmRadianceHashGridInsert. Half of the queries hit stored keys, the other half
+ * are keys of unrelated hits, which is the common case when querying the cache during path tracing.
+ * Arguments: hashMapSizeExp, method (0 = rhc, 1 = irhc), thread count.
+ */
+void bmRadianceHashGridLookup(bench::State& state)
+{
+    const uint32_t capacity = 1u << state.range(0);
+    const uint32_t threadCount = uint32_t(state.range(2));
+    const std::vector<HashKey>& storedKeys = getSampleKeys(state.range(1), capacity / 4, 1);
+    const std::vector<HashKey>& missKeys = getSampleKeys(state.range(1), capacity / 4, 2);
+    RadianceHashGrid grid(getLayout(state.range(1)), capacity);
+    std::unique_ptr<BS::thread_pool> pPool = threadCount > 1 ? std::make_unique<BS::thread_pool>(threadCount) : nullptr;
+    fillGrid(grid, pPool.get(), storedKeys);
+
+    std::vector<HashKey> queries;
+    queries.reserve(storedKeys.size() + missKeys.size());
+    for (size_t i = 0; i < storedKeys.size(); i++)
+    {
+        queries.push_back(storedKeys[i]);
+        queries.push_back(missKeys[i]);
+    }
+
+    std::atomic<uint64_t> found{0};
+    while (state.keepRunning())
+    {
+        forEachKey(
+            pPool.get(),
+            queries.size(),
+            [&](size_t begin, size_t end)
+            {
+                uint64_t localFound = 0;
+                for (size_t i = begin; i < end; i++)
+                    localFound += grid.findEntry(queries[i]) != RadianceHashGrid::kInvalidIdx ? 1 : 0;
+                found.fetch_add(localFound, std::memory_order_relaxed);
+            }
+        );
+    }
+
+    // probe counts are gathered in a separate pass to keep the bookkeeping out of the measurement
+    std::vector<uint64_t> hitProbes;
+    std::vector<uint64_t> missProbes;
+    for (HashKey key : queries)
+    {
+        uint32_t probeCount = 0;
+        const bool hit = grid.findEntry(key, &probeCount) != RadianceHashGrid::kInvalidIdx;
+        addProbeCount(hit ? hitProbes : missProbes, probeCount);
+    }
+
+    state.setItemsProcessed(state.getIterations() * queries.size());
+    state.setCounter("hitRate", state.getIterations() > 0 ? double(found) / double(state.getIterations() * queries.size()) : 0.0);
+    state.setHistogram("hitProbes", std::move(hitProbes));
+    state.setHistogram("missProbes", std::move(missProbes));
+    reportGridStats(state, grid);
+}
+
+/**
+ * Compares the probing schemes at a fixed table size over load factors. Keys are unique random values so the load factor is
+ * exact, probe counts are memory loads including the probing metadata.
+ * Arguments: probing scheme (HC_PROBING_SCHEME), load factor in percent, query kind (0 = hits, 1 = misses).
+ */
+void bmRadianceHashGridProbing(bench::State& state)
+{
+    const uint32_t capacity = 1u << 20;
+    const auto scheme = RadianceHashGrid::ProbingScheme(state.range(0));
+    const size_t keyCount = size_t(capacity) * size_t(state.range(1)) / 100;
+    const bool queryMisses = state.range(2) != 0;
+
+    std::mt19937_64 rng(3);
+    std::vector<HashKey> keys(keyCount);
+    for (auto& key : keys)
+        key = rng() | 1;
+    RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), capacity, scheme);
+    fillGrid(grid, nullptr, keys);
+
+    // misses use even keys, which are never stored
+    std::vector<HashKey> queries = keys;
+    if (queryMisses)
+    {
+        for (auto& query : queries)
+            query = rng() & ~HashKey(1);
+    }
+    std::shuffle(queries.begin(), queries.end(), rng);
+
+    uint64_t found = 0;
+    while (state.keepRunning())
+    {
+        for (HashKey query : queries)
+            found += grid.findEntry(query) != RadianceHashGrid::kInvalidIdx ? 1 : 0;
+    }
+    bench::doNotOptimize(found);
+
+    std::vector<uint64_t> probes;
+    uint64_t probeSum = 0;
+    for (HashKey query : queries)
+    {
+        uint32_t probeCount = 0;
+        grid.findEntry(query, &probeCount);
+        addProbeCount(probes, probeCount);
+        probeSum += probeCount;
+    }
+
+    state.setItemsProcessed(state.getIterations() * queries.size());
+    state.setCounter("avgProbes", double(probeSum) / double(queries.size()));
+    state.setCounter("maxProbes", double(probes.size() - 1));
+    state.setHistogram("probes", std::move(probes));
+    reportGridStats(state, grid);
+}
+
+/**
+ * Full training round trip: splat radiance for a batch of training hits and resolve the whole table.
+ * Arguments: hashMapSizeExp, method (0 = rhc, 1 = irhc), voxel layout (0 = float, 1 = packed).
+ */
+void bmRadianceHashCacheAccumulateResolve(bench::State& state)
+{
+    const uint32_t hashMapSizeExp = uint32_t(state.range(0));
+    const auto method = RadianceHashCache::Method(state.range(1));
+    const auto voxelLayout = RadianceHashCache::VoxelLayout(state.range(2));
+    RadianceHashCache cache(method, hashMapSizeExp, RadianceHashGrid::ProbingScheme::Linear, voxelLayout);
+    const std::vector<HashKey>& keys = getSampleKeys(state.range(1), cache.getCapacity() / 4, 1);
+
+    std::vector<RadianceHashCache::VoxelIndices> indices(keys.size() / RadianceHashCache::kLevelTrainingSpread);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        for (uint32_t l = 0; l < RadianceHashCache::kLevelTrainingSpread; l++)
+            indices[i][l] = cache.getHashGrid().insertEntry(keys[i * RadianceHashCache::kLevelTrainingSpread + l]);
+    }
+
+    BS::thread_pool pool;
+    while (state.keepRunning())
+    {
+        pool.parallelize_loop(
+                size_t(0),
+                indices.size(),
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                        cache.addVoxelData(indices[i], float3(0.5f, 0.25f, 1.f), true);
+                }
+            )
+            .wait();
+        pool.parallelize_loop(cache.getCapacity(), [&](uint32_t begin, uint32_t end) { cache.resolve(begin, end); }).wait();
+        cache.endFrame();
+    }
+
+    state.setItemsProcessed(state.getIterations() * indices.size());
+    state.setCounter("voxels", double(cache.getCapacity()));
+}
+
+/**
+ * Resolve after a frame of training hits into a warm table, either over all slots or only over the slots inserted this frame.
+ * Only the resolve is timed. Arguments: hashMapSizeExp, incremental (0 = full, 1 = dirty list).
+ */
+void bmRadianceHashCacheIncrementalResolve(bench::State& state)
+{
+    const uint32_t hashMapSizeExp = uint32_t(state.range(0));
+    const bool incremental = state.range(1) != 0;
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, hashMapSizeExp, RadianceHashGrid::ProbingScheme::Linear, RadianceHashCache::VoxelLayout::Packed);
+    cache.setIncrementalResolve(incremental);
+    BS::thread_pool pool;
+
+    // voxels of earlier frames that are not touched anymore
+    const std::vector<HashKey>& warmKeys = getSampleKeys(int64_t(RadianceHashCache::Method::RHC), cache.getCapacity() / 8, 1);
+    pool.parallelize_loop(
+            size_t(0),
+            warmKeys.size(),
+            [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                    cache.getHashGrid().insertEntry(warmKeys[i]);
+            }
+        )
+        .wait();
+    cache.endFrame();
+
+    // a 1920x1080 frame traces frameDim / 10 training paths
+    const std::vector<HashKey>& keys = getSampleKeys(int64_t(RadianceHashCache::Method::RHC), 192 * 108, 2);
+    std::vector<RadianceHashCache::VoxelIndices> indices(keys.size() / RadianceHashCache::kLevelTrainingSpread);
+    uint64_t dirtySlotCount = 0;
+    while (state.keepRunning())
+    {
+        state.pauseTiming();
+        pool.parallelize_loop(
+                size_t(0),
+                indices.size(),
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        for (uint32_t l = 0; l < RadianceHashCache::kLevelTrainingSpread; l++)
+                            indices[i][l] = cache.getHashGrid().insertEntry(keys[i * RadianceHashCache::kLevelTrainingSpread + l]);
+                        cache.addVoxelData(indices[i], float3(0.5f, 0.25f, 1.f), true);
+                    }
+                }
+            )
+            .wait();
+        dirtySlotCount = cache.getHashGrid().getDirtySlotCount();
+        state.resumeTiming();
+
+        if (incremental)
+            pool.parallelize_loop(cache.getHashGrid().getDirtySlotCount(), [&](uint32_t begin, uint32_t end) { cache.resolveDirty(begin, end); }).wait();
+        else
+            pool.parallelize_loop(cache.getCapacity(), [&](uint32_t begin, uint32_t end) { cache.resolve(begin, end); }).wait();
+
+        state.pauseTiming();
+        cache.endFrame();
+        state.resumeTiming();
+    }
+
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("voxels", double(cache.getCapacity()));
+    state.setCounter("dirtySlots", double(dirtySlotCount));
+}
+
+/**
+ * Camera fly-through: every frame inserts training hits around a camera that moves along a line through a scene far larger than
+ * the table, then resolves. Without eviction the table fills up and later regions cannot be cached anymore.
+ * Arguments: max age in frames (0 = no eviction), probing scheme.
+ */
+void bmRadianceHashCacheFlyThrough(bench::State& state)
+{
+    const uint32_t frameCount = 256;
+    const uint32_t hitsPerFrame = 2048;
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 16, RadianceHashGrid::ProbingScheme(state.range(1)));
+    cache.getHashGrid().setMaxAge(uint32_t(state.range(0)));
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> offsetDist(-8.f, 8.f);
+    std::uniform_real_distribution<float> distanceDist(0.5f, 8.f);
+
+    uint64_t lastFrameFailed = 0;
+    uint64_t lastFrameInserts = 0;
+    while (state.keepRunning())
+    {
+        state.pauseTiming();
+        cache.reset();
+        state.resumeTiming();
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            const float3 cameraPos(float(frame) * 2.f, 0.f, 0.f);
+            const bool lastFrame = frame + 1 == frameCount;
+            const uint64_t failedBefore = lastFrame ? cache.getHashGrid().computeStats().failedInserts : 0;
+            for (uint32_t i = 0; i < hitsPerFrame; i++)
+            {
+                RadianceHashCache::HitData hit;
+                hit.distance = distanceDist(rng);
+                hit.positionWorld = cameraPos + float3(offsetDist(rng), offsetDist(rng), offsetDist(rng));
+                hit.normalWorld = sampleDirection(rng);
+                hit.direction = float3(0.f, 0.f, 1.f);
+                cache.addVoxelData(cache.insertEntries(hit), float3(1.f), true);
+            }
+            if (lastFrame)
+            {
+                lastFrameFailed = cache.getHashGrid().computeStats().failedInserts - failedBefore;
+                lastFrameInserts = hitsPerFrame * RadianceHashCache::kLevelTrainingSpread;
+            }
+            cache.resolve();
+            cache.endFrame();
+        }
+    }
+
+    const RadianceHashGrid::Stats stats = cache.getHashGrid().computeStats();
+    state.setItemsProcessed(state.getIterations() * frameCount);
+    state.setCounter("lastFrameFailedRate", lastFrameInserts > 0 ? double(lastFrameFailed) / double(lastFrameInserts) : 0.0);
+    state.setCounter("load", stats.getLoadFactor());
+    state.setCounter("evicted", double(stats.evictedEntries));
+}
+
+/**
+ * Key layout of an exterior scene: training hits on the ground of a square scene, inserted with the fixed layout of the method or
+ * the one fitted to the scene bounds. Reports the expected key collision rate of the layout next to the occupancy of the table.
+ * Arguments: scene extent in units, method, fitted layout.
+ */
+void bmRadianceHashGridKeyLayout(bench::State& state)
+{
+    const float extent = float(state.range(0));
+    const float3 sceneMin(-0.5f * extent, 0.f, -0.5f * extent);
+    const float3 sceneMax(0.5f * extent, 0.05f * extent, 0.5f * extent);
+    const float minDistance = 0.1f;
+    const float maxDistance = length(sceneMax - sceneMin);
+    const uint32_t levelSpread = RadianceHashCache::kLevelTrainingSpread / 2;
+    RadianceHashGrid::Layout layout = getLayout(state.range(1));
+    if (state.range(2) != 0) layout = RadianceHashGrid::Layout::fitScene(layout, sceneMin, sceneMax, minDistance, maxDistance, levelSpread);
+
+    const uint32_t hitCount = 1 << 16;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> positionDist(-0.5f * extent, 0.5f * extent);
+    std::uniform_real_distribution<float> logDistanceDist(std::log(minDistance), std::log(maxDistance));
+    const RadianceHashGrid keyGrid(layout, 1);
+    std::vector<HashKey> keys;
+    keys.reserve(size_t(hitCount) * RadianceHashCache::kLevelTrainingSpread);
+    for (uint32_t i = 0; i < hitCount; i++)
+    {
+        const float distance = std::exp(logDistanceDist(rng));
+        const float3 position(positionDist(rng), 0.f, positionDist(rng));
+        for (uint32_t l = 0; l < RadianceHashCache::kLevelTrainingSpread; l++)
+        {
+            const int levelOffset = int(l) - int(levelSpread);
+            keys.push_back(keyGrid.computeSpatialHash(distance, position, float3(0.f, 0.f, 1.f), float3(0.f, 1.f, 0.f), levelOffset));
+        }
+    }
+
+    RadianceHashGrid grid(layout, 1 << 20);
+    while (state.keepRunning())
+    {
+        state.pauseTiming();
+        grid.reset();
+        state.resumeTiming();
+        for (HashKey key : keys) grid.insertEntry(key);
+    }
+
+    state.setItemsProcessed(state.getIterations() * keys.size());
+    reportGridStats(state, grid);
+    state.setCounter("collisionRate", layout.estimateCollisionRate(sceneMin, sceneMax, minDistance, maxDistance, levelSpread));
+    state.setCounter("positionBits", double(layout.positionBitNum));
+    state.setCounter("levelBits", double(layout.levelBitNum));
+}
+
+/**
+ * Per level sub-tables against a table shared by all levels: training hits on the ground of a 100 x 20 x 100 scene with log-uniform
+ * distances up to the scene diagonal. Reports failed inserts and probe lengths at the same capacity.
+ * Arguments: hashMapSizeExp, probing scheme, level tables.
+ */
+void bmRadianceHashGridLevelTables(bench::State& state)
+{
+    const uint32_t capacity = 1u << state.range(0);
+    const float3 sceneMin(-50.f, 0.f, -50.f);
+    const float3 sceneMax(50.f, 20.f, 50.f);
+    const float minDistance = 0.1f;
+    const float maxDistance = length(sceneMax - sceneMin);
+    const uint32_t levelSpread = RadianceHashCache::kLevelTrainingSpread / 2;
+    const RadianceHashGrid::Layout layout =
+        RadianceHashGrid::Layout::fitScene(RadianceHashGrid::Layout::rhc(), sceneMin, sceneMax, minDistance, maxDistance, levelSpread);
+    RadianceHashGrid grid(layout, capacity, RadianceHashGrid::ProbingScheme(state.range(1)));
+    if (state.range(2) != 0) grid.setLevelTables(RadianceHashGrid::LevelTables::fitScene(layout, capacity, sceneMin, sceneMax, minDistance, maxDistance, levelSpread));
+
+    // hits on the ground, up to 3/4 of the capacity in keys, the coarse levels hold few distinct ones
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> unitDist(0.f, 1.f);
+    std::vector<HashKey> keys;
+    keys.reserve(size_t(capacity / 4) * RadianceHashCache::kLevelTrainingSpread);
+    for (uint32_t i = 0; i < capacity / 4; i++)
+    {
+        const float distance = minDistance * std::pow(maxDistance / minDistance, unitDist(rng));
+        const float3 position = sceneMin + (sceneMax - sceneMin) * float3(unitDist(rng), 0.f, unitDist(rng));
+        const float3 normal(0.f, 1.f, 0.f);
+        for (uint32_t l = 0; l < RadianceHashCache::kLevelTrainingSpread; l++)
+        {
+            const int levelOffset = int(l) - int(levelSpread);
+            keys.push_back(grid.computeSpatialHash(distance, position, float3(0.f, 0.f, 1.f), normal, levelOffset));
+        }
+    }
+
+    while (state.keepRunning())
+    {
+        state.pauseTiming();
+        grid.reset();
+        state.resumeTiming();
+        for (HashKey key : keys) grid.insertEntry(key);
+    }
+
+    state.setItemsProcessed(state.getIterations() * keys.size());
+    reportGridStats(state, grid);
+    const RadianceHashGrid::Stats stats = grid.computeStats();
+    state.setCounter("avgProbes", stats.getAverageProbeCount());
+    state.setCounter("maxProbes", double(stats.getMaxProbeCount()));
+    // load of the fullest level, the level that runs out of slots first
+    double maxLevelLoad = 0.0;
+    for (const RadianceHashGrid::LevelStats& levelStats : stats.levels)
+        maxLevelLoad = std::max(maxLevelLoad, double(levelStats.occupiedSlots + levelStats.failedInserts) / double(std::max(levelStats.capacity, 1u)));
+    state.setCounter("maxLevelLoad", maxLevelLoad);
+}
+
+std::vector<int64_t> getThreadCounts()
+{
+    const int64_t threadCount = std::thread::hardware_concurrency();
+    if (threadCount > 1) return {1, threadCount};
+    return {1};
+}
+} // namespace
+
+FALCOR_BENCHMARK(bmRadianceHashGridInsert)
+    ->argsProduct({kHashMapSizeExps, {0, 1}, getThreadCounts()})
+    ->argNames({"sizeExp", "method", "threads"});
+FALCOR_BENCHMARK(bmRadianceHashGridLookup)
+    ->argsProduct({kHashMapSizeExps, {0, 1}, getThreadCounts()})
+    ->argNames({"sizeExp", "method", "threads"});
+FALCOR_BENCHMARK(bmRadianceHashGridProbing)->argsProduct({{0, 1, 2}, {50, 75, 90}, {0, 1}})->argNames({"scheme", "load", "miss"});
+FALCOR_BENCHMARK(bmRadianceHashCacheAccumulateResolve)->argsProduct({{16, 20, 22}, {0, 1}, {0, 1}})->argNames({"sizeExp", "method", "layout"});
+FALCOR_BENCHMARK(bmRadianceHashCacheIncrementalResolve)->argsProduct({{20, 22}, {0, 1}})->argNames({"sizeExp", "incremental"});
+FALCOR_BENCHMARK(bmRadianceHashGridKeyLayout)->argsProduct({{100, 1000, 20000}, {0, 1}, {0, 1}})->argNames({"extent", "method", "fit"});
+FALCOR_BENCHMARK(bmRadianceHashGridLevelTables)->argsProduct({{16, 20}, {0, 1, 2}, {0, 1}})->argNames({"sizeExp", "scheme", "tables"});
+FALCOR_BENCHMARK(bmRadianceHashCacheFlyThrough)->argsProduct({{0, 8, 32}, {0, 1, 2}})->argNames({"maxAge", "scheme"})->iterations(1);
+} // namespace Falcor
@@ -0,0 +1,144 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "Host/TinynnFeatureEncodings.h"
+
+#include <fmt/format.h>
+
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+// queries per call, the size of a wavefront of NN queries of a small tile
+const uint32_t kQueryCount = 4096;
+// training batches inserted before the lookups are timed
+const uint32_t kTrainingFrameCount = 64;
+
+/// Hits on the walls of a 20 x 6 x 20 room with random directions, stored as structure of arrays.
+struct RoomQueries
+{
+    std::vector<float> components[9];
+    QueryBatch batch;
+
+    RoomQueries(std::mt19937& rng, uint32_t count)
+    {
+        const float3 extent(10.f, 3.f, 10.f);
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+        std::uniform_int_distribution<uint32_t> wallDist(0, 5);
+        for (auto& c : components)
+            c.resize(count);
+        for (uint32_t q = 0; q < count; q++)
+        {
+            const uint32_t wall = wallDist(rng);
+            const uint32_t axis = wall / 2;
+            const float side = wall % 2 ? 1.f : -1.f;
+            float3 position(dist(rng), dist(rng), dist(rng));
+            position[axis] = side;
+            float3 normal(0.f);
+            normal[axis] = -side;
+            float3 dir;
+            do
+                dir = float3(dist(rng), dist(rng), dist(rng));
+            while (dot(dir, dir) > 1.f || dot(dir, dir) < 1e-4f);
+            dir = normalize(dir);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                components[c][q] = position[c] * extent[c];
+                components[3 + c][q] = dir[c];
+                components[6 + c][q] = normal[c];
+            }
+        }
+        batch.count = count;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            batch.position[c] = components[c].data();
+            batch.direction[c] = components[3 + c].data();
+            batch.normal[c] = components[6 + c].data();
+        }
+    }
+};
+
+/**
+ * Throughput of the NIRC feature hash encoding of computeFeature() for the default grid of 2^22 halfs, reported as queries per
+ * second. The grid is trained with kTrainingFrameCount batches of room hits before lookups of new hits are timed.
+ * Arguments: interpolation (0 = hash enc, 1 = hash enc with interpolation), separate level grids (0, 1), probing size.
+ * Counters: collisionN is the fraction of training inserts at level N that found no slot for their key, missN the fraction of
+ * timed lookups at level N that did not find their key. Both fall back to the home slot and read a shared feature.
+ */
+void bmTinynnHashEncoding(bench::State& state)
+{
+    const Encoding encoding = state.range(0) != 0 ? Encoding::HashInterpolation : Encoding::Hash;
+    FeatureHashGrid::Desc desc;
+    desc.separateLevelGrids = state.range(1) != 0;
+    desc.probingSize = uint32_t(state.range(2));
+    uint32_t offsetPrim = 0;
+    uint32_t offsetGrad = 0;
+    FeatureHashGrid grid(desc, offsetPrim, offsetGrad);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1e-2f, 1e-2f);
+    std::vector<float16_t> primal(offsetPrim);
+    for (auto& v : primal)
+        v = float16_t(dist(rng));
+
+    std::vector<float16_t> features(size_t(kQueryCount) * kFeatureWidth);
+    for (uint32_t frame = 0; frame < kTrainingFrameCount; frame++)
+    {
+        const RoomQueries training(rng, kQueryCount);
+        computeFeatures(encoding, &grid, primal.data(), training.batch, true, features.data());
+    }
+    std::vector<FeatureHashGrid::LevelStats> trainingStats;
+    for (uint32_t level = 0; level < FeatureHashGrid::kLevelCount; level++)
+        trainingStats.push_back(grid.getLevelStats(level));
+    grid.resetStats();
+    const RoomQueries queries(rng, kQueryCount);
+
+    while (state.keepRunning())
+    {
+        computeFeatures(encoding, &grid, primal.data(), queries.batch, false, features.data());
+        bench::doNotOptimize(features);
+    }
+
+    state.setItemsProcessed(state.getIterations() * kQueryCount);
+    for (uint32_t level = 0; level < FeatureHashGrid::kLevelCount; level++)
+    {
+        state.setCounter(fmt::format("collision{}", level), trainingStats[level].getMissRate());
+        state.setCounter(fmt::format("miss{}", level), grid.getLevelStats(level).getMissRate());
+    }
+}
+} // namespace
+
+FALCOR_BENCHMARK(bmTinynnHashEncoding)
+    ->argsProduct({{0, 1}, {0, 1}, {0, 1, 2, 4, 8}})
+    ->argNames({"interpolation", "separateLevelGrids", "probingSize"});
+} // namespace Falcor
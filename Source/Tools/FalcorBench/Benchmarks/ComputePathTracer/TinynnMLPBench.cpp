@@ -0,0 +1,99 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "Host/TinynnMLP.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+// queries per call, the size of a wavefront of NN queries of a small tile
+const uint32_t kQueryCount = 4096;
+
+std::vector<float16_t> randomHalfs(std::mt19937& rng, size_t count, float range)
+{
+    std::uniform_real_distribution<float> dist(-range, range);
+    std::vector<float16_t> values(count);
+    for (auto& v : values)
+        v = float16_t(dist(rng));
+    return values;
+}
+
+/**
+ * Throughput of the CPU tinynn MLP with ReLU activations, reported as queries per second.
+ * Arguments: width (16 or 32), layer count, instruction set (0 = scalar, 1 = AVX2, 2 = AVX-512), pass (0 = forward, 1 = backward).
+ * Instances with an instruction set the CPU does not support are skipped.
+ */
+void bmTinynnMLP(bench::State& state)
+{
+    const uint32_t width = uint32_t(state.range(0));
+    const uint32_t layerCount = uint32_t(state.range(1));
+    const Isa isa = Isa(state.range(2));
+    const bool backward = state.range(3) != 0;
+    if (!isIsaSupported(isa))
+    {
+        state.setLabel("unsupported");
+        return;
+    }
+
+    uint32_t offsetPrim = 0;
+    uint32_t offsetGrad = 0;
+    HalfMLP mlp(width, layerCount, Activation::ReLU, offsetPrim, offsetGrad);
+    mlp.setIsa(isa);
+    std::mt19937 rng(1);
+    mlp.loadWeights(randomHalfs(rng, offsetPrim, 1.f / std::sqrt(float(width))).data());
+
+    const std::vector<float16_t> input = randomHalfs(rng, size_t(kQueryCount) * width, 1.f);
+    const std::vector<float16_t> dOutput = randomHalfs(rng, size_t(kQueryCount) * width, 1.f);
+    std::vector<float16_t> output(size_t(kQueryCount) * width);
+    std::vector<float> gradient(offsetGrad, 0.f);
+    std::vector<float> gradientCount(offsetGrad, 0.f);
+
+    while (state.keepRunning())
+    {
+        if (backward)
+            mlp.backward(input.data(), dOutput.data(), output.data(), gradient.data(), gradientCount.data(), kQueryCount);
+        else
+            mlp.forward(input.data(), output.data(), kQueryCount);
+        bench::doNotOptimize(output);
+    }
+
+    state.setItemsProcessed(state.getIterations() * kQueryCount);
+}
+} // namespace
+
+FALCOR_BENCHMARK(bmTinynnMLP)
+    ->argsProduct({{16, 32}, {1, 2, 3, 4, 5, 6, 7, 8}, {0, 1, 2}, {0, 1}})
+    ->argNames({"width", "layers", "isa", "backward"});
+} // namespace Falcor
@@ -0,0 +1,94 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "Host/TinynnOptimizer.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+// one 32 wide layer followed by a feature hash grid
+const uint32_t kGridBegin = 32 * 32;
+const uint32_t kParamCount = kGridBegin + (1u << 20);
+
+/**
+ * Throughput of the CPU optimizer passes of one training iteration, reported as parameters per second. Every iteration first copies
+ * the gradients of a training pass into the gradient buffers.
+ * Arguments: mode (0 = clear and descent, 1 = fused, 2 = fused with sparse feature grid update, 3 = fused with lazy feature grid
+ * Adam), percentage of grid parameters with a gradient.
+ */
+void bmTinynnOptimizer(bench::State& state)
+{
+    const uint32_t mode = uint32_t(state.range(0));
+    const uint32_t hitPercentage = uint32_t(state.range(1));
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    std::vector<float16_t> primal(kParamCount);
+    std::vector<float16_t> filteredPrimal(kParamCount);
+    std::vector<float> trainingGradient(kParamCount, 0.f);
+    std::vector<float> trainingGradientCount(kParamCount, 0.f);
+    for (uint32_t i = 0; i < kParamCount; i++)
+    {
+        primal[i] = float16_t(0.01f * dist(rng));
+        filteredPrimal[i] = primal[i];
+        if (i >= kGridBegin && rng() % 100 >= hitPercentage) continue;
+        trainingGradient[i] = dist(rng);
+        trainingGradientCount[i] = 1.f;
+    }
+    std::vector<float> gradient(kParamCount, 0.f);
+    std::vector<float> gradientCount(kParamCount, 0.f);
+    std::vector<float> aux(3 * kParamCount, 0.f);
+    const OptimizerBuffers buffers{kParamCount, primal.data(), filteredPrimal.data(), gradient.data(), gradientCount.data(), aux.data()};
+    const OptimizerDesc desc;
+
+    int step = 1;
+    while (state.keepRunning())
+    {
+        if (mode == 0) clearGradients(buffers);
+        // the training pass adds to the cleared buffers
+        std::copy(trainingGradient.begin(), trainingGradient.end(), gradient.begin());
+        std::copy(trainingGradientCount.begin(), trainingGradientCount.end(), gradientCount.begin());
+        if (mode == 0) gradientDescent(desc, step, buffers);
+        else fusedOptimizerStep(desc, step, buffers, {kGridBegin, mode >= 2 ? kParamCount : 0, mode == 3, uint32_t(step)});
+        bench::doNotOptimize(primal);
+        step++;
+    }
+
+    state.setItemsProcessed(state.getIterations() * kParamCount);
+}
+} // namespace
+
+FALCOR_BENCHMARK(bmTinynnOptimizer)->argsProduct({{0, 1, 2, 3}, {100, 20, 5}})->argNames({"mode", "hitPercentage"});
+} // namespace Falcor
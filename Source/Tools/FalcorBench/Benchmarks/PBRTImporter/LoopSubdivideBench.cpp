@@ -0,0 +1,88 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "LoopSubdivide.h"
+
+#include <cmath>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+// Face count of the subdivided meshes.
+const uint32_t kFaceCountExp = 20;
+
+/// Triangulated torus with nx x ny quads.
+void createTorus(uint32_t nx, uint32_t ny, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+{
+    for (uint32_t y = 0; y < ny; ++y)
+    {
+        for (uint32_t x = 0; x < nx; ++x)
+        {
+            float a = 2.f * float(M_PI) * x / nx;
+            float b = 2.f * float(M_PI) * y / ny;
+            positions.push_back(float3((2.f + std::cos(b)) * std::cos(a), (2.f + std::cos(b)) * std::sin(a), std::sin(b)));
+            uint32_t v00 = y * nx + x;
+            uint32_t v10 = y * nx + (x + 1) % nx;
+            uint32_t v01 = ((y + 1) % ny) * nx + x;
+            uint32_t v11 = ((y + 1) % ny) * nx + (x + 1) % nx;
+            indices.insert(indices.end(), {v00, v11, v10, v00, v01, v11});
+        }
+    }
+}
+
+/**
+ * Loop subdivision of a torus into 1M faces, reported as output faces per second.
+ * The base mesh has 1M / 4^levels faces so that all levels produce the same output.
+ * Arguments: number of subdivision levels.
+ */
+void bmLoopSubdivide(bench::State& state)
+{
+    const uint32_t levels = uint32_t(state.range(0));
+
+    const uint32_t baseFaceCountExp = kFaceCountExp - 2 * levels;
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    createTorus(1u << (baseFaceCountExp / 2), 1u << (baseFaceCountExp - 1 - baseFaceCountExp / 2), positions, indices);
+
+    size_t faceCount = 0;
+    while (state.keepRunning())
+    {
+        auto result = pbrt::loopSubdivide(levels, positions, indices);
+        faceCount = result.indices.size() / 3;
+        bench::doNotOptimize(result);
+    }
+
+    state.setItemsProcessed(state.getIterations() * faceCount);
+    state.setCounter("baseFaces", double(indices.size() / 3));
+}
+} // namespace
+
+FALCOR_BENCHMARK(bmLoopSubdivide)->denseRange(1, 4)->argNames({"levels"});
+} // namespace Falcor
@@ -0,0 +1,109 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Benchmark.h"
+#include "Core/Error.h"
+
+#include <args.hxx>
+
+#include <fmt/format.h>
+
+#include <iostream>
+#include <regex>
+#include <string>
+
+using namespace Falcor;
+
+int runMain(int argc, char** argv)
+{
+    args::ArgumentParser parser("Falcor CPU benchmarks.");
+    parser.helpParams.programName = "FalcorBench";
+    args::HelpFlag helpFlag(parser, "help", "Display this help menu.", {'h', "help"});
+    args::Flag listFlag(parser, "", "List benchmark instances.", {'l', "list"});
+    args::ValueFlag<std::string> filterFlag(parser, "regex", "Filter benchmark instances to run.", {'f', "filter"});
+    args::ValueFlag<double> minTimeFlag(parser, "seconds", "Minimum measuring time per benchmark instance (default: 0.5).", {"min-time"});
+    args::ValueFlag<std::string> csvFlag(parser, "path", "CSV report output file.", {"csv"});
+    args::CompletionFlag completionFlag(parser, {"complete"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Completion& e)
+    {
+        std::cout << e.what();
+        return 0;
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (const args::ParseError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    catch (const args::RequiredError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    bench::RunOptions options;
+    if (filterFlag)
+        options.filter = args::get(filterFlag);
+    if (minTimeFlag)
+        options.minTime = args::get(minTimeFlag);
+    if (csvFlag)
+        options.csvPath = args::get(csvFlag);
+
+    if (listFlag)
+    {
+        const std::regex filter(options.filter.empty() ? ".*" : options.filter);
+        for (const auto& benchmark : bench::getBenchmarks())
+        {
+            std::vector<std::vector<int64_t>> argSets = benchmark->getArgs();
+            if (argSets.empty()) argSets.push_back({});
+            for (const auto& args : argSets)
+            {
+                const std::string name = benchmark->getInstanceName(args);
+                if (std::regex_search(name, filter)) fmt::print("{}\n", name);
+            }
+        }
+        return 0;
+    }
+
+    return bench::runBenchmarks(options);
+}
+
+int main(int argc, char** argv)
+{
+    return catchAndReportAllExceptions([&]() { return runMain(argc, argv); });
+}
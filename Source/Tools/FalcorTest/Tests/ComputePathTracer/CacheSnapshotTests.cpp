@@ -0,0 +1,203 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/CacheSnapshot.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+std::vector<uint8_t> makeData(size_t size, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    // half of the bytes are zero like in a sparsely filled hash table
+    for (auto& value : data)
+        value = rng() % 2 == 0 ? 0 : uint8_t(rng());
+    return data;
+}
+} // namespace
+
+CPU_TEST(CacheSnapshot_Key)
+{
+    const std::map<std::string, std::string> defines = {{"HC_HASHMAP_SIZE", "4194304"}, {"USE_RHC", "1"}};
+    const auto key = CacheSnapshot::computeKey("scene.pyscene", defines);
+    EXPECT(key == CacheSnapshot::computeKey("scene.pyscene", defines));
+
+    auto otherDefines = defines;
+    otherDefines["HC_HASHMAP_SIZE"] = "1048576";
+    EXPECT(key != CacheSnapshot::computeKey("scene.pyscene", otherDefines));
+    EXPECT(key != CacheSnapshot::computeKey("other.pyscene", defines));
+    // names and values are separated, so shifting characters between them changes the key
+    EXPECT(CacheSnapshot::computeKey("", {{"AB", "C"}}) != CacheSnapshot::computeKey("", {{"A", "BC"}}));
+}
+
+CPU_TEST(CacheSnapshot_KeyDefines)
+{
+    const std::map<std::string, std::string> defines = {
+        {"HC_HASHMAP_SIZE", "4194304"},
+        {"HC_DEBUG_VOXELS", "1"},
+        {"NN_LAYER_WIDTH", "64"},
+        {"NN_DEBUG", "1"},
+        {"FEATURE_HASH_GRID_SIZE", "1024"},
+        {"MLP_COUNT", "2"},
+        {"USE_RHC", "1"},
+        {"USE_NIRC", "0"},
+        {"USE_NEE", "1"},
+        {"IR_DEBUG_OUTPUT_WIDTH", "512"},
+        {"CACHE_STATS", "1"},
+        {"is_valid_gViewW", "1"},
+    };
+    const auto keyDefines = CacheSnapshot::getKeyDefines(defines);
+    const std::map<std::string, std::string> expected = {
+        {"HC_HASHMAP_SIZE", "4194304"},
+        {"NN_LAYER_WIDTH", "64"},
+        {"FEATURE_HASH_GRID_SIZE", "1024"},
+        {"MLP_COUNT", "2"},
+        {"USE_RHC", "1"},
+        {"USE_NIRC", "0"},
+    };
+    EXPECT(keyDefines == expected);
+
+    // toggling a debug or output define keeps the key
+    auto debugDefines = defines;
+    debugDefines["HC_DEBUG_VOXELS"] = "0";
+    debugDefines["NN_DEBUG"] = "0";
+    debugDefines["CACHE_STATS"] = "0";
+    debugDefines["is_valid_gViewW"] = "0";
+    EXPECT(CacheSnapshot::computeKey("scene", CacheSnapshot::getKeyDefines(debugDefines)) == CacheSnapshot::computeKey("scene", keyDefines));
+}
+
+CPU_TEST(CacheSnapshot_RoundTrip)
+{
+    const auto path = std::filesystem::temp_directory_path() / "FalcorTest" / "CacheSnapshot_RoundTrip.hcsnap";
+    CacheSnapshot snapshot;
+    snapshot.setKey(CacheSnapshot::computeKey("scene", {{"USE_RHC", "1"}}));
+    // larger than an lz4 block
+    snapshot.setSection("HCVoxelData0", makeData(3 * 1024 * 1024 + 17, 1));
+    snapshot.setSection("NNPrimal", makeData(1000, 2));
+    snapshot.setSection("Empty", {});
+    snapshot.setValue("FrameCount", uint32_t(1234));
+    snapshot.write(path);
+
+    const CacheSnapshot loaded = CacheSnapshot::read(path);
+    EXPECT(loaded.getKey() == snapshot.getKey());
+    EXPECT_EQ(loaded.getSections().size(), snapshot.getSections().size());
+    for (const auto& [name, data] : snapshot.getSections())
+    {
+        EXPECT(loaded.hasSection(name)) << name;
+        EXPECT(loaded.getSection(name) == data) << name;
+    }
+    EXPECT_EQ(loaded.getValue<uint32_t>("FrameCount"), 1234u);
+    EXPECT_THROW(loaded.getValue<uint64_t>("FrameCount"));
+    EXPECT_THROW(loaded.getSection("Missing"));
+
+    // the sparse data is stored compressed
+    EXPECT_LT(std::filesystem::file_size(path), 3u * 1024 * 1024);
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(CacheSnapshot_InvalidFiles)
+{
+    const auto dir = std::filesystem::temp_directory_path() / "FalcorTest";
+    EXPECT_THROW(CacheSnapshot::read(dir / "CacheSnapshot_Missing.hcsnap"));
+
+    CacheSnapshot snapshot;
+    snapshot.setSection("HCVoxelData0", makeData(64 * 1024, 3));
+    const auto path = dir / "CacheSnapshot_InvalidFiles.hcsnap";
+    snapshot.write(path);
+    const auto size = std::filesystem::file_size(path);
+
+    // a different format version is rejected
+    {
+        std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        fs.seekp(8);
+        const uint32_t version = CacheSnapshot::kVersion + 1;
+        fs.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    EXPECT_THROW(CacheSnapshot::read(path));
+
+    // a truncated file is rejected
+    snapshot.write(path);
+    std::filesystem::resize_file(path, size / 2);
+    EXPECT_THROW(CacheSnapshot::read(path));
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(CacheSnapshot_CorruptSizes)
+{
+    const auto path = std::filesystem::temp_directory_path() / "FalcorTest" / "CacheSnapshot_CorruptSizes.hcsnap";
+    const std::string name = "HCVoxelData0";
+    // random bytes do not compress, so the sizes around the name are stored as is in the lz4 block
+    std::vector<uint8_t> data(256 * 1024);
+    std::mt19937 rng(4);
+    for (auto& value : data)
+        value = uint8_t(rng());
+    CacheSnapshot snapshot;
+    snapshot.setSection(name, data);
+
+    // the name size is stored in front of the name, the data size behind it
+    const auto writeCorruptSize = [&](int64_t offsetFromName, uint64_t size)
+    {
+        snapshot.write(path);
+        std::vector<char> bytes(std::filesystem::file_size(path));
+        {
+            std::ifstream fs(path, std::ios_base::binary);
+            fs.read(bytes.data(), bytes.size());
+        }
+        const auto it = std::search(bytes.begin(), bytes.end(), name.begin(), name.end());
+        if (it == bytes.end()) return false;
+        std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        fs.seekp(std::distance(bytes.begin(), it) + offsetFromName);
+        fs.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        return true;
+    };
+
+    ASSERT(writeCorruptSize(-8, name.size()));
+    EXPECT(CacheSnapshot::read(path).getSection(name) == data);
+
+    // a corrupt size is reported as an error of the file, not as a failed allocation
+    ASSERT(writeCorruptSize(-8, 1ull << 40));
+    EXPECT_THROW_AS(CacheSnapshot::read(path), RuntimeError);
+    ASSERT(writeCorruptSize(name.size(), 1ull << 40));
+    EXPECT_THROW_AS(CacheSnapshot::read(path), RuntimeError);
+    ASSERT(writeCorruptSize(name.size(), ~0ull));
+    EXPECT_THROW_AS(CacheSnapshot::read(path), RuntimeError);
+
+    // names are bounded on write as well
+    snapshot.setSection(std::string(1000, 'x'), {});
+    EXPECT_THROW(snapshot.write(path));
+    std::filesystem::remove(path);
+}
+} // namespace Falcor
@@ -0,0 +1,107 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/CacheStats.h"
+
+#include <array>
+#include <cmath>
+#include <random>
+
+namespace Falcor
+{
+CPU_TEST(CacheStats_Decode)
+{
+    std::array<uint32_t, CacheStats::kWordCount> words{};
+    words[CacheStats::kOccupiedSlotsWord] = 256;
+    words[CacheStats::kFailedInsertsWord] = 3;
+    words[CacheStats::kProbeSumWord] = 384;
+    words[CacheStats::kMaxProbeCountWord] = 7;
+    words[CacheStats::kFeatureGridParamsWord] = 1000;
+    words[CacheStats::kFeatureGridGradientsWord] = 250;
+    words[CacheStats::kLevelWord + 2] = 200;
+    words[CacheStats::kLevelWord + 5] = 56;
+
+    const CacheStats stats = CacheStats::decode(words.data(), 1024);
+    EXPECT_EQ(stats.capacity, 1024u);
+    EXPECT_EQ(stats.occupiedSlots, 256u);
+    EXPECT_EQ(stats.failedInserts, 3u);
+    EXPECT_EQ(stats.maxProbeCount, 7u);
+    EXPECT_EQ(stats.getLoadFactor(), 0.25f);
+    EXPECT_EQ(stats.getAverageProbeCount(), 1.5f);
+    EXPECT_EQ(stats.getGradientSparsity(), 0.75f);
+    // the levels above the highest one with keys are dropped
+    EXPECT_EQ(stats.levelOccupiedSlots.size(), 6u);
+    EXPECT_EQ(stats.levelOccupiedSlots[2], 200u);
+    EXPECT_EQ(stats.levelOccupiedSlots[5], 56u);
+
+    // a frame without hash cache and training
+    const CacheStats empty = CacheStats::decode(std::array<uint32_t, CacheStats::kWordCount>{}.data(), 0);
+    EXPECT_EQ(empty.getLoadFactor(), 0.f);
+    EXPECT_EQ(empty.getAverageProbeCount(), 0.f);
+    EXPECT_EQ(empty.getGradientSparsity(), 0.f);
+    EXPECT(empty.levelOccupiedSlots.empty());
+}
+
+CPU_TEST(CacheStats_AccumulateGrid)
+{
+    using ProbingScheme = RadianceHashGrid::ProbingScheme;
+    const RadianceHashGrid::Layout layout = RadianceHashGrid::Layout::rhc();
+    const uint32_t levelShift = 2 * layout.directionBitNum + 3 * layout.positionBitNum;
+    for (ProbingScheme scheme : {ProbingScheme::Linear, ProbingScheme::BoundedDisplacement, ProbingScheme::Bucketized})
+    {
+        RadianceHashGrid grid(layout, 4096, scheme);
+        std::mt19937_64 rng(3);
+        for (uint32_t i = 0; i < 3584; i++)
+        {
+            // mostly low levels, a few above the last level counter
+            const uint64_t level = i % 16 == 0 ? 64 + rng() % 64 : rng() % 12;
+            grid.insertEntry((rng() & ((uint64_t(1) << levelShift) - 1)) | (level << levelShift) | 1);
+        }
+
+        std::array<uint32_t, CacheStats::kWordCount> words{};
+        CacheStats::accumulate(grid, words.data());
+        const CacheStats stats = CacheStats::decode(words.data(), grid.getCapacity());
+        const RadianceHashGrid::Stats gridStats = grid.computeStats();
+        EXPECT_EQ(stats.occupiedSlots, gridStats.occupiedSlots) << "scheme " << uint32_t(scheme);
+        EXPECT_LT(std::abs(stats.getAverageProbeCount() - gridStats.getAverageProbeCount()), 1e-4f) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(stats.maxProbeCount, gridStats.getMaxProbeCount()) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(stats.levelOccupiedSlots.size(), CacheStats::kLevelCount) << "scheme " << uint32_t(scheme);
+        uint32_t highLevelSlots = 0;
+        for (uint32_t level = 0; level < gridStats.levels.size(); level++)
+        {
+            if (level < CacheStats::kLevelCount - 1)
+                EXPECT_EQ(stats.levelOccupiedSlots[level], gridStats.levels[level].occupiedSlots) << "scheme " << uint32_t(scheme) << " level " << level;
+            else
+                highLevelSlots += gridStats.levels[level].occupiedSlots;
+        }
+        // the keys above the counted levels end up in the last counter
+        EXPECT_EQ(stats.levelOccupiedSlots.back(), highLevelSlots) << "scheme " << uint32_t(scheme);
+        EXPECT_GT(highLevelSlots, 0u);
+    }
+}
+} // namespace Falcor
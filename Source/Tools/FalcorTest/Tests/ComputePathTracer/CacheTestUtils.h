@@ -0,0 +1,61 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Host/RadianceHashCache.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Find count distinct keys, starting at 1, whose home slot is the given slot.
+ * @param[in] getSlot Callable mapping a key to its home slot.
+ */
+template<typename GetSlot>
+inline std::vector<uint64_t> findCollidingKeys(const GetSlot& getSlot, uint32_t slot, size_t count)
+{
+    std::vector<uint64_t> keys;
+    for (uint64_t key = 1; keys.size() < count; key++)
+    {
+        if (getSlot(key) == slot) keys.push_back(key);
+    }
+    return keys;
+}
+
+/// Hit at the given position, facing up and looked at along +z.
+inline RadianceHashCache::HitData makeHit(float3 position)
+{
+    RadianceHashCache::HitData hit;
+    hit.distance = 1.f;
+    hit.positionWorld = position;
+    hit.normalWorld = float3(0.f, 1.f, 0.f);
+    hit.direction = float3(0.f, 0.f, 1.f);
+    return hit;
+}
+} // namespace Falcor
@@ -0,0 +1,746 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "CacheTestUtils.h"
+#include "Host/RadianceHashCache.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using HashKey = RadianceHashGrid::HashKey;
+
+HashKey packKey(const RadianceHashGrid::Layout& layout, HashKey normalBits, HashKey level, int3 pos, uint2 dir)
+{
+    const HashKey positionMask = layout.getPositionBitMask();
+    HashKey key = normalBits;
+    key = (key << layout.levelBitNum) | level;
+    key = (key << layout.positionBitNum) | (HashKey(uint32_t(pos.z)) & positionMask);
+    key = (key << layout.positionBitNum) | (HashKey(uint32_t(pos.y)) & positionMask);
+    key = (key << layout.positionBitNum) | (HashKey(uint32_t(pos.x)) & positionMask);
+    key = (key << layout.directionBitNum) | dir.y;
+    key = (key << layout.directionBitNum) | dir.x;
+    return key;
+}
+
+/// Find count distinct keys that share the given home slot.
+std::vector<HashKey> findCollidingKeys(const RadianceHashGrid& grid, uint32_t slot, size_t count)
+{
+    return Falcor::findCollidingKeys([&](HashKey key) { return grid.getSlot(key); }, slot, count);
+}
+} // namespace
+
+CPU_TEST(RadianceHashGrid_Hash)
+{
+    // reference values computed independently from the shader source
+    EXPECT_EQ(RadianceHashGrid::hashJenkins32(0x0), 0x6b4ed927u);
+    EXPECT_EQ(RadianceHashGrid::hashJenkins32(0x1), 0xb48681b6u);
+    EXPECT_EQ(RadianceHashGrid::hashJenkins32(0xdeadbeef), 0x7ff0eadau);
+    EXPECT_EQ(RadianceHashGrid::hashJenkins32(0xffffffff), 0xfe64c182u);
+    EXPECT_EQ(RadianceHashGrid::hash32(0x123456789abcdef0ull), 0x3b8b2109u);
+}
+
+CPU_TEST(RadianceHashGrid_SpatialHash)
+{
+    {
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024);
+        EXPECT_EQ(grid.getGridLevel(1.f), 2u);
+        EXPECT_EQ(grid.getGridLevel(1000.f), 11u);
+        EXPECT_EQ(grid.getGridLevel(1e-6f), 1u);
+        EXPECT_EQ(grid.getGridLevel(0.f), 1u);
+
+        // positions away from voxel borders on all tested levels to stay clear of rounding differences
+        const float3 position = float3(30.25f, -10.25f, 100.25f) / 60.f;
+        const HashKey key = grid.computeSpatialHash(1.f, position, float3(0.f, 0.f, 1.f), float3(1.f, -1.f, 1.f));
+        EXPECT_EQ(key, packKey(grid.getLayout(), 5, 2, int3(30, -11, 100), uint2(0)));
+        const HashKey coarseKey = grid.computeSpatialHash(1.f, position, float3(0.f, 0.f, 1.f), float3(1.f, -1.f, 1.f), 1);
+        EXPECT_EQ(coarseKey, packKey(grid.getLayout(), 5, 3, int3(15, -6, 50), uint2(0)));
+    }
+    {
+        RadianceHashGrid grid(RadianceHashGrid::Layout::irhc(), 1024);
+        const float3 position = float3(30.25f, -10.25f, 100.25f) / 45.f;
+        const float3 direction = normalize(float3(1.f, 1.f, 0.f));
+        const HashKey key = grid.computeSpatialHash(1.f, position, direction, float3(-1.f, 1.f, -1.f));
+        EXPECT_EQ(key, packKey(grid.getLayout(), 2, 2, int3(30, -11, 100), uint2(4, 3)));
+        const HashKey fineKey = grid.computeSpatialHash(1.f, position, direction, float3(-1.f, 1.f, -1.f), -1);
+        EXPECT_EQ(fineKey, packKey(grid.getLayout(), 2, 1, int3(60, -21, 200), uint2(4, 3)));
+    }
+}
+
+CPU_TEST(RadianceHashGrid_FitScene)
+{
+    const float3 sceneMin(-500.f, -20.f, -500.f);
+    const float3 sceneMax(500.f, 80.f, 500.f);
+    const float minDistance = 0.1f;
+    const float maxDistance = length(sceneMax - sceneMin);
+    for (const RadianceHashGrid::Layout& base : {RadianceHashGrid::Layout::rhc(), RadianceHashGrid::Layout::irhc()})
+    {
+        const RadianceHashGrid::Layout layout = RadianceHashGrid::Layout::fitScene(base, sceneMin, sceneMax, minDistance, maxDistance, 1);
+        EXPECT_LE(layout.getKeyBitNum(), 64u);
+        EXPECT_EQ(layout.directionBitNum, base.directionBitNum);
+        EXPECT_EQ(layout.sceneScale, base.sceneScale);
+        // the training spread around the farthest hits fits the level bits
+        EXPECT_LE(layout.getGridLevel(maxDistance) + 1, layout.getLevelBitMask());
+        // the voxel size at a distance is the one of the fixed layout, apart from the closest hits that would alias
+        for (float distance : {4.f, 20.f, 100.f})
+            EXPECT_EQ(layout.getVoxelSize(layout.getGridLevel(distance)), base.getVoxelSize(base.getGridLevel(distance))) << "distance=" << distance;
+        EXPECT_GE(layout.getVoxelSize(layout.getGridLevel(minDistance)), base.getVoxelSize(base.getGridLevel(minDistance)));
+
+        // the finest level covers the scene without wrapping and starts at the scene minimum
+        const RadianceHashGrid grid(layout, 1024);
+        const int4 lo = grid.calculateGridPositionLog(minDistance, sceneMin, -1);
+        const int4 hi = grid.calculateGridPositionLog(minDistance, sceneMax, -1);
+        EXPECT_EQ(lo.w, 0);
+        EXPECT(lo.x == 0 && lo.y == 0 && lo.z == 0);
+        EXPECT_LT(uint64_t(hi.x), uint64_t(1) << layout.positionBitNum);
+        EXPECT_LT(uint64_t(hi.z), uint64_t(1) << layout.positionBitNum);
+    }
+
+    EXPECT_THROW(RadianceHashGrid::Layout::fitScene(RadianceHashGrid::Layout::rhc(), sceneMin, sceneMax, 0.f, maxDistance, 1));
+    EXPECT_THROW(RadianceHashGrid::Layout::fitScene(RadianceHashGrid::Layout::rhc(), sceneMax, sceneMin, minDistance, maxDistance, 1));
+}
+
+CPU_TEST(RadianceHashGrid_KeyCollisionRate)
+{
+    const float minDistance = 0.1f;
+    {
+        // a room fits the fixed layout
+        const float3 sceneMin(-5.f, 0.f, -5.f);
+        const float3 sceneMax(5.f, 3.f, 5.f);
+        EXPECT_EQ(RadianceHashGrid::Layout::rhc().estimateCollisionRate(sceneMin, sceneMax, minDistance, 20.f, 1), 0.f);
+    }
+    {
+        // a 20 km exterior wraps around the position bits of the fixed layouts, the fitted ones do not
+        const float3 sceneMin(-10000.f, 0.f, -10000.f);
+        const float3 sceneMax(10000.f, 500.f, 10000.f);
+        const float maxDistance = length(sceneMax - sceneMin);
+        for (const RadianceHashGrid::Layout& base : {RadianceHashGrid::Layout::rhc(), RadianceHashGrid::Layout::irhc()})
+        {
+            const float baseRate = base.estimateCollisionRate(sceneMin, sceneMax, minDistance, maxDistance, 1);
+            EXPECT_GT(baseRate, 0.2f);
+            EXPECT_LE(baseRate, 1.f);
+            const RadianceHashGrid::Layout layout = RadianceHashGrid::Layout::fitScene(base, sceneMin, sceneMax, minDistance, maxDistance, 1);
+            EXPECT_EQ(layout.estimateCollisionRate(sceneMin, sceneMax, minDistance, maxDistance, 1), 0.f);
+        }
+    }
+    {
+        // a single wrap on one axis: 3 cells on 2 slots alias 2 of them
+        RadianceHashGrid::Layout layout = RadianceHashGrid::Layout::rhc();
+        layout.positionBitNum = 1;
+        // unit voxels on level 1
+        layout.sceneScale = 2.f;
+        layout.levelBias = 0;
+        const float rate = layout.estimateCollisionRate(float3(0.5f), float3(0.5f, 0.5f, 2.5f), 2.5f, 2.5f, 0);
+        EXPECT_EQ(layout.getGridLevel(2.5f), 1u);
+        EXPECT_LT(std::abs(rate - 2.f / 3.f), 1e-6f);
+    }
+}
+
+CPU_TEST(RadianceHashGrid_InsertFind)
+{
+    RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024);
+    const std::vector<HashKey> keys = findCollidingKeys(grid, 100, 3);
+    uint32_t probeCount = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        EXPECT_EQ(grid.insertEntry(keys[i], &probeCount), 100 + i);
+        EXPECT_EQ(probeCount, i + 1);
+    }
+    // inserting again returns the existing slot
+    EXPECT_EQ(grid.insertEntry(keys[1]), 101u);
+    for (size_t i = 0; i < keys.size(); i++)
+        EXPECT_EQ(grid.findEntry(keys[i]), 100 + i);
+
+    const HashKey missingKey = findCollidingKeys(grid, 100, 4).back();
+    EXPECT_EQ(grid.findEntry(missingKey, &probeCount), RadianceHashGrid::kInvalidIdx);
+    EXPECT_EQ(probeCount, grid.getLayout().bucketSize);
+
+    const RadianceHashGrid::Stats stats = grid.computeStats();
+    EXPECT_EQ(stats.occupiedSlots, 3u);
+    EXPECT_EQ(stats.probeHistogram[1], 1u);
+    EXPECT_EQ(stats.probeHistogram[2], 1u);
+    EXPECT_EQ(stats.probeHistogram[3], 1u);
+    EXPECT_EQ(stats.getMaxProbeCount(), 3u);
+    EXPECT_EQ(stats.getAverageProbeCount(), 2.f);
+
+    grid.reset();
+    EXPECT_EQ(grid.findEntry(keys[0]), RadianceHashGrid::kInvalidIdx);
+    EXPECT_EQ(grid.computeStats().occupiedSlots, 0u);
+}
+
+CPU_TEST(RadianceHashGrid_BucketLimits)
+{
+    RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024);
+    const uint32_t bucketSize = grid.getLayout().bucketSize;
+
+    // a full bucket rejects further keys
+    const std::vector<HashKey> keys = findCollidingKeys(grid, 0, bucketSize + 1);
+    for (uint32_t i = 0; i < bucketSize; i++)
+        EXPECT_EQ(grid.insertEntry(keys[i]), i);
+    EXPECT_EQ(grid.insertEntry(keys[bucketSize]), RadianceHashGrid::kInvalidIdx);
+    EXPECT_EQ(grid.computeStats().failedInserts, 1u);
+
+    // buckets wrap around at the end of the table
+    grid.reset();
+    const std::vector<HashKey> lastKeys = findCollidingKeys(grid, 1023, 2);
+    EXPECT_EQ(grid.insertEntry(lastKeys[0]), 1023u);
+    EXPECT_EQ(grid.insertEntry(lastKeys[1]), 0u);
+    EXPECT_EQ(grid.findEntry(lastKeys[1]), 0u);
+    EXPECT_EQ(grid.computeStats().failedInserts, 0u);
+}
+
+CPU_TEST(RadianceHashGrid_ProbingSchemes)
+{
+    using ProbingScheme = RadianceHashGrid::ProbingScheme;
+    for (ProbingScheme scheme : {ProbingScheme::Linear, ProbingScheme::BoundedDisplacement, ProbingScheme::Bucketized})
+    {
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 4096, scheme);
+        std::mt19937_64 rng(2);
+        std::vector<HashKey> keys(3584);
+        for (auto& key : keys)
+            key = rng() | 1;
+
+        std::vector<uint32_t> indices;
+        for (HashKey key : keys)
+            indices.push_back(grid.insertEntry(key));
+        const RadianceHashGrid::Stats stats = grid.computeStats();
+        EXPECT_EQ(stats.occupiedSlots + stats.failedInserts, keys.size()) << "scheme " << uint32_t(scheme);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            EXPECT_EQ(grid.findEntry(keys[i]), indices[i]) << "scheme " << uint32_t(scheme);
+            EXPECT_EQ(grid.insertEntry(keys[i]), indices[i]) << "scheme " << uint32_t(scheme);
+        }
+        for (size_t i = 0; i < 1000; i++)
+            EXPECT_EQ(grid.findEntry(rng() & ~HashKey(1)), RadianceHashGrid::kInvalidIdx) << "scheme " << uint32_t(scheme);
+    }
+
+    // the bucket wraps around the end of the table for all schemes
+    for (ProbingScheme scheme : {ProbingScheme::BoundedDisplacement, ProbingScheme::Bucketized})
+    {
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024, scheme);
+        const uint32_t lastSlot = scheme == ProbingScheme::Bucketized ? 1024 - RadianceHashGrid::kGroupSize : 1023;
+        const std::vector<HashKey> keys = findCollidingKeys(grid, lastSlot, 10);
+        for (size_t i = 0; i < keys.size(); i++)
+            EXPECT_EQ(grid.insertEntry(keys[i]), (lastSlot + i) % 1024) << "scheme " << uint32_t(scheme);
+        for (size_t i = 0; i < keys.size(); i++)
+            EXPECT_EQ(grid.findEntry(keys[i]), (lastSlot + i) % 1024) << "scheme " << uint32_t(scheme);
+    }
+}
+
+CPU_TEST(RadianceHashGrid_ProbeCounts)
+{
+    using ProbingScheme = RadianceHashGrid::ProbingScheme;
+    uint32_t probeCount = 0;
+    {
+        // the displacement mask only points at slots that hold keys of the same home slot
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024, ProbingScheme::BoundedDisplacement);
+        EXPECT_EQ(grid.findEntry(1, &probeCount), RadianceHashGrid::kInvalidIdx);
+        EXPECT_EQ(probeCount, 1u);
+        const std::vector<HashKey> keys = findCollidingKeys(grid, 100, 4);
+        // a foreign key in between is skipped by lookups
+        EXPECT_EQ(grid.insertEntry(findCollidingKeys(grid, 101, 1)[0]), 101u);
+        for (size_t i = 0; i < 3; i++)
+            grid.insertEntry(keys[i]);
+        EXPECT_EQ(grid.findEntry(keys[2], &probeCount), 103u);
+        EXPECT_EQ(probeCount, 4u);
+        EXPECT_EQ(grid.findEntry(keys[3], &probeCount), RadianceHashGrid::kInvalidIdx);
+        EXPECT_EQ(probeCount, 4u);
+        // inserting a present key only costs the lookup
+        EXPECT_EQ(grid.insertEntry(keys[0], &probeCount), 100u);
+        EXPECT_EQ(probeCount, 2u);
+    }
+    {
+        // lookups stop at the first group with a free slot
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024, ProbingScheme::Bucketized);
+        const uint32_t groupSize = RadianceHashGrid::kGroupSize;
+        const std::vector<HashKey> keys = findCollidingKeys(grid, 64, groupSize + 2);
+        for (uint32_t i = 0; i <= groupSize; i++)
+            EXPECT_EQ(grid.insertEntry(keys[i]), 64 + i);
+        EXPECT_EQ(grid.findEntry(keys[groupSize], &probeCount), 64 + groupSize);
+        EXPECT_GE(probeCount, 3u);
+        EXPECT_EQ(grid.findEntry(keys[groupSize + 1], &probeCount), RadianceHashGrid::kInvalidIdx);
+        EXPECT_LE(probeCount, 2u + 2 * groupSize);
+        EXPECT_EQ(grid.computeStats().occupiedSlots, groupSize + 1);
+    }
+}
+
+CPU_TEST(RadianceHashGrid_ConcurrentInsert)
+{
+    using ProbingScheme = RadianceHashGrid::ProbingScheme;
+    std::mt19937_64 rng(1);
+    std::vector<HashKey> keys(20000);
+    for (auto& key : keys)
+        key = rng() | 1;
+
+    for (ProbingScheme scheme : {ProbingScheme::Linear, ProbingScheme::BoundedDisplacement, ProbingScheme::Bucketized})
+    {
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1 << 16, scheme);
+        const uint32_t threadCount = 8;
+        std::vector<std::vector<uint32_t>> indices(threadCount);
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back(
+                [&, t]()
+                {
+                    // every thread inserts all keys in a different order
+                    for (size_t i = 0; i < keys.size(); i++)
+                        indices[t].push_back(grid.insertEntry(keys[(i * (t + 1) * 7919) % keys.size()]));
+                }
+            );
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        std::set<HashKey> storedKeys;
+        for (uint32_t i = 0; i < grid.getCapacity(); i++)
+        {
+            const HashKey key = grid.getEntry(i);
+            if (key == RadianceHashGrid::kInvalidHashKey) continue;
+            EXPECT(storedKeys.insert(key).second) << "Key stored twice with scheme " << uint32_t(scheme) << ".";
+        }
+        EXPECT_EQ(grid.computeStats().occupiedSlots, keys.size()) << "scheme " << uint32_t(scheme);
+        for (uint32_t t = 0; t < threadCount; t++)
+        {
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                const HashKey key = keys[(i * (t + 1) * 7919) % keys.size()];
+                EXPECT_EQ(grid.getEntry(indices[t][i]), key) << "scheme " << uint32_t(scheme);
+                // the metadata has to be complete once all inserts returned
+                EXPECT_EQ(grid.findEntry(key), indices[t][i]) << "scheme " << uint32_t(scheme);
+            }
+        }
+    }
+}
+
+CPU_TEST(RadianceHashGrid_Eviction)
+{
+    using ProbingScheme = RadianceHashGrid::ProbingScheme;
+    for (ProbingScheme scheme : {ProbingScheme::Linear, ProbingScheme::BoundedDisplacement, ProbingScheme::Bucketized})
+    {
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024, scheme);
+        grid.setMaxAge(2);
+        const std::vector<HashKey> keys = findCollidingKeys(grid, 64, 4);
+        for (size_t i = 0; i < 3; i++)
+            EXPECT_EQ(grid.insertEntry(keys[i]), 64 + i) << "scheme " << uint32_t(scheme);
+
+        // only the key touched within the last two frames survives
+        grid.setFrameIndex(3);
+        EXPECT_EQ(grid.insertEntry(keys[1]), 65u) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(grid.getStamp(65), 3u);
+        EXPECT(grid.isStale(64)) << "scheme " << uint32_t(scheme);
+        EXPECT(!grid.isStale(65)) << "scheme " << uint32_t(scheme);
+        EXPECT(!grid.isStale(67)) << "empty slots are never stale";
+        grid.evictEntry(64);
+        grid.evictEntry(66);
+        EXPECT_EQ(grid.computeStats().evictedEntries, 2u);
+        EXPECT_EQ(grid.computeStats().occupiedSlots, 1u);
+
+        // keys behind the freed slot stay reachable and are not inserted a second time
+        EXPECT_EQ(grid.findEntry(keys[0]), RadianceHashGrid::kInvalidIdx) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(grid.findEntry(keys[1]), 65u) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(grid.insertEntry(keys[1]), 65u) << "scheme " << uint32_t(scheme);
+        // freed slots are reused
+        EXPECT_EQ(grid.insertEntry(keys[3]), 64u) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(grid.insertEntry(keys[0]), 66u) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(grid.findEntry(keys[0]), 66u) << "scheme " << uint32_t(scheme);
+        EXPECT_EQ(grid.findEntry(keys[3]), 64u) << "scheme " << uint32_t(scheme);
+    }
+
+    {
+        // evicted slots of the bucketized scheme are tombstones, lookups continue into the next group
+        RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 1024, ProbingScheme::Bucketized);
+        grid.setMaxAge(1);
+        const uint32_t groupSize = RadianceHashGrid::kGroupSize;
+        const std::vector<HashKey> keys = findCollidingKeys(grid, 128, groupSize + 1);
+        for (uint32_t i = 0; i <= groupSize; i++)
+            EXPECT_EQ(grid.insertEntry(keys[i]), 128 + i);
+        grid.evictEntry(130);
+        EXPECT_EQ(grid.findEntry(keys[groupSize]), 128 + groupSize);
+        EXPECT_EQ(grid.insertEntry(keys[groupSize]), 128 + groupSize);
+    }
+}
+
+CPU_TEST(RadianceHashGrid_DirtySlots)
+{
+    RadianceHashGrid grid(RadianceHashGrid::Layout::rhc(), 256);
+    grid.setTrackDirtySlots(true);
+    // the first frame after a reset has index 0, which must still differ from the stamp of an empty slot
+    const uint32_t idx0 = grid.insertEntry(1);
+    const uint32_t idx1 = grid.insertEntry(2);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(grid.insertEntry(1), idx0);
+        EXPECT_EQ(grid.insertEntry(2), idx1);
+    }
+    EXPECT_EQ(grid.getDirtySlotCount(), 2u);
+    EXPECT_EQ(grid.getDirtySlot(0), idx0);
+    EXPECT_EQ(grid.getDirtySlot(1), idx1);
+
+    // every frame lists each inserted slot once
+    grid.setFrameIndex(1);
+    grid.clearDirtySlots();
+    EXPECT_EQ(grid.getDirtySlotCount(), 0u);
+    grid.insertEntry(2);
+    grid.insertEntry(2);
+    EXPECT_EQ(grid.getDirtySlotCount(), 1u);
+    EXPECT_EQ(grid.getDirtySlot(0), idx1);
+
+    // concurrent inserts of the same keys append every slot exactly once
+    grid.setFrameIndex(2);
+    grid.clearDirtySlots();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (HashKey key = 1; key <= 100; key++)
+                    grid.insertEntry(key);
+            }
+        );
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(grid.getDirtySlotCount(), 100u);
+    std::set<uint32_t> slots;
+    for (uint32_t i = 0; i < grid.getDirtySlotCount(); i++)
+        slots.insert(grid.getDirtySlot(i));
+    EXPECT_EQ(slots.size(), 100u);
+}
+
+CPU_TEST(RadianceHashGrid_LevelTables)
+{
+    using ProbingScheme = RadianceHashGrid::ProbingScheme;
+    const float3 sceneMin(-50.f, 0.f, -50.f);
+    const float3 sceneMax(50.f, 20.f, 50.f);
+    const RadianceHashGrid::Layout layout = RadianceHashGrid::Layout::rhc();
+    const float maxDistance = length(sceneMax - sceneMin);
+    const RadianceHashGrid::LevelTables levelTables = RadianceHashGrid::LevelTables::fitScene(layout, 1 << 20, sceneMin, sceneMax, 0.1f, maxDistance, 1);
+    // levels 0 to the level of the farthest hits plus the spread
+    EXPECT_EQ(levelTables.firstLevel, 0u);
+    EXPECT_EQ(levelTables.getTableCount(), layout.getGridLevel(maxDistance) + 2);
+    EXPECT_EQ(levelTables.offsets.front(), 0u);
+    EXPECT_EQ(levelTables.offsets.back(), 1u << 20);
+    std::vector<uint32_t> sizes;
+    for (uint32_t i = 0; i < levelTables.getTableCount(); i++)
+    {
+        sizes.push_back(levelTables.offsets[i + 1] - levelTables.offsets[i]);
+        EXPECT_GT(sizes.back(), 0u);
+        EXPECT_EQ(sizes.back() % layout.bucketSize, 0u);
+    }
+    // the coarsest levels are limited by the scene surface
+    const uint32_t maxSize = *std::max_element(sizes.begin(), sizes.end());
+    EXPECT_LT(sizes.back() * 4, maxSize);
+    EXPECT_LT(sizes[sizes.size() - 2] * 2, maxSize);
+    EXPECT_THROW(RadianceHashGrid::LevelTables::fitScene(layout, 1000, sceneMin, sceneMax, 0.1f, maxDistance, 1));
+    EXPECT_THROW(RadianceHashGrid::LevelTables::fitScene(layout, 64, sceneMin, sceneMax, 0.1f, maxDistance, 1));
+
+    for (ProbingScheme scheme : {ProbingScheme::Linear, ProbingScheme::BoundedDisplacement, ProbingScheme::Bucketized})
+    {
+        RadianceHashGrid grid(layout, 1 << 20, scheme);
+        grid.setLevelTables(levelTables);
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<int32_t> posDist(-2000, 2000);
+        std::uniform_int_distribution<uint32_t> levelDist(0, levelTables.getTableCount() + 2);
+        std::vector<HashKey> keys;
+        for (uint32_t i = 0; i < 4000; i++)
+            keys.push_back(packKey(layout, 5, levelDist(rng), int3(posDist(rng), posDist(rng), posDist(rng)), uint2(0)));
+
+        std::vector<uint32_t> indices;
+        for (HashKey key : keys)
+            indices.push_back(grid.insertEntry(key));
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (indices[i] == RadianceHashGrid::kInvalidIdx) continue;
+            // the levels above the last table share it
+            const uint32_t table = std::min(grid.getKeyLevel(keys[i]), levelTables.getTableCount() - 1);
+            EXPECT(indices[i] >= levelTables.offsets[table] && indices[i] < levelTables.offsets[table + 1]) << "scheme " << uint32_t(scheme);
+            EXPECT_EQ(grid.findEntry(keys[i]), indices[i]) << "scheme " << uint32_t(scheme);
+        }
+
+        const RadianceHashGrid::Stats stats = grid.computeStats();
+        EXPECT_EQ(stats.occupiedSlots + stats.failedInserts, keys.size()) << "scheme " << uint32_t(scheme);
+        uint64_t levelKeys = 0;
+        for (uint32_t level = 0; level < stats.levels.size(); level++)
+        {
+            const RadianceHashGrid::LevelStats& levelStats = stats.levels[level];
+            levelKeys += levelStats.occupiedSlots + levelStats.failedInserts;
+            const uint32_t table = std::min(level, levelTables.getTableCount() - 1);
+            EXPECT_EQ(levelStats.capacity, levelTables.offsets[table + 1] - levelTables.offsets[table]) << "level " << level;
+        }
+        EXPECT_EQ(levelKeys, keys.size());
+
+        // eviction clears the probing metadata within the table
+        for (size_t i = 0; i < keys.size(); i += 2)
+            if (indices[i] != RadianceHashGrid::kInvalidIdx) grid.evictEntry(indices[i]);
+        for (size_t i = 1; i < keys.size(); i += 2)
+            if (indices[i] != RadianceHashGrid::kInvalidIdx) EXPECT_EQ(grid.findEntry(keys[i]), indices[i]) << "scheme " << uint32_t(scheme);
+    }
+
+    {
+        // without level tables every level reports the whole table
+        RadianceHashGrid grid(layout, 1024);
+        grid.insertEntry(packKey(layout, 5, 3, int3(1, 2, 3), uint2(0)));
+        const RadianceHashGrid::Stats stats = grid.computeStats();
+        EXPECT_EQ(stats.levels.size(), 4u);
+        EXPECT_EQ(stats.levels[3].occupiedSlots, 1u);
+        EXPECT_EQ(stats.levels[3].capacity, 1024u);
+        RadianceHashGrid::LevelTables invalid;
+        invalid.offsets = {0, 512, 1000};
+        EXPECT_THROW(grid.setLevelTables(invalid));
+    }
+}
+
+CPU_TEST(RadianceHashCache_ResolveRHC)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10);
+    const auto hit = makeHit(float3(0.5f, 0.25f, -0.75f));
+    const auto idx = cache.insertEntries(hit);
+    for (uint32_t i = 0; i < RadianceHashCache::kLevelTrainingSpread; i++)
+        EXPECT_NE(idx[i], RadianceHashGrid::kInvalidIdx);
+
+    cache.addVoxelData(idx, float3(1.f, 2.f, 3.f), true);
+    cache.addVoxelData(idx, float3(1.f, 2.f, -3.f), true);
+    cache.addVoxelData(idx, float3(0.f, 0.f, 3.f), false);
+    cache.resolve();
+    float3 radiance;
+    EXPECT(cache.getCachedRadiance(hit, radiance));
+    EXPECT_EQ(radiance, float3(1.f, 2.f, 3.f));
+    EXPECT_EQ(cache.getVoxelData(true, idx[1]).sampleNum, 2u);
+    // the resolve folded the delta of the frame into the estimate
+    EXPECT_EQ(cache.getVoxelData(false, idx[1]).sampleNum, 2u);
+    EXPECT_EQ(cache.getVoxelRadianceSum(idx[1]), float3(0.f));
+
+    cache.endFrame();
+    cache.addVoxelData(idx, float3(3.f), true);
+    cache.addVoxelData(idx, float3(3.f), true);
+    // the samples of the frame do not change the estimate before the resolve
+    EXPECT_EQ(cache.getVoxelData(false, idx[1]).sampleNum, 4u);
+    EXPECT_EQ(cache.getVoxelData(true, idx[1]).sampleNum, 2u);
+    EXPECT(cache.getCachedRadiance(hit, radiance));
+    EXPECT_EQ(radiance, float3(1.f, 2.f, 3.f));
+    cache.resolve();
+    EXPECT(cache.getCachedRadiance(hit, radiance));
+    const float weight = 2 * 0.001f;
+    EXPECT_EQ(radiance, (1 - weight) * float3(1.f, 2.f, 3.f) + weight * float3(3.f));
+    EXPECT_EQ(cache.getVoxelData(false, idx[1]).sampleNum, 4u);
+
+    // nothing new, the previous estimate is kept
+    cache.endFrame();
+    cache.resolve();
+    float3 keptRadiance;
+    EXPECT(cache.getCachedRadiance(hit, keptRadiance));
+    EXPECT_EQ(keptRadiance, radiance);
+
+    cache.reset();
+    EXPECT(!cache.getCachedRadiance(hit, radiance));
+}
+
+CPU_TEST(RadianceHashCache_ResolveIRHC)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::IRHC, 10);
+    const auto hit = makeHit(float3(0.5f, 0.25f, -0.75f));
+    const auto idx = cache.insertEntries(hit);
+
+    // below 32 samples the irhc keeps a running average
+    cache.addVoxelData(idx, float3(2.f), true);
+    cache.resolve();
+    cache.endFrame();
+    cache.addVoxelData(idx, float3(4.f), true);
+    cache.resolve();
+    float3 radiance;
+    EXPECT(cache.getCachedRadiance(hit, radiance));
+    EXPECT_EQ(radiance, float3(3.f));
+}
+
+CPU_TEST(RadianceHashCache_TrainingPath)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 12);
+    const auto hit0 = makeHit(float3(0.5f, 0.25f, -0.75f));
+    const auto hit1 = makeHit(float3(-2.5f, 1.25f, 3.75f));
+    RadianceHashCache::PathState state;
+    cache.updateHit(state, hit0, float3(0.f));
+    cache.setThroughput(state, float3(0.5f));
+    cache.updateHit(state, hit1, float3(0.f));
+    cache.setThroughput(state, float3(0.5f));
+    cache.updateMiss(state, float3(4.f));
+    EXPECT_EQ(state.pathLength, 2u);
+    cache.resolve();
+
+    // the rhc weights the radiance with the throughput of each vertex before adding it
+    float3 radiance;
+    EXPECT(cache.getCachedRadiance(hit1, radiance));
+    EXPECT_EQ(radiance, float3(2.f));
+    EXPECT(cache.getCachedRadiance(hit0, radiance));
+    EXPECT_EQ(radiance, float3(1.f));
+}
+
+CPU_TEST(RadianceHashCache_ConcurrentAccumulate)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10);
+    const auto idx = cache.insertEntries(makeHit(float3(0.f)));
+    const uint32_t threadCount = 8;
+    const uint32_t sampleCount = 1000;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (uint32_t i = 0; i < sampleCount; i++)
+                    cache.addVoxelData(idx, float3(1.f), true);
+            }
+        );
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    // integer sums stay exact in float, so no sample may have been lost
+    EXPECT_EQ(cache.getVoxelRadianceSum(idx[0]), float3(float(threadCount * sampleCount)));
+    EXPECT_EQ(cache.getVoxelData(false, idx[0]).sampleNum, threadCount * sampleCount);
+}
+
+CPU_TEST(RadianceHashCache_Eviction)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10);
+    cache.getHashGrid().setMaxAge(4);
+    const auto staleHit = makeHit(float3(0.5f, 0.25f, -0.75f));
+    const auto liveHit = makeHit(float3(-5.5f, 3.25f, 8.75f));
+    const auto staleIdx = cache.insertEntries(staleHit);
+    cache.addVoxelData(staleIdx, float3(1.f), true);
+    float3 radiance;
+    for (uint32_t frame = 0; frame < 6; frame++)
+    {
+        cache.addVoxelData(cache.insertEntries(liveHit), float3(2.f), true);
+        cache.resolve();
+        // the stale voxels are kept for maxAge frames after their last update
+        EXPECT_EQ(cache.getCachedRadiance(staleHit, radiance), frame <= 4) << "frame " << frame;
+        EXPECT(cache.getCachedRadiance(liveHit, radiance)) << "frame " << frame;
+        EXPECT_EQ(radiance, float3(2.f)) << "frame " << frame;
+        cache.endFrame();
+    }
+    EXPECT_EQ(cache.getHashGrid().computeStats().evictedEntries, RadianceHashCache::kLevelTrainingSpread);
+    for (uint32_t i = 0; i < RadianceHashCache::kLevelTrainingSpread; i++)
+    {
+        EXPECT_EQ(cache.getVoxelData(false, staleIdx[i]).sampleNum, 0u);
+        EXPECT_EQ(cache.getVoxelData(true, staleIdx[i]).sampleNum, 0u);
+    }
+
+    // a voxel inserted again starts from scratch
+    cache.addVoxelData(cache.insertEntries(staleHit), float3(3.f), true);
+    cache.resolve();
+    EXPECT(cache.getCachedRadiance(staleHit, radiance));
+    EXPECT_EQ(radiance, float3(3.f));
+}
+
+CPU_TEST(RadianceHashCache_IncrementalResolve)
+{
+    for (auto layout : {RadianceHashCache::VoxelLayout::Float, RadianceHashCache::VoxelLayout::Packed})
+    {
+        for (auto method : {RadianceHashCache::Method::RHC, RadianceHashCache::Method::IRHC})
+        {
+            RadianceHashCache fullCache(method, 12, RadianceHashGrid::ProbingScheme::Linear, layout);
+            RadianceHashCache incrementalCache(method, 12, RadianceHashGrid::ProbingScheme::Linear, layout);
+            incrementalCache.setIncrementalResolve(true);
+            std::mt19937 rng(4);
+            std::uniform_real_distribution<float> valueDist(0.f, 4.f);
+            for (uint32_t frame = 0; frame < 24; frame++)
+            {
+                // the training paths move through the scene, so most voxels are not touched every frame
+                std::uniform_real_distribution<float> positionDist(float(frame % 8) * 4.f, float(frame % 8) * 4.f + 6.f);
+                for (uint32_t path = 0; path < 64; path++)
+                {
+                    RadianceHashCache::PathState fullState;
+                    RadianceHashCache::PathState incrementalState;
+                    for (uint32_t vertex = 0; vertex < 3; vertex++)
+                    {
+                        const auto hit = makeHit(float3(positionDist(rng), positionDist(rng), positionDist(rng)));
+                        const float3 radiance(valueDist(rng), valueDist(rng), valueDist(rng));
+                        fullCache.updateHit(fullState, hit, radiance);
+                        incrementalCache.updateHit(incrementalState, hit, radiance);
+                        fullCache.setThroughput(fullState, float3(0.5f));
+                        incrementalCache.setThroughput(incrementalState, float3(0.5f));
+                    }
+                    const float3 radiance(valueDist(rng), valueDist(rng), valueDist(rng));
+                    fullCache.updateMiss(fullState, radiance);
+                    incrementalCache.updateMiss(incrementalState, radiance);
+                }
+                EXPECT_LT(incrementalCache.getHashGrid().getDirtySlotCount(), incrementalCache.getCapacity() / 4) << "frame " << frame;
+                fullCache.resolve();
+                incrementalCache.resolveDirty();
+
+                // untouched voxels are left as is by a full resolve, so both caches hold the same bits
+                for (uint32_t i = 0; i < fullCache.getCapacity(); i++)
+                {
+                    EXPECT_EQ(incrementalCache.getHashGrid().getEntry(i), fullCache.getHashGrid().getEntry(i)) << "slot " << i;
+                    const auto fullData = fullCache.getVoxelData(false, i);
+                    const auto incrementalData = incrementalCache.getVoxelData(false, i);
+                    EXPECT_EQ(incrementalData.radiance, fullData.radiance) << "frame " << frame << " slot " << i;
+                    EXPECT_EQ(incrementalData.sampleNum, fullData.sampleNum) << "frame " << frame << " slot " << i;
+                }
+                fullCache.endFrame();
+                incrementalCache.endFrame();
+            }
+        }
+    }
+}
+
+CPU_TEST(RadianceHashCache_IncrementalEviction)
+{
+    const uint32_t maxAge = 4;
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10, RadianceHashGrid::ProbingScheme::Linear, RadianceHashCache::VoxelLayout::Packed);
+    cache.setIncrementalResolve(true);
+    cache.getHashGrid().setMaxAge(maxAge);
+    const auto staleHit = makeHit(float3(0.5f, 0.25f, -0.75f));
+    const auto liveHit = makeHit(float3(-5.5f, 3.25f, 8.75f));
+    cache.addVoxelData(cache.insertEntries(staleHit), float3(1.f), true);
+    // a window of the table is tested every frame, so a stale entry is evicted at most maxAge frames late
+    const uint32_t windowSize = (cache.getCapacity() + maxAge - 1) / maxAge;
+    float3 radiance;
+    for (uint32_t frame = 0; frame < 2 * maxAge + 1; frame++)
+    {
+        cache.addVoxelData(cache.insertEntries(liveHit), float3(2.f), true);
+        cache.resolveDirty();
+        const uint32_t begin = (frame % maxAge) * windowSize;
+        cache.evict(begin, std::min(begin + windowSize, cache.getCapacity()));
+        if (frame <= maxAge) EXPECT(cache.getCachedRadiance(staleHit, radiance)) << "frame " << frame;
+        EXPECT(cache.getCachedRadiance(liveHit, radiance)) << "frame " << frame;
+        EXPECT_EQ(radiance, float3(2.f)) << "frame " << frame;
+        cache.endFrame();
+    }
+    EXPECT(!cache.getCachedRadiance(staleHit, radiance));
+    EXPECT_EQ(cache.getHashGrid().computeStats().evictedEntries, RadianceHashCache::kLevelTrainingSpread);
+}
+} // namespace Falcor
@@ -0,0 +1,143 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/TinynnDeferredQueries.h"
+
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+std::vector<DeferredQuery> createQueries(std::mt19937& rng, uint32_t count, uint2 frameDim)
+{
+    std::uniform_real_distribution<float> posDist(-4.f, 4.f);
+    std::normal_distribution<float> dirDist;
+    std::vector<DeferredQuery> queries(count);
+    for (uint32_t q = 0; q < count; q++)
+    {
+        DeferredQuery& query = queries[q];
+        query.pos = float3(posDist(rng), posDist(rng), posDist(rng));
+        query.dir = normalize(float3(dirDist(rng), dirDist(rng), dirDist(rng)));
+        query.normal = normalize(float3(dirDist(rng), dirDist(rng), dirDist(rng)));
+        query.weight = float3(0.5f, 0.25f, 1.f);
+        query.pixel = uint2(q % frameDim.x, (q / frameDim.x) % frameDim.y);
+    }
+    return queries;
+}
+} // namespace
+
+CPU_TEST(TinynnDeferredQueries_Append)
+{
+    // waves of different sizes, the header has to describe all queries like a single append would
+    uint4 header(0, 1, 1, 0);
+    uint32_t total = 0;
+    for (uint32_t waveQueryCount : {32u, 5u, 0u, 31u, 128u, 1u, 96u, 200u})
+    {
+        EXPECT_EQ(appendDeferredQueries(header, waveQueryCount), total);
+        total += waveQueryCount;
+        EXPECT_EQ(header.w, total);
+        EXPECT_EQ(header.x, (total + kDeferredQueryGroupSize - 1) / kDeferredQueryGroupSize) << "queries=" << total;
+    }
+    EXPECT_EQ(header.y, 1u);
+    EXPECT_EQ(header.z, 1u);
+}
+
+CPU_TEST(TinynnDeferredQueries_InferMatchesInline)
+{
+    std::mt19937 rng(7);
+    // more queries than one chunk of the batch inference
+    const uint32_t count = 5000;
+    const std::vector<DeferredQuery> queries = createQueries(rng, count, uint2(64, 64));
+
+    for (Encoding encoding : {Encoding::Hash, Encoding::HashInterpolation, Encoding::Frequency})
+    {
+        uint32_t offsetPrim = 0;
+        uint32_t offsetGrad = 0;
+        HalfMLP mlp(kFeatureWidth, 2, Activation::ReLU, offsetPrim, offsetGrad);
+        FeatureHashGrid::Desc desc;
+        desc.size = 1u << 16;
+        FeatureHashGrid grid(desc, offsetPrim, offsetGrad);
+        std::uniform_real_distribution<float> weightDist(-0.25f, 0.5f);
+        std::vector<float16_t> primal(offsetPrim);
+        for (auto& value : primal)
+            value = float16_t(weightDist(rng));
+        mlp.loadWeights(primal.data());
+
+        std::vector<float3> results(count);
+        inferDeferredQueries(encoding, &grid, primal.data(), mlp, queries.data(), count, results.data());
+
+        // evaluate every query on its own like the inline queries of the path tracer
+        std::vector<float16_t> feature(kFeatureWidth);
+        for (uint32_t q = 0; q < count; q += 97)
+        {
+            const DeferredQuery& query = queries[q];
+            QueryBatch batch;
+            batch.count = 1;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                batch.position[c] = &query.pos[c];
+                batch.direction[c] = &query.dir[c];
+                batch.normal[c] = &query.normal[c];
+            }
+            computeFeatures(encoding, &grid, primal.data(), batch, false, feature.data());
+            mlp.forward(feature.data(), feature.data(), 1);
+            for (uint32_t c = 0; c < 3; c++)
+                EXPECT_EQ(results[q][c], float(feature[c])) << "encoding=" << uint32_t(encoding) << " query=" << q << " c=" << c;
+        }
+    }
+}
+
+CPU_TEST(TinynnDeferredQueries_Resolve)
+{
+    const uint2 frameDim(4, 3);
+    std::vector<float4> image(frameDim.x * frameDim.y, float4(1.f, 2.f, 3.f, 1.f));
+    DeferredQuery queries[2] = {};
+    queries[0].pixel = uint2(1, 2);
+    queries[0].weight = float3(0.5f, 1.f, 2.f);
+    queries[1].pixel = uint2(3, 0);
+    queries[1].weight = float3(1.f);
+    const float3 results[2] = {float3(2.f, 4.f, 8.f), float3(-1.f, 0.f, 1.f)};
+    resolveDeferredQueries(queries, results, 2, frameDim, image.data());
+
+    for (uint32_t i = 0; i < image.size(); i++)
+    {
+        float4 expected(1.f, 2.f, 3.f, 1.f);
+        if (i == 2 * frameDim.x + 1) expected = float4(2.f, 6.f, 19.f, 1.f);
+        else if (i == 3) expected = float4(0.f, 2.f, 4.f, 1.f);
+        for (uint32_t c = 0; c < 4; c++)
+            EXPECT_EQ(image[i][c], expected[c]) << "pixel=" << i << " c=" << c;
+    }
+
+    queries[1].pixel = uint2(4, 0);
+    EXPECT_THROW(resolveDeferredQueries(queries, results, 2, frameDim, image.data()));
+}
+} // namespace Falcor
@@ -0,0 +1,181 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/TinynnExperts.h"
+
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+std::vector<DeferredQuery> createQueries(std::mt19937& rng, uint32_t count, uint32_t expertCount)
+{
+    std::uniform_real_distribution<float> posDist(-4.f, 4.f);
+    std::normal_distribution<float> dirDist;
+    std::vector<DeferredQuery> queries(count);
+    for (uint32_t q = 0; q < count; q++)
+    {
+        DeferredQuery& query = queries[q];
+        query.pos = float3(posDist(rng), posDist(rng), posDist(rng));
+        query.dir = normalize(float3(dirDist(rng), dirDist(rng), dirDist(rng)));
+        query.normal = normalize(float3(dirDist(rng), dirDist(rng), dirDist(rng)));
+        query.weight = float3(1.f);
+        query.pixel = uint2(q % 64, q / 64);
+        query.expert = rng() % expertCount;
+        // leave the second expert without queries
+        if (expertCount > 2 && query.expert == 1) query.expert = 0;
+    }
+    return queries;
+}
+} // namespace
+
+CPU_TEST(TinynnExperts_Route)
+{
+    // the x axis is the longest, four slabs of width 2
+    const ExpertRouter router = ExpertRouter::create(ExpertRouting::Spatial, 4, float3(-2.f, 0.f, 0.f), float3(6.f, 2.f, 1.f));
+    EXPECT_EQ(router.axis, 0u);
+    EXPECT_EQ(router.origin, -2.f);
+    EXPECT_EQ(router.scale, 0.5f);
+    EXPECT_EQ(router.route(float3(-1.5f, 5.f, 5.f), 3), 0u);
+    EXPECT_EQ(router.route(float3(0.f, 0.f, 0.f), 3), 1u);
+    EXPECT_EQ(router.route(float3(3.9f, 0.f, 0.f), 3), 2u);
+    EXPECT_EQ(router.route(float3(6.f, 0.f, 0.f), 3), 3u);
+    // outside of the bounds and nan use the closest slab
+    EXPECT_EQ(router.route(float3(-100.f, 0.f, 0.f), 3), 0u);
+    EXPECT_EQ(router.route(float3(100.f, 0.f, 0.f), 3), 3u);
+    EXPECT_EQ(router.route(float3(std::numeric_limits<float>::quiet_NaN(), 0.f, 0.f), 3), 0u);
+
+    const ExpertRouter zRouter = ExpertRouter::create(ExpertRouting::Spatial, 2, float3(0.f), float3(1.f, 1.f, 4.f));
+    EXPECT_EQ(zRouter.axis, 2u);
+    EXPECT_EQ(zRouter.route(float3(0.f, 0.f, 2.5f), 0), 1u);
+    // flat bounds put everything into the first slab
+    const ExpertRouter flatRouter = ExpertRouter::create(ExpertRouting::Spatial, 3, float3(1.f), float3(1.f));
+    EXPECT_EQ(flatRouter.route(float3(5.f), 0), 0u);
+
+    const ExpertRouter materialRouter = ExpertRouter::create(ExpertRouting::Material, 3, float3(0.f), float3(1.f));
+    for (uint32_t materialID = 0; materialID < 10; materialID++)
+        EXPECT_EQ(materialRouter.route(float3(0.5f), materialID), materialID % 3);
+
+    const ExpertRouter singleRouter = ExpertRouter::create(ExpertRouting::Material, 1, float3(0.f), float3(1.f));
+    EXPECT_EQ(singleRouter.route(float3(0.5f), 7), 0u);
+
+    EXPECT_THROW(ExpertRouter::create(ExpertRouting::Spatial, 0, float3(0.f), float3(1.f)));
+    EXPECT_THROW(ExpertRouter::create(ExpertRouting::Spatial, kMaxExperts + 1, float3(0.f), float3(1.f)));
+}
+
+CPU_TEST(TinynnExperts_Bin)
+{
+    std::mt19937 rng(3);
+    for (uint32_t expertCount = 1; expertCount <= kMaxExperts; expertCount++)
+    {
+        const uint32_t count = 1000;
+        const std::vector<DeferredQuery> queries = createQueries(rng, count, expertCount);
+        const ExpertBins bins = binDeferredQueries(queries.data(), count, expertCount);
+
+        uint32_t groupCount = 0;
+        for (uint32_t e = 0; e < expertCount; e++)
+        {
+            EXPECT_EQ(bins.offsets[e], groupCount * kDeferredQueryGroupSize) << "experts=" << expertCount << " e=" << e;
+            groupCount += (bins.counts[e] + kDeferredQueryGroupSize - 1) / kDeferredQueryGroupSize;
+        }
+        EXPECT_EQ(bins.getGroupCount(), groupCount) << "experts=" << expertCount;
+        if (expertCount > 2) EXPECT_EQ(bins.counts[1], 0u);
+
+        // every query is in one slot and all queries of a group use the expert of the group
+        std::vector<uint32_t> seen(count, 0);
+        for (uint32_t slot = 0; slot < bins.order.size(); slot++)
+        {
+            const uint32_t expert = bins.getGroupExpert(slot / kDeferredQueryGroupSize);
+            const uint32_t q = bins.order[slot];
+            if (slot < bins.offsets[expert] + bins.counts[expert])
+            {
+                EXPECT_EQ(queries[q].expert, expert) << "experts=" << expertCount << " slot=" << slot;
+                seen[q]++;
+            }
+            else
+            {
+                EXPECT_EQ(q, ExpertBins::kInvalidQuery) << "experts=" << expertCount << " slot=" << slot;
+            }
+        }
+        for (uint32_t q = 0; q < count; q++)
+            EXPECT_EQ(seen[q], 1u) << "experts=" << expertCount << " query=" << q;
+    }
+
+    DeferredQuery query = {};
+    query.expert = 2;
+    EXPECT_THROW(binDeferredQueries(&query, 1, 2));
+}
+
+CPU_TEST(TinynnExperts_InferMatchesExpert)
+{
+    std::mt19937 rng(5);
+    const uint32_t expertCount = 3;
+    const uint32_t count = 700;
+    const std::vector<DeferredQuery> queries = createQueries(rng, count, expertCount);
+    const ExpertBins bins = binDeferredQueries(queries.data(), count, expertCount);
+
+    // the experts follow each other in the parameter buffer like in the shaders, each with its own layer count
+    uint32_t offsetPrim = 0;
+    uint32_t offsetGrad = 0;
+    std::vector<std::unique_ptr<HalfMLP>> mlps;
+    std::vector<std::unique_ptr<FeatureHashGrid>> grids;
+    FeatureHashGrid::Desc desc;
+    desc.size = 1u << 14;
+    for (uint32_t e = 0; e < expertCount; e++)
+    {
+        mlps.push_back(std::make_unique<HalfMLP>(kFeatureWidth, e + 1, Activation::ReLU, offsetPrim, offsetGrad));
+        grids.push_back(std::make_unique<FeatureHashGrid>(desc, offsetPrim, offsetGrad));
+    }
+    std::uniform_real_distribution<float> weightDist(-0.25f, 0.5f);
+    std::vector<float16_t> primal(offsetPrim);
+    for (auto& value : primal)
+        value = float16_t(weightDist(rng));
+    for (auto& mlp : mlps)
+        mlp->loadWeights(primal.data());
+
+    const HalfMLP* mlpList[expertCount] = {mlps[0].get(), mlps[1].get(), mlps[2].get()};
+    FeatureHashGrid* gridList[expertCount] = {grids[0].get(), grids[1].get(), grids[2].get()};
+    std::vector<float3> results(count);
+    inferExpertQueries(Encoding::HashInterpolation, gridList, primal.data(), mlpList, bins, queries.data(), results.data());
+
+    for (uint32_t q = 0; q < count; q += 7)
+    {
+        const uint32_t e = queries[q].expert;
+        float3 expected;
+        inferDeferredQueries(Encoding::HashInterpolation, grids[e].get(), primal.data(), *mlps[e], &queries[q], 1, &expected);
+        for (uint32_t c = 0; c < 3; c++)
+            EXPECT_EQ(results[q][c], expected[c]) << "query=" << q << " c=" << c;
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,392 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "CacheTestUtils.h"
+#include "Host/TinynnFeatureEncodings.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+using HashKey = FeatureHashGrid::HashKey;
+
+const float kPi = 3.14159265358979323846f;
+
+/// Random queries in structure-of-arrays layout.
+struct Queries
+{
+    std::vector<float> components[9];
+    QueryBatch batch;
+
+    Queries(std::mt19937& rng, uint32_t count, float extent)
+    {
+        std::uniform_real_distribution<float> posDist(-extent, extent);
+        std::normal_distribution<float> dirDist;
+        for (auto& c : components)
+            c.resize(count);
+        for (uint32_t q = 0; q < count; q++)
+        {
+            float3 dir(dirDist(rng), dirDist(rng), dirDist(rng));
+            dir = normalize(dir);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                components[c][q] = posDist(rng);
+                components[3 + c][q] = dir[c];
+                components[6 + c][q] = dirDist(rng);
+            }
+        }
+        batch.count = count;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            batch.position[c] = components[c].data();
+            batch.direction[c] = components[3 + c].data();
+            batch.normal[c] = components[6 + c].data();
+        }
+    }
+
+    float3 position(uint32_t q) const { return float3(components[0][q], components[1][q], components[2][q]); }
+    float3 direction(uint32_t q) const { return float3(components[3][q], components[4][q], components[5][q]); }
+    float3 normal(uint32_t q) const { return float3(components[6][q], components[7][q], components[8][q]); }
+
+    /// Batch of the single query q.
+    QueryBatch single(uint32_t q) const
+    {
+        QueryBatch result;
+        result.count = 1;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            result.position[c] = components[c].data() + q;
+            result.direction[c] = components[3 + c].data() + q;
+            result.normal[c] = components[6 + c].data() + q;
+        }
+        return result;
+    }
+};
+
+QueryBatch singleQuery(const float3& position, const float3& direction, const float3& normal)
+{
+    QueryBatch batch;
+    batch.count = 1;
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        batch.position[c] = &position[c];
+        batch.direction[c] = &direction[c];
+        batch.normal[c] = &normal[c];
+    }
+    return batch;
+}
+
+float roundToHalf(float x)
+{
+    return float(float16_t(x));
+}
+} // namespace
+
+CPU_TEST(TinynnFeatureEncodings_SH)
+{
+    // addition theorem, the squares of a band sum up to (2l + 1) / (4 pi) for every direction
+    std::mt19937 rng(1);
+    const uint32_t count = 64;
+    Queries queries(rng, count, 1.f);
+    std::vector<float> values(64 * count);
+    encodeSH(8, queries.batch, values.data());
+    for (uint32_t q = 0; q < count; q++)
+    {
+        for (uint32_t l = 0; l < 8; l++)
+        {
+            double sum = 0.0;
+            for (uint32_t i = l * l; i < (l + 1) * (l + 1); i++)
+                sum += double(values[i * count + q]) * values[i * count + q];
+            const double expected = (2 * l + 1) / (4.0 * kPi);
+            EXPECT_LT(std::abs(sum - expected), 4e-3 * expected) << "q=" << q << " l=" << l;
+        }
+    }
+
+    // lower degrees are prefixes
+    std::vector<float> values3(9 * count);
+    encodeSH(3, queries.batch, values3.data());
+    for (uint32_t i = 0; i < 9 * count; i++)
+        EXPECT_EQ(values3[i], values[(i / count) * count + i % count]) << "i=" << i;
+
+    const float3 z(0.f, 0.f, 1.f);
+    float dirValues[4];
+    encodeSH(2, singleQuery(float3(0.f), z, z), dirValues);
+    EXPECT_EQ(dirValues[0], roundToHalf(0.28209479177387814f));
+    EXPECT_EQ(dirValues[1], 0.f);
+    EXPECT_EQ(dirValues[2], roundToHalf(0.48860251190291987f));
+    EXPECT_EQ(dirValues[3], 0.f);
+
+    EXPECT_THROW(encodeSH(0, queries.batch, values.data()));
+    EXPECT_THROW(encodeSH(9, queries.batch, values.data()));
+}
+
+CPU_TEST(TinynnFeatureEncodings_Frequency)
+{
+    std::mt19937 rng(2);
+    const uint32_t count = 32;
+    Queries queries(rng, count, 2.f);
+    std::vector<float> values(12 * count);
+    encodeFrequency(4, 2, queries.batch, values.data());
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        const float frequency = roundToHalf(3.1415926f * std::pow(2.f, float(i * 2)));
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            for (uint32_t q = 0; q < count; q++)
+            {
+                const float p = roundToHalf(queries.components[c][q]);
+                const float expected = roundToHalf(std::sin(roundToHalf(p * frequency)));
+                // the test rounds ties away from zero, the encoding to nearest even
+                EXPECT_LE(std::abs(values[(3 * i + c) * count + q] - expected), 1e-3f) << "i=" << i << " c=" << c << " q=" << q;
+            }
+        }
+    }
+}
+
+CPU_TEST(TinynnFeatureEncodings_SpatialHash)
+{
+    uint32_t offsetPrim = 5, offsetGrad = 3;
+    const float3 up(0.f, 0.f, 1.f);
+    const float3 right(1.f, 0.f, 0.f);
+
+    FeatureHashGrid::Desc desc;
+    desc.method = FeatureHashGrid::Method::NRC;
+    desc.size = 1u << 16;
+    desc.separateLevelGrids = false;
+    FeatureHashGrid nrc(desc, offsetPrim, offsetGrad);
+    EXPECT_EQ(nrc.getOffsetPrim(), 5u);
+    EXPECT_EQ(offsetPrim, 5u + (1u << 16));
+    EXPECT_EQ(offsetGrad, 3u + (1u << 16));
+    EXPECT(!nrc.useMultiLevelDir());
+    EXPECT_EQ(nrc.getPlacesPerElement(), 2u);
+    EXPECT_EQ(nrc.getCapacity(), 1u << 15);
+    EXPECT_EQ(nrc.getLevelOffset(), 0u);
+
+    // | normal 3 | level 10 | pos.z 17 | pos.y 17 | pos.x 17 |
+    {
+        const float voxelSize = FeatureHashGrid::getVoxelSize(1);
+        const float3 position = float3(1.5f, 2.5f, -0.5f) * voxelSize;
+        const HashKey expected = ((((HashKey(7) << 10 | 1) << 17 | 0x1ffff) << 17 | 2) << 17) | 1;
+        EXPECT_EQ(nrc.computeSpatialHash(position, right, up, 1, false), expected);
+    }
+
+    // | normal 3 | pos.z 15 | pos.y 15 | pos.x 15 | dir.y 3 | dir.x 3 |, the multi level direction uses position level 5
+    desc.method = FeatureHashGrid::Method::NIRC;
+    desc.separateLevelGrids = true;
+    FeatureHashGrid nirc(desc, offsetPrim, offsetGrad);
+    EXPECT(nirc.useMultiLevelDir());
+    EXPECT_EQ(nirc.getPlacesPerElement(), 1u);
+    EXPECT_EQ(nirc.getCapacity(), 1u << 13);
+    EXPECT_EQ(nirc.getLevelOffset(), 1u << 13);
+    {
+        const float3 normal(-1.f, 1.f, -1.f);
+        const float3 position = float3(1.5f, 0.5f, 0.5f) * FeatureHashGrid::getVoxelSize(5);
+        // atan(0) and acos(0) are both in the middle of the quantized range
+        const HashKey expected = ((((HashKey(2) << 7) << 45 | 1) << 3 | 3) << 3) | 3;
+        EXPECT_EQ(nirc.computeSpatialHash(position, right, normal, 2, true), expected);
+
+        // without the multi level direction the key uses the fixed 4 direction bits and the actual level
+        const float3 position1 = float3(1.5f, 0.5f, 0.5f) * FeatureHashGrid::getVoxelSize(1);
+        const HashKey expected1 = ((((HashKey(2) << 7) << 42 | 1) << 4 | 7) << 4) | 7;
+        EXPECT_EQ(nirc.computeSpatialHash(position1, right, normal, 1, false), expected1);
+    }
+}
+
+CPU_TEST(TinynnFeatureEncodings_Probing)
+{
+    FeatureHashGrid::Desc desc;
+    desc.method = FeatureHashGrid::Method::NRC;
+    desc.size = 64;
+    desc.separateLevelGrids = false;
+    desc.probingSize = 2;
+    uint32_t offsetPrim = 0, offsetGrad = 0;
+    FeatureHashGrid grid(desc, offsetPrim, offsetGrad);
+    const uint32_t capacity = grid.getCapacity();
+    EXPECT_EQ(capacity, 32u);
+
+    // the home slot leaves room for the probing window before the end of the grid
+    const uint32_t home = capacity / 2;
+    const std::vector<HashKey> keys = findCollidingKeys([&](HashKey key) { return FeatureHashGrid::hash32(key) % capacity; }, home, 5);
+    EXPECT_EQ(grid.insertEntry(keys[0], 0), home * 2);
+    EXPECT_EQ(grid.insertEntry(keys[1], 0), (home + 1) * 2);
+    EXPECT_EQ(grid.insertEntry(keys[2], 0), (home + 2) * 2);
+    // the bucket is full, the key collides on the home slot
+    EXPECT_EQ(grid.insertEntry(keys[3], 0), home * 2);
+    EXPECT_EQ(grid.insertEntry(keys[1], 0), (home + 1) * 2);
+    EXPECT_EQ(grid.getEntry(home + 2), keys[2]);
+
+    FeatureHashGrid::LevelStats stats = grid.getLevelStats(0);
+    EXPECT_EQ(stats.lookups, 5u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.probes, 1u + 2u + 3u + 3u + 2u);
+
+    grid.resetStats();
+    EXPECT_EQ(grid.findEntry(keys[2], 0), (home + 2) * 2);
+    EXPECT_EQ(grid.findEntry(keys[4], 0), home * 2);
+    stats = grid.getLevelStats(0);
+    EXPECT_EQ(stats.lookups, 2u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.getMissRate(), 0.5f);
+    EXPECT_EQ(grid.getLevelStats(1).lookups, 0u);
+
+    // separate level grids offset every level by the capacity
+    desc.size = 256;
+    desc.separateLevelGrids = true;
+    FeatureHashGrid separate(desc, offsetPrim, offsetGrad);
+    EXPECT_EQ(separate.getCapacity(), 16u);
+    const uint32_t slot = FeatureHashGrid::hash32(keys[0]) % 16;
+    EXPECT_EQ(separate.insertEntry(keys[0], 3), (slot + 3 * 16) * 2);
+    EXPECT_EQ(separate.findEntry(keys[0], 3), (slot + 3 * 16) * 2);
+    EXPECT_EQ(separate.getLevelStats(3).misses, 0u);
+
+    separate.reset();
+    EXPECT_EQ(separate.getEntry(slot + 3 * 16), FeatureHashGrid::kInvalidHashKey);
+    EXPECT_EQ(separate.getLevelStats(3).lookups, 0u);
+}
+
+CPU_TEST(TinynnFeatureEncodings_Interpolation)
+{
+    FeatureHashGrid::Desc desc;
+    desc.size = 1u << 16;
+    uint32_t offsetPrim = 0, offsetGrad = 0;
+    FeatureHashGrid grid(desc, offsetPrim, offsetGrad);
+    const float3 dir = normalize(float3(0.3f, -0.5f, 0.8f));
+    const float3 normal(0.f, 1.f, 0.f);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-3.f, 3.f);
+    for (uint32_t n = 0; n < 100; n++)
+    {
+        const float3 position(dist(rng), dist(rng), dist(rng));
+        const uint32_t level = n % FeatureHashGrid::kLevelCount;
+        HashKey keys[FeatureHashGrid::kCornerCount];
+        float weights[FeatureHashGrid::kCornerCount];
+        grid.computeCornerHashes(position, dir, normal, level, false, keys, weights);
+        float sum = 0.f;
+        for (float w : weights)
+        {
+            EXPECT_GE(w, 0.f) << "position=" << position.x << "," << position.y << "," << position.z;
+            sum += w;
+        }
+        EXPECT_LT(std::abs(sum - 1.f), 1e-5f);
+
+        // corner 0 is the voxel of the query, corner 1 the opposite one
+        const float voxelSize = FeatureHashGrid::getVoxelSize(level);
+        const float3 corner0 = (floor(position / voxelSize) + 0.5f) * voxelSize;
+        EXPECT_EQ(keys[0], grid.computeSpatialHash(corner0, dir, normal, level, false));
+        EXPECT_EQ(keys[1], grid.computeSpatialHash(corner0 + voxelSize, dir, normal, level, false));
+        EXPECT_EQ(keys[2], grid.computeSpatialHash(corner0 + float3(voxelSize, 0.f, 0.f), dir, normal, level, false));
+    }
+
+    HashKey keys[FeatureHashGrid::kCornerCount];
+    float weights[FeatureHashGrid::kCornerCount];
+    grid.computeCornerHashes(float3(-2.f, 1.f, 0.f) * FeatureHashGrid::getVoxelSize(0), dir, normal, 0, false, keys, weights);
+    EXPECT_EQ(weights[0], 1.f);
+    for (uint32_t i = 1; i < FeatureHashGrid::kCornerCount; i++)
+        EXPECT_EQ(weights[i], 0.f) << "i=" << i;
+}
+
+CPU_TEST(TinynnFeatureEncodings_Features)
+{
+    std::mt19937 rng(4);
+    const uint32_t count = 50;
+    Queries queries(rng, count, 4.f);
+    const Encoding encodings[] = {Encoding::Hash, Encoding::HashInterpolation, Encoding::Frequency};
+    for (Encoding encoding : encodings)
+    {
+        for (uint32_t config = 0; config < 4; config++)
+        {
+            FeatureHashGrid::Desc desc;
+            desc.method = config & 1 ? FeatureHashGrid::Method::NRC : FeatureHashGrid::Method::NIRC;
+            desc.size = 1u << 20;
+            desc.separateLevelGrids = config & 2;
+            desc.probingSize = 4;
+            uint32_t offsetPrim = 11, offsetGrad = 0;
+            FeatureHashGrid grid(desc, offsetPrim, offsetGrad);
+            std::vector<float16_t> primal(offsetPrim);
+            std::uniform_real_distribution<float> dist(-1.f, 1.f);
+            for (auto& v : primal)
+                v = float16_t(dist(rng));
+
+            std::vector<float16_t> features(count * kFeatureWidth);
+            computeFeatures(encoding, &grid, primal.data(), queries.batch, true, features.data());
+
+            // lookups find the inserted keys
+            std::vector<float16_t> lookup(count * kFeatureWidth);
+            grid.resetStats();
+            computeFeatures(encoding, &grid, primal.data(), queries.batch, false, lookup.data());
+            for (uint32_t i = 0; i < count * kFeatureWidth; i++)
+                EXPECT_EQ(lookup[i].toBits(), features[i].toBits()) << "encoding=" << uint32_t(encoding) << " i=" << i;
+            for (uint32_t level = 0; level < FeatureHashGrid::kLevelCount; level++)
+                EXPECT_EQ(grid.getLevelStats(level).misses, 0u) << "level=" << level;
+
+            // a batch matches the single queries
+            std::vector<float16_t> single(kFeatureWidth);
+            for (uint32_t q = 0; q < count; q++)
+            {
+                computeFeatures(encoding, &grid, primal.data(), queries.single(q), false, single.data());
+                for (uint32_t i = 0; i < kFeatureWidth; i++)
+                {
+                    EXPECT_EQ(single[i].toBits(), features[q * kFeatureWidth + i].toBits())
+                        << "encoding=" << uint32_t(encoding) << " config=" << config << " q=" << q << " i=" << i;
+                }
+            }
+
+            for (uint32_t q = 0; q < count; q++)
+            {
+                const float16_t* row = features.data() + q * kFeatureWidth;
+                for (uint32_t c = 0; c < 3; c++)
+                    EXPECT_EQ(float(row[c]), float(float16_t(queries.components[c][q])));
+                EXPECT_EQ(float(row[kFeatureWidth - 1]), 1.f);
+                if (encoding != Encoding::Hash) continue;
+
+                // hash encoding reads the values of the slots directly
+                const float16_t* data = primal.data() + grid.getOffsetPrim();
+                for (uint32_t level = 0; level < FeatureHashGrid::kLevelCount; level++)
+                {
+                    const float3 p = queries.position(q), d = queries.direction(q), n = queries.normal(q);
+                    const bool multiLevelDir = grid.useMultiLevelDir();
+                    const uint32_t idx0 = grid.findEntry(grid.computeSpatialHash(p, d, n, level, multiLevelDir), level);
+                    const uint32_t idx1 = multiLevelDir ? grid.findEntry(grid.computeSpatialHash(p, d, n, level, false), level) : idx0 + 1;
+                    EXPECT_EQ(row[15 + 2 * level].toBits(), data[idx0].toBits()) << "q=" << q << " level=" << level;
+                    EXPECT_EQ(row[16 + 2 * level].toBits(), data[idx1].toBits()) << "q=" << q << " level=" << level;
+                }
+            }
+            if (encoding == Encoding::Frequency) break;
+        }
+    }
+
+    std::vector<float16_t> features(count * kFeatureWidth);
+    EXPECT_THROW(computeFeatures(Encoding::Hash, nullptr, nullptr, queries.batch, false, features.data()));
+}
+} // namespace Falcor
@@ -0,0 +1,136 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/TinynnGradientReduction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+// the training pass runs 32x4 threads per group
+const uint32_t kWarpCount = 4;
+
+// the summation order differs from the per thread atomics, which on the gpu have no fixed order either
+void expectGradientsMatch(const std::vector<float>& reference, const std::vector<float>& result, CPUUnitTestContext& ctx)
+{
+    for (size_t i = 0; i < reference.size(); i++)
+        EXPECT_LE(std::abs(result[i] - reference[i]), 1e-5f * std::max(1.f, std::abs(reference[i]))) << "gradient " << i;
+}
+
+void testLinearLayer(uint32_t width, uint32_t offset, CPUUnitTestContext& ctx)
+{
+    // shared memory of the group as the weight gradient matmul of LinearHalf<width> leaves it
+    std::mt19937 rng(width);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    std::vector<float16_t> shared(8192);
+    for (auto& value : shared) value = float16_t(dist(rng));
+    const WarpGradients warps{shared.data() + offset, width, kWarpCount, width * width};
+
+    // the buffers already hold the gradients of other groups
+    std::vector<float> gradient(width * width), gradientCount(width * width);
+    for (uint32_t i = 0; i < width * width; i++)
+    {
+        gradient[i] = dist(rng);
+        gradientCount[i] = float(i % 3) * kWarpCount;
+    }
+    std::vector<float> referenceGradient = gradient, referenceCount = gradientCount;
+
+    const uint32_t referenceAtomics = accumulateWarpGradients(warps, referenceGradient.data(), referenceCount.data());
+    const uint32_t atomics = reduceGroupGradients(warps, gradient.data(), gradientCount.data());
+
+    expectGradientsMatch(referenceGradient, gradient, ctx);
+    // counts are whole numbers and exact
+    for (uint32_t i = 0; i < width * width; i++) EXPECT_EQ(gradientCount[i], referenceCount[i]) << "count " << i;
+    EXPECT_EQ(atomics * kWarpCount, referenceAtomics);
+}
+
+std::vector<float> makeLaneValues(std::mt19937& rng)
+{
+    std::normal_distribution<float> dist(0.f, 1.f);
+    std::vector<float> values(kLaneCount);
+    for (auto& value : values) value = dist(rng);
+    return values;
+}
+} // namespace
+
+CPU_TEST(TinynnGradientReductionLinear16)
+{
+    // LinearHalf<16> keeps its per warp gradients behind the 32x32 layers
+    testLinearLayer(16, 4096, ctx);
+}
+
+CPU_TEST(TinynnGradientReductionLinear32)
+{
+    testLinearLayer(32, 0, ctx);
+}
+
+CPU_TEST(TinynnGradientReductionWaveCoalescing)
+{
+    std::mt19937 rng(1);
+    // the number of different slots a wave hits, a coherent wave hits the same slots of the coarse levels
+    for (uint32_t slotCount : {1u, 4u, 13u, 32u})
+    {
+        for (uint32_t active : {0xffffffffu, 0x0f0f0f0fu, 0x80000001u})
+        {
+            std::uniform_int_distribution<uint32_t> slotDist(0, slotCount - 1);
+            std::vector<uint32_t> indices(kLaneCount);
+            // spread the slots over the buffer so the distinct case does not collide
+            for (auto& index : indices) index = slotDist(rng) * 7;
+            const std::vector<float> values = makeLaneValues(rng);
+
+            std::vector<float> referenceGradient(32 * 7), referenceCount(32 * 7);
+            uint32_t referenceAtomics = 0;
+            for (uint32_t lane = 0; lane < kLaneCount; lane++)
+            {
+                if (active & (1u << lane))
+                    referenceAtomics +=
+                        accumulateLaneGradients(&indices[lane], &values[lane], 1, referenceGradient.data(), referenceCount.data());
+            }
+
+            std::vector<float> gradient(32 * 7), gradientCount(32 * 7);
+            const uint32_t atomics =
+                coalesceLaneGradients(indices.data(), values.data(), kLaneCount, active, gradient.data(), gradientCount.data());
+
+            expectGradientsMatch(referenceGradient, gradient, ctx);
+            for (size_t i = 0; i < gradientCount.size(); i++) EXPECT_EQ(gradientCount[i], referenceCount[i]) << "count " << i;
+            // one pair of atomics per distinct active slot
+            uint32_t distinct = 0;
+            for (size_t i = 0; i < gradientCount.size(); i++) distinct += gradientCount[i] > 0.f ? 1 : 0;
+            EXPECT_EQ(atomics, 2 * distinct);
+            EXPECT_LE(atomics, referenceAtomics);
+        }
+    }
+}
+} // namespace Falcor
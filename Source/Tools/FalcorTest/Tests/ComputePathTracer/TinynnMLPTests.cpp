@@ -0,0 +1,371 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/TinynnMLP.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+const Activation kActivations[] = {
+    Activation::None,
+    Activation::ReLU,
+    Activation::LeakyReLU,
+    Activation::Exponential,
+    Activation::Sigmoid,
+    Activation::Sine,
+    Activation::Tanh,
+};
+
+std::vector<float16_t> toHalf(const std::vector<float>& values)
+{
+    std::vector<float16_t> result;
+    for (float v : values)
+        result.push_back(float16_t(v));
+    return result;
+}
+
+std::vector<float16_t> randomHalfs(std::mt19937& rng, size_t count, float range)
+{
+    std::uniform_real_distribution<float> dist(-range, range);
+    std::vector<float16_t> values(count);
+    for (auto& v : values)
+        v = float16_t(dist(rng));
+    return values;
+}
+
+/// Straightforward evaluation in double, every layer output is rounded to half like in HalfMLP.
+struct ReferenceMLP
+{
+    uint32_t width;
+    uint32_t layerCount;
+    Activation activation;
+    std::vector<double> weights;
+
+    ReferenceMLP(const HalfMLP& mlp, const std::vector<float16_t>& primal)
+        : width(mlp.getWidth()), layerCount(mlp.getLayerCount()), activation(mlp.getActivation())
+    {
+        for (uint32_t i = 0; i < mlp.getParamCount(); i++)
+            weights.push_back(float(primal[mlp.getOffsetPrim() + i]));
+    }
+
+    double w(uint32_t layer, uint32_t n, uint32_t k) const { return weights[(layer * width + n) * width + k]; }
+
+    static double round(double x) { return float(float16_t(float(x))); }
+
+    double act(double x) const { return activation == Activation::ReLU ? std::max(x, 0.0) : x; }
+    double actDerivative(double x) const { return activation == Activation::ReLU ? (x > 0.0 ? 1.0 : 0.0) : 1.0; }
+
+    /// Inputs of all layers and the output.
+    std::vector<std::vector<double>> forward(const float16_t* input) const
+    {
+        std::vector<std::vector<double>> values(1);
+        for (uint32_t k = 0; k < width; k++)
+            values[0].push_back(float(input[k]));
+        for (uint32_t l = 0; l < layerCount; l++)
+        {
+            std::vector<double> out(width);
+            for (uint32_t n = 0; n < width; n++)
+            {
+                double sum = 0.0;
+                for (uint32_t k = 0; k < width; k++)
+                    sum += w(l, n, k) * values[l][k];
+                out[n] = round(act(round(sum)));
+            }
+            values.push_back(out);
+        }
+        return values;
+    }
+
+    /// Adds the weight gradients and returns the input gradient.
+    std::vector<double> backward(const float16_t* input, const float16_t* dOutput, std::vector<double>& gradient) const
+    {
+        const auto values = forward(input);
+        std::vector<double> d(width);
+        for (uint32_t n = 0; n < width; n++)
+            d[n] = float(dOutput[n]);
+        for (uint32_t l = layerCount; l-- > 0;)
+        {
+            std::vector<double> dz(width);
+            for (uint32_t n = 0; n < width; n++)
+            {
+                double z = 0.0;
+                for (uint32_t k = 0; k < width; k++)
+                    z += w(l, n, k) * values[l][k];
+                dz[n] = round(d[n] * actDerivative(round(z)));
+                for (uint32_t k = 0; k < width; k++)
+                    gradient[(l * width + n) * width + k] += dz[n] * values[l][k];
+            }
+            for (uint32_t k = 0; k < width; k++)
+            {
+                double sum = 0.0;
+                for (uint32_t n = 0; n < width; n++)
+                    sum += w(l, n, k) * dz[n];
+                d[k] = round(sum);
+            }
+        }
+        return d;
+    }
+};
+
+bool isBitwiseEqual(const std::vector<float16_t>& a, const std::vector<float16_t>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].toBits() != b[i].toBits()) return false;
+    return true;
+}
+} // namespace
+
+CPU_TEST(TinynnMLP_Layout)
+{
+    // two networks back to back in the primal buffer like the feature grids following the MLP in the shaders
+    uint32_t offsetPrim = 7;
+    uint32_t offsetGrad = 3;
+    HalfMLP mlp0(32, 2, Activation::ReLU, offsetPrim, offsetGrad);
+    HalfMLP mlp1(16, 3, Activation::ReLU, offsetPrim, offsetGrad);
+    EXPECT_EQ(mlp0.getOffsetPrim(), 7u);
+    EXPECT_EQ(mlp0.getParamCount(), 2u * 32 * 32);
+    EXPECT_EQ(mlp1.getOffsetPrim(), 7u + 2 * 32 * 32);
+    EXPECT_EQ(mlp1.getOffsetGrad(), 3u + 2 * 32 * 32);
+    EXPECT_EQ(offsetPrim, 7u + 2 * 32 * 32 + 3 * 16 * 16);
+    EXPECT_EQ(offsetGrad, 3u + 2 * 32 * 32 + 3 * 16 * 16);
+
+    uint32_t unused = 0;
+    EXPECT_THROW(HalfMLP(24, 1, Activation::ReLU, unused, unused));
+    EXPECT_THROW(HalfMLP(16, 0, Activation::ReLU, unused, unused));
+}
+
+CPU_TEST(TinynnMLP_ForwardGolden)
+{
+    // layer 0 computes x[n] - 0.5 * x[n + 1], layer 1 doubles, layer 2 reverses and scales by n / 16
+    const uint32_t width = 16;
+    uint32_t offsetPrim = 1;
+    uint32_t offsetGrad = 0;
+    HalfMLP mlp(width, 3, Activation::ReLU, offsetPrim, offsetGrad);
+    std::vector<float> weights(1 + mlp.getParamCount(), 0.f);
+    for (uint32_t n = 0; n < width; n++)
+    {
+        weights[1 + n * width + n] = 1.f;
+        weights[1 + n * width + (n + 1) % width] = -0.5f;
+        weights[1 + width * width + n * width + n] = 2.f;
+        weights[1 + 2 * width * width + n * width + (width - 1 - n)] = float(n) / 16.f;
+    }
+    const std::vector<float16_t> primal = toHalf(weights);
+    std::vector<float> inputValues;
+    for (uint32_t k = 0; k < width; k++)
+        inputValues.push_back(1.f - float(k % 5) * 0.25f);
+    const std::vector<float16_t> input = toHalf(inputValues);
+
+    // e.g. relu(2 * relu(x[0] - 0.5 * x[1])) = 2 * (1 - 0.375) = 1.25
+    const float goldenLayer1[] = {1.25f, 1.f, 0.75f, 0.5f, 0.f, 1.25f, 1.f, 0.75f, 0.5f, 0.f, 1.25f, 1.f, 0.75f, 0.5f, 0.f, 1.f};
+    std::vector<float> golden(width);
+    for (uint32_t n = 0; n < width; n++)
+        golden[n] = goldenLayer1[width - 1 - n] * float(n) / 16.f;
+
+    for (Isa isa : {Isa::Scalar, Isa::AVX2, Isa::AVX512})
+    {
+        if (!isIsaSupported(isa)) continue;
+        mlp.setIsa(isa);
+        mlp.loadWeights(primal.data());
+        std::vector<float16_t> output(width);
+        mlp.forward(input.data(), output.data(), 1);
+        for (uint32_t n = 0; n < width; n++)
+            EXPECT_EQ(float(output[n]), golden[n]) << "isa=" << uint32_t(isa) << " n=" << n;
+
+        // in-place evaluation of several queries
+        std::vector<float16_t> values = input;
+        values.insert(values.end(), input.begin(), input.end());
+        mlp.forward(values.data(), values.data(), 2);
+        for (uint32_t n = 0; n < 2 * width; n++)
+            EXPECT_EQ(float(values[n]), golden[n % width]) << "isa=" << uint32_t(isa) << " n=" << n;
+    }
+}
+
+CPU_TEST(TinynnMLP_BackwardGolden)
+{
+    // single layer W[n][k] = (n == k) - (n == k + 1), the output gradient selects output 3
+    const uint32_t width = 16;
+    uint32_t offsetPrim = 0;
+    uint32_t offsetGrad = 2;
+    HalfMLP mlp(width, 1, Activation::ReLU, offsetPrim, offsetGrad);
+    std::vector<float> weights(mlp.getParamCount(), 0.f);
+    for (uint32_t n = 0; n < width; n++)
+    {
+        weights[n * width + n] = 1.f;
+        if (n > 0) weights[n * width + n - 1] = -1.f;
+    }
+    mlp.loadWeights(toHalf(weights).data());
+
+    std::vector<float> inputValues(width, 0.f);
+    inputValues[2] = 0.5f;
+    inputValues[3] = 2.f;
+    inputValues[4] = 4.f;
+    const std::vector<float16_t> input = toHalf(inputValues);
+    std::vector<float> dOutputValues(width, 0.f);
+    dOutputValues[3] = 0.25f;
+    // output 4 is active but has no gradient, output 2 has a gradient but is inactive
+    dOutputValues[2] = 1.f;
+    inputValues[1] = 1.f;
+    const std::vector<float16_t> inputWithInactive = toHalf(inputValues);
+    const std::vector<float16_t> dOutput = toHalf(dOutputValues);
+
+    std::vector<float> gradient(2 + mlp.getParamCount(), 0.f);
+    std::vector<float> gradientCount(2 + mlp.getParamCount(), 0.f);
+    std::vector<float16_t> dInput(width);
+    mlp.backward(inputWithInactive.data(), dOutput.data(), dInput.data(), gradient.data(), gradientCount.data(), 1);
+
+    // z[2] = 0.5 - 1 < 0, z[3] = 2 - 0.5 > 0, so only row 3 receives dW[3][k] = 0.25 * x[k]
+    for (uint32_t n = 0; n < width; n++)
+    {
+        for (uint32_t k = 0; k < width; k++)
+        {
+            const float expected = n == 3 ? 0.25f * inputValues[k] : 0.f;
+            EXPECT_EQ(gradient[2 + n * width + k], expected) << "n=" << n << " k=" << k;
+        }
+    }
+    // dx[k] = W[3][k] * 0.25
+    for (uint32_t k = 0; k < width; k++)
+        EXPECT_EQ(float(dInput[k]), k == 3 ? 0.25f : (k == 2 ? -0.25f : 0.f)) << "k=" << k;
+    EXPECT_EQ(gradientCount[0], 0.f);
+    EXPECT_EQ(gradientCount[2], 1.f);
+
+    // 33 queries span two warps, the gradients sum up
+    std::vector<float16_t> inputs;
+    std::vector<float16_t> dOutputs;
+    for (uint32_t q = 0; q < 33; q++)
+    {
+        inputs.insert(inputs.end(), inputWithInactive.begin(), inputWithInactive.end());
+        dOutputs.insert(dOutputs.end(), dOutput.begin(), dOutput.end());
+    }
+    std::fill(gradient.begin(), gradient.end(), 0.f);
+    mlp.backward(inputs.data(), dOutputs.data(), nullptr, gradient.data(), gradientCount.data(), 33);
+    EXPECT_EQ(gradient[2 + 3 * width + 3], 33 * 0.25f * 2.f);
+    EXPECT_EQ(gradientCount[2], 3.f);
+    EXPECT_EQ(gradientCount[1 + mlp.getParamCount()], 3.f);
+}
+
+CPU_TEST(TinynnMLP_Reference)
+{
+    std::mt19937 rng(1);
+    for (uint32_t width : {16u, 32u})
+    {
+        for (uint32_t layerCount : {1u, 3u, 5u})
+        {
+            uint32_t offsetPrim = 5;
+            uint32_t offsetGrad = 0;
+            HalfMLP mlp(width, layerCount, Activation::ReLU, offsetPrim, offsetGrad);
+            const std::vector<float16_t> primal = randomHalfs(rng, offsetPrim, 1.f / std::sqrt(float(width)));
+            mlp.loadWeights(primal.data());
+            const ReferenceMLP reference(mlp, primal);
+
+            const uint32_t count = 40;
+            const std::vector<float16_t> input = randomHalfs(rng, count * width, 2.f);
+            const std::vector<float16_t> dOutput = randomHalfs(rng, count * width, 1.f);
+            std::vector<float16_t> output(count * width);
+            std::vector<float16_t> dInput(count * width);
+            std::vector<float> gradient(mlp.getParamCount(), 0.f);
+            mlp.forward(input.data(), output.data(), count);
+            mlp.backward(input.data(), dOutput.data(), dInput.data(), gradient.data(), nullptr, count);
+
+            // a different summation order can flip the rounding of a layer output, the error stays within a few half ulps
+            std::vector<double> refGradient(mlp.getParamCount(), 0.0);
+            for (uint32_t q = 0; q < count; q++)
+            {
+                const auto refOutput = reference.forward(&input[q * width]).back();
+                const auto refDInput = reference.backward(&input[q * width], &dOutput[q * width], refGradient);
+                for (uint32_t n = 0; n < width; n++)
+                {
+                    EXPECT_LT(std::abs(float(output[q * width + n]) - refOutput[n]), 1e-2 * (1.0 + std::abs(refOutput[n])))
+                        << "width=" << width << " layers=" << layerCount << " q=" << q << " n=" << n;
+                    EXPECT_LT(std::abs(float(dInput[q * width + n]) - refDInput[n]), 1e-2 * (1.0 + std::abs(refDInput[n])))
+                        << "width=" << width << " layers=" << layerCount << " q=" << q << " n=" << n;
+                }
+            }
+            for (uint32_t i = 0; i < mlp.getParamCount(); i++)
+                EXPECT_LT(std::abs(gradient[i] - refGradient[i]), 5e-2 * (1.0 + std::abs(refGradient[i])))
+                    << "width=" << width << " layers=" << layerCount << " i=" << i;
+        }
+    }
+}
+
+CPU_TEST(TinynnMLP_IsaEquivalence)
+{
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> scaleDist(-12.f, 4.f);
+    for (uint32_t width : {16u, 32u})
+    {
+        for (Activation activation : kActivations)
+        {
+            uint32_t offsetPrim = 0;
+            uint32_t offsetGrad = 0;
+            HalfMLP mlp(width, 3, activation, offsetPrim, offsetGrad);
+            const std::vector<float16_t> primal = randomHalfs(rng, offsetPrim, 0.5f);
+
+            // inputs over a wide range of magnitudes, including ones with denormal and infinite products
+            const uint32_t count = 37;
+            std::vector<float16_t> input = randomHalfs(rng, count * width, 1.f);
+            for (auto& v : input)
+                v = float16_t(float(v) * std::exp2(scaleDist(rng) + 8.f));
+            const std::vector<float16_t> dOutput = randomHalfs(rng, count * width, 1.f);
+
+            std::vector<float16_t> refOutput(count * width);
+            std::vector<float16_t> refDInput(count * width);
+            std::vector<float> refGradient(offsetGrad, 0.f);
+            mlp.setIsa(Isa::Scalar);
+            mlp.loadWeights(primal.data());
+            mlp.forward(input.data(), refOutput.data(), count);
+            mlp.backward(input.data(), dOutput.data(), refDInput.data(), refGradient.data(), nullptr, count);
+
+            for (Isa isa : {Isa::AVX2, Isa::AVX512})
+            {
+                if (!isIsaSupported(isa)) continue;
+                mlp.setIsa(isa);
+                std::vector<float16_t> output(count * width);
+                std::vector<float16_t> dInput(count * width);
+                std::vector<float> gradient(offsetGrad, 0.f);
+                mlp.forward(input.data(), output.data(), count);
+                mlp.backward(input.data(), dOutput.data(), dInput.data(), gradient.data(), nullptr, count);
+                const std::string msg = fmt::format("isa={} width={} activation={}", uint32_t(isa), width, uint32_t(activation));
+                EXPECT(isBitwiseEqual(output, refOutput)) << msg;
+                EXPECT(isBitwiseEqual(dInput, refDInput)) << msg;
+                bool gradientEqual = true;
+                for (size_t i = 0; i < gradient.size(); i++)
+                    gradientEqual &= gradient[i] == refGradient[i] || (std::isnan(gradient[i]) && std::isnan(refGradient[i]));
+                EXPECT(gradientEqual) << msg;
+            }
+        }
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,293 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/TinynnOptimizer.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace tinynn;
+
+const uint32_t kParamCount = 4096;
+// parameters [0, kGridBegin) stand in for the mlp, the rest for the feature hash grid
+const uint32_t kGridBegin = 1024;
+const uint32_t kIterationsPerFrame = 4;
+
+struct OptimizerState
+{
+    std::vector<float16_t> primal;
+    std::vector<float16_t> filteredPrimal;
+    std::vector<float> gradient;
+    std::vector<float> gradientCount;
+    std::vector<float> aux;
+
+    OptimizerState(uint32_t seed)
+        : primal(kParamCount), filteredPrimal(kParamCount), gradient(kParamCount), gradientCount(kParamCount), aux(3 * kParamCount)
+    {
+        // like NNReset.slang, the gradients are left uninitialized
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(0.001f, 0.02f);
+        for (uint32_t i = 0; i < kParamCount; i++)
+        {
+            primal[i] = float16_t(dist(rng));
+            filteredPrimal[i] = primal[i];
+            gradient[i] = 1.f;
+            gradientCount[i] = 1.f;
+        }
+    }
+
+    OptimizerBuffers getBuffers()
+    {
+        return {kParamCount, primal.data(), filteredPrimal.data(), gradient.data(), gradientCount.data(), aux.data()};
+    }
+};
+
+/// Adds the gradients of one training pass, only a fraction of the grid parameters is hit. Some gradients are not finite.
+void accumulateGradients(OptimizerState& state, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> value(-1.f, 1.f);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    for (uint32_t i = 0; i < kParamCount; i++)
+    {
+        if (i >= kGridBegin && u(rng) > 0.2f) continue;
+        const uint32_t warpCount = 1 + rng() % 4;
+        for (uint32_t w = 0; w < warpCount; w++)
+        {
+            state.gradient[i] += value(rng);
+            state.gradientCount[i] += 1.f;
+        }
+        if (rng() % 1000 == 0) state.gradient[i] = std::numeric_limits<float>::infinity();
+    }
+}
+
+/// The training loop of ComputePathTracer::execute(), train[frame] selects the frames that run a descent.
+void runTraining(OptimizerState& state, const OptimizerDesc& desc, const std::vector<bool>& train, bool fused, uint32_t sparseEnd = 0)
+{
+    bool gradientsCleared = false;
+    for (int frame = 0; frame < int(train.size()); frame++)
+    {
+        for (uint32_t i = 0; i < kIterationsPerFrame; i++)
+        {
+            if (!gradientsCleared) clearGradients(state.getBuffers());
+            accumulateGradients(state, frame * kIterationsPerFrame + i);
+            if (train[frame])
+            {
+                if (fused) fusedOptimizerStep(desc, frame, state.getBuffers(), {kGridBegin, sparseEnd});
+                else gradientDescent(desc, frame, state.getBuffers());
+            }
+            gradientsCleared = train[frame] && fused;
+        }
+    }
+}
+
+template<typename T>
+bool isBitwiseEqual(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+bool isZero(const std::vector<float>& values)
+{
+    for (float v : values)
+        if (v != 0.f) return false;
+    return true;
+}
+/// Mean squared distance of the filtered grid parameters, the ones used for rendering, to their targets.
+float computeLoss(const OptimizerState& state, const std::vector<float>& targets)
+{
+    float loss = 0.f;
+    for (uint32_t i = kGridBegin; i < kParamCount; i++)
+    {
+        const float d = float(state.filteredPrimal[i]) - targets[i];
+        loss += d * d;
+    }
+    return loss / float(kParamCount - kGridBegin);
+}
+
+/// Fits the grid parameters to the targets, every iteration a fifth of them gets the gradient of the squared distance.
+void fitTargets(OptimizerState& state, const std::vector<float>& targets, bool lazy, uint32_t frameCount)
+{
+    OptimizerDesc desc;
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    clearGradients(state.getBuffers());
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        for (uint32_t i = 0; i < kIterationsPerFrame; i++)
+        {
+            for (uint32_t p = kGridBegin; p < kParamCount; p++)
+            {
+                if (u(rng) > 0.2f) continue;
+                state.gradient[p] += 2.f * (float(state.primal[p]) - targets[p]);
+                state.gradientCount[p] += 1.f;
+            }
+            const uint32_t iteration = frame * kIterationsPerFrame + i;
+            fusedOptimizerStep(desc, frame, state.getBuffers(), {kGridBegin, lazy ? kParamCount : 0, lazy, iteration});
+        }
+    }
+}
+} // namespace
+
+CPU_TEST(TinynnOptimizer_FusedMatchesUnfused)
+{
+    const std::vector<bool> train = {true, true, false, true, true, true};
+    for (OptimizerType type : {OptimizerType::SGD, OptimizerType::Adam})
+    {
+        OptimizerDesc desc;
+        desc.type = type;
+        if (type == OptimizerType::SGD) desc.param1 = 0.1f;
+
+        OptimizerState unfused(1);
+        OptimizerState fused(1);
+        runTraining(unfused, desc, train, false);
+        runTraining(fused, desc, train, true);
+
+        EXPECT(isBitwiseEqual(fused.primal, unfused.primal)) << "type " << uint32_t(type);
+        EXPECT(isBitwiseEqual(fused.filteredPrimal, unfused.filteredPrimal)) << "type " << uint32_t(type);
+        EXPECT(isBitwiseEqual(fused.aux, unfused.aux)) << "type " << uint32_t(type);
+        // the fused pass consumed the gradients of the last iteration
+        EXPECT(isZero(fused.gradient));
+        EXPECT(isZero(fused.gradientCount));
+        // the parameters actually moved
+        EXPECT(!isBitwiseEqual(fused.primal, OptimizerState(1).primal));
+    }
+}
+
+CPU_TEST(TinynnOptimizer_FusedKeepsTrainingDisabledGradients)
+{
+    // without a descent the gradients are not consumed and the next iteration has to clear them
+    OptimizerDesc desc;
+    OptimizerState unfused(2);
+    OptimizerState fused(2);
+    runTraining(unfused, desc, {true, false}, false);
+    runTraining(fused, desc, {true, false}, true);
+    EXPECT(isBitwiseEqual(fused.gradient, unfused.gradient));
+    EXPECT(isBitwiseEqual(fused.gradientCount, unfused.gradientCount));
+    EXPECT(!isZero(fused.gradientCount));
+}
+
+CPU_TEST(TinynnOptimizer_SparseFeatureGridUpdate)
+{
+    OptimizerDesc desc;
+    OptimizerState dense(3);
+    OptimizerState sparse(3);
+    runTraining(dense, desc, {true}, true);
+    runTraining(sparse, desc, {true}, true);
+
+    // one more step from the same state, the sparse step only skips grid parameters without gradient
+    const OptimizerState before = sparse;
+    accumulateGradients(dense, 100);
+    accumulateGradients(sparse, 100);
+    const std::vector<float> count = sparse.gradientCount;
+    fusedOptimizerStep(desc, 1, dense.getBuffers());
+    fusedOptimizerStep(desc, 1, sparse.getBuffers(), {kGridBegin, kParamCount});
+
+    uint32_t skipped = 0;
+    for (uint32_t i = 0; i < kParamCount; i++)
+    {
+        const bool skip = i >= kGridBegin && count[i] == 0.f;
+        const OptimizerState& expected = skip ? before : dense;
+        skipped += skip;
+        EXPECT_EQ(sparse.primal[i].toBits(), expected.primal[i].toBits()) << "param " << i;
+        EXPECT_EQ(sparse.filteredPrimal[i].toBits(), expected.filteredPrimal[i].toBits()) << "param " << i;
+        EXPECT_EQ(sparse.aux[2 * i + 0], expected.aux[2 * i + 0]) << "param " << i;
+        EXPECT_EQ(sparse.aux[2 * i + 1], expected.aux[2 * i + 1]) << "param " << i;
+        EXPECT_EQ(sparse.gradient[i], 0.f) << "param " << i;
+        EXPECT_EQ(sparse.gradientCount[i], 0.f) << "param " << i;
+    }
+    EXPECT_GE(skipped, (kParamCount - kGridBegin) / 2);
+}
+CPU_TEST(TinynnOptimizer_LazyAdamCatchUp)
+{
+    // one grid parameter gets a gradient, skips some iterations and gets the next one, late enough for settled bias corrections
+    const int step = 2000;
+    for (uint32_t skipped : {0u, 1u, 7u, 40u})
+    {
+        OptimizerDesc desc;
+        OptimizerState dense(5);
+        OptimizerState lazy(5);
+        const uint32_t p = kGridBegin + 3;
+        for (uint32_t iteration = 0; iteration < skipped + 2; iteration++)
+        {
+            const bool hit = iteration == 0 || iteration == skipped + 1;
+            for (OptimizerState* state : {&dense, &lazy})
+            {
+                clearGradients(state->getBuffers());
+                state->gradient[p] = hit ? (iteration == 0 ? 0.5f : -0.25f) : 0.f;
+                state->gradientCount[p] = hit ? 1.f : 0.f;
+            }
+            fusedOptimizerStep(desc, step, dense.getBuffers());
+            fusedOptimizerStep(desc, step, lazy.getBuffers(), {kGridBegin, kParamCount, true, iteration});
+        }
+        // the dense primal is rounded to half after every step
+        EXPECT_LE(std::abs(float(lazy.primal[p]) - float(dense.primal[p])), 1e-4f + 1e-3f * std::abs(float(dense.primal[p])))
+            << "skipped " << skipped;
+        EXPECT_LE(std::abs(lazy.aux[2 * p + 0] - dense.aux[2 * p + 0]), 1e-5f * std::abs(dense.aux[2 * p + 0])) << "skipped " << skipped;
+        EXPECT_LE(std::abs(lazy.aux[2 * p + 1] - dense.aux[2 * p + 1]), 1e-5f * std::abs(dense.aux[2 * p + 1])) << "skipped " << skipped;
+        EXPECT_LE(std::abs(float(lazy.filteredPrimal[p]) - float(dense.filteredPrimal[p])), 1e-3f) << "skipped " << skipped;
+        // untouched grid parameters keep their state
+        EXPECT_EQ(lazy.primal[p + 1].toBits(), OptimizerState(5).primal[p + 1].toBits());
+    }
+}
+
+CPU_TEST(TinynnOptimizer_LazyAdamConverges)
+{
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+    std::vector<float> targets(kParamCount);
+    for (float& t : targets)
+        t = dist(rng);
+
+    OptimizerState dense(7);
+    OptimizerState lazy(7);
+    const float initialLoss = computeLoss(dense, targets);
+    fitTargets(dense, targets, false, 500);
+    fitTargets(lazy, targets, true, 500);
+    const float denseLoss = computeLoss(dense, targets);
+    const float lazyLoss = computeLoss(lazy, targets);
+    EXPECT_LT(denseLoss, 1e-3f * initialLoss);
+    EXPECT_LT(lazyLoss, 1e-3f * initialLoss) << "dense " << denseLoss;
+
+    // both end up at the same solution up to the noise of the learning rate
+    float difference = 0.f;
+    for (uint32_t i = kGridBegin; i < kParamCount; i++)
+    {
+        const float d = float(lazy.filteredPrimal[i]) - float(dense.filteredPrimal[i]);
+        difference += d * d;
+    }
+    EXPECT_LT(std::sqrt(difference / float(kParamCount - kGridBegin)), OptimizerDesc().learningRate);
+}
+} // namespace Falcor
@@ -0,0 +1,119 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Host/TrainingBudget.h"
+
+#include <cmath>
+#include <limits>
+
+namespace Falcor
+{
+CPU_TEST(TrainingBudget_Levels)
+{
+    TrainingBudget::Desc desc;
+    desc.maxIterations = 4;
+    desc.maxLevel = 4;
+    desc.window = 1;
+    TrainingBudget budget(desc);
+    // the iterations are halved first, then the paths are quartered
+    const uint32_t expected[][2] = {{4, 1}, {2, 1}, {1, 1}, {1, 2}, {1, 4}};
+    for (uint32_t level = 0; level <= desc.maxLevel; level++)
+    {
+        EXPECT_EQ(budget.getLevel(), level);
+        EXPECT_EQ(budget.getBudget().iterations, expected[level][0]) << "level=" << level;
+        EXPECT_EQ(budget.getBudget().pathTileScale, expected[level][1]) << "level=" << level;
+        budget.addLoss(1.f);
+    }
+    // the lowest level is kept
+    EXPECT_EQ(budget.getLevel(), desc.maxLevel);
+
+    desc.maxIterations = 0;
+    EXPECT_THROW(TrainingBudget{desc});
+}
+
+CPU_TEST(TrainingBudget_Plateau)
+{
+    TrainingBudget::Desc desc;
+    TrainingBudget budget(desc);
+    // a converging nn keeps the full budget
+    float loss = 1.f;
+    for (uint32_t i = 0; i < 5 * desc.window; i++, loss *= 0.97f)
+        budget.addLoss(loss);
+    EXPECT_EQ(budget.getLevel(), 0u);
+
+    // the smoothed loss lags behind, once it settled there is one level per window with a flat loss
+    for (uint32_t i = 0; i < 2 * desc.window; i++)
+        budget.addLoss(loss);
+    const uint32_t settledLevel = budget.getLevel();
+    EXPECT_LE(settledLevel, 2u);
+    for (uint32_t level = settledLevel + 1; level <= settledLevel + 2; level++)
+    {
+        for (uint32_t i = 0; i < desc.window; i++)
+            budget.addLoss(loss);
+        EXPECT_EQ(budget.getLevel(), level);
+    }
+    // noise below the plateau threshold does not count as progress
+    budget.reset();
+    for (uint32_t i = 0; i < desc.window; i++)
+        budget.addLoss(loss * (i % 2 == 0 ? 1.01f : 0.99f));
+    EXPECT_EQ(budget.getLevel(), 1u);
+}
+
+CPU_TEST(TrainingBudget_Restore)
+{
+    TrainingBudget::Desc desc;
+    TrainingBudget budget(desc);
+    for (uint32_t i = 0; i < 2 * desc.window; i++)
+        budget.addLoss(0.5f);
+    EXPECT_EQ(budget.getLevel(), 2u);
+
+    // invalid samples are ignored
+    budget.addLoss(std::numeric_limits<float>::quiet_NaN());
+    budget.addLoss(std::numeric_limits<float>::infinity());
+    budget.addLoss(-1.f);
+    EXPECT_EQ(budget.getSmoothedLoss(), 0.5f);
+
+    // a loss rising above the plateau restores the full budget within a few frames
+    uint32_t frames = 0;
+    while (budget.getLevel() > 0 && frames < 10)
+    {
+        budget.addLoss(1.f);
+        frames++;
+    }
+    EXPECT_EQ(budget.getLevel(), 0u);
+    EXPECT_LE(frames, 5u);
+
+    for (uint32_t i = 0; i < 3 * desc.window; i++)
+        budget.addLoss(0.5f);
+    EXPECT(budget.getLevel() > 0);
+    budget.reset();
+    EXPECT_EQ(budget.getLevel(), 0u);
+    EXPECT_EQ(budget.getSmoothedLoss(), 0.f);
+    EXPECT_EQ(budget.getBudget().iterations, desc.maxIterations);
+}
+} // namespace Falcor
@@ -0,0 +1,228 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "CacheTestUtils.h"
+#include "Host/RadianceHashCache.h"
+#include "Host/VoxelPacking.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+float maxComponent(float3 v)
+{
+    return std::max(v.x, std::max(v.y, v.z));
+}
+} // namespace
+
+CPU_TEST(VoxelPacking_RGB9E5)
+{
+    EXPECT_EQ(hc::encodeRGB9E5(float3(0.f)), 0u);
+    EXPECT_EQ(hc::decodeRGB9E5(0), float3(0.f));
+    // values with few mantissa bits are exact
+    for (float3 value : {float3(1.f, 0.5f, 0.25f), float3(3.f, 0.f, 1.5f), float3(hc::kRGB9E5Max), float3(1.f / 1024.f, 0.f, 0.f)})
+        EXPECT_EQ(hc::decodeRGB9E5(hc::encodeRGB9E5(value)), value);
+    EXPECT_EQ(hc::encodeRGB9E5(float3(1.f, 0.5f, 0.25f)), 0x81010100u);
+
+    // out of range input is clamped, negative and NaN components become 0
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    EXPECT_EQ(hc::decodeRGB9E5(hc::encodeRGB9E5(float3(1e9f, inf, 1.f))), float3(hc::kRGB9E5Max, hc::kRGB9E5Max, 0.f));
+    EXPECT_EQ(hc::decodeRGB9E5(hc::encodeRGB9E5(float3(-1.f, nan, 2.f))), float3(0.f, 0.f, 2.f));
+    // rounding up the largest mantissa moves to the next exponent
+    EXPECT_EQ(hc::decodeRGB9E5(hc::encodeRGB9E5(float3(1.9999f, 0.f, 0.f))), float3(2.f, 0.f, 0.f));
+
+    // the error of every channel is at most half a step of the shared exponent
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> exponentDist(-20.f, 15.f);
+    std::uniform_real_distribution<float> ratioDist(0.f, 1.f);
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        const float scale = std::exp2(exponentDist(rng));
+        const float3 value = float3(ratioDist(rng), ratioDist(rng), ratioDist(rng)) * scale;
+        const uint32_t packed = hc::encodeRGB9E5(value);
+        const float3 decoded = hc::decodeRGB9E5(packed);
+        const float step = hc::exp2i(int(packed >> 27) - 24);
+        EXPECT_LE(std::abs(decoded.x - value.x), 0.5f * step) << "value " << value.x;
+        EXPECT_LE(std::abs(decoded.y - value.y), 0.5f * step) << "value " << value.y;
+        EXPECT_LE(std::abs(decoded.z - value.z), 0.5f * step) << "value " << value.z;
+        // the largest channel keeps 8 to 9 significant bits above the smallest exponent
+        if (maxComponent(value) >= std::exp2(-15.f)) EXPECT_LE(std::abs(maxComponent(decoded) - maxComponent(value)), maxComponent(value) / 256.f);
+        // decoded values are representable, encoding them again is lossless
+        EXPECT_EQ(hc::decodeRGB9E5(hc::encodeRGB9E5(decoded)), decoded);
+    }
+}
+
+CPU_TEST(VoxelPacking_Accumulator)
+{
+    EXPECT_EQ(hc::decodeAccumulator(0), float3(0.f));
+    // non-positive and NaN input does not change the accumulator
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_EQ(hc::accumulate(0, float3(-1.f, 0.f, nan)), 0ull);
+
+    // integer sums stay exact while they fit into the mantissa
+    uint64_t accumulator = 0;
+    for (uint32_t i = 0; i < 1000; i++)
+        accumulator = hc::accumulate(accumulator, float3(1.f, 2.f, 0.f));
+    EXPECT_EQ(hc::decodeAccumulator(accumulator), float3(1000.f, 2000.f, 0.f));
+
+    // the exponent grows with the sum instead of overflowing
+    accumulator = hc::accumulate(0, float3(1e-6f));
+    accumulator = hc::accumulate(accumulator, float3(1e6f, 0.f, 0.f));
+    const float3 mixed = hc::decodeAccumulator(accumulator);
+    EXPECT_LE(std::abs(mixed.x - 1e6f), 1e6f * 4e-6f);
+    EXPECT_LE(mixed.y, 1e6f * 4e-6f);
+
+    // random HDR sums, the relative error of the largest channel is bounded by the rounding of every addition
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> exponentDist(-10.f, 10.f);
+    std::uniform_real_distribution<float> ratioDist(0.f, 1.f);
+    for (uint32_t run = 0; run < 100; run++)
+    {
+        const uint32_t sampleCount = 1 + run * 20;
+        accumulator = 0;
+        double reference[3] = {};
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            const float3 value = float3(ratioDist(rng), ratioDist(rng), ratioDist(rng)) * std::exp2(exponentDist(rng));
+            accumulator = hc::accumulate(accumulator, value);
+            reference[0] += value.x;
+            reference[1] += value.y;
+            reference[2] += value.z;
+        }
+        const float3 sum = hc::decodeAccumulator(accumulator);
+        const double maxReference = std::max(reference[0], std::max(reference[1], reference[2]));
+        const double tolerance = maxReference * std::exp2(-18.0) * sampleCount;
+        EXPECT_LE(std::abs(sum.x - reference[0]), tolerance) << "run " << run;
+        EXPECT_LE(std::abs(sum.y - reference[1]), tolerance) << "run " << run;
+        EXPECT_LE(std::abs(sum.z - reference[2]), tolerance) << "run " << run;
+    }
+}
+
+CPU_TEST(VoxelPacking_PackedCache)
+{
+    // both layouts produce the same estimates up to the RGB9E5 precision
+    for (auto method : {RadianceHashCache::Method::RHC, RadianceHashCache::Method::IRHC})
+    {
+        RadianceHashCache floatCache(method, 10);
+        RadianceHashCache packedCache(method, 10, RadianceHashGrid::ProbingScheme::Linear, RadianceHashCache::VoxelLayout::Packed);
+        const auto hit = makeHit(float3(0.5f, 0.25f, -0.75f));
+        const auto floatIdx = floatCache.insertEntries(hit);
+        const auto packedIdx = packedCache.insertEntries(hit);
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> valueDist(0.f, 4.f);
+        for (uint32_t frame = 0; frame < 40; frame++)
+        {
+            for (uint32_t i = 0; i < frame % 5; i++)
+            {
+                const float3 value(valueDist(rng), valueDist(rng), valueDist(rng));
+                floatCache.addVoxelData(floatIdx, value, true);
+                packedCache.addVoxelData(packedIdx, value, true);
+            }
+            EXPECT_EQ(packedCache.getVoxelData(false, packedIdx[0]).sampleNum, floatCache.getVoxelData(false, floatIdx[0]).sampleNum);
+            floatCache.resolve();
+            packedCache.resolve();
+
+            float3 floatRadiance;
+            float3 packedRadiance;
+            EXPECT_EQ(floatCache.getCachedRadiance(hit, floatRadiance), packedCache.getCachedRadiance(hit, packedRadiance));
+            const float tolerance = maxComponent(floatRadiance) / 128.f;
+            EXPECT_LE(std::abs(packedRadiance.x - floatRadiance.x), tolerance) << "frame " << frame;
+            EXPECT_LE(std::abs(packedRadiance.y - floatRadiance.y), tolerance) << "frame " << frame;
+            EXPECT_LE(std::abs(packedRadiance.z - floatRadiance.z), tolerance) << "frame " << frame;
+            floatCache.endFrame();
+            packedCache.endFrame();
+        }
+    }
+
+    // the sample count saturates at 16 bits
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10, RadianceHashGrid::ProbingScheme::Linear, RadianceHashCache::VoxelLayout::Packed);
+    const auto idx = cache.insertEntries(makeHit(float3(0.f)));
+    cache.setVoxelData(idx[0], {float3(1.f), 65530});
+    for (uint32_t i = 0; i < 10; i++)
+        cache.addVoxelData(idx, float3(1.f), true);
+    cache.resolve();
+    EXPECT_EQ(cache.getVoxelData(true, idx[0]).sampleNum, 0xffffu);
+    EXPECT_EQ(cache.getVoxelData(true, idx[0]).radiance, float3(1.f));
+
+    // so does the count of a single frame, a wrapped count would inflate the estimate
+    cache.setVoxelData(idx[0], {float3(0.f), 0});
+    for (uint32_t i = 0; i < 70000; i++)
+        cache.addVoxelData(idx, float3(1.f), true);
+    cache.resolve();
+    EXPECT_EQ(cache.getVoxelData(true, idx[0]).sampleNum, 0xffffu);
+    EXPECT_LE(cache.getVoxelData(true, idx[0]).radiance.x, 70000.f / 0xffff + 0.01f);
+}
+
+CPU_TEST(VoxelPacking_DropRadianceWithoutSamples)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10, RadianceHashGrid::ProbingScheme::Linear, RadianceHashCache::VoxelLayout::Packed);
+    const auto idx = cache.insertEntries(makeHit(float3(0.f)));
+
+    // radiance spread to a voxel without samples does not carry over to the next frame
+    cache.addVoxelData(idx, float3(100.f), false);
+    cache.resolve();
+    cache.endFrame();
+    cache.addVoxelData(idx, float3(1.f), true);
+    cache.resolve();
+    EXPECT_EQ(cache.getVoxelData(true, idx[0]).sampleNum, 1u);
+    EXPECT_EQ(cache.getVoxelData(true, idx[0]).radiance, float3(1.f));
+}
+
+CPU_TEST(VoxelPacking_ConcurrentAccumulate)
+{
+    RadianceHashCache cache(RadianceHashCache::Method::RHC, 10, RadianceHashGrid::ProbingScheme::Linear, RadianceHashCache::VoxelLayout::Packed);
+    const auto idx = cache.insertEntries(makeHit(float3(0.f)));
+    const uint32_t threadCount = 8;
+    const uint32_t sampleCount = 1000;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (uint32_t i = 0; i < sampleCount; i++)
+                    cache.addVoxelData(idx, float3(2.f), true);
+            }
+        );
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(cache.getVoxelData(false, idx[0]).sampleNum, threadCount * sampleCount);
+    cache.resolve();
+    // the accumulated sum is exact, so the mean is as well
+    EXPECT_EQ(cache.getVoxelData(true, idx[0]).radiance, float3(2.f));
+}
+} // namespace Falcor
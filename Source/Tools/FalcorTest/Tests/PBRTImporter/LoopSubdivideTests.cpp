@@ -0,0 +1,234 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "LoopSubdivide.h"
+
+#include <cmath>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const float kEpsilon = 1e-6f;
+
+struct Expected
+{
+    std::vector<uint32_t> indices;
+    std::vector<float3> positions;
+    std::vector<float3> normals;
+};
+
+// Results of the previous pbrt-v3 style implementation.
+
+const std::vector<float3> kTetraPositions = {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}};
+const std::vector<uint32_t> kTetraIndices = {0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3};
+const Expected kTetraLevel1 = {
+    {
+        0, 4, 6, 4, 2, 5, 6, 5, 1, 4, 5, 6, //
+        0, 6, 8, 6, 1, 7, 8, 7, 3, 6, 7, 8, //
+        0, 8, 4, 8, 3, 9, 4, 9, 2, 8, 9, 4, //
+        1, 5, 7, 5, 2, 9, 7, 9, 3, 5, 9, 7, //
+    },
+    {
+        {0.200000003f, 0.199999988f, 0.200000018f},
+        {0.399999976f, 0.200000018f, 0.199999988f},
+        {0.199999988f, 0.399999976f, 0.200000018f},
+        {0.200000018f, 0.199999988f, 0.399999976f},
+        {0.177083328f, 0.322916657f, 0.177083328f},
+        {0.322916657f, 0.322916687f, 0.177083328f},
+        {0.322916687f, 0.177083328f, 0.177083328f},
+        {0.322916687f, 0.177083328f, 0.322916657f},
+        {0.177083328f, 0.177083328f, 0.322916687f},
+        {0.177083328f, 0.322916657f, 0.322916687f},
+    },
+    {
+        {0.0184180867f, 0.0184180811f, 0.0184180774f},
+        {-0.0184180867f, -1.88194815e-09f, 2.22044605e-16f},
+        {4.3461732e-09f, -0.0184180867f, 2.17308527e-09f},
+        {-1.88194815e-09f, 2.22044605e-16f, -0.0184180867f},
+        {0.0873543099f, -1.86264515e-08f, 0.0873543546f},
+        {-0.0873542577f, -0.0873543024f, -4.47034836e-08f},
+        {2.42143869e-08f, 0.0873542652f, 0.0873543024f},
+        {-0.0873543024f, -5.21540642e-08f, -0.0873542577f},
+        {0.0873542503f, 0.0873543173f, 2.04890966e-08f},
+        {-3.35276127e-08f, -0.0873542577f, -0.087354295f},
+    },
+};
+
+// Closed fan around an interior vertex of valence 5, the rim vertices are on the boundary.
+const std::vector<float3> kFanPositions = {
+    {0.f, 0.f, 0.f},
+    {1.f, 0.f, 0.f},
+    {0.5f, 1.f, 0.f},
+    {-0.5f, 1.f, 0.f},
+    {-1.f, 0.f, 0.f},
+    {0.f, -1.f, 0.5f},
+};
+const std::vector<uint32_t> kFanIndices = {0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5, 0, 5, 1};
+const Expected kFanLevel1 = {
+    {
+        0, 6,  8,  6,  1, 7,  8,  7,  2, 6,  7,  8,  //
+        0, 8,  10, 8,  2, 9,  10, 9,  3, 8,  9,  10, //
+        0, 10, 12, 10, 3, 11, 12, 11, 4, 10, 11, 12, //
+        0, 12, 14, 12, 4, 13, 14, 13, 5, 12, 13, 14, //
+        0, 14, 6,  14, 5, 15, 6,  15, 1, 14, 15, 6,  //
+    },
+    {
+        {-3.7252903e-09f, 0.100000001f, 0.0500000045f},
+        {0.737500072f, 0.f, 0.087500006f},
+        {0.412500024f, 0.825000048f, 0.f},
+        {-0.412500024f, 0.825000048f, 0.f},
+        {-0.737500072f, 0.f, 0.087500006f},
+        {0.f, -0.650000036f, 0.325000018f},
+        {0.411458343f, 0.0166666694f, 0.0760416612f},
+        {0.700000048f, 0.475000024f, 0.0125000002f},
+        {0.239583343f, 0.495833308f, 0.00833333377f},
+        {0.f, 0.950000048f, 0.f},
+        {-0.239583343f, 0.495833308f, 0.00833333377f},
+        {-0.699999988f, 0.475000024f, 0.0125000002f},
+        {-0.411458343f, 0.0166666694f, 0.0760416687f},
+        {-0.462500036f, -0.450000018f, 0.237500012f},
+        {0.f, -0.327083319f, 0.180208325f},
+        {0.462500036f, -0.450000018f, 0.237500012f},
+    },
+    {
+        {1.35571252e-08f, -0.227460623f, -1.19099927f},
+        {0.00684896857f, -0.0760807469f, -0.305546969f},
+        {0.000156250782f, -0.00799479242f, -0.312552154f},
+        {-0.000156250782f, -0.00799479149f, -0.312552154f},
+        {-0.00684896205f, -0.0760807469f, -0.305546969f},
+        {0.f, -0.133932322f, -0.298697978f},
+        {0.0442071557f, -0.440276623f, -1.88592482f},
+        {0.0192187726f, -0.12747398f, -1.27328157f},
+        {0.0110395625f, -0.147545695f, -1.94117117f},
+        {0.f, -0.0275000036f, -1.29250038f},
+        {-0.0110395355f, -0.14754571f, -1.94117117f},
+        {-0.0192187615f, -0.12747398f, -1.27328146f},
+        {-0.0442070961f, -0.440276533f, -1.88592422f},
+        {-0.0230729282f, -0.475963652f, -1.23098993f},
+        {-1.49011612e-08f, -0.660684586f, -1.84171748f},
+        {0.0230729431f, -0.475963682f, -1.23098993f},
+    },
+};
+
+bool isNear(float3 a, float3 b)
+{
+    return std::abs(a.x - b.x) <= kEpsilon && std::abs(a.y - b.y) <= kEpsilon && std::abs(a.z - b.z) <= kEpsilon;
+}
+
+void testExpected(CPUUnitTestContext& ctx, const pbrt::LoopSubdivideResult& result, const Expected& expected)
+{
+    EXPECT(result.indices == expected.indices);
+    ASSERT_EQ(result.positions.size(), expected.positions.size());
+    ASSERT_EQ(result.normals.size(), expected.normals.size());
+    for (size_t i = 0; i < expected.positions.size(); ++i)
+    {
+        EXPECT_MSG(isNear(result.positions[i], expected.positions[i]), fmt::format("position {}", i));
+        EXPECT_MSG(isNear(result.normals[i], expected.normals[i]), fmt::format("normal {}", i));
+    }
+}
+
+/// Triangulated torus with n x n quads, a closed surface with Euler characteristic 0.
+void createTorus(uint32_t n, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+{
+    for (uint32_t y = 0; y < n; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            float a = 2.f * float(M_PI) * x / n;
+            float b = 2.f * float(M_PI) * y / n;
+            positions.push_back(float3((2.f + std::cos(b)) * std::cos(a), (2.f + std::cos(b)) * std::sin(a), std::sin(b)));
+            uint32_t v00 = y * n + x;
+            uint32_t v10 = y * n + (x + 1) % n;
+            uint32_t v01 = ((y + 1) % n) * n + x;
+            uint32_t v11 = ((y + 1) % n) * n + (x + 1) % n;
+            indices.insert(indices.end(), {v00, v11, v10, v00, v01, v11});
+        }
+    }
+}
+} // namespace
+
+CPU_TEST(LoopSubdivide_Tetrahedron)
+{
+    testExpected(ctx, pbrt::loopSubdivide(1, kTetraPositions, kTetraIndices), kTetraLevel1);
+}
+
+CPU_TEST(LoopSubdivide_Boundary)
+{
+    testExpected(ctx, pbrt::loopSubdivide(1, kFanPositions, kFanIndices), kFanLevel1);
+}
+
+CPU_TEST(LoopSubdivide_Torus)
+{
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    createTorus(32, positions, indices);
+
+    size_t vertexCount = positions.size();
+    size_t faceCount = indices.size() / 3;
+    for (uint32_t levels = 0; levels <= 3; ++levels)
+    {
+        auto result = pbrt::loopSubdivide(levels, positions, indices);
+
+        // Every level adds one vertex per edge and splits every face into four.
+        ASSERT_EQ(result.positions.size(), vertexCount);
+        ASSERT_EQ(result.normals.size(), vertexCount);
+        ASSERT_EQ(result.indices.size(), 3 * faceCount);
+        for (uint32_t index : result.indices)
+            ASSERT_LT(index, vertexCount);
+
+        // The limit surface stays close to the torus and the normals point outwards.
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            float3 p = result.positions[i];
+            float3 center = 2.f * normalize(float3(p.x, p.y, 0.f));
+            float3 outward = normalize(p - center);
+            EXPECT_LT(std::abs(length(p - center) - 1.f), 0.05f);
+            EXPECT_GT(dot(normalize(result.normals[i]), outward), 0.99f);
+        }
+
+        size_t edgeCount = 3 * faceCount / 2;
+        vertexCount += edgeCount;
+        faceCount *= 4;
+    }
+}
+
+CPU_TEST(LoopSubdivide_UnreferencedVertex)
+{
+    std::vector<float3> positions = kTetraPositions;
+    positions.push_back(float3(5.f));
+    auto result = pbrt::loopSubdivide(1, positions, kTetraIndices);
+
+    // The unreferenced vertex keeps its index and position, the odd vertices follow.
+    ASSERT_EQ(result.positions.size(), kTetraLevel1.positions.size() + 1);
+    EXPECT(all(result.positions[4] == float3(5.f)));
+    for (size_t i = 0; i < 4; ++i)
+        EXPECT(isNear(result.positions[i], kTetraLevel1.positions[i]));
+}
+} // namespace Falcor
@@ -0,0 +1,67 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+namespace Falcor
+{
+/// Directory of the files written by the importer tests.
+inline std::filesystem::path getTestDirectory()
+{
+    return std::filesystem::temp_directory_path() / "FalcorTest";
+}
+
+/**
+ * File in the test directory that is written on construction and removed when the test leaves its scope, also on a failed ASSERT.
+ * Files of one test can reference each other by name.
+ */
+class TestFile
+{
+public:
+    TestFile(const std::string& name, const std::string& data) : mPath(getTestDirectory() / name)
+    {
+        std::filesystem::create_directories(mPath.parent_path());
+        std::ofstream(mPath, std::ios::binary).write(data.data(), data.size());
+    }
+    TestFile(const TestFile&) = delete;
+    TestFile& operator=(const TestFile&) = delete;
+    ~TestFile()
+    {
+        std::error_code ec;
+        std::filesystem::remove(mPath, ec);
+    }
+
+    const std::filesystem::path& getPath() const { return mPath; }
+
+private:
+    std::filesystem::path mPath;
+};
+} // namespace Falcor
@@ -0,0 +1,269 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Parser.h"
+#include "PBRTImporterTestUtils.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using namespace pbrt;
+
+/// Records the statements passed on by the parser, one line each.
+class RecordingTarget : public ParserTarget
+{
+public:
+    std::vector<std::string> statements;
+    std::vector<FileLoc> locs;
+
+    void onScale(Float sx, Float sy, Float sz, FileLoc loc) override { add(fmt::format("Scale {} {} {}", sx, sy, sz), loc); }
+    void onShape(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("Shape " + name + formatParams(params), loc); }
+    void onOption(const std::string& name, const std::string& value, FileLoc loc) override { add("Option " + name, loc); }
+    void onIdentity(FileLoc loc) override { add("Identity", loc); }
+    void onTranslate(Float dx, Float dy, Float dz, FileLoc loc) override { add(fmt::format("Translate {} {} {}", dx, dy, dz), loc); }
+    void onRotate(Float angle, Float ax, Float ay, Float az, FileLoc loc) override { add("Rotate", loc); }
+    void onLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz, Float ux, Float uy, Float uz, FileLoc loc) override { add("LookAt", loc); }
+    void onConcatTransform(Float transform[16], FileLoc loc) override { add("ConcatTransform", loc); }
+    void onTransform(Float transform[16], FileLoc loc) override { add("Transform", loc); }
+    void onCoordinateSystem(const std::string& name, FileLoc loc) override { add("CoordinateSystem " + name, loc); }
+    void onCoordSysTransform(const std::string& name, FileLoc loc) override { add("CoordSysTransform " + name, loc); }
+    void onActiveTransformAll(FileLoc loc) override { add("ActiveTransformAll", loc); }
+    void onActiveTransformEndTime(FileLoc loc) override { add("ActiveTransformEndTime", loc); }
+    void onActiveTransformStartTime(FileLoc loc) override { add("ActiveTransformStartTime", loc); }
+    void onTransformTimes(Float start, Float end, FileLoc loc) override { add("TransformTimes", loc); }
+    void onColorSpace(const std::string& name, FileLoc loc) override { add("ColorSpace " + name, loc); }
+    void onPixelFilter(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("PixelFilter " + name, loc); }
+    void onFilm(const std::string& type, ParsedParameterVector params, FileLoc loc) override { add("Film " + type, loc); }
+    void onAccelerator(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("Accelerator " + name, loc); }
+    void onIntegrator(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("Integrator " + name, loc); }
+    void onCamera(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("Camera " + name, loc); }
+    void onMakeNamedMedium(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("MakeNamedMedium " + name, loc); }
+    void onMediumInterface(const std::string& insideName, const std::string& outsideName, FileLoc loc) override { add("MediumInterface", loc); }
+    void onSampler(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("Sampler " + name, loc); }
+    void onWorldBegin(FileLoc loc) override { add("WorldBegin", loc); }
+    void onAttributeBegin(FileLoc loc) override { add("AttributeBegin", loc); }
+    void onAttributeEnd(FileLoc loc) override { add("AttributeEnd", loc); }
+    void onAttribute(const std::string& target, ParsedParameterVector params, FileLoc loc) override { add("Attribute " + target, loc); }
+    void onTexture(const std::string& name, const std::string& type, const std::string& texname, ParsedParameterVector params, FileLoc loc)
+        override
+    {
+        add("Texture " + name + formatParams(params), loc);
+    }
+    void onMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("Material " + name, loc); }
+    void onMakeNamedMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("MakeNamedMaterial " + name, loc); }
+    void onNamedMaterial(const std::string& name, FileLoc loc) override { add("NamedMaterial " + name, loc); }
+    void onLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("LightSource " + name, loc); }
+    void onAreaLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override { add("AreaLightSource " + name, loc); }
+    void onReverseOrientation(FileLoc loc) override { add("ReverseOrientation", loc); }
+    void onObjectBegin(const std::string& name, FileLoc loc) override { add("ObjectBegin " + name, loc); }
+    void onObjectEnd(FileLoc loc) override { add("ObjectEnd", loc); }
+    void onObjectInstance(const std::string& name, FileLoc loc) override { add("ObjectInstance " + name, loc); }
+    void onEndOfFiles() override { add("EndOfFiles", {}); }
+
+private:
+    void add(std::string statement, FileLoc loc)
+    {
+        statements.push_back(std::move(statement));
+        locs.push_back(loc);
+    }
+
+    /// Name, value count and first value of every parameter.
+    static std::string formatParams(const ParsedParameterVector& params)
+    {
+        std::string result;
+        for (const auto& param : params)
+        {
+            result += " " + param.name;
+            if (!param.floats.empty())
+                result += fmt::format(" {}:{}", param.floats.size(), param.floats[0]);
+            if (!param.strings.empty())
+                result += fmt::format(" {}:{}", param.strings.size(), param.strings[0]);
+        }
+        return result;
+    }
+};
+
+/// Size of the chunks the tokenizer splits files into, see Parser.cpp.
+const size_t kChunkSize = 4 * 1024 * 1024;
+/// Comment line of 64 bytes.
+const std::string kPaddingLine = "# " + std::string(61, 'x') + "\n";
+
+/// Float array of the given size whose values start at first.
+std::string floatArray(size_t size, int first)
+{
+    std::string result = "[";
+    for (size_t i = 0; i < size; i++)
+        result += " " + std::to_string(first + int(i));
+    return result + " ]";
+}
+} // namespace
+
+CPU_TEST(PBRTParser_ImportScope)
+{
+    // the first import ends with a statement without parameters, the second one in the parameter list of a shape
+    const TestFile import0("PBRTParser_Import0.pbrt", "Material \"diffuse\"\nTranslate 1 2 3\n");
+    const TestFile import1("PBRTParser_Import1.pbrt", "Shape \"sphere\" \"float radius\" [ 2 ]\n");
+    const TestFile include("PBRTParser_Include.pbrt", "Translate 4 5 6\n");
+    const TestFile file(
+        "PBRTParser_ImportScope.pbrt",
+        "AttributeBegin\n"
+        "Import \"PBRTParser_Import0.pbrt\"\n"
+        "Material \"conductor\"\n"
+        "Import \"PBRTParser_Import1.pbrt\"\n"
+        "Shape \"disk\"\n"
+        "Include \"PBRTParser_Include.pbrt\"\n"
+        "Material \"dielectric\"\n"
+        "AttributeEnd\n"
+    );
+
+    RecordingTarget target;
+    parseFile(target, file.getPath());
+    // the importing file continues after the attribute block of an import, included files share the graphics state
+    const std::vector<std::string> expected = {
+        "AttributeBegin",
+        "AttributeBegin",
+        "Material diffuse",
+        "Translate 1 2 3",
+        "AttributeEnd",
+        "Material conductor",
+        "AttributeBegin",
+        "Shape sphere radius 1:2",
+        "AttributeEnd",
+        "Shape disk",
+        "Translate 4 5 6",
+        "Material dielectric",
+        "AttributeEnd",
+        "EndOfFiles",
+    };
+    EXPECT(target.statements == expected) << fmt::format("{}", fmt::join(target.statements, ", "));
+    // the attribute block of an import is located at the 'Import' directive
+    EXPECT_EQ(target.locs[4].line, 2u);
+    EXPECT_EQ(target.locs[8].line, 4u);
+
+    // statements can not continue past the end of an imported file
+    const TestFile truncated("PBRTParser_ImportTruncated.pbrt", "Translate 1 2\n");
+    const TestFile truncatedMain("PBRTParser_ImportTruncatedMain.pbrt", "Import \"PBRTParser_ImportTruncated.pbrt\"\n3\n");
+    RecordingTarget truncatedTarget;
+    EXPECT_THROW(parseFile(truncatedTarget, truncatedMain.getPath()));
+}
+
+CPU_TEST(PBRTParser_ChunkBoundary)
+{
+    // the statement on line 65536 crosses the end of the first chunk, the next one starts the second chunk
+    std::string str;
+    for (size_t i = 0; i < kChunkSize / kPaddingLine.size() - 1; i++)
+        str += kPaddingLine;
+    str += "Shape \"trianglemesh\" \"string name\" \"a string across the chunk boundary\" \"float radius\" [ 1.25 ]\n";
+    str += "Shape \"sphere\" \"string name\" \"esc\\\"aped\" \"float radius\" [ 0.5 ]\n";
+    FALCOR_ASSERT(str.size() > kChunkSize);
+    while (str.size() < 2 * kChunkSize)
+        str += kPaddingLine;
+    str += "Translate 1 -2 3.5\n";
+    const uint32_t lastLine = uint32_t(std::count(str.begin(), str.end(), '\n'));
+
+    RecordingTarget target;
+    parseString(target, std::move(str));
+    const std::vector<std::string> expected = {
+        "Shape trianglemesh name 1:a string across the chunk boundary radius 1:1.25",
+        "Shape sphere name 1:esc\"aped radius 1:0.5",
+        "Translate 1 -2 3.5",
+        "EndOfFiles",
+    };
+    EXPECT(target.statements == expected) << fmt::format("{}", fmt::join(target.statements, ", "));
+    ASSERT_EQ(target.locs.size(), expected.size());
+    EXPECT_EQ(target.locs[0].line, 65536u);
+    EXPECT_EQ(target.locs[1].line, 65537u);
+    EXPECT_EQ(target.locs[1].column, 0u);
+    EXPECT_EQ(target.locs[2].line, lastLine);
+}
+
+CPU_TEST(PBRTParser_ChunkErrorLine)
+{
+    // tokenizer errors of later chunks are reported at their line in the file
+    std::string str;
+    while (str.size() < 2 * kChunkSize + kChunkSize / 2)
+        str += kPaddingLine;
+    const uint32_t line = uint32_t(str.size() / kPaddingLine.size()) + 2;
+    str += "Translate 1 2 3\n";
+    str += "Shape \"sphere\" \"string name\" \"unterminated\n";
+    str += "Translate 1 2 3\n";
+
+    RecordingTarget target;
+    std::string message;
+    try
+    {
+        parseString(target, std::move(str));
+    }
+    catch (const std::exception& e)
+    {
+        message = e.what();
+    }
+    EXPECT_NE(message.find("Unterminated string"), std::string::npos) << message;
+    EXPECT_NE(message.find(fmt::format(":{}:", line)), std::string::npos) << message;
+    // the statements before the error were passed on
+    EXPECT(!target.statements.empty() && target.statements.back() == "Translate 1 2 3");
+}
+
+CPU_TEST(PBRTParser_DeferredParameterOrder)
+{
+    // long parameter lists are parsed on the thread pool, short ones right away, the target sees them in file order
+    std::string str;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 200; i++)
+    {
+        const size_t size = i % 3 == 0 ? 3 : 300 + i;
+        if (i % 4 == 1)
+        {
+            str += fmt::format("Texture \"tex{}\" \"spectrum\" \"imagemap\" \"float values\" {}\n", i, floatArray(size, i));
+            expected.push_back(fmt::format("Texture tex{} values {}:{}", i, size, i));
+        }
+        else
+        {
+            str += fmt::format("Shape \"trianglemesh\" \"point3 P\" {} \"string name\" \"shape{}\"\n", floatArray(size, i), i);
+            expected.push_back(fmt::format("Shape trianglemesh P {}:{} name 1:shape{}", size, i, i));
+        }
+        if (i % 7 == 0)
+        {
+            str += fmt::format("Translate {} 0 0\n", i);
+            expected.push_back(fmt::format("Translate {} 0 0", i));
+        }
+    }
+    expected.push_back("EndOfFiles");
+
+    RecordingTarget target;
+    parseString(target, std::move(str));
+    ASSERT_EQ(target.statements.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(target.statements[i], expected[i]) << i;
+}
+} // namespace Falcor
@@ -0,0 +1,220 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "PlyReader.h"
+#include "PBRTImporterTestUtils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const std::string kHeaderAscii = "ply\nformat ascii 1.0\n";
+
+// Triangle written as an ASCII file and compressed with gzip.
+const uint8_t kGzipTriangle[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x5d, 0x8d, 0xe1, 0x0a, 0xc3, 0x20, 0x0c, 0x84, 0xff, 0xe7, 0x29, 0xee,
+    0x09, 0x86, 0xae, 0x0f, 0x54, 0x82, 0x46, 0x1a, 0xb0, 0x2a, 0xea, 0x46, 0xdd, 0xd3, 0xcf, 0xf5, 0x47, 0x07, 0xe5, 0x20, 0x77, 0x7c,
+    0x09, 0xb9, 0x12, 0x07, 0x85, 0x5c, 0x77, 0xee, 0xe0, 0xe6, 0x54, 0x61, 0x1f, 0x86, 0x24, 0xca, 0x2e, 0xa9, 0xe3, 0x2d, 0xb5, 0xcb,
+    0x81, 0x85, 0x4a, 0xcd, 0x65, 0xe6, 0x81, 0x10, 0xf3, 0xbc, 0x3c, 0xee, 0x60, 0xdc, 0xc1, 0xe7, 0xfa, 0x11, 0xd8, 0x09, 0xec, 0x7f,
+    0x1f, 0xb5, 0x75, 0xbc, 0xdc, 0xc6, 0x15, 0x7a, 0x55, 0xac, 0x9a, 0xbc, 0x3a, 0x69, 0x24, 0xc9, 0xaf, 0x9b, 0xb0, 0x97, 0x4a, 0x06,
+    0x53, 0x64, 0xcf, 0x69, 0x30, 0x9d, 0x16, 0xfc, 0xfc, 0x49, 0x5f, 0xb1, 0x74, 0x78, 0xf9, 0xb4, 0x00, 0x00, 0x00,
+};
+
+/// Appends binary values in the given byte order.
+struct BinaryWriter
+{
+    std::string data;
+    bool bigEndian;
+
+    template<typename T>
+    BinaryWriter& operator<<(T value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        // the tests run on little endian hosts
+        if (bigEndian)
+            std::reverse(bytes, bytes + sizeof(T));
+        data.append(bytes, sizeof(T));
+        return *this;
+    }
+};
+
+/// Pentagon in the xy plane with normals and texture coordinates, preceded by an element the reader skips.
+std::string writePentagon(bool bigEndian)
+{
+    std::string header = std::string("ply\nformat ") + (bigEndian ? "binary_big_endian" : "binary_little_endian") + " 1.0\n";
+    header += "comment skipped element with a list\n";
+    header += "element material 1\nproperty list uchar float values\nproperty int id\n";
+    header += "element vertex 5\nproperty float x\nproperty float y\nproperty float z\n";
+    header += "property float nx\nproperty float ny\nproperty float nz\nproperty double u\nproperty double v\n";
+    header += "element face 1\nproperty uchar flags\nproperty list uchar int vertex_indices\nend_header\n";
+
+    BinaryWriter writer{header, bigEndian};
+    writer << uint8_t(2) << 0.5f << 0.25f << int32_t(7);
+    const float2 positions[] = {{0.f, 0.f}, {2.f, 0.f}, {3.f, 1.f}, {1.f, 2.f}, {-1.f, 1.f}};
+    for (const float2& p : positions)
+        writer << p.x << p.y << 0.f << 0.f << 0.f << 1.f << double(p.x * 0.25f) << double(p.y * 0.25f);
+    writer << uint8_t(0) << uint8_t(5) << int32_t(0) << int32_t(1) << int32_t(2) << int32_t(3) << int32_t(4);
+    return writer.data;
+}
+
+void checkPentagon(CPUUnitTestContext& ctx, const ref<TriangleMesh>& pMesh)
+{
+    // the pentagon is split into a fan around its first vertex
+    const std::vector<uint32_t> expectedIndices = {0, 1, 2, 0, 2, 3, 0, 3, 4};
+    EXPECT(pMesh->getIndices() == expectedIndices);
+    const auto& vertices = pMesh->getVertices();
+    ASSERT_EQ(vertices.size(), 5u);
+    EXPECT_EQ(vertices[2].position, float3(3.f, 1.f, 0.f));
+    EXPECT_EQ(vertices[2].normal, float3(0.f, 0.f, 1.f));
+    // the v coordinate is flipped like in the other mesh loaders
+    EXPECT_EQ(vertices[2].texCoord, float2(0.75f, 0.75f));
+    EXPECT_EQ(vertices[3].texCoord, float2(0.25f, 0.5f));
+}
+
+void expectReadError(CPUUnitTestContext& ctx, const std::string& name, const std::string& data)
+{
+    const TestFile file(name, data);
+    bool thrown = false;
+    try
+    {
+        pbrt::readPlyMesh(file.getPath());
+    }
+    catch (const std::exception&)
+    {
+        thrown = true;
+    }
+    EXPECT(thrown) << name;
+}
+} // namespace
+
+CPU_TEST(PlyReader_Ascii)
+{
+    // a quad with CRLF line endings and a comment
+    const std::string data = "ply\r\nformat ascii 1.0\r\ncomment quad\r\nelement vertex 4\r\n"
+                             "property float x\r\nproperty float y\r\nproperty float z\r\n"
+                             "property float nx\r\nproperty float ny\r\nproperty float nz\r\n"
+                             "property float s\r\nproperty float t\r\n"
+                             "element face 1\r\nproperty list uchar uint vertex_index\r\nend_header\r\n"
+                             "0 0 0 0 1 0 0 0\r\n1 0 0 0 1 0 1 0\r\n1 0 1 0 1 0 1 1\r\n0 0 1 0 1 0 0 0.25\r\n"
+                             "4 0 1 2 3\r\n";
+    const TestFile file("PlyReader_Ascii.ply", data);
+    const auto pMesh = pbrt::readPlyMesh(file.getPath());
+    const std::vector<uint32_t> expectedIndices = {0, 1, 2, 0, 2, 3};
+    EXPECT(pMesh->getIndices() == expectedIndices);
+    const auto& vertices = pMesh->getVertices();
+    ASSERT_EQ(vertices.size(), 4u);
+    EXPECT_EQ(vertices[2].position, float3(1.f, 0.f, 1.f));
+    EXPECT_EQ(vertices[2].normal, float3(0.f, 1.f, 0.f));
+    EXPECT_EQ(vertices[2].texCoord, float2(1.f, 0.f));
+    EXPECT_EQ(vertices[3].texCoord, float2(0.f, 0.75f));
+}
+
+CPU_TEST(PlyReader_BinaryLittleEndian)
+{
+    const TestFile file("PlyReader_BinaryLittleEndian.ply", writePentagon(false));
+    checkPentagon(ctx, pbrt::readPlyMesh(file.getPath()));
+}
+
+CPU_TEST(PlyReader_BinaryBigEndian)
+{
+    const TestFile file("PlyReader_BinaryBigEndian.ply", writePentagon(true));
+    checkPentagon(ctx, pbrt::readPlyMesh(file.getPath()));
+}
+
+CPU_TEST(PlyReader_Gzip)
+{
+    const TestFile file("PlyReader_Gzip.ply.gz", std::string(reinterpret_cast<const char*>(kGzipTriangle), sizeof(kGzipTriangle)));
+    const auto pMesh = pbrt::readPlyMesh(file.getPath());
+    EXPECT_EQ(pMesh->getIndices().size(), 3u);
+    ASSERT_EQ(pMesh->getVertices().size(), 3u);
+    EXPECT_EQ(pMesh->getVertices()[1].position, float3(1.f, 0.f, 0.f));
+}
+
+CPU_TEST(PlyReader_FlatNormals)
+{
+    // two triangles sharing an edge, folded by 90 degrees
+    const std::string data = kHeaderAscii + "element vertex 4\nproperty float x\nproperty float y\nproperty float z\n"
+                                            "element face 2\nproperty list uchar int vertex_indices\nend_header\n"
+                                            "0 0 0\n1 0 0\n0 1 0\n0 0 1\n"
+                                            "3 0 1 2\n3 0 3 1\n";
+    const TestFile file("PlyReader_FlatNormals.ply", data);
+    const auto pMesh = pbrt::readPlyMesh(file.getPath());
+    // without normals the vertices are unshared and get the normal of their face
+    const std::vector<uint32_t> expectedIndices = {0, 1, 2, 3, 4, 5};
+    EXPECT(pMesh->getIndices() == expectedIndices);
+    const auto& vertices = pMesh->getVertices();
+    ASSERT_EQ(vertices.size(), 6u);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(vertices[i].normal, float3(0.f, 0.f, 1.f)) << i;
+        EXPECT_EQ(vertices[3 + i].normal, float3(0.f, 1.f, 0.f)) << i;
+    }
+    EXPECT_EQ(vertices[4].position, float3(0.f, 0.f, 1.f));
+}
+
+CPU_TEST(PlyReader_InvalidFiles)
+{
+    EXPECT_THROW(pbrt::readPlyMesh(getTestDirectory() / "PlyReader_Missing.ply"));
+
+    const std::string vertexHeader = "element vertex 3\nproperty float x\nproperty float y\nproperty float z\n";
+    const std::string faceHeader = "element face 1\nproperty list uchar int vertex_indices\nend_header\n";
+    const std::string vertices = "0 0 0\n1 0 0\n0 1 0\n";
+    expectReadError(ctx, "PlyReader_NotPly.ply", "obj\n");
+    expectReadError(ctx, "PlyReader_NoEndHeader.ply", kHeaderAscii + vertexHeader);
+    expectReadError(ctx, "PlyReader_NoPositions.ply", kHeaderAscii + "element vertex 1\nproperty float x\nend_header\n0\n");
+    expectReadError(ctx, "PlyReader_IndexOutOfRange.ply", kHeaderAscii + vertexHeader + faceHeader + vertices + "3 0 1 3\n");
+    expectReadError(ctx, "PlyReader_NegativeIndex.ply", kHeaderAscii + vertexHeader + faceHeader + vertices + "3 0 1 -1\n");
+    expectReadError(ctx, "PlyReader_NegativeCount.ply", kHeaderAscii + vertexHeader + faceHeader + vertices + "-1 0 1 2\n");
+    expectReadError(ctx, "PlyReader_TruncatedAscii.ply", kHeaderAscii + vertexHeader + faceHeader + vertices + "3 0 1\n");
+    expectReadError(ctx, "PlyReader_NotANumber.ply", kHeaderAscii + vertexHeader + faceHeader + "0 0 0\n1 x 0\n0 1 0\n3 0 1 2\n");
+
+    // a signed binary count of -1 would otherwise be read as about 4G
+    {
+        BinaryWriter writer{"ply\nformat binary_little_endian 1.0\n" + vertexHeader + "element face 1\nproperty list char int vertex_indices\nend_header\n", false};
+        for (uint32_t i = 0; i < 9; i++)
+            writer << float(i == 3 || i == 7);
+        writer << int8_t(-1) << int32_t(0) << int32_t(1) << int32_t(2);
+        expectReadError(ctx, "PlyReader_NegativeBinaryCount.ply", writer.data);
+    }
+    // the file ends inside the vertex and the index data
+    {
+        BinaryWriter writer{"ply\nformat binary_little_endian 1.0\n" + vertexHeader + faceHeader, false};
+        for (uint32_t i = 0; i < 9; i++)
+            writer << float(i == 3 || i == 7);
+        expectReadError(ctx, "PlyReader_TruncatedVertices.ply", writer.data.substr(0, writer.data.size() - 2));
+        writer << uint8_t(200) << int32_t(0) << int32_t(1) << int32_t(2);
+        expectReadError(ctx, "PlyReader_TruncatedIndices.ply", writer.data);
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,79 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Material/MaterialSystem.h"
+#include "Scene/Material/StandardMaterial.h"
+#include "Scene/Material/PBRT/PBRTDiffuseMaterial.h"
+
+namespace Falcor
+{
+GPU_TEST(MaterialSystem_RemoveDuplicateMaterials)
+{
+    ref<Device> pDevice = ctx.getDevice();
+
+    auto createStandard = [&](const std::string& name, float3 baseColor, float roughness)
+    {
+        auto pMaterial = StandardMaterial::create(pDevice, name);
+        pMaterial->setBaseColor3(baseColor);
+        pMaterial->setRoughness(roughness);
+        return pMaterial;
+    };
+
+    std::vector<ref<Material>> materials = {
+        createStandard("red", float3(1.f, 0.f, 0.f), 0.5f),
+        createStandard("blue", float3(0.f, 0.f, 1.f), 0.5f),
+        createStandard("red copy", float3(1.f, 0.f, 0.f), 0.5f),
+        createStandard("red rough", float3(1.f, 0.f, 0.f), 1.f),
+        PBRTDiffuseMaterial::create(pDevice, "diffuse"),
+        PBRTDiffuseMaterial::create(pDevice, "diffuse copy"),
+        createStandard("blue copy", float3(0.f, 0.f, 1.f), 0.5f),
+    };
+
+    // Materials that compare equal must have equal hashes.
+    EXPECT(materials[0]->isEqual(materials[2]));
+    EXPECT_EQ(materials[0]->computeHash(), materials[2]->computeHash());
+    EXPECT(!materials[0]->isEqual(materials[3]));
+    EXPECT_NE(materials[0]->computeHash(), materials[3]->computeHash());
+    EXPECT_EQ(materials[4]->computeHash(), materials[5]->computeHash());
+
+    MaterialSystem materialSystem(pDevice);
+    for (const auto& pMaterial : materials)
+        materialSystem.addMaterial(pMaterial);
+
+    std::vector<MaterialID> idMap;
+    EXPECT_EQ(materialSystem.removeDuplicateMaterials(idMap), 3);
+    EXPECT_EQ(materialSystem.getMaterialCount(), 4);
+
+    // Duplicates map to the first equal material, unique materials keep their order.
+    const std::vector<uint32_t> expected = {0, 1, 0, 2, 3, 3, 1};
+    ASSERT_EQ(idMap.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_EQ(idMap[i].get(), expected[i]);
+    EXPECT_EQ(materialSystem.getMaterial(MaterialID(1))->getName(), "blue");
+}
+} // namespace Falcor
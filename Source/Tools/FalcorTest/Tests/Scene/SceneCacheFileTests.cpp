@@ -0,0 +1,222 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneCacheFile.h"
+#include "Scene/SceneCache.h"
+#include "Core/Platform/OS.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kVersion = 7;
+
+std::vector<uint8_t> createData(size_t size, uint32_t seed)
+{
+    std::vector<uint8_t> data(size);
+    std::mt19937 rng(seed);
+    // Low entropy so that the LZ4 frames actually compress.
+    for (size_t i = 0; i < size; ++i)
+        data[i] = (rng() & 0x3) + uint8_t(i / 256);
+    return data;
+}
+
+bool equals(SceneCacheFile::Bytes bytes, const std::vector<uint8_t>& data)
+{
+    return bytes.size == data.size() && (data.empty() || std::memcmp(bytes.data, data.data(), data.size()) == 0);
+}
+} // namespace
+
+CPU_TEST(SceneCacheFile_RoundTrip)
+{
+    const std::filesystem::path tempPath = std::filesystem::absolute("test_scene_cache_file.bin");
+
+    const std::vector<uint8_t> compressed0 = createData(3 * 1024 * 1024 + 17, 0);
+    const std::vector<uint8_t> compressed1 = createData(100, 1);
+    const std::vector<uint8_t> raw0 = createData(12345, 2);
+    const std::vector<uint8_t> raw1 = createData(5 * 1024 * 1024, 3);
+
+    {
+        SceneCacheFile::Writer writer;
+        writer.addCompressed(0, compressed0);
+        writer.addRaw(1, raw0.data(), raw0.size());
+        writer.addCompressed(2, compressed1);
+        writer.addCompressed(3, {});
+        writer.addRaw(4, raw1.data(), raw1.size());
+        writer.addRaw(5, nullptr, 0);
+        writer.write(tempPath, kVersion);
+    }
+
+    EXPECT(SceneCacheFile::hasValidHeader(tempPath, kVersion));
+    EXPECT(!SceneCacheFile::hasValidHeader(tempPath, kVersion + 1));
+
+    {
+        SceneCacheFile::Reader reader(tempPath, kVersion);
+        EXPECT_EQ(reader.getSectionInfos().size(), 6);
+        EXPECT(equals(reader.getSection(0), compressed0));
+        EXPECT(equals(reader.getSection(1), raw0));
+        EXPECT(equals(reader.getSection(2), compressed1));
+        EXPECT(equals(reader.getSection(3), {}));
+        EXPECT(equals(reader.getSection(4), raw1));
+        EXPECT(equals(reader.getSection(5), {}));
+
+        for (const auto& info : reader.getSectionInfos())
+        {
+            if (info.encoding == SceneCacheFile::Encoding::Raw)
+                EXPECT_EQ(info.offset % SceneCacheFile::kRawSectionAlignment, 0);
+        }
+        EXPECT(reader.getSectionInfos()[0].size < compressed0.size());
+
+        EXPECT(reader.hasSection(4));
+        EXPECT(!reader.hasSection(6));
+        EXPECT_THROW(reader.getSection(6));
+    }
+
+    std::filesystem::remove(tempPath);
+}
+
+CPU_TEST(SceneCacheFile_DuplicateSection)
+{
+    const std::filesystem::path tempPath = std::filesystem::absolute("test_scene_cache_file_duplicate.bin");
+
+    SceneCacheFile::Writer writer;
+    writer.addCompressed(0, createData(10, 0));
+    writer.addCompressed(0, createData(10, 1));
+    EXPECT_THROW(writer.write(tempPath, kVersion));
+
+    std::filesystem::remove(tempPath);
+}
+
+CPU_TEST(SceneCacheFile_Invalid)
+{
+    const std::filesystem::path tempPath = std::filesystem::absolute("test_scene_cache_file_invalid.bin");
+
+    EXPECT(!SceneCacheFile::hasValidHeader("__file_that_does_not_exist__", kVersion));
+    EXPECT_THROW(SceneCacheFile::Reader reader("__file_that_does_not_exist__", kVersion));
+
+    {
+        SceneCacheFile::Writer writer;
+        writer.addCompressed(0, createData(64 * 1024, 0));
+        writer.write(tempPath, kVersion);
+    }
+    EXPECT_THROW(SceneCacheFile::Reader reader(tempPath, kVersion + 1));
+
+    // Corrupt the decoded size of the compressed section, the reader must not allocate it.
+    const auto writeRawSize = [&](uint64_t rawSize)
+    {
+        std::fstream fs(tempPath, std::ios::binary | std::ios::in | std::ios::out);
+        fs.seekp(16 + offsetof(SceneCacheFile::SectionInfo, rawSize));
+        fs.write(reinterpret_cast<const char*>(&rawSize), sizeof(rawSize));
+    };
+    writeRawSize(1ull << 60);
+    EXPECT_THROW(SceneCacheFile::Reader reader(tempPath, kVersion));
+    writeRawSize(64 * 1024 + 1);
+    EXPECT_THROW(SceneCacheFile::Reader reader(tempPath, kVersion));
+    writeRawSize(64 * 1024);
+    EXPECT_EQ(SceneCacheFile::Reader(tempPath, kVersion).getSection(0).size, 64 * 1024);
+
+    // Truncate the file in the middle of the compressed section.
+    const auto size = std::filesystem::file_size(tempPath);
+    std::filesystem::resize_file(tempPath, size / 2);
+    EXPECT(SceneCacheFile::hasValidHeader(tempPath, kVersion));
+    EXPECT_THROW(SceneCacheFile::Reader reader(tempPath, kVersion));
+
+    // Corrupt the magic.
+    {
+        std::fstream fs(tempPath, std::ios::binary | std::ios::in | std::ios::out);
+        fs.write("XXXX", 4);
+    }
+    EXPECT(!SceneCacheFile::hasValidHeader(tempPath, kVersion));
+    EXPECT_THROW(SceneCacheFile::Reader reader(tempPath, kVersion));
+
+    std::filesystem::remove(tempPath);
+}
+
+GPU_TEST(SceneCache_BadSectionMarker)
+{
+    const std::string keyString = "test_scene_cache_bad_section_marker";
+    const SceneCache::Key key = SHA1::compute(keyString.data(), keyString.size());
+    const std::filesystem::path cachePath = getAppDataDirectory() / "NVIDIA/Falcor/SceneCache" / SHA1::toString(key);
+
+    // Large raw sections so that their copy tasks are still running when the corrupt marker is found.
+    Scene::SceneData sceneData;
+    sceneData.pMaterials = std::make_unique<MaterialSystem>(ctx.getDevice());
+    sceneData.meshIndexData.resize(16 * 1024 * 1024);
+    sceneData.meshStaticData.resize(1024 * 1024);
+    SceneCache::writeCache(sceneData, key);
+    ASSERT(SceneCache::hasValidCache(key));
+
+    uint32_t version = 0;
+    {
+        std::ifstream fs(cachePath, std::ios::binary);
+        fs.seekg(8);
+        fs.read(reinterpret_cast<char*>(&version), sizeof(version));
+    }
+
+    // Copy all sections and corrupt the first marker of the scene section.
+    std::vector<SceneCacheFile::SectionInfo> infos;
+    std::vector<std::vector<uint8_t>> sections;
+    {
+        SceneCacheFile::Reader reader(cachePath, version);
+        infos = reader.getSectionInfos();
+        for (const auto& info : infos)
+        {
+            SceneCacheFile::Bytes bytes = reader.getSection(info.id);
+            sections.emplace_back(bytes.data, bytes.data + bytes.size);
+        }
+    }
+    ASSERT(!sections.empty() && infos[0].id == 0);
+    const std::string marker = "Path";
+    auto it = std::search(sections[0].begin(), sections[0].end(), marker.begin(), marker.end());
+    ASSERT(it != sections[0].end());
+    it[1] = 'x';
+
+    {
+        SceneCacheFile::Writer writer;
+        for (size_t i = 0; i < infos.size(); ++i)
+        {
+            if (infos[i].encoding == SceneCacheFile::Encoding::LZ4)
+                writer.addCompressed(infos[i].id, sections[i]);
+            else
+                writer.addRaw(infos[i].id, sections[i].data(), sections[i].size());
+        }
+        writer.write(cachePath, version);
+    }
+    EXPECT(SceneCache::hasValidCache(key));
+    EXPECT_THROW(SceneCache::readCache(ctx.getDevice(), key));
+
+    std::filesystem::remove(cachePath);
+}
+} // namespace Falcor
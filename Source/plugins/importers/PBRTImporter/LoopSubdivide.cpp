@@ -35,126 +35,97 @@
 #include "Core/Error.h"
 
 #include <algorithm>
-#include <map>
-#include <memory>
-#include <memory_resource>
-#include <set>
+#include <execution>
+#include <numeric>
 
 #include <cmath>
 
 namespace Falcor::pbrt
 {
 
-struct SDFace;
-struct SDVertex;
-
-#define NEXT(i) (((i) + 1) % 3)
-#define PREV(i) (((i) + 2) % 3)
+namespace
+{
+const uint32_t kInvalid = uint32_t(-1);
 
-struct SDVertex
+// Half-edge 3 * face + k goes from corner k to corner (k + 1) % 3 of the face.
+inline uint32_t nextHalfedge(uint32_t h)
 {
-    SDVertex(const float3& p = float3(0.f)) : p(p) {}
+    return h % 3 == 2 ? h - 2 : h + 1;
+}
 
-    int valence();
-    void oneRing(float3* p);
+inline uint32_t prevHalfedge(uint32_t h)
+{
+    return h % 3 == 0 ? h + 2 : h - 1;
+}
 
-    float3 p;
-    SDFace* startFace = nullptr;
-    SDVertex* child = nullptr;
-    bool regular = false;
-    bool boundary = false;
+/**
+ * Triangle mesh with half-edge adjacency stored in flat arrays.
+ * The origin of a half-edge is the vertex at its face corner, i.e. indices[h].
+ */
+struct SubdivMesh
+{
+    std::vector<float3> positions;
+    std::vector<uint32_t> startHalfedges; ///< Outgoing half-edge where the one-ring traversal starts, kInvalid if unreferenced.
+    std::vector<uint32_t> valences;
+    std::vector<uint8_t> boundaries;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> twins; ///< Opposite half-edge, kInvalid on boundary edges.
+
+    size_t getFaceCount() const { return indices.size() / 3; }
 };
 
-struct SDFace
+/**
+ * Run func(i) for all i in [0, count) in parallel.
+ * Work is scheduled in blocks to amortize the overhead for cheap functions.
+ */
+template<typename Func>
+void parallelFor(size_t count, Func func)
 {
-    SDFace()
-    {
-        for (uint32_t i = 0; i < 3; ++i)
-        {
-            v[i] = nullptr;
-            f[i] = nullptr;
-        }
-        for (uint32_t i = 0; i < 4; ++i)
-        {
-            children[i] = nullptr;
-        }
-    }
-
-    uint32_t vnum(SDVertex* vert) const
-    {
-        for (int i = 0; i < 3; ++i)
-        {
-            if (v[i] == vert)
-                return i;
-        }
-        FALCOR_THROW("Basic logic error in SDFace::vnum().");
-    }
-
-    SDFace* nextFace(SDVertex* vert) const { return f[vnum(vert)]; }
-    SDFace* prevFace(SDVertex* vert) const { return f[PREV(vnum(vert))]; }
-    SDVertex* nextVert(SDVertex* vert) const { return v[NEXT(vnum(vert))]; }
-    SDVertex* prevVert(SDVertex* vert) const { return v[PREV(vnum(vert))]; }
-    SDVertex* otherVert(SDVertex* v0, SDVertex* v1)
-    {
-        for (uint32_t i = 0; i < 3; ++i)
+    const size_t kBlockSize = 4096;
+    std::vector<size_t> blocks((count + kBlockSize - 1) / kBlockSize);
+    std::iota(blocks.begin(), blocks.end(), size_t(0));
+    std::for_each(
+        std::execution::par,
+        blocks.begin(),
+        blocks.end(),
+        [&](size_t block)
         {
-            if (v[i] != v0 && v[i] != v1)
-                return v[i];
+            size_t end = std::min((block + 1) * kBlockSize, count);
+            for (size_t i = block * kBlockSize; i < end; ++i)
+                func(i);
         }
-        FALCOR_THROW("Basic logic error in SDFace::otherVert()");
-    }
-
-    SDVertex* v[3];
-    SDFace* f[3];
-    SDFace* children[4];
-};
-
-struct SDEdge
-{
-    SDEdge(SDVertex* v0 = nullptr, SDVertex* v1 = nullptr)
-    {
-        v[0] = std::min(v0, v1);
-        v[1] = std::max(v0, v1);
-        f[0] = f[1] = nullptr;
-        f0edgeNum = -1;
-    }
-
-    bool operator<(const SDEdge& e2) const
-    {
-        if (v[0] == e2.v[0])
-            return v[1] < e2.v[1];
-        return v[0] < e2.v[0];
-    }
-
-    SDVertex* v[2];
-    SDFace* f[2];
-    int f0edgeNum;
-};
-
-static float3 weightOneRing(SDVertex* vert, float beta);
-static float3 weightBoundary(SDVertex* vert, float beta);
+    );
+}
 
-inline int SDVertex::valence()
+/**
+ * Call func(j, p) for the one-ring neighbors of a vertex.
+ * Interior vertices are visited counter-clockwise from the start half-edge, boundary vertices from one boundary to the other.
+ */
+template<typename Func>
+void forEachOneRing(const SubdivMesh& mesh, uint32_t vertex, Func func)
 {
-    SDFace* f = startFace;
-    if (!boundary)
+    const uint32_t start = mesh.startHalfedges[vertex];
+    uint32_t h = start;
+    uint32_t j = 0;
+    if (!mesh.boundaries[vertex])
     {
-        // Compute valence of interior vertex.
-        int nf = 1;
-        while ((f = f->nextFace(this)) != startFace)
-            ++nf;
-        return nf;
+        do
+        {
+            func(j++, mesh.positions[mesh.indices[nextHalfedge(h)]]);
+            h = nextHalfedge(mesh.twins[h]);
+        } while (h != start);
     }
     else
     {
-        // Compute valence of boundary vertex
-        int nf = 1;
-        while ((f = f->nextFace(this)) != nullptr)
-            ++nf;
-        f = startFace;
-        while ((f = f->prevFace(this)) != nullptr)
-            ++nf;
-        return nf + 1;
+        while (mesh.twins[h] != kInvalid)
+            h = nextHalfedge(mesh.twins[h]);
+        func(j++, mesh.positions[mesh.indices[nextHalfedge(h)]]);
+        do
+        {
+            uint32_t prev = prevHalfedge(h);
+            func(j++, mesh.positions[mesh.indices[prev]]);
+            h = mesh.twins[prev];
+        } while (h != kInvalid);
     }
 }
 
@@ -171,372 +142,375 @@ inline float loopGamma(uint32_t valence)
     return 1.f / (valence + 3.f / (8.f * beta(valence)));
 }
 
-LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
+float3 weightOneRing(const SubdivMesh& mesh, uint32_t vertex, float beta)
 {
-    std::vector<SDVertex*> vertices;
-    std::vector<SDFace*> faces;
+    float3 p = (1 - mesh.valences[vertex] * beta) * mesh.positions[vertex];
+    forEachOneRing(mesh, vertex, [&](uint32_t, const float3& q) { p += beta * q; });
+    return p;
+}
 
-    // Allocate vertices and faces.
-    std::unique_ptr<SDVertex[]> vertexBuffer = std::make_unique<SDVertex[]>(positions.size());
-    for (size_t i = 0; i < positions.size(); ++i)
-    {
-        vertexBuffer[i] = SDVertex(positions[i]);
-        vertices.push_back(&vertexBuffer[i]);
-    }
-    size_t faceCount = indices.size() / 3;
-    std::unique_ptr<SDFace[]> fs = std::make_unique<SDFace[]>(faceCount);
-    for (size_t i = 0; i < faceCount; ++i)
-    {
-        faces.push_back(&fs[i]);
-    }
+float3 weightBoundary(const SubdivMesh& mesh, uint32_t vertex, float beta)
+{
+    const uint32_t valence = mesh.valences[vertex];
+    float3 first, last;
+    forEachOneRing(
+        mesh,
+        vertex,
+        [&](uint32_t j, const float3& q)
+        {
+            if (j == 0)
+                first = q;
+            if (j == valence - 1)
+                last = q;
+        }
+    );
+    float3 p = (1 - 2 * beta) * mesh.positions[vertex];
+    p += beta * first;
+    p += beta * last;
+    return p;
+}
 
-    // Set face to vertex pointers.
+/**
+ * Match the half-edges of a triangle list with a sorted edge table.
+ * Edges shared by more than two faces are paired in face order, edges between inconsistently oriented faces are left as boundaries.
+ */
+std::vector<uint32_t> computeTwins(const std::vector<uint32_t>& indices)
+{
+    struct Edge
     {
-        const uint32_t* vp = indices.data();
-        for (size_t i = 0; i < faceCount; ++i, vp += 3)
+        uint64_t key; ///< Vertex pair, smaller index in the upper bits.
+        uint32_t halfedge;
+        bool operator<(const Edge& other) const { return key != other.key ? key < other.key : halfedge < other.halfedge; }
+    };
+
+    const size_t halfedgeCount = indices.size();
+    std::vector<Edge> edges(halfedgeCount);
+    parallelFor(
+        halfedgeCount,
+        [&](size_t h)
         {
-            SDFace* f = faces[i];
-            for (uint32_t j = 0; j < 3; ++j)
+            uint32_t v0 = indices[h];
+            uint32_t v1 = indices[nextHalfedge(uint32_t(h))];
+            edges[h] = {(uint64_t(std::min(v0, v1)) << 32) | std::max(v0, v1), uint32_t(h)};
+        }
+    );
+    std::sort(std::execution::par, edges.begin(), edges.end());
+
+    std::vector<uint32_t> twins(halfedgeCount, kInvalid);
+    parallelFor(
+        halfedgeCount,
+        [&](size_t i)
+        {
+            if (i > 0 && edges[i - 1].key == edges[i].key)
+                return;
+            size_t end = i + 1;
+            while (end < halfedgeCount && edges[end].key == edges[i].key)
+                ++end;
+            for (size_t j = i; j + 1 < end; j += 2)
             {
-                SDVertex* v = vertices[vp[j]];
-                f->v[j] = v;
-                v->startFace = f;
+                uint32_t h0 = edges[j].halfedge;
+                uint32_t h1 = edges[j + 1].halfedge;
+                if (indices[h0] != indices[h1] && indices[h0] == indices[nextHalfedge(h1)])
+                {
+                    twins[h0] = h1;
+                    twins[h1] = h0;
+                }
             }
         }
-    }
+    );
+    return twins;
+}
 
-    // Set neighbor pointers in faces.
-    std::set<SDEdge> edges;
-    for (size_t i = 0; i < faceCount; ++i)
-    {
-        SDFace* f = faces[i];
-        for (uint32_t edgeNum = 0; edgeNum < 3; ++edgeNum)
+SubdivMesh createBaseMesh(fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
+{
+    SubdivMesh mesh;
+    mesh.positions.assign(positions.begin(), positions.end());
+    mesh.indices.assign(indices.begin(), indices.end());
+    mesh.indices.resize(mesh.indices.size() - mesh.indices.size() % 3);
+    for (uint32_t index : mesh.indices)
+        FALCOR_CHECK(index < positions.size(), "Vertex index {} is out of bounds.", index);
+
+    mesh.twins = computeTwins(mesh.indices);
+
+    // Start the one-ring traversal in the last face referencing the vertex.
+    mesh.startHalfedges.assign(positions.size(), kInvalid);
+    for (uint32_t h = 0; h < mesh.indices.size(); ++h)
+        mesh.startHalfedges[mesh.indices[h]] = h;
+
+    // Rotate around the vertices to find boundaries and valences.
+    mesh.valences.resize(positions.size());
+    mesh.boundaries.resize(positions.size());
+    parallelFor(
+        positions.size(),
+        [&](size_t vertex)
         {
-            // Update neighbor pointer for edgeNum.
-            int v0 = edgeNum, v1 = NEXT(edgeNum);
-            SDEdge e(f->v[v0], f->v[v1]);
-            if (edges.find(e) == edges.end())
+            const uint32_t start = mesh.startHalfedges[vertex];
+            if (start == kInvalid)
             {
-                // Handle new edge.
-                e.f[0] = f;
-                e.f0edgeNum = edgeNum;
-                edges.insert(e);
+                mesh.valences[vertex] = 0;
+                mesh.boundaries[vertex] = 0;
+                return;
             }
-            else
+            uint32_t faceCount = 1;
+            uint32_t h = start;
+            while ((h = mesh.twins[h]) != kInvalid && (h = nextHalfedge(h)) != start)
+                ++faceCount;
+            const bool boundary = h == kInvalid;
+            if (boundary)
             {
-                // Handle previously seen edge.
-                e = *edges.find(e);
-                e.f[0]->f[e.f0edgeNum] = f;
-                f->f[edgeNum] = e.f[0];
-                edges.erase(e);
+                h = start;
+                while ((h = mesh.twins[prevHalfedge(h)]) != kInvalid)
+                    ++faceCount;
             }
+            mesh.valences[vertex] = boundary ? faceCount + 1 : faceCount;
+            mesh.boundaries[vertex] = boundary;
         }
-    }
-
-    // Finish vertex initialization.
-    for (size_t i = 0; i < positions.size(); ++i)
-    {
-        SDVertex* v = vertices[i];
-        SDFace* f = v->startFace;
-        do
-        {
-            f = f->nextFace(v);
-        } while ((f != nullptr) && f != v->startFace);
-        v->boundary = (f == nullptr);
-        if (!v->boundary && v->valence() == 6)
-            v->regular = true;
-        else if (v->boundary && v->valence() == 4)
-            v->regular = true;
-        else
-            v->regular = false;
-    }
+    );
 
-    // Refine LoopSubdiv into triangles.
-    std::vector<SDFace*> f = faces;
-    std::vector<SDVertex*> v = vertices;
+    return mesh;
+}
 
-    std::pmr::monotonic_buffer_resource buffer;
-    std::pmr::polymorphic_allocator<SDVertex> vertexAllocator(&buffer);
-    std::pmr::polymorphic_allocator<SDFace> faceAllocator(&buffer);
+/**
+ * Apply one level of Loop subdivision.
+ * Even vertices keep their index. The odd vertex of an edge is appended in the order the edges are first visited by the faces.
+ * Face f is split into the faces 4 * f + k, the corner triangles k = 0..2 followed by the center triangle.
+ */
+SubdivMesh subdivide(const SubdivMesh& mesh)
+{
+    const size_t vertexCount = mesh.positions.size();
+    const size_t faceCount = mesh.getFaceCount();
+    const size_t halfedgeCount = mesh.indices.size();
 
-    for (size_t i = 0; i < levels; ++i)
+    // Number the edges, each edge is owned by its first half-edge.
+    auto isOwner = [&](uint32_t h) { return mesh.twins[h] == kInvalid || mesh.twins[h] > h; };
+    std::vector<uint32_t> edgeIndices(halfedgeCount);
     {
-        // Update f and v for next level of subdivision.
-        std::vector<SDFace*> newFaces;
-        std::vector<SDVertex*> newVertices;
-
-        // Allocate next level of children in mesh tree.
-        for (SDVertex* vertex : v)
+        std::vector<uint32_t> owners(halfedgeCount);
+        parallelFor(halfedgeCount, [&](size_t h) { owners[h] = isOwner(uint32_t(h)) ? 1 : 0; });
+        std::exclusive_scan(std::execution::par, owners.begin(), owners.end(), edgeIndices.begin(), 0u);
+    }
+    const size_t edgeCount = halfedgeCount > 0 ? edgeIndices.back() + (isOwner(uint32_t(halfedgeCount - 1)) ? 1 : 0) : 0;
+    parallelFor(
+        halfedgeCount,
+        [&](size_t h)
         {
-            vertex->child = vertexAllocator.allocate(1);
-            vertex->child->regular = vertex->regular;
-            vertex->child->boundary = vertex->boundary;
-            newVertices.push_back(vertex->child);
+            if (!isOwner(uint32_t(h)))
+                edgeIndices[h] = edgeIndices[mesh.twins[h]];
         }
-        for (SDFace* face : f)
+    );
+
+    SubdivMesh child;
+    const size_t childVertexCount = vertexCount + edgeCount;
+    child.positions.resize(childVertexCount);
+    child.startHalfedges.resize(childVertexCount);
+    child.valences.resize(childVertexCount);
+    child.boundaries.resize(childVertexCount);
+    child.indices.resize(12 * faceCount);
+    child.twins.resize(12 * faceCount);
+
+    // Update positions of even vertices.
+    parallelFor(
+        vertexCount,
+        [&](size_t vertex)
         {
-            for (uint32_t k = 0; k < 4; ++k)
+            const uint32_t h = mesh.startHalfedges[vertex];
+            child.valences[vertex] = mesh.valences[vertex];
+            child.boundaries[vertex] = mesh.boundaries[vertex];
+            if (h == kInvalid)
             {
-                face->children[k] = faceAllocator.allocate(1);
-                newFaces.push_back(face->children[k]);
+                child.positions[vertex] = mesh.positions[vertex];
+                child.startHalfedges[vertex] = kInvalid;
+                return;
             }
+            // Regular interior vertices have valence 6, for which beta() is 1/16.
+            if (!mesh.boundaries[vertex])
+                child.positions[vertex] = weightOneRing(mesh, uint32_t(vertex), beta(mesh.valences[vertex]));
+            else
+                child.positions[vertex] = weightBoundary(mesh, uint32_t(vertex), 1.f / 8.f);
+            uint32_t face = h / 3, k = h % 3;
+            child.startHalfedges[vertex] = 3 * (4 * face + k) + k;
         }
+    );
 
-        // Update vertex positions and create new edge vertices.
-
-        // Update vertex positions for even vertices.
-        for (SDVertex* vertex : v)
+    // Create odd vertices.
+    parallelFor(
+        halfedgeCount,
+        [&](size_t i)
         {
-            if (!vertex->boundary)
+            const uint32_t h = uint32_t(i);
+            if (!isOwner(h))
+                return;
+            const uint32_t vertex = uint32_t(vertexCount + edgeIndices[h]);
+            const uint32_t twin = mesh.twins[h];
+            const float3& p0 = mesh.positions[mesh.indices[h]];
+            const float3& p1 = mesh.positions[mesh.indices[nextHalfedge(h)]];
+            float3 p;
+            if (twin == kInvalid)
             {
-                // Apply one-ring rule for even vertex.
-                if (vertex->regular)
-                    vertex->child->p = weightOneRing(vertex, 1.f / 16.f);
-                else
-                    vertex->child->p = weightOneRing(vertex, beta(vertex->valence()));
+                p = 0.5f * p0;
+                p += 0.5f * p1;
             }
             else
             {
-                // Apply boundary rule for even vertex.
-                vertex->child->p = weightBoundary(vertex, 1.f / 8.f);
+                p = 3.f / 8.f * p0;
+                p += 3.f / 8.f * p1;
+                p += 1.f / 8.f * mesh.positions[mesh.indices[prevHalfedge(h)]];
+                p += 1.f / 8.f * mesh.positions[mesh.indices[prevHalfedge(twin)]];
             }
+            child.positions[vertex] = p;
+            child.boundaries[vertex] = twin == kInvalid;
+            child.valences[vertex] = twin == kInvalid ? 4 : 6;
+            uint32_t face = h / 3, k = h % 3;
+            child.startHalfedges[vertex] = 3 * (4 * face + 3) + k;
         }
+    );
 
-        // Compute new odd edge vertices.
-        std::map<SDEdge, SDVertex*> edgeVerts;
-        for (SDFace* face : f)
+    // Split faces. Corner triangle k keeps the even vertex v[k] at corner k, the center triangle is (e[0], e[1], e[2]).
+    parallelFor(
+        faceCount,
+        [&](size_t face)
         {
+            const uint32_t* v = &mesh.indices[3 * face];
+            const uint32_t* twins = &mesh.twins[3 * face];
+            const uint32_t* e = &edgeIndices[3 * face];
+            uint32_t* childIndices = &child.indices[12 * face];
+            uint32_t* childTwins = &child.twins[12 * face];
+            const uint32_t base = uint32_t(4 * face);
             for (uint32_t k = 0; k < 3; ++k)
             {
-                // Compute odd vertex on kth edge.
-                SDEdge edge(face->v[k], face->v[NEXT(k)]);
-                SDVertex* vert = edgeVerts[edge];
-                if (vert == nullptr)
+                const uint32_t next = (k + 1) % 3;
+                const uint32_t prev = (k + 2) % 3;
+                const uint32_t odd = uint32_t(vertexCount + e[k]);
+
+                // Even vertex of corner triangle k and odd vertex of edge k, which is shared by the corner triangles k and k + 1.
+                childIndices[3 * k + k] = v[k];
+                childIndices[3 * k + next] = odd;
+                childIndices[3 * next + k] = odd;
+                childIndices[9 + k] = odd;
+
+                // Edge k is split between the corner triangles k and k + 1 and matched with the children of the neighbor face.
+                const uint32_t twin = twins[k];
+                if (twin != kInvalid)
                 {
-                    // Create and initialize new odd vertex
-                    vert = vertexAllocator.allocate(1);
-                    newVertices.push_back(vert);
-                    vert->regular = true;
-                    vert->boundary = (face->f[k] == nullptr);
-                    vert->startFace = face->children[3];
-
-                    // Apply edge rules to compute new vertex position
-                    if (vert->boundary)
-                    {
-                        vert->p = 0.5f * edge.v[0]->p;
-                        vert->p += 0.5f * edge.v[1]->p;
-                    }
-                    else
-                    {
-                        vert->p = 3.f / 8.f * edge.v[0]->p;
-                        vert->p += 3.f / 8.f * edge.v[1]->p;
-                        vert->p += 1.f / 8.f * face->otherVert(edge.v[0], edge.v[1])->p;
-                        vert->p += 1.f / 8.f * face->f[k]->otherVert(edge.v[0], edge.v[1])->p;
-                    }
-                    edgeVerts[edge] = vert;
+                    const uint32_t neighbor = twin / 3, i = twin % 3;
+                    childTwins[3 * k + k] = 3 * (4 * neighbor + (i + 1) % 3) + i;
+                    childTwins[3 * next + k] = 3 * (4 * neighbor + i) + i;
                 }
+                else
+                {
+                    childTwins[3 * k + k] = kInvalid;
+                    childTwins[3 * next + k] = kInvalid;
+                }
+
+                // Inner edges between corner triangle k and the center triangle.
+                childTwins[3 * k + next] = 3 * (base + 3) + prev;
+                childTwins[9 + prev] = 3 * (base + k) + next;
             }
         }
+    );
 
-        // Update new mesh topology.
+    return child;
+}
+} // namespace
 
-        // Update even vertex face pointers.
-        for (SDVertex* vertex : v)
-        {
-            int vertNum = vertex->startFace->vnum(vertex);
-            vertex->child->startFace = vertex->startFace->children[vertNum];
-        }
+LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
+{
+    SubdivMesh mesh = createBaseMesh(positions, indices);
+    for (uint32_t i = 0; i < levels; ++i)
+        mesh = subdivide(mesh);
 
-        // Update face neighbor pointers.
-        for (SDFace* face : f)
-        {
-            for (uint32_t j = 0; j < 3; ++j)
-            {
-                // Update children f pointers for siblings.
-                face->children[3]->f[j] = face->children[NEXT(j)];
-                face->children[j]->f[NEXT(j)] = face->children[3];
-
-                // Update children f pointers for neighbor children.
-                SDFace* f2 = face->f[j];
-                face->children[j]->f[j] = f2 != nullptr ? f2->children[f2->vnum(face->v[j])] : nullptr;
-                f2 = face->f[PREV(j)];
-                face->children[j]->f[PREV(j)] = f2 != nullptr ? f2->children[f2->vnum(face->v[j])] : nullptr;
-            }
-        }
+    const size_t vertexCount = mesh.positions.size();
 
-        // Update face vertex pointers.
-        for (SDFace* face : f)
+    // Push vertices to limit surface.
+    std::vector<float3> pLimit(vertexCount);
+    parallelFor(
+        vertexCount,
+        [&](size_t vertex)
         {
-            for (uint32_t j = 0; j < 3; ++j)
-            {
-                // Update child vertex pointer to new even vertex
-                face->children[j]->v[j] = face->v[j]->child;
-
-                // Update child vertex pointer to new odd vertex
-                SDVertex* vert = edgeVerts[SDEdge(face->v[j], face->v[NEXT(j)])];
-                face->children[j]->v[NEXT(j)] = vert;
-                face->children[NEXT(j)]->v[j] = vert;
-                face->children[3]->v[j] = vert;
-            }
+            if (mesh.startHalfedges[vertex] == kInvalid)
+                pLimit[vertex] = mesh.positions[vertex];
+            else if (mesh.boundaries[vertex])
+                pLimit[vertex] = weightBoundary(mesh, uint32_t(vertex), 1.f / 5.f);
+            else
+                pLimit[vertex] = weightOneRing(mesh, uint32_t(vertex), loopGamma(mesh.valences[vertex]));
         }
-
-        // Prepare for next level of subdivision
-        f = newFaces;
-        v = newVertices;
-    }
-
-    // Push vertices to limit surface.
-    std::vector<float3> pLimit(v.size());
-    for (size_t i = 0; i < v.size(); ++i)
-    {
-        if (v[i]->boundary)
-            pLimit[i] = weightBoundary(v[i], 1.f / 5.f);
-        else
-            pLimit[i] = weightOneRing(v[i], loopGamma(v[i]->valence()));
-    }
-    for (size_t i = 0; i < v.size(); ++i)
-    {
-        v[i]->p = pLimit[i];
-    }
+    );
+    mesh.positions = std::move(pLimit);
 
     // Compute vertex tangents on limit surface.
-    std::vector<float3> Ns;
-    Ns.reserve(v.size());
-    std::vector<float3> pRing(16, float3());
-    for (SDVertex* vertex : v)
-    {
-        float3 S(0.f);
-        float3 T(0.f);
-        uint32_t valence = vertex->valence();
-        if (valence > pRing.size())
-            pRing.resize(valence);
-        vertex->oneRing(&pRing[0]);
-        if (!vertex->boundary)
-        {
-            // Compute tangents of interior face
-            for (uint32_t j = 0; j < valence; ++j)
-            {
-                S += std::cos(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
-                T += std::sin(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
-            }
-        }
-        else
+    std::vector<float3> Ns(vertexCount);
+    parallelFor(
+        vertexCount,
+        [&](size_t vertex)
         {
-            // Compute tangents of boundary face
-            S = pRing[valence - 1] - pRing[0];
-            if (valence == 2)
+            const uint32_t valence = mesh.valences[vertex];
+            if (mesh.startHalfedges[vertex] == kInvalid)
             {
-                T = float3(pRing[0] + pRing[1] - 2.f * vertex->p);
+                Ns[vertex] = float3(0.f);
+                return;
             }
-            else if (valence == 3)
+
+            // High valences are rare, only those allocate.
+            const uint32_t kLocalRingSize = 16;
+            float3 localRing[kLocalRingSize];
+            std::vector<float3> heapRing;
+            float3* pRing = localRing;
+            if (valence > kLocalRingSize)
             {
-                T = pRing[1] - vertex->p;
+                heapRing.resize(valence);
+                pRing = heapRing.data();
             }
-            else if (valence == 4) // regular
+            forEachOneRing(mesh, uint32_t(vertex), [&](uint32_t j, const float3& q) { pRing[j] = q; });
+
+            const float3& p = mesh.positions[vertex];
+            float3 S(0.f);
+            float3 T(0.f);
+            if (!mesh.boundaries[vertex])
             {
-                T = float3(-1.f * pRing[0] + 2.f * pRing[1] + 2.f * pRing[2] + -1.f * pRing[3] + -2.f * vertex->p);
+                // Compute tangents of interior face
+                for (uint32_t j = 0; j < valence; ++j)
+                {
+                    S += std::cos(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
+                    T += std::sin(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
+                }
             }
             else
             {
-                float theta = float(M_PI) / float(valence - 1);
-                T = float3(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
-                for (uint32_t k = 1; k < valence - 1; ++k)
+                // Compute tangents of boundary face
+                S = pRing[valence - 1] - pRing[0];
+                if (valence == 2)
                 {
-                    float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
-                    T += float3(wt * pRing[k]);
+                    T = float3(pRing[0] + pRing[1] - 2.f * p);
+                }
+                else if (valence == 3)
+                {
+                    T = pRing[1] - p;
+                }
+                else if (valence == 4) // regular
+                {
+                    T = float3(-1.f * pRing[0] + 2.f * pRing[1] + 2.f * pRing[2] + -1.f * pRing[3] + -2.f * p);
+                }
+                else
+                {
+                    float theta = float(M_PI) / float(valence - 1);
+                    T = float3(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
+                    for (uint32_t k = 1; k < valence - 1; ++k)
+                    {
+                        float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
+                        T += float3(wt * pRing[k]);
+                    }
+                    T = -T;
                 }
-                T = -T;
-            }
-        }
-        Ns.push_back(cross(S, T));
-    }
-
-    // Create triangle mesh from subdivision mesh
-    {
-        size_t ntris = f.size();
-        std::vector<uint32_t> verts(3 * ntris);
-        uint32_t* vp = verts.data();
-        uint32_t totVerts = (uint32_t)v.size();
-        std::map<SDVertex*, uint32_t> usedVerts;
-        for (uint32_t i = 0; i < totVerts; ++i)
-        {
-            usedVerts[v[i]] = i;
-        }
-        for (size_t i = 0; i < ntris; ++i)
-        {
-            for (uint32_t j = 0; j < 3; ++j)
-            {
-                *vp = usedVerts[f[i]->v[j]];
-                ++vp;
             }
+            Ns[vertex] = cross(S, T);
         }
+    );
 
-        LoopSubdivideResult result;
-        result.positions = std::move(pLimit);
-        result.normals = std::move(Ns);
-        result.indices = std::move(verts);
-        return result;
-    }
-}
-
-static float3 weightOneRing(SDVertex* vert, float beta)
-{
-    // Put vert one-ring in pRing.
-    uint32_t valence = vert->valence();
-    FALCOR_ASSERT(valence < 16);
-    float3 pRing[16];
-
-    vert->oneRing(pRing);
-    float3 p = (1 - valence * beta) * vert->p;
-    for (uint32_t i = 0; i < valence; ++i)
-    {
-        p += beta * pRing[i];
-    }
-    return p;
-}
-
-void SDVertex::oneRing(float3* p_)
-{
-    if (!boundary)
-    {
-        // Get one-ring vertices for interior vertex.
-        SDFace* face = startFace;
-        do
-        {
-            *p_++ = face->nextVert(this)->p;
-            face = face->nextFace(this);
-        } while (face != startFace);
-    }
-    else
-    {
-        // Get one-ring vertices for boundary vertex.
-        SDFace* face = startFace;
-        SDFace* f2;
-        while ((f2 = face->nextFace(this)) != nullptr)
-        {
-            face = f2;
-        }
-        *p_++ = face->nextVert(this)->p;
-        do
-        {
-            *p_++ = face->prevVert(this)->p;
-            face = face->prevFace(this);
-        } while (face != nullptr);
-    }
-}
-
-static float3 weightBoundary(SDVertex* vert, float beta)
-{
-    // Put vert one-ring in pRing.
-    uint32_t valence = vert->valence();
-    FALCOR_ASSERT(valence < 16);
-    float3 pRing[16];
-
-    vert->oneRing(pRing);
-    float3 p = (1 - 2 * beta) * vert->p;
-    p += beta * pRing[0];
-    p += beta * pRing[valence - 1];
-    return p;
+    LoopSubdivideResult result;
+    result.positions = std::move(mesh.positions);
+    result.normals = std::move(Ns);
+    result.indices = std::move(mesh.indices);
+    return result;
 }
 
 } // namespace Falcor::pbrt
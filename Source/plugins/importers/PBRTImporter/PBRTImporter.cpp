@@ -63,6 +63,7 @@
 #include "Builder.h"
 #include "Helpers.h"
 #include "LoopSubdivide.h"
+#include "PlyReader.h"
 #include "EnvMapConverter.h"
 #include "Core/Error.h"
 #include "Core/API/Device.h"
@@ -87,6 +88,7 @@
 #include <pybind11/pybind11.h>
 
 #include <unordered_map>
+#include <execution>
 
 namespace Falcor
 {
@@ -201,6 +203,16 @@ struct CurveAggregate
     std::vector<float> widths;     ///< Concatenated list of widths of all strands.
 };
 
+/**
+ * PLY mesh loaded ahead of createShape().
+ */
+struct PreloadedPlyMesh
+{
+    Falcor::ref<Falcor::TriangleMesh> pTriangleMesh;
+    std::string error;   ///< Error message if loading failed.
+    size_t useCount = 0; ///< Number of shapes still referencing the mesh.
+};
+
 struct InstanceDefinition
 {
     std::vector<std::pair<MeshID, float4x4>> meshes;  // List of meshID + transform
@@ -226,6 +238,8 @@ struct BuilderContext
 
     std::map<std::string, InstanceDefinition> instanceDefinitions;
 
+    std::map<std::filesystem::path, PreloadedPlyMesh> plyMeshes;
+
     size_t curveCount = 0;
 
     bool usePBRTMaterials = false;
@@ -1593,9 +1607,40 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
         auto filename = params.getString("filename", "");
         auto path = ctx.resolver(filename);
 
-        shape.pTriangleMesh = Falcor::TriangleMesh::createFromFile(path.string());
-        if (shape.pTriangleMesh)
+        auto it = ctx.plyMeshes.find(path);
+        if (it == ctx.plyMeshes.end())
+        {
+            it = ctx.plyMeshes.emplace(path, PreloadedPlyMesh{}).first;
+            it->second.useCount = 1;
+            try
+            {
+                it->second.pTriangleMesh = readPlyMesh(path);
+            }
+            catch (const std::exception& e)
+            {
+                it->second.error = e.what();
+            }
+        }
+
+        // Take over the mesh on its last use, shapes may modify it (e.g. reverse orientation).
+        PreloadedPlyMesh& plyMesh = it->second;
+        if (plyMesh.pTriangleMesh)
+        {
+            if (--plyMesh.useCount == 0)
+                shape.pTriangleMesh = std::move(plyMesh.pTriangleMesh);
+            else
+                shape.pTriangleMesh = Falcor::TriangleMesh::create(
+                    plyMesh.pTriangleMesh->getVertices(), plyMesh.pTriangleMesh->getIndices(), plyMesh.pTriangleMesh->getFrontFaceCW()
+                );
             shape.pTriangleMesh->setName(filename);
+        }
+        else
+        {
+            logWarning(entity.loc, "{}", plyMesh.error);
+            --plyMesh.useCount;
+        }
+        if (plyMesh.useCount == 0)
+            ctx.plyMeshes.erase(it);
         shape.transform = entity.transform;
     }
     else if (type == "loopsubdiv")
@@ -1667,6 +1712,46 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
     return shape;
 }
 
+/// Number of shapes whose PLY files are loaded together, limits the number of loaded meshes held in memory.
+const size_t kPlyPreloadBatchSize = 128;
+
+/**
+ * Load the PLY files of a batch of shapes in parallel. The meshes are picked up by createShape().
+ * @param[in] first Index of the first shape in the batch.
+ */
+void preloadPlyMeshes(BuilderContext& ctx, const std::vector<ShapeSceneEntity>& shapes, size_t first)
+{
+    std::vector<std::pair<const std::filesystem::path, PreloadedPlyMesh>*> pending;
+    for (size_t i = first; i < std::min(first + kPlyPreloadBatchSize, shapes.size()); ++i)
+    {
+        const auto& entity = shapes[i];
+        if (entity.name != "plymesh")
+            continue;
+        auto path = ctx.resolver(entity.params.getString("filename", ""));
+        auto [it, inserted] = ctx.plyMeshes.emplace(path, PreloadedPlyMesh{});
+        if (inserted)
+            pending.push_back(&*it);
+        ++it->second.useCount;
+    }
+
+    std::for_each(
+        std::execution::par,
+        pending.begin(),
+        pending.end(),
+        [](auto* pEntry)
+        {
+            try
+            {
+                pEntry->second.pTriangleMesh = readPlyMesh(pEntry->first);
+            }
+            catch (const std::exception& e)
+            {
+                pEntry->second.error = e.what();
+            }
+        }
+    );
+}
+
 /**
  * Create curve geometry from a curve aggregate.
  * This can either result in mesh or curve geometry depending on the tesselation mode.
@@ -1758,8 +1843,12 @@ InstanceDefinition createInstanceDefinition(BuilderContext& ctx, const InstanceD
 {
     InstanceDefinition instanceDefinition;
 
-    for (const auto& shapeEntity : entity.shapes)
+    for (size_t i = 0; i < entity.shapes.size(); ++i)
     {
+        if (i % kPlyPreloadBatchSize == 0)
+            preloadPlyMeshes(ctx, entity.shapes, i);
+        const auto& shapeEntity = entity.shapes[i];
+
         // Process shapes and create meshes.
         auto shape = createShape(ctx, shapeEntity);
         if (shape.pTriangleMesh)
@@ -1843,8 +1932,13 @@ void buildScene(BuilderContext& ctx)
     }
 
     // Process shapes and create meshes.
-    for (const auto& entity : ctx.scene.getShapes())
+    const auto& shapes = ctx.scene.getShapes();
+    for (size_t i = 0; i < shapes.size(); ++i)
     {
+        if (i % kPlyPreloadBatchSize == 0)
+            preloadPlyMeshes(ctx, shapes, i);
+        const auto& entity = shapes[i];
+
         auto shape = createShape(ctx, entity);
         if (shape.pTriangleMesh)
         {
@@ -39,9 +39,15 @@
 
 #include <fast_float/fast_float.h>
 
+#include <BS_thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <utility>
 #include <charconv>
+#include <cstring>
+#include <iterator>
 
 namespace Falcor::pbrt
 {
@@ -58,12 +64,43 @@ std::string Token::toString() const
     return fmt::format("[ Token token: {} loc: {} ]", token, loc.toString());
 }
 
-static char decodeEscaped(int ch, const FileLoc& loc)
+namespace
+{
+/// Size of the chunks the files are split into for tokenizing.
+constexpr size_t kChunkSize = 4 * 1024 * 1024;
+
+/// Parameter lists with fewer tokens are parsed immediately instead of on the thread pool.
+constexpr size_t kMinDeferredParameterTokens = 256;
+
+/// Maximum number of statements waiting to be passed on to the target.
+constexpr size_t kMaxPendingStatements = 1024;
+
+BS::thread_pool& getThreadPool()
+{
+    static BS::thread_pool threadPool;
+    return threadPool;
+}
+
+/// Characters that end a regular token.
+constexpr std::array<bool, 256> kDelimiters = []()
+{
+    std::array<bool, 256> delimiters{};
+    for (unsigned char ch : {' ', '\n', '\t', '\r', '"', '[', ']'})
+        delimiters[ch] = true;
+    return delimiters;
+}();
+
+/// Error thrown while tokenizing a chunk, the line is relative to the start of the chunk.
+struct TokenizerError
+{
+    FileLoc loc;
+    std::string message;
+};
+
+char decodeEscaped(char ch, const FileLoc& loc)
 {
     switch (ch)
     {
-    case EOF:
-        throwError(loc, "Premature EOF after character escape '\\'");
     case 'b':
         return '\b';
     case 'f':
@@ -81,10 +118,10 @@ static char decodeEscaped(int ch, const FileLoc& loc)
     case '\"':
         return '\"';
     default:
-        throwError(loc, "Unexpected escaped character '%c'", ch);
+        throw TokenizerError{loc, fmt::format("Unexpected escaped character '{}'", ch)};
     }
-    return 0;
 }
+} // namespace
 
 std::unique_ptr<Tokenizer> Tokenizer::createFromFile(const std::filesystem::path& path)
 {
@@ -108,13 +145,33 @@ std::unique_ptr<Tokenizer> Tokenizer::createFromString(std::string str)
 Tokenizer::Tokenizer(std::string str, const std::filesystem::path& path) : mPath(path), mContents(std::move(str))
 {
     auto pFilename = std::make_unique<std::string>(path.string());
-    mLoc = FileLoc(*pFilename);
+    mFilename = *pFilename;
     getFilenames().push_back(std::move(pFilename));
 
-    mPos = mContents.data();
-    mEnd = mPos + mContents.size();
     if (isUTF16(mContents.data(), mContents.size()))
         throwError("File is encoded with UTF-16, which is not currently supported.");
+
+    // Split the contents into chunks that end after a line break.
+    const char* begin = mContents.data();
+    const char* end = begin + mContents.size();
+    while (begin < end)
+    {
+        const char* split = begin + std::min<size_t>(kChunkSize, end - begin);
+        if (split < end)
+        {
+            const void* lineBreak = std::memchr(split, '\n', end - split);
+            split = lineBreak ? static_cast<const char*>(lineBreak) + 1 : end;
+        }
+        mChunkTexts.emplace_back(begin, size_t(split - begin));
+        begin = split;
+    }
+}
+
+Tokenizer::~Tokenizer()
+{
+    // Chunks in flight reference the contents.
+    for (auto& chunk : mPendingChunks)
+        chunk.wait();
 }
 
 bool Tokenizer::isUTF16(const void* ptr, size_t len) const
@@ -124,102 +181,155 @@ bool Tokenizer::isUTF16(const void* ptr, size_t len) const
     return (len >= 2 && ((c[0] == 0xfe && c[1] == 0xff) || (c[0] == 0xff && c[1] == 0xfe)));
 }
 
-std::optional<Token> Tokenizer::next()
+Tokenizer::Chunk Tokenizer::tokenizeChunk(std::string_view text)
 {
-    while (true)
+    Chunk chunk;
+    chunk.text = text;
+    chunk.tokens.reserve(text.size() / 4);
+
+    const char* begin = text.data();
+    const char* pos = begin;
+    const char* end = begin + text.size();
+    const char* lineStart = pos;
+    uint32_t line = 0;
+
+    auto addToken = [&](const char* tokenStart, const char* tokenEnd)
     {
-        const char* tokenStart = mPos;
-        FileLoc startLoc = mLoc;
+        chunk.tokens.push_back({uint32_t(tokenStart - begin), uint32_t(tokenEnd - tokenStart), line, uint32_t(tokenStart - lineStart)});
+    };
 
-        int ch = getChar();
-        if (ch == EOF)
-        {
-            return {};
-        }
-        else if (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r')
-        {
-            // Skip.
-        }
-        else if (ch == '"')
+    try
+    {
+        while (pos < end)
         {
-            // Scan to closing quote.
-            bool haveEscaped = false;
-            while ((ch = getChar()) != '"')
+            const char* tokenStart = pos;
+            const char ch = *pos;
+
+            if (ch == '\n')
+            {
+                ++line;
+                lineStart = ++pos;
+            }
+            else if (ch == ' ' || ch == '\t' || ch == '\r')
+            {
+                ++pos;
+            }
+            else if (ch == '"')
             {
-                if (ch == EOF)
+                // Scan to closing quote. Strings can not span lines.
+                FileLoc startLoc;
+                startLoc.line = line;
+                startLoc.column = uint32_t(tokenStart - lineStart);
+                bool haveEscaped = false;
+                for (++pos;; ++pos)
                 {
-                    throwError(startLoc, "Premature EOF.");
+                    if (pos == end)
+                        throw TokenizerError{startLoc, "Premature EOF."};
+                    if (*pos == '"')
+                        break;
+                    if (*pos == '\n')
+                        throw TokenizerError{startLoc, "Unterminated string."};
+                    if (*pos == '\\')
+                    {
+                        haveEscaped = true;
+                        // Skip the next character.
+                        if (++pos == end)
+                            throw TokenizerError{startLoc, "Premature EOF."};
+                        if (*pos == '\n')
+                            throw TokenizerError{startLoc, "Unterminated string."};
+                    }
                 }
-                else if (ch == '\n')
+                ++pos;
+
+                if (!haveEscaped)
                 {
-                    throwError(startLoc, "Unterminated string.");
+                    addToken(tokenStart, pos);
                 }
-                else if (ch == '\\')
+                else
                 {
-                    haveEscaped = true;
-                    // Grab the next character.
-                    if ((ch = getChar()) == EOF)
+                    auto pEscaped = std::make_unique<std::string>();
+                    for (const char* p = tokenStart; p < pos; ++p)
                     {
-                        throwError(startLoc, "Premature EOF.");
+                        if (*p != '\\')
+                            pEscaped->push_back(*p);
+                        else
+                            pEscaped->push_back(decodeEscaped(*++p, startLoc));
                     }
+                    chunk.tokens.push_back({uint32_t(chunk.escaped.size()), ChunkToken::kEscaped, startLoc.line, startLoc.column});
+                    chunk.escaped.push_back(std::move(pEscaped));
                 }
             }
-
-            if (!haveEscaped)
+            else if (ch == '[' || ch == ']')
             {
-                return Token({tokenStart, size_t(mPos - tokenStart)}, startLoc);
+                addToken(tokenStart, ++pos);
             }
-            else
+            else if (ch == '#')
             {
-                mEscaped.clear();
-                for (const char* p = tokenStart; p < mPos; ++p)
-                {
-                    if (*p != '\\')
-                    {
-                        mEscaped.push_back(*p);
-                    }
-                    else
-                    {
-                        ++p;
-                        FALCOR_ASSERT(p < mPos);
-                        mEscaped.push_back(decodeEscaped(*p, startLoc));
-                    }
-                }
-                return Token({mEscaped.data(), mEscaped.size()}, startLoc);
+                // Comment: skip to EOL (or EOF).
+                while (pos < end && *pos != '\n' && *pos != '\r')
+                    ++pos;
             }
-        }
-        else if (ch == '[' || ch == ']')
-        {
-            return Token({tokenStart, size_t(1)}, startLoc);
-        }
-        else if (ch == '#')
-        {
-            // Comment: scan to EOL (or EOF).
-            while ((ch = getChar()) != EOF)
+            else
             {
-                if (ch == '\n' || ch == '\r')
-                {
-                    ungetChar();
-                    break;
-                }
+                // Regular statement or numeric token. Scan until we hit a space, opening quote, or bracket.
+                ++pos;
+                while (pos < end && !kDelimiters[static_cast<unsigned char>(*pos)])
+                    ++pos;
+                addToken(tokenStart, pos);
             }
-
-            return Token({tokenStart, size_t(mPos - tokenStart)}, startLoc);
         }
-        else
+    }
+    catch (TokenizerError& e)
+    {
+        chunk.error = ChunkError{e.loc, std::move(e.message)};
+    }
+
+    chunk.lineCount = line;
+    return chunk;
+}
+
+void Tokenizer::scheduleChunks()
+{
+    const size_t maxPendingChunks = 2 * getThreadPool().get_thread_count();
+    while (mPendingChunks.size() < maxPendingChunks && mNextChunk < mChunkTexts.size())
+    {
+        std::string_view text = mChunkTexts[mNextChunk++];
+        mPendingChunks.push_back(getThreadPool().submit([text]() { return tokenizeChunk(text); }));
+    }
+}
+
+std::optional<Token> Tokenizer::next()
+{
+    while (mTokenIndex == mChunk.tokens.size())
+    {
+        if (mChunk.error)
         {
-            // Regular statement or numeric token. Scan until we hit a space, opening quote, or bracket.
-            while ((ch = getChar()) != EOF)
-            {
-                if (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '"' || ch == '[' || ch == ']')
-                {
-                    ungetChar();
-                    break;
-                }
-            }
-            return Token({tokenStart, size_t(mPos - tokenStart)}, startLoc);
+            FileLoc loc(mFilename);
+            loc.line = mChunkLine + mChunk.error->loc.line;
+            loc.column = mChunk.error->loc.column;
+            throwError(loc, "{}", mChunk.error->message);
         }
+
+        scheduleChunks();
+        if (mPendingChunks.empty())
+            return {};
+
+        // Tokens handed out before may still be referenced, keep their escaped strings alive.
+        std::move(mChunk.escaped.begin(), mChunk.escaped.end(), std::back_inserter(mEscaped));
+        mChunkLine += mChunk.lineCount;
+
+        mChunk = mPendingChunks.front().get();
+        mPendingChunks.pop_front();
+        mTokenIndex = 0;
     }
+
+    const ChunkToken& chunkToken = mChunk.tokens[mTokenIndex++];
+    FileLoc loc(mFilename);
+    loc.line = mChunkLine + chunkToken.line;
+    loc.column = chunkToken.column;
+    if (chunkToken.size == ChunkToken::kEscaped)
+        return Token(*mChunk.escaped[chunkToken.offset], loc);
+    return Token(mChunk.text.substr(chunkToken.offset, chunkToken.size), loc);
 }
 
 static int32_t parseInt(const Token& t)
@@ -448,7 +558,327 @@ static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken)
     return parameterVector;
 }
 
-void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
+/**
+ * Collect the tokens of a parameter list without converting the values.
+ */
+template<typename Next, typename Unget>
+static std::vector<Token> collectParameterTokens(Next nextToken, Unget ungetToken)
+{
+    std::vector<Token> tokens;
+
+    while (true)
+    {
+        auto t = nextToken(TokenOptional);
+        if (!t.has_value())
+            return tokens;
+
+        if (!isQuotedString(t->token))
+        {
+            ungetToken(*t);
+            return tokens;
+        }
+
+        tokens.push_back(*t);
+        Token val = *nextToken(TokenRequired);
+        tokens.push_back(val);
+        if (val.token == "[")
+        {
+            while (val.token != "]")
+            {
+                val = *nextToken(TokenRequired);
+                tokens.push_back(val);
+            }
+        }
+    }
+}
+
+/**
+ * Parse the values of a collected parameter list.
+ */
+static ParsedParameterVector parseParameterTokens(const std::vector<Token>& tokens)
+{
+    size_t pos = 0;
+    auto nextToken = [&](uint32_t flags) -> std::optional<Token>
+    {
+        if (pos < tokens.size())
+            return tokens[pos++];
+        if ((flags & TokenRequired) != 0)
+            throwError("Premature end of file.");
+        return {};
+    };
+    auto ungetToken = [&](const Token&) { --pos; };
+    return parseParameters(nextToken, ungetToken);
+}
+
+/**
+ * Parse the values of a collected parameter list, large lists are parsed on the thread pool.
+ * The tokens reference the contents of the tokenizer, it has to stay alive until the result is available.
+ */
+static std::future<ParsedParameterVector> parseParameterTokensAsync(std::vector<Token> tokens)
+{
+    if (tokens.size() < kMinDeferredParameterTokens)
+    {
+        std::promise<ParsedParameterVector> promise;
+        promise.set_value(parseParameterTokens(tokens));
+        return promise.get_future();
+    }
+    return getThreadPool().submit([tokens = std::move(tokens)]() { return parseParameterTokens(tokens); });
+}
+
+/**
+ * Parser target that queues the statements and passes them on to the final target in file order.
+ * Statements with parameter lists that are still being parsed block the statements after them,
+ * this allows parsing many shapes in parallel while the target only sees a sequential stream.
+ */
+class DeferredParserTarget : public ParserTarget
+{
+public:
+    DeferredParserTarget(ParserTarget& target) : mTarget(target) {}
+
+    ~DeferredParserTarget()
+    {
+        // Parameter lists in flight reference the contents of the tokenizers.
+        for (auto& statement : mStatements)
+        {
+            if (statement.params.valid())
+                statement.params.wait();
+        }
+    }
+
+    /// Pass all queued statements on to the target.
+    void flush() { dispatch(true); }
+
+    void onShape(const std::string& name, std::future<ParsedParameterVector> params, FileLoc loc)
+    {
+        push(std::move(params), [=](ParserTarget& t, ParsedParameterVector p) { t.onShape(name, std::move(p), loc); });
+    }
+
+    void onTexture(
+        const std::string& name,
+        const std::string& type,
+        const std::string& texname,
+        std::future<ParsedParameterVector> params,
+        FileLoc loc
+    )
+    {
+        push(std::move(params), [=](ParserTarget& t, ParsedParameterVector p) { t.onTexture(name, type, texname, std::move(p), loc); });
+    }
+
+    void onScale(Float sx, Float sy, Float sz, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onScale(sx, sy, sz, loc); });
+    }
+    void onShape(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onShape(name, params, loc); });
+    }
+    void onOption(const std::string& name, const std::string& value, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onOption(name, value, loc); });
+    }
+    void onIdentity(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onIdentity(loc); });
+    }
+    void onTranslate(Float dx, Float dy, Float dz, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onTranslate(dx, dy, dz, loc); });
+    }
+    void onRotate(Float angle, Float ax, Float ay, Float az, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onRotate(angle, ax, ay, az, loc); });
+    }
+    void onLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz, Float ux, Float uy, Float uz, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onLookAt(ex, ey, ez, lx, ly, lz, ux, uy, uz, loc); });
+    }
+    void onConcatTransform(Float transform[16], FileLoc loc) override
+    {
+        std::array<Float, 16> m;
+        std::copy(transform, transform + 16, m.begin());
+        push([=](ParserTarget& t) mutable { t.onConcatTransform(m.data(), loc); });
+    }
+    void onTransform(Float transform[16], FileLoc loc) override
+    {
+        std::array<Float, 16> m;
+        std::copy(transform, transform + 16, m.begin());
+        push([=](ParserTarget& t) mutable { t.onTransform(m.data(), loc); });
+    }
+    void onCoordinateSystem(const std::string& name, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onCoordinateSystem(name, loc); });
+    }
+    void onCoordSysTransform(const std::string& name, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onCoordSysTransform(name, loc); });
+    }
+    void onActiveTransformAll(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onActiveTransformAll(loc); });
+    }
+    void onActiveTransformEndTime(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onActiveTransformEndTime(loc); });
+    }
+    void onActiveTransformStartTime(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onActiveTransformStartTime(loc); });
+    }
+    void onTransformTimes(Float start, Float end, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onTransformTimes(start, end, loc); });
+    }
+    void onColorSpace(const std::string& name, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onColorSpace(name, loc); });
+    }
+    void onPixelFilter(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onPixelFilter(name, params, loc); });
+    }
+    void onFilm(const std::string& type, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onFilm(type, params, loc); });
+    }
+    void onAccelerator(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onAccelerator(name, params, loc); });
+    }
+    void onIntegrator(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onIntegrator(name, params, loc); });
+    }
+    void onCamera(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onCamera(name, params, loc); });
+    }
+    void onMakeNamedMedium(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onMakeNamedMedium(name, params, loc); });
+    }
+    void onMediumInterface(const std::string& insideName, const std::string& outsideName, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onMediumInterface(insideName, outsideName, loc); });
+    }
+    void onSampler(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onSampler(name, params, loc); });
+    }
+    void onWorldBegin(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onWorldBegin(loc); });
+    }
+    void onAttributeBegin(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onAttributeBegin(loc); });
+    }
+    void onAttributeEnd(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onAttributeEnd(loc); });
+    }
+    void onAttribute(const std::string& target, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onAttribute(target, params, loc); });
+    }
+    void onTexture(
+        const std::string& name,
+        const std::string& type,
+        const std::string& texname,
+        ParsedParameterVector params,
+        FileLoc loc
+    ) override
+    {
+        push([=](ParserTarget& t) { t.onTexture(name, type, texname, params, loc); });
+    }
+    void onMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onMaterial(name, params, loc); });
+    }
+    void onMakeNamedMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onMakeNamedMaterial(name, params, loc); });
+    }
+    void onNamedMaterial(const std::string& name, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onNamedMaterial(name, loc); });
+    }
+    void onLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onLightSource(name, params, loc); });
+    }
+    void onAreaLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onAreaLightSource(name, params, loc); });
+    }
+    void onReverseOrientation(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onReverseOrientation(loc); });
+    }
+    void onObjectBegin(const std::string& name, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onObjectBegin(name, loc); });
+    }
+    void onObjectEnd(FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onObjectEnd(loc); });
+    }
+    void onObjectInstance(const std::string& name, FileLoc loc) override
+    {
+        push([=](ParserTarget& t) { t.onObjectInstance(name, loc); });
+    }
+    void onEndOfFiles() override
+    {
+        push([=](ParserTarget& t) { t.onEndOfFiles(); });
+    }
+
+private:
+    using Apply = std::function<void(ParserTarget&, ParsedParameterVector)>;
+
+    struct Statement
+    {
+        std::future<ParsedParameterVector> params; ///< Parameter list, invalid for statements without a deferred list.
+        Apply apply;
+    };
+
+    void push(std::function<void(ParserTarget&)> apply)
+    {
+        // Pass the statement on directly if nothing is queued.
+        if (mStatements.empty())
+            return apply(mTarget);
+        mStatements.push_back({{}, [apply = std::move(apply)](ParserTarget& t, ParsedParameterVector) { apply(t); }});
+        dispatch(false);
+    }
+
+    void push(std::future<ParsedParameterVector> params, Apply apply)
+    {
+        mStatements.push_back({std::move(params), std::move(apply)});
+        dispatch(false);
+    }
+
+    /// Pass statements on to the target, in order, until reaching one that is not ready. Blocks if too many are queued.
+    void dispatch(bool all)
+    {
+        while (!mStatements.empty())
+        {
+            Statement& statement = mStatements.front();
+            if (statement.params.valid())
+            {
+                bool wait = all || mStatements.size() > kMaxPendingStatements;
+                if (!wait && statement.params.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    return;
+            }
+            ParsedParameterVector params = statement.params.valid() ? statement.params.get() : ParsedParameterVector();
+            Apply apply = std::move(statement.apply);
+            mStatements.pop_front();
+            apply(mTarget, std::move(params));
+        }
+    }
+
+    ParserTarget& mTarget;
+    std::deque<Statement> mStatements;
+};
+
+void parse(ParserTarget& finalTarget, std::unique_ptr<Tokenizer> tokenizer)
 {
     static std::atomic<bool> warnedTransformBeginEndDeprecated{false};
 
@@ -456,8 +886,42 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
 
     auto searchPath = tokenizer->getPath().parent_path();
 
-    std::vector<std::unique_ptr<Tokenizer>> fileStack;
-    fileStack.push_back(std::move(tokenizer));
+    /// File on the include stack. Included files are loaded on the thread pool.
+    struct InputFile
+    {
+        std::unique_ptr<Tokenizer> tokenizer;
+        std::future<std::unique_ptr<Tokenizer>> pendingTokenizer;
+        std::optional<FileLoc> importLoc; ///< Location of the 'Import' directive for imported files.
+    };
+
+    std::vector<InputFile> fileStack;
+    fileStack.push_back({std::move(tokenizer), {}, {}});
+
+    // Files that reached EOF. They are released between statements as the current one may still reference them.
+    std::vector<InputFile> finishedFiles;
+
+    // Declared after the files as queued statements reference the contents of the tokenizers.
+    DeferredParserTarget target(finalTarget);
+
+    auto releaseFinishedFiles = [&]()
+    {
+        // Imported files are parsed in their own attribute block, see 'Import' below. Their end also ends the statement in
+        // progress, so the block is closed before the importing file continues.
+        for (const auto& file : finishedFiles)
+        {
+            if (file.importLoc)
+                target.onAttributeEnd(*file.importLoc);
+        }
+        // Pass on the statements that still reference the files before releasing them.
+        target.flush();
+        finishedFiles.clear();
+    };
+
+    auto pushFile = [&](const std::filesystem::path& path, std::optional<FileLoc> importLoc)
+    {
+        auto pendingTokenizer = getThreadPool().submit([path]() { return Tokenizer::createFromFile(path); });
+        fileStack.push_back({nullptr, std::move(pendingTokenizer), importLoc});
+    };
 
     std::optional<Token> ungetToken;
 
@@ -478,18 +942,29 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             return {};
         }
 
-        std::optional<Token> tok = fileStack.back()->next();
+        InputFile& file = fileStack.back();
+        if (!file.tokenizer)
+        {
+            file.tokenizer = file.pendingTokenizer.get();
+            logInfo("PBRTImporter: Started parsing '{}'.", file.tokenizer->getPath().string());
+        }
+
+        std::optional<Token> tok = file.tokenizer->next();
 
         if (!tok)
         {
             // We've reached EOF in the current file. Anything more to parse?
-            logInfo("PBRTImporter: Finished parsing '{}'.", fileStack.back()->getPath().string());
+            logInfo("PBRTImporter: Finished parsing '{}'.", file.tokenizer->getPath().string());
+            const bool imported = file.importLoc.has_value();
+            finishedFiles.push_back(std::move(file));
             fileStack.pop_back();
-            return nextToken(flags);
-        }
-        else if (tok->token[0] == '#')
-        {
-            // Swallow comments.
+            // An imported file ends the statement in progress like the end of the scene does.
+            if (imported)
+            {
+                if ((flags & TokenRequired) != 0)
+                    throwError("Premature end of file.");
+                return {};
+            }
             return nextToken(flags);
         }
         else
@@ -530,9 +1005,17 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
 
     while (true)
     {
+        if (!finishedFiles.empty())
+            releaseFinishedFiles();
+
         tok = nextToken(TokenOptional);
         if (!tok.has_value())
-            break;
+        {
+            if (fileStack.empty())
+                break;
+            // End of an imported file.
+            continue;
+        }
 
         switch (tok->token[0])
         {
@@ -632,14 +1115,16 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             {
                 Token filenameToken = *nextToken(TokenRequired);
                 std::string filename = toString(dequoteString(filenameToken));
-                auto path = searchPath / filename;
-                std::unique_ptr<Tokenizer> includeTokenizer = Tokenizer::createFromFile(path);
-                logInfo("PBRTImporter: Started parsing '{}'.", includeTokenizer->getPath().string());
-                fileStack.push_back(std::move(includeTokenizer));
+                pushFile(searchPath / filename, {});
             }
             else if (tok->token == "Import")
             {
-                throwError(tok->loc, "'Import' directive not supported yet.");
+                // Imported files can not change the graphics state of the importing file (as in pbrt-v4).
+                // The file is parsed in an attribute block, its shapes and textures are parsed in parallel like all others.
+                Token filenameToken = *nextToken(TokenRequired);
+                std::string filename = toString(dequoteString(filenameToken));
+                target.onAttributeBegin(tok->loc);
+                pushFile(searchPath / filename, tok->loc);
             }
             else if (tok->token == "Identity")
             {
@@ -782,7 +1267,10 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         case 'S':
             if (tok->token == "Shape")
             {
-                basicParamListEntrypoint(&ParserTarget::onShape, tok->loc);
+                Token t = *nextToken(TokenRequired);
+                std::string name = toString(dequoteString(t));
+                std::vector<Token> paramTokens = collectParameterTokens(nextToken, unget);
+                target.onShape(name, parseParameterTokensAsync(std::move(paramTokens)), tok->loc);
             }
             else if (tok->token == "Sampler")
             {
@@ -850,8 +1338,8 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 Token t = *nextToken(TokenRequired);
                 std::string_view dequoted = dequoteString(t);
                 std::string texName = toString(dequoted);
-                ParsedParameterVector params = parseParameters(nextToken, unget);
-                target.onTexture(name, type, texName, std::move(params), tok->loc);
+                std::vector<Token> paramTokens = collectParameterTokens(nextToken, unget);
+                target.onTexture(name, type, texName, parseParameterTokensAsync(std::move(paramTokens)), tok->loc);
             }
             else
             {
@@ -874,6 +1362,8 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             syntaxError(*tok);
         }
     }
+
+    releaseFinishedFiles();
 }
 
 void parseFile(ParserTarget& target, const std::filesystem::path& path)
@@ -35,11 +35,15 @@
 
 #include "Types.h"
 #include "Parameters.h"
+#include <deque>
 #include <functional>
 #include <filesystem>
+#include <future>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace Falcor::pbrt
 {
@@ -113,23 +117,57 @@ struct Token
     FileLoc loc;
 };
 
+/**
+ * Splits a file into tokens.
+ * The file is split into chunks at line boundaries (strings and comments can not span lines), the chunks are tokenized
+ * in parallel ahead of the consumer.
+ */
 class Tokenizer
 {
 public:
     Tokenizer(std::string str, const std::filesystem::path& path);
+    ~Tokenizer();
 
     static std::unique_ptr<Tokenizer> createFromFile(const std::filesystem::path& path);
     static std::unique_ptr<Tokenizer> createFromString(std::string str);
 
     /**
-     * Get the next token.
-     * Note: The Token::token field is only valid until the next call to next().
+     * Get the next token. Comments are skipped.
+     * Note: The Token::token field is valid as long as the tokenizer is alive.
      */
     std::optional<Token> next();
 
     const std::filesystem::path& getPath() const { return mPath; }
 
 private:
+    /// Error found while tokenizing a chunk, reported once the tokens before it are consumed. The line is relative to the chunk.
+    struct ChunkError
+    {
+        FileLoc loc;
+        std::string message;
+    };
+
+    /// Token of a chunk, kept compact as large files have billions of tokens.
+    struct ChunkToken
+    {
+        static constexpr uint32_t kEscaped = 0xffffffff;
+
+        uint32_t offset; ///< Offset from the start of the chunk, or index of the escaped string if size is kEscaped.
+        uint32_t size;
+        uint32_t line; ///< Line relative to the start of the chunk (starting at 0).
+        uint32_t column;
+    };
+
+    /// Tokens of a chunk.
+    struct Chunk
+    {
+        std::string_view text;
+        std::vector<ChunkToken> tokens;
+        std::vector<std::unique_ptr<std::string>> escaped; ///< Storage of escaped tokens.
+        uint32_t lineCount = 0;                            ///< Number of line breaks in the chunk.
+        std::optional<ChunkError> error;
+    };
+
     /**
      * Static list of filenames to allow file locations (FileLoc::filename) to be valid
      * even after the tokenizer is destroyed.
@@ -142,42 +180,24 @@ private:
 
     bool isUTF16(const void* ptr, size_t len) const;
 
-    int getChar()
-    {
-        if (mPos == mEnd)
-            return EOF;
-        int ch = *mPos++;
-        if (ch == '\n')
-        {
-            ++mLoc.line;
-            mLoc.column = 0;
-        }
-        else
-        {
-            ++mLoc.column;
-        }
-        return ch;
-    }
+    static Chunk tokenizeChunk(std::string_view text);
 
-    void ungetChar()
-    {
-        --mPos;
-        if (*mPos == '\n')
-        {
-            // Don't worry about the column; we'll be going to the start of
-            // the next line again shortly...
-            --mLoc.line;
-        }
-    }
+    /// Start tokenizing chunks until enough are in flight.
+    void scheduleChunks();
 
     std::filesystem::path mPath; ///< File path we're reading from.
-    FileLoc mLoc;                ///< File location.
+    std::string_view mFilename;  ///< File name used in file locations.
     std::string mContents;       ///< File contents we're parsing.
 
-    const char* mPos; ///< Current position in the file.
-    const char* mEnd; ///< End of the file (one past).
+    std::vector<std::string_view> mChunkTexts; ///< Chunks of the file contents, each starts at the beginning of a line.
+    size_t mNextChunk = 0;                     ///< Next chunk to schedule.
+    std::deque<std::future<Chunk>> mPendingChunks;
+
+    Chunk mChunk;            ///< Chunk we're reading tokens from.
+    size_t mTokenIndex = 0;  ///< Next token in the current chunk.
+    uint32_t mChunkLine = 1; ///< Line number of the first line of the current chunk.
 
-    std::string mEscaped; ///< Temporary storage for escaped tokens.
+    std::vector<std::unique_ptr<std::string>> mEscaped; ///< Escaped tokens of consumed chunks.
 };
 
 } // namespace Falcor::pbrt
@@ -0,0 +1,594 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PlyReader.h"
+#include "Core/Error.h"
+#include "Core/Platform/OS.h"
+#include "Core/Platform/MemoryMappedFile.h"
+
+#include <fast_float/fast_float.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Falcor::pbrt
+{
+
+namespace
+{
+enum class PlyFormat
+{
+    Ascii,
+    BinaryLittleEndian,
+    BinaryBigEndian,
+};
+
+enum class PlyType
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64,
+};
+
+std::optional<PlyType> parseType(std::string_view name)
+{
+    if (name == "char" || name == "int8")
+        return PlyType::Int8;
+    if (name == "uchar" || name == "uint8")
+        return PlyType::UInt8;
+    if (name == "short" || name == "int16")
+        return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")
+        return PlyType::UInt16;
+    if (name == "int" || name == "int32")
+        return PlyType::Int32;
+    if (name == "uint" || name == "uint32")
+        return PlyType::UInt32;
+    if (name == "float" || name == "float32")
+        return PlyType::Float32;
+    if (name == "double" || name == "float64")
+        return PlyType::Float64;
+    return {};
+}
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type = PlyType::Float32;
+    bool isList = false;
+    PlyType countType = PlyType::UInt8; ///< Type of the element count for list properties.
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+struct PlyHeader
+{
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    size_t size = 0; ///< Size of the header in bytes.
+};
+
+std::vector<std::string_view> splitWords(std::string_view line)
+{
+    std::vector<std::string_view> words;
+    size_t pos = 0;
+    while (true)
+    {
+        pos = line.find_first_not_of(" \t", pos);
+        if (pos == std::string_view::npos)
+            return words;
+        size_t end = std::min(line.find_first_of(" \t", pos), line.size());
+        words.push_back(line.substr(pos, end - pos));
+        pos = end;
+    }
+}
+
+PlyHeader parseHeader(std::string_view data)
+{
+    PlyHeader header;
+    size_t pos = 0;
+    auto nextLine = [&]() -> std::optional<std::string_view>
+    {
+        if (pos >= data.size())
+            return {};
+        size_t end = std::min(data.find('\n', pos), data.size());
+        std::string_view line = data.substr(pos, end - pos);
+        pos = std::min(end + 1, data.size());
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        return line;
+    };
+
+    auto parseTypeOrThrow = [](std::string_view name)
+    {
+        auto type = parseType(name);
+        if (!type)
+            FALCOR_THROW("Unknown property type '{}'.", name);
+        return *type;
+    };
+
+    auto firstLine = nextLine();
+    if (!firstLine || *firstLine != "ply")
+        FALCOR_THROW("Not a PLY file.");
+
+    bool hasFormat = false;
+    while (true)
+    {
+        auto line = nextLine();
+        if (!line)
+            FALCOR_THROW("Missing 'end_header'.");
+
+        auto words = splitWords(*line);
+        if (words.empty())
+            continue;
+
+        if (words[0] == "end_header")
+        {
+            break;
+        }
+        else if (words[0] == "format")
+        {
+            if (words.size() < 2)
+                FALCOR_THROW("Invalid format '{}'.", *line);
+            if (words[1] == "ascii")
+                header.format = PlyFormat::Ascii;
+            else if (words[1] == "binary_little_endian")
+                header.format = PlyFormat::BinaryLittleEndian;
+            else if (words[1] == "binary_big_endian")
+                header.format = PlyFormat::BinaryBigEndian;
+            else
+                FALCOR_THROW("Unknown format '{}'.", words[1]);
+            hasFormat = true;
+        }
+        else if (words[0] == "element")
+        {
+            PlyElement element;
+            if (words.size() != 3 || std::from_chars(words[2].data(), words[2].data() + words[2].size(), element.count).ec != std::errc())
+                FALCOR_THROW("Invalid element '{}'.", *line);
+            element.name = words[1];
+            header.elements.push_back(std::move(element));
+        }
+        else if (words[0] == "property")
+        {
+            if (header.elements.empty())
+                FALCOR_THROW("Property '{}' outside of an element.", *line);
+            PlyProperty property;
+            if (words.size() == 5 && words[1] == "list")
+            {
+                property.isList = true;
+                property.countType = parseTypeOrThrow(words[2]);
+                property.type = parseTypeOrThrow(words[3]);
+                property.name = words[4];
+            }
+            else if (words.size() == 3)
+            {
+                property.type = parseTypeOrThrow(words[1]);
+                property.name = words[2];
+            }
+            else
+            {
+                FALCOR_THROW("Invalid property '{}'.", *line);
+            }
+            header.elements.back().properties.push_back(std::move(property));
+        }
+        else if (words[0] != "comment" && words[0] != "obj_info")
+        {
+            FALCOR_THROW("Unknown header keyword '{}'.", words[0]);
+        }
+    }
+
+    if (!hasFormat)
+        FALCOR_THROW("Missing format.");
+
+    header.size = pos;
+    return header;
+}
+
+/// Reads values from the binary body of a PLY file.
+class BinaryReader
+{
+public:
+    BinaryReader(std::string_view data, bool swapBytes) : mPos(data.data()), mEnd(data.data() + data.size()), mSwapBytes(swapBytes) {}
+
+    template<typename T>
+    T read(PlyType type)
+    {
+        switch (type)
+        {
+        case PlyType::Int8:
+            return static_cast<T>(readRaw<int8_t>());
+        case PlyType::UInt8:
+            return static_cast<T>(readRaw<uint8_t>());
+        case PlyType::Int16:
+            return static_cast<T>(readRaw<int16_t>());
+        case PlyType::UInt16:
+            return static_cast<T>(readRaw<uint16_t>());
+        case PlyType::Int32:
+            return static_cast<T>(readRaw<int32_t>());
+        case PlyType::UInt32:
+            return static_cast<T>(readRaw<uint32_t>());
+        case PlyType::Float32:
+            return static_cast<T>(readRaw<float>());
+        case PlyType::Float64:
+            return static_cast<T>(readRaw<double>());
+        }
+        FALCOR_UNREACHABLE();
+    }
+
+    void skip(PlyType type)
+    {
+        static constexpr size_t kSizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+        size_t size = kSizes[static_cast<size_t>(type)];
+        if (size > size_t(mEnd - mPos))
+            FALCOR_THROW("Unexpected end of file.");
+        mPos += size;
+    }
+
+    size_t getRemainingSize() const { return size_t(mEnd - mPos); }
+
+private:
+    template<typename T>
+    T readRaw()
+    {
+        if (sizeof(T) > size_t(mEnd - mPos))
+            FALCOR_THROW("Unexpected end of file.");
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, mPos, sizeof(T));
+        mPos += sizeof(T);
+        if (mSwapBytes)
+            std::reverse(bytes, bytes + sizeof(T));
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    const char* mPos;
+    const char* mEnd;
+    bool mSwapBytes;
+};
+
+/// Reads values from the ASCII body of a PLY file.
+class AsciiReader
+{
+public:
+    AsciiReader(std::string_view data) : mPos(data.data()), mEnd(data.data() + data.size()) {}
+
+    template<typename T>
+    T read(PlyType type)
+    {
+        std::string_view word = nextWord();
+        if (type == PlyType::Float32 || type == PlyType::Float64)
+        {
+            double value;
+            auto result = fast_float::from_chars(word.data(), word.data() + word.size(), value);
+            if (result.ptr != word.data() + word.size())
+                FALCOR_THROW("'{}': Expected a number.", word);
+            return static_cast<T>(value);
+        }
+        else
+        {
+            int64_t value;
+            auto result = std::from_chars(word.data(), word.data() + word.size(), value);
+            if (result.ptr != word.data() + word.size())
+                FALCOR_THROW("'{}': Expected an integer.", word);
+            return static_cast<T>(value);
+        }
+    }
+
+    void skip(PlyType) { nextWord(); }
+
+    size_t getRemainingSize() const { return size_t(mEnd - mPos); }
+
+private:
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    std::string_view nextWord()
+    {
+        while (mPos < mEnd && isSpace(*mPos))
+            ++mPos;
+        if (mPos == mEnd)
+            FALCOR_THROW("Unexpected end of file.");
+        const char* begin = mPos;
+        while (mPos < mEnd && !isSpace(*mPos))
+            ++mPos;
+        return std::string_view(begin, size_t(mPos - begin));
+    }
+
+    const char* mPos;
+    const char* mEnd;
+};
+
+/// Read the element count of a list property. Every value takes at least a byte, so larger counts are truncated files.
+template<typename Reader>
+size_t readListCount(Reader& reader, const PlyProperty& property)
+{
+    int64_t count = reader.template read<int64_t>(property.countType);
+    if (count < 0)
+        FALCOR_THROW("Negative list count {}.", count);
+    if (uint64_t(count) > reader.getRemainingSize())
+        FALCOR_THROW("Unexpected end of file.");
+    return size_t(count);
+}
+
+template<typename Reader>
+void skipProperty(Reader& reader, const PlyProperty& property)
+{
+    if (property.isList)
+    {
+        size_t count = readListCount(reader, property);
+        for (size_t i = 0; i < count; ++i)
+            reader.skip(property.type);
+    }
+    else
+    {
+        reader.skip(property.type);
+    }
+}
+
+/// Vertex attributes read from the vertex element.
+enum VertexSlot
+{
+    PositionX,
+    PositionY,
+    PositionZ,
+    NormalX,
+    NormalY,
+    NormalZ,
+    TexCoordU,
+    TexCoordV,
+    VertexSlotCount,
+    NoSlot = VertexSlotCount,
+};
+
+VertexSlot getVertexSlot(std::string_view name)
+{
+    if (name == "x")
+        return PositionX;
+    if (name == "y")
+        return PositionY;
+    if (name == "z")
+        return PositionZ;
+    if (name == "nx")
+        return NormalX;
+    if (name == "ny")
+        return NormalY;
+    if (name == "nz")
+        return NormalZ;
+    if (name == "u" || name == "s" || name == "texture_u" || name == "texture_s")
+        return TexCoordU;
+    if (name == "v" || name == "t" || name == "texture_v" || name == "texture_t")
+        return TexCoordV;
+    return NoSlot;
+}
+
+struct PlyMesh
+{
+    TriangleMesh::VertexList vertices;
+    TriangleMesh::IndexList indices;
+    bool hasNormals = false;
+};
+
+template<typename Reader>
+void readVertices(Reader& reader, const PlyElement& element, PlyMesh& mesh)
+{
+    std::vector<VertexSlot> slots;
+    bool hasSlot[VertexSlotCount] = {};
+    for (const auto& property : element.properties)
+    {
+        VertexSlot slot = property.isList ? NoSlot : getVertexSlot(property.name);
+        slots.push_back(slot);
+        if (slot != NoSlot)
+            hasSlot[slot] = true;
+    }
+
+    if (!hasSlot[PositionX] || !hasSlot[PositionY] || !hasSlot[PositionZ])
+        FALCOR_THROW("Vertex positions missing.");
+    mesh.hasNormals = hasSlot[NormalX] && hasSlot[NormalY] && hasSlot[NormalZ];
+    bool hasTexCoords = hasSlot[TexCoordU] && hasSlot[TexCoordV];
+
+    mesh.vertices.resize(element.count);
+    for (auto& vertex : mesh.vertices)
+    {
+        float values[VertexSlotCount + 1] = {};
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            const auto& property = element.properties[i];
+            if (property.isList)
+                skipProperty(reader, property);
+            else
+                values[slots[i]] = reader.template read<float>(property.type);
+        }
+
+        vertex.position = float3(values[PositionX], values[PositionY], values[PositionZ]);
+        vertex.normal = mesh.hasNormals ? float3(values[NormalX], values[NormalY], values[NormalZ]) : float3(0.f);
+        vertex.texCoord = hasTexCoords ? float2(values[TexCoordU], 1.f - values[TexCoordV]) : float2(0.f);
+    }
+}
+
+template<typename Reader>
+void readFaces(Reader& reader, const PlyElement& element, PlyMesh& mesh)
+{
+    auto it = std::find_if(
+        element.properties.begin(),
+        element.properties.end(),
+        [](const PlyProperty& property) { return property.isList && (property.name == "vertex_indices" || property.name == "vertex_index"); }
+    );
+    if (it == element.properties.end())
+        FALCOR_THROW("Face vertex indices missing.");
+    const size_t indicesProperty = std::distance(element.properties.begin(), it);
+
+    // Most files only have triangles and quads.
+    mesh.indices.reserve(mesh.indices.size() + element.count * 3);
+
+    std::vector<uint32_t> polygon;
+    for (size_t face = 0; face < element.count; ++face)
+    {
+        for (size_t i = 0; i < element.properties.size(); ++i)
+        {
+            const auto& property = element.properties[i];
+            if (i != indicesProperty)
+            {
+                skipProperty(reader, property);
+                continue;
+            }
+
+            polygon.resize(readListCount(reader, property));
+            for (auto& index : polygon)
+                index = reader.template read<uint32_t>(property.type);
+
+            // Split into a triangle fan, faces with less than three vertices are dropped.
+            for (size_t j = 2; j < polygon.size(); ++j)
+            {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[j - 1]);
+                mesh.indices.push_back(polygon[j]);
+            }
+        }
+    }
+}
+
+template<typename Reader>
+PlyMesh readBody(Reader& reader, const PlyHeader& header)
+{
+    PlyMesh mesh;
+    bool hasVertices = false;
+    for (const auto& element : header.elements)
+    {
+        if (element.name == "vertex")
+        {
+            readVertices(reader, element, mesh);
+            hasVertices = true;
+        }
+        else if (element.name == "face")
+        {
+            readFaces(reader, element, mesh);
+        }
+        else
+        {
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                for (const auto& property : element.properties)
+                    skipProperty(reader, property);
+            }
+        }
+    }
+    if (!hasVertices)
+        FALCOR_THROW("Vertex element missing.");
+    return mesh;
+}
+
+/// Unshare the vertices and assign face normals.
+void generateFaceNormals(PlyMesh& mesh)
+{
+    TriangleMesh::VertexList vertices(mesh.indices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        for (size_t j = 0; j < 3; ++j)
+            vertices[i + j] = mesh.vertices[mesh.indices[i + j]];
+
+        float3 normal = cross(vertices[i + 1].position - vertices[i].position, vertices[i + 2].position - vertices[i].position);
+        float len = length(normal);
+        normal = len > 0.f ? normal / len : float3(0.f, 0.f, 1.f);
+        for (size_t j = 0; j < 3; ++j)
+            vertices[i + j].normal = normal;
+    }
+    mesh.vertices = std::move(vertices);
+    for (size_t i = 0; i < mesh.indices.size(); ++i)
+        mesh.indices[i] = uint32_t(i);
+}
+} // namespace
+
+ref<TriangleMesh> readPlyMesh(const std::filesystem::path& path)
+{
+    try
+    {
+        std::string decompressed;
+        MemoryMappedFile file;
+        std::string_view data;
+        if (hasExtension(path, "gz"))
+        {
+            decompressed = decompressFile(path);
+            data = decompressed;
+        }
+        else
+        {
+            if (!file.open(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan))
+                FALCOR_THROW("File not found.");
+            data = std::string_view(static_cast<const char*>(file.getData()), file.getSize());
+        }
+
+        PlyHeader header = parseHeader(data);
+        std::string_view body = data.substr(header.size);
+
+        PlyMesh mesh;
+        if (header.format == PlyFormat::Ascii)
+        {
+            AsciiReader reader(body);
+            mesh = readBody(reader, header);
+        }
+        else
+        {
+            // Byte order of the host.
+            const uint16_t one = 1;
+            const bool isLittleEndian = *reinterpret_cast<const uint8_t*>(&one) == 1;
+            BinaryReader reader(body, (header.format == PlyFormat::BinaryLittleEndian) != isLittleEndian);
+            mesh = readBody(reader, header);
+        }
+
+        for (uint32_t index : mesh.indices)
+        {
+            if (index >= mesh.vertices.size())
+                FALCOR_THROW("Vertex index {} is out of bounds.", index);
+        }
+
+        if (!mesh.hasNormals)
+            generateFaceNormals(mesh);
+
+        return TriangleMesh::create(std::move(mesh.vertices), std::move(mesh.indices));
+    }
+    catch (const std::exception& e)
+    {
+        FALCOR_THROW("Failed to read PLY file '{}': {}", path.string(), e.what());
+    }
+}
+
+} // namespace Falcor::pbrt